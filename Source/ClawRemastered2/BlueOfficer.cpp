@@ -2,6 +2,7 @@
 
 
 #include "BlueOfficer.h"
+#include "ClawTileMovementComponent.h"
 #include "PaperFlipbookComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -9,11 +10,17 @@
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
 #include "BlueOfficerBullet.h"
-#include "Kismet/GameplayStatics.h"
+#include "ClawProjectilePool.h"
+#include "ClawProjectileSystem.h"
+#include "ClawSoundPool.h"
+#include "ClawDamageSystem.h"
 #include "Engine/Engine.h"
+#include "Net/UnrealNetwork.h"
+#include "ClawStats.h"
 
 
-ABlueOfficer::ABlueOfficer()
+ABlueOfficer::ABlueOfficer(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UClawTileMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Use only Yaw from the controller and ignore the rest of the rotation.
 	bUseControllerRotationPitch = false;
@@ -39,9 +46,11 @@ ABlueOfficer::ABlueOfficer()
 	// behavior on the edge of a ledge versus inclines by setting this to true or false
 	GetCharacterMovement()->bUseFlatBaseForFloorChecks = true;
 
-	// Enable replication on the Sprite component so animations show up when networked
-	GetSprite()->SetIsReplicated(true);
+	// the enemy manager replicates the position, animation and facing as one small state,
+	// so neither the movement nor the flipbook component is sent
 	bReplicates = true;
+	SetReplicatingMovement(false);
+	NetUpdateFrequency = 10.0f;
 
 	//UE_LOG(LogTemp, Warning, TEXT("swording"));
 
@@ -61,44 +70,9 @@ ABlueOfficer::ABlueOfficer()
 	GunBashCollisionBox->SetBoxExtent(FVector(10.0f, 10.0f, 10.0f));
 	GunBashCollisionBox->SetCollisionProfileName("Trigger");
 	GunBashCollisionBox->SetupAttachment(RootComponent); 
-}
-
-void ABlueOfficer::UpdateAnimation()
-{
-	const FVector PlayerVelocity = GetVelocity();
-	const float PlayerSpeedSqr = PlayerVelocity.SizeSquared();
 
-	UPaperFlipbook* DesiredAnimation;
-
-	if (isDead) {
-		DesiredAnimation = DeadAnimation;
-	}
-	else if (isHurt) {
-		DesiredAnimation = HurtAnimation;
-	}
-	else if (isFiringGun) {
-		if (isCrouching)
-		{
-			DesiredAnimation = CrouchingGunAttackAnimation;
-		} 
-		else
-		{
-			DesiredAnimation = GunAttackAnimation;
-		}
-	}
-	else if (isBashingGun) {
-		DesiredAnimation = GunBashAnimation;
-	}
-	else {
-		// else render running or idle animation
-		DesiredAnimation = (PlayerSpeedSqr > 0.0f) ? WalkingAnimation : IdleAnimation;
-	}
-
-	// Are we moving or standing still?
-	if (GetSprite()->GetFlipbook() != DesiredAnimation)
-	{
-		GetSprite()->SetFlipbook(DesiredAnimation);
-	}
+	GunBashCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &ABlueOfficer::OnOverlapBeginGunBashCollisionBox);
+	GunBashCollisionBox->OnComponentEndOverlap.AddDynamic(this, &ABlueOfficer::OnOverlapEndGunBashCollisionBox);
 }
 
 void ABlueOfficer::BeginPlay()
@@ -108,116 +82,85 @@ void ABlueOfficer::BeginPlay()
 
 	//UE_LOG(LogTemp, Warning, TEXT("beginplay"));
 
-	SetActorRotation(FRotator(0.0f, 180.0f, 0.0f));
-	StartMoving();
-}
-
-void ABlueOfficer::Tick(float DeltaSeconds)
-{
-	Super::Tick(DeltaSeconds); 
-
-	// the movementDirection will routinly be changed from 1 to -1
-	// so the enemy will always be moving either to left or to right
-	if (!isDead)
+	FClawEnemyFlipbooks Flipbooks;
+	Flipbooks.ByState[(int32)EClawEnemyState::Walking] = WalkingAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Idling] = IdleAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Attacking] = GunAttackAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::CrouchAttacking] = CrouchingGunAttackAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Bashing] = GunBashAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Hurt] = HurtAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Dead] = DeadAnimation;
+	Flipbooks.bIdleWhenStill = true;
+
+	EnemyManager = GetWorld()->GetSubsystem<UClawEnemyManager>();
+	FClawEnemySenses Senses;
+	Senses.Sight = GunFireCollisionBox;
+	Senses.Reach = GunBashCollisionBox;
+
+	BrainHandle = EnemyManager->RegisterEnemy(this, EClawEnemyKind::BlueOfficer, OfficerHealth, Flipbooks, Senses,
+		Behaviour ? Behaviour : EnemyManager->GetDefaultBehaviour(EClawEnemyKind::BlueOfficer));
+
+	// the enemy manager updates all brains in one pass unless batching is turned off
+	SetActorTickEnabled(!EnemyManager->IsBatched());
+
+	// the officers share their bullets, a few are enough to start a firefight without spawning
+	ProjectileSystem = GetWorld()->GetSubsystem<UClawProjectileSystem>();
+	ProjectilePool = GetWorld()->GetSubsystem<UClawProjectilePool>();
+	if (!ProjectileSystem->IsSimulating())
 	{
-		if (isWalking)
-		{
-			AddMovementInput(FVector(movementDirection, 0.0f, 0.0f), 1);
-		} 
-	} 
-
-	if (!isDead && OfficerHealth->GetHealth() <= 0) {
-		HandleDeath();
+		ProjectilePool->Prewarm(BulletClass, 8);
 	}
-
-	UpdateCharacter();
-}
-
-void ABlueOfficer::StartMoving()
-{
-	isWalking = true;
-
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::ChangeMovementDirection, 1.5f, false);
 }
 
-void ABlueOfficer::ChangeMovementDirection()
+void ABlueOfficer::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (patrols <= 4) {
-		patrols++;
-
-		if (isDead)  return; 
-
-		if (isFiringGun || isBashingGun)
-		{
-			StartMoving();
-			return;
-		}
-
-		if (movementDirection == 1.0f) movementDirection = -1.0f;
-		else movementDirection = 1.0f;  
-
-		if (movementDirection < 0.0f)
-		{
-			SetActorRotation(FRotator(0.0f, 0.0f, 0.0f));
-		}
-		else if (movementDirection > 0.0f)
-		{
-			SetActorRotation(FRotator(0.0f, 180.0f, 0.0f));
-		}
-
-		StartMoving();
+	if (EnemyManager)
+	{
+		EnemyManager->UnregisterEnemy(BrainHandle);
+		BrainHandle = INDEX_NONE;
 	}
-	else {
-		patrols = 0;
 
-		StopMoving();
-	}
+	Super::EndPlay(EndPlayReason);
 }
 
-void ABlueOfficer::StopMoving()
+void ABlueOfficer::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	isWalking = false;
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	StartIdling();
+	DOREPLIFETIME(ABlueOfficer, NetState);
 }
 
-void ABlueOfficer::StartIdling()
+bool ABlueOfficer::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
 {
-	isIdling = true;
-
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::StopIdling, 6.0f, false);
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
 }
 
-void ABlueOfficer::StopIdling()
+void ABlueOfficer::OnRep_NetState()
 {
-	isIdling = false;
-
-	StartMoving();
+	// the manager picks the state up when the enemy registers
+	if (BrainHandle != INDEX_NONE)
+	{
+		EnemyManager->ApplyNetState(BrainHandle, NetState);
+	}
 }
 
-void ABlueOfficer::StartGunAttack()
+void ABlueOfficer::Tick(float DeltaSeconds)
 {
-	//UE_LOG(LogTemp, Warning, TEXT("swording"));
-	isFiringGun = true;
-
-	// swording animation takes 0.6 second
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::FireBullet, 0.75f, false);
+	Super::Tick(DeltaSeconds); 
 
-	GetCharacterMovement()->DisableMovement(); 
+	// only reached when the enemy manager doesn't batch the brains
+	EnemyManager->TickEnemy(BrainHandle, DeltaSeconds);
 }
 
 void ABlueOfficer::FireBullet()
 {
 	//UE_LOG(LogTemp, Warning, TEXT("pistoling"));
-	if (BulletClass && !isDead)
+	if (BulletClass && !IsDead())
 	{
-		UGameplayStatics::SpawnSound2D(this, BulletSound, 1.0f, 1.0f, 0.0f);
+		UClawSoundPool::PlaySound2D(this, BulletSound, EClawSoundCategory::Weapon, 0.5f);
 
 		FRotator SpawnRotation = GetSprite()->GetComponentRotation();
-		if (movementDirection < 0)
+		if (EnemyManager->GetFacing(BrainHandle) < 0)
 			SpawnRotation.Yaw = 180;
 		else SpawnRotation.Yaw = 0;
 		FVector SpawnLocation;
@@ -225,163 +168,112 @@ void ABlueOfficer::FireBullet()
 		if (GetActorRotation().Yaw < 0) SpawnLocation = GetActorLocation() + FVector(65.0, 0.0f, 35.0f);
 		else SpawnLocation = GetActorLocation() + FVector(-65.0, 0.0f, 35.0f);
 
-		if (isCrouching) SpawnLocation.Z -= 40.0f;
-
-		GetWorld()->SpawnActor<ABlueOfficerBullet>(BulletClass, SpawnLocation, SpawnRotation);
-	}
-
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::StopGunAttack, 0.75f, false);
-}
+		// the officer shoots low when Claw crouched as the attack started
+		if (EnemyManager->GetState(BrainHandle) == EClawEnemyState::CrouchAttacking) SpawnLocation.Z -= 40.0f;
 
-void ABlueOfficer::StopGunAttack()
-{
-	if (ClawCharacter != nullptr && GunFireCollisionBox->IsOverlappingActor(ClawCharacter) && GunFireCollisionBox->IsOverlappingComponent(ClawCapsuleComponent))
-	{
-		if (GunBashCollisionBox->IsOverlappingActor(ClawCharacter) && GunBashCollisionBox->IsOverlappingComponent(ClawCapsuleComponent))
+		// bullets the projectile system can't simulate are still actors, the server replicates those
+		if (!ProjectileSystem->Fire(BulletClass, SpawnLocation, SpawnRotation, this) && HasAuthority())
 		{
-			isFiringGun = false;
-
-			StartGunBash();
+			ProjectilePool->Acquire<ABlueOfficerBullet>(BulletClass, SpawnLocation, SpawnRotation);
 		}
-		else 
+
+		// the simulated bullets aren't actors, so the clients fire their own
+		if (ClawNet::IsServing(GetWorld()))
 		{
-			AClawRemastered2Character* clawCharacter;
-			clawCharacter = Cast<AClawRemastered2Character>(ClawCharacter);
-
-			if (clawCharacter->isCrouching)
-			{
-				isCrouching = true;
-			}
-			else
-			{
-				isCrouching = false;
-			}
-
-			StartGunAttack();
-		} 
-	}
-	else {
-		GetCharacterMovement()->SetMovementMode(MOVE_Walking);
-		isFiringGun = false;
+			MulticastFireBullet();
+		}
 	}
 }
 
-void ABlueOfficer::StartGunBash()
-{
-	isBashingGun = true;
-	
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::DealDamage, 0.4f, false);
-
-	GetCharacterMovement()->DisableMovement();
-}
-
-void ABlueOfficer::DealDamage()
+void ABlueOfficer::MulticastFireBullet_Implementation()
 {
-	if (ClawCharacter && ClawCapsuleComponent && GunBashCollisionBox->IsOverlappingActor(ClawCharacter) && GunBashCollisionBox->IsOverlappingComponent(ClawCapsuleComponent))
+	// the shot is aimed from the replicated facing and state, the server already fired it
+	if (!HasAuthority())
 	{
-		UGameplayStatics::ApplyDamage(ClawCharacter, 15, GetOwner()->GetInstigatorController(), this, DamageType);
+		FireBullet();
 	}
-
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::StopGunBash, 0.4f, false);
 }
 
-void ABlueOfficer::StopGunBash()
+void ABlueOfficer::DealDamage()
 {
-	if (ClawCharacter != nullptr && GunFireCollisionBox->IsOverlappingActor(ClawCharacter) && GunFireCollisionBox->IsOverlappingComponent(ClawCapsuleComponent))
+	// the Claw in reach comes from the gun bash box, either through its overlaps or the spatial hash
+	AActor* Claw = EnemyManager->GetClawInReach(BrainHandle);
+	if (Claw)
 	{
-		if (GunBashCollisionBox->IsOverlappingActor(ClawCharacter) && GunBashCollisionBox->IsOverlappingComponent(ClawCapsuleComponent))
-		{
-			StartGunBash();
-		}
-		else
-		{ 
-			AClawRemastered2Character* clawCharacter;
-			clawCharacter = Cast<AClawRemastered2Character>(ClawCharacter);
-
-			if (clawCharacter->isCrouching)
-			{
-				isCrouching = true;
-			}
-			else
-			{
-				isCrouching = false;
-			}
-			StartGunAttack();
-		}
-	}
-	else {
-		GetCharacterMovement()->SetMovementMode(MOVE_Walking);
-		isBashingGun = false;
+		UClawDamageSystem::ApplyDamage(Claw, 15, GetOwner()->GetInstigatorController(), this, DamageType);
 	}
 }
 
-void ABlueOfficer::UpdateCharacter()
+bool ABlueOfficer::IsDead() const
 {
-	// Update animation to match the motion
-	UpdateAnimation();
+	// an officer without a brain hasn't begun play or already left the world
+	return BrainHandle == INDEX_NONE || EnemyManager->GetState(BrainHandle) == EClawEnemyState::Dead;
 }
 
 void ABlueOfficer::OnOverlapBeginGunFireCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	//UE_LOG(LogTemp, Warning, TEXT("begin overlap"));
 	//GEngine->AddOnScreenDebugMessage(-1, 1.0f, FColor::Green, "overlap Begin");
-	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && !isDead)
+	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && !IsDead())
 	{
-		//UE_LOG(LogTemp, Warning, TEXT("overlapping"));
-		
 		if (OtherActor != GetOwner())
 		{
 			ClawCharacter = OtherActor;
 			ClawCapsuleComponent = OtherComp;
 
-			if (GunBashCollisionBox->IsOverlappingActor(OtherActor) && GunBashCollisionBox->IsOverlappingComponent(OtherComp))
-			{
-				StartGunBash();
-			}
-			else {
-				AClawRemastered2Character* clawCharacter;
-				clawCharacter = Cast<AClawRemastered2Character>(OtherActor);
-
-				if (clawCharacter->isCrouching)
-				{
-					isCrouching = true;
-				} 
-				else 
-				{
-					isCrouching = false;
-				}
-
-				StartGunAttack();
-			} 
-		} 
+			// the behaviour starts shooting on its next update
+			EnemyManager->SetClawInSight(BrainHandle, OtherActor, true);
+		}
 	}
 }
 
 void ABlueOfficer::OnOverlapEndGunFireCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	CLAW_SCOPE_OVERLAP();
+
+	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && BrainHandle != INDEX_NONE)
+	{
+		EnemyManager->SetClawInSight(BrainHandle, OtherActor, false);
+	}
 }
 
-void ABlueOfficer::HandleDeath()
+void ABlueOfficer::OnOverlapBeginGunBashCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	isDead = true;
-
-	UGameplayStatics::SpawnSound2D(this, DeathSound, 1.0f, 1.0f, 0.0f);
+	CLAW_SCOPE_OVERLAP();
 
-	if (ClawCelebrationSound != nullptr)
+	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && !IsDead())
 	{
-		UGameplayStatics::SpawnSound2D(this, ClawCelebrationSound, 1.0f, 1.0f, 0.0f);
+		ClawCharacter = OtherActor;
+		ClawCapsuleComponent = OtherComp;
+
+		EnemyManager->SetClawInReach(BrainHandle, OtherActor, true);
 	}
+}
 
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &ABlueOfficer::DestroyOfficer, 0.6f, false);
+void ABlueOfficer::OnOverlapEndGunBashCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	CLAW_SCOPE_OVERLAP();
 
-	this->SetActorEnableCollision(false);
+	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && BrainHandle != INDEX_NONE)
+	{
+		EnemyManager->SetClawInReach(BrainHandle, OtherActor, false);
+	}
 }
 
-void ABlueOfficer::DestroyOfficer()
+void ABlueOfficer::HandleDeath()
 {
-	this->Destroy();
+	// the dead state of the behaviour destroys the officer once the animation played
+	EnemyManager->Kill(BrainHandle);
+	EnemyManager->SetMoveDirection(BrainHandle, 0.0f);
+
+	UClawSoundPool::PlaySound2D(this, DeathSound, EClawSoundCategory::Effect, 2.0f);
+
+	if (ClawCelebrationSound != nullptr)
+	{
+		UClawSoundPool::PlaySound2D(this, ClawCelebrationSound, EClawSoundCategory::Voice);
+	}
+
+	this->SetActorEnableCollision(false);
 }
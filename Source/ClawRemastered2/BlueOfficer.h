@@ -6,6 +6,8 @@
 #include "PaperCharacter.h"
 #include "HealthComponent.h"
 #include "Sound/SoundBase.h"
+#include "ClawEnemyManager.h"
+#include "ClawNet.h"
 #include "BlueOfficer.generated.h"
 
 
@@ -18,6 +20,10 @@ class CLAWREMASTERED2_API ABlueOfficer : public APaperCharacter
 
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// the enemy manager updates the brain and calls HandleDeath
+	friend class UClawEnemyManager;
 
 protected:
 	// The animation to play while idle (standing still)
@@ -47,42 +53,36 @@ protected:
 	// The animation to play after death
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	class UPaperFlipbook* DeadAnimation;
-	
 
-	/** Called to choose the correct animation to play based on the character's movement state */
-	void UpdateAnimation();
+	// what the officer does, the enemy manager uses the default officer behaviour when none is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Behaviour)
+	UClawEnemyBehaviour* Behaviour;
 
-	void UpdateCharacter();
+	// run by the behaviour while the officer attacks
+	void FireBullet();
 
-	void StartMoving();
-	void ChangeMovementDirection();
-	void StopMoving();
+	// repeats a shot on the clients, where the officer's brain doesn't act
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireBullet();
+	void DealDamage();
 
-	void StartIdling();
-	void StopIdling();
+	bool IsDead() const;
 
-	void StartGunAttack();
-	void FireBullet();
-	void StopGunAttack();
+	UClawEnemyManager* EnemyManager;
 
-	void StartGunBash();
-	void DealDamage();
-	void StopGunBash();
+	class UClawProjectileSystem* ProjectileSystem;
+
+	class UClawProjectilePool* ProjectilePool;
 
-	bool isWalking = true;
-	bool isIdling = true;
-	bool isFiringGun = false;
-	bool isBashingGun = false;
-	bool isDead = false;
-	bool isHurt = false;
-	bool isCrouching = false;
+	// handle of this officer's brain in the enemy manager
+	int32 BrainHandle = INDEX_NONE;
 
-	int patrols = 0;
+	// what the clients see of the officer, written by the enemy manager on the server
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FClawNetEnemyState NetState;
 
-	// movementDirection will be multiplied by world vector
-	// 0 will result in no movement, 1 is right
-	// movement and -1 is left movement.
-	float movementDirection = 1.0f;
+	UFUNCTION()
+	void OnRep_NetState();
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sounds)
 	USoundBase* BulletSound;
@@ -94,7 +94,10 @@ protected:
 	USoundBase* ClawCelebrationSound;
 
 public:
-	ABlueOfficer();
+	ABlueOfficer(const FObjectInitializer& ObjectInitializer);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Projectile, meta = (AllowPrivateAccess = "true"))
 	TSubclassOf<APaperSpriteActor> BulletClass;
@@ -121,7 +124,11 @@ private:
 	UFUNCTION()
 	void OnOverlapEndGunFireCollisionBox(class UPrimitiveComponent* OverlappedComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	void HandleDeath();
+	UFUNCTION()
+	void OnOverlapBeginGunBashCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
-	void DestroyOfficer();
+	UFUNCTION()
+	void OnOverlapEndGunBashCollisionBox(class UPrimitiveComponent* OverlappedComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	void HandleDeath();
 };
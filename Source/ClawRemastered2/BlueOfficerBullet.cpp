@@ -2,16 +2,23 @@
 
 
 #include "BlueOfficerBullet.h"
+#include "ClawRemastered2.h"
 #include "PaperFlipbookComponent.h" 
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
 #include "EnemyCharacter.h"
-#include "Kismet/GameplayStatics.h"	
+#include "Kismet/GameplayStatics.h"
+#include "ClawDamageSystem.h"
 #include "Components/CapsuleComponent.h" 
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "ClawGameMode.h"
+#include "ClawProjectilePool.h"
+#include "ClawProjectileSystem.h"
+#include "ClawNet.h"
+#include "PaperSpriteComponent.h"
 #include "BlueOfficer.h"
 #include "Engine/Engine.h"
+#include "ClawStats.h"
 
 
 ABlueOfficerBullet::ABlueOfficerBullet()
@@ -30,6 +37,12 @@ ABlueOfficerBullet::ABlueOfficerBullet()
 	HitCollisionBox->SetCollisionProfileName("Trigger");
 	HitCollisionBox->SetupAttachment(RootComponent);
 
+	// a bullet flies straight, whole units are enough for where the clients show it
+	bReplicates = true;
+	SetReplicatingMovement(true);
+	GetReplicatedMovement_Mutable().LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	GetReplicatedMovement_Mutable().VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+
 	HitCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &ABlueOfficerBullet::OnOverlapBegin); 
 }
 
@@ -39,19 +52,114 @@ void ABlueOfficerBullet::BeginPlay()
 	//UE_LOG(LogTemp, Warning, TEXT("pistoling"));
 
 	GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
+
+	ProjectilePool = GetWorld()->GetSubsystem<UClawProjectilePool>();
+	bArmed = true;
 }
 
 void ABlueOfficerBullet::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	UE_LOG(LogTemp, Warning, TEXT("overlapping"));
+	CLAW_SCOPE_OVERLAP();
+
+	// a bullet only hits once, it might still overlap something until it's back in the pool
+	if (!bArmed) return;
+
+	UE_LOG(LogClaw, Verbose, TEXT("%s overlapped %s"), *GetName(), *GetNameSafe(OtherActor));
 	// check it it's claw who's overlapping with the score object.
 	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
 		// decrease the enemy health.
-		UGameplayStatics::ApplyDamage(OtherActor, Damage, GetInstigatorController(), this, DamageType);
+		UClawDamageSystem::ApplyDamage(OtherActor, Damage, GetInstigatorController(), this, DamageType);
 
-		// destroy the bullet.
-		this->Destroy(); 
+		// hand the bullet back to the pool.
+		bArmed = false;
+		ReturnToPool();
 	}
 }
 
+void ABlueOfficerBullet::OnAcquired()
+{
+	bArmed = true;
+
+	ClawNet::SetDormant(this, false);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// fly off along the new rotation at full speed, like a freshly spawned bullet
+	ProjectileMovement->SetUpdatedComponent(GetRootComponent());
+	ProjectileMovement->SetVelocityInLocalSpace(FVector(ProjectileMovement->InitialSpeed, 0.0f, 0.0f));
+	ProjectileMovement->Activate(true);
+	ProjectileMovement->UpdateComponentVelocity();
+
+	HitCollisionBox->UpdateOverlaps();
+
+	SetLifeSpan(InitialLifeSpan);
+}
+
+void ABlueOfficerBullet::OnReleased()
+{
+	bArmed = false;
+
+	SetLifeSpan(0.0f);
+
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+
+	// the clients get the hidden bullet once, then it sleeps until it is fired again
+	ClawNet::SetDormant(this, true);
+}
+
+void ABlueOfficerBullet::LifeSpanExpired()
+{
+	if (ProjectilePool || !HasAuthority())
+	{
+		ReturnToPool();
+	}
+	else
+	{
+		Super::LifeSpanExpired();
+	}
+}
+
+void ABlueOfficerBullet::ReturnToPool()
+{
+	// the server still drives its bullet, a client mustn't hand it out for a predicted shot.
+	// Its copy only disappears until replication tears it down
+	if (!HasAuthority())
+	{
+		bArmed = false;
+		SetActorEnableCollision(false);
+		SetActorHiddenInGame(true);
+		return;
+	}
+
+	if (ProjectilePool)
+	{
+		ProjectilePool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+bool ABlueOfficerBullet::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
+}
+
+bool ABlueOfficerBullet::DescribeSimulatedProjectile(FClawProjectileDesc& OutDesc) const
+{
+	OutDesc.Sprite = GetRenderComponent()->GetSprite();
+	OutDesc.DamageType = DamageType;
+	OutDesc.Speed = ProjectileMovement->InitialSpeed;
+	OutDesc.LifeSpan = InitialLifeSpan;
+	OutDesc.Damage = Damage;
+	OutDesc.Radius = HitCollisionBox->GetUnscaledBoxExtent().GetMax();
+	OutDesc.bHitsClaw = true;
+	return true;
+}
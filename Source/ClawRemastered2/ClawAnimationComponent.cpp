@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawAnimationComponent.h"
+#include "PaperFlipbookComponent.h"
+
+UClawAnimationComponent::UClawAnimationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UClawAnimationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!Sprite)
+	{
+		Sprite = GetOwner()->FindComponentByClass<UPaperFlipbookComponent>();
+	}
+}
+
+void UClawAnimationComponent::SetFlags(EClawAnimationFlags Flags)
+{
+	if (Flags == AppliedFlags && bApplied)
+	{
+		return;
+	}
+
+	AppliedFlags = Flags;
+	Apply();
+}
+
+void UClawAnimationComponent::SetAnimationSet(UClawAnimationSet* InAnimationSet)
+{
+	AnimationSet = InAnimationSet;
+	if (bApplied)
+	{
+		Apply();
+	}
+}
+
+void UClawAnimationComponent::Apply()
+{
+	if (!AnimationSet || !Sprite)
+	{
+		return;
+	}
+
+	bApplied = true;
+
+	UPaperFlipbook* Flipbook = AnimationSet->GetFlipbook(AppliedFlags);
+	if (Sprite->GetFlipbook() != Flipbook)
+	{
+		Sprite->SetFlipbook(Flipbook);
+	}
+}
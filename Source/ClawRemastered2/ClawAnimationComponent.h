@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ClawAnimationSet.h"
+#include "ClawAnimationComponent.generated.h"
+
+class UPaperFlipbookComponent;
+
+/**
+ * Shows the flipbook of an animation set that matches the flags of its character.
+ *
+ * The character hands over its flags as one mask whenever it updates. Nothing happens
+ * while the mask stays the same, and a new mask is a single table lookup, so the
+ * component doesn't tick.
+ */
+UCLASS(ClassGroup = (Claw), meta = (BlueprintSpawnableComponent))
+class CLAWREMASTERED2_API UClawAnimationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UClawAnimationComponent();
+
+	virtual void BeginPlay() override;
+
+	/** Shows the flipbook for Flags when they differ from the last ones. */
+	void SetFlags(EClawAnimationFlags Flags);
+
+	EClawAnimationFlags GetFlags() const { return AppliedFlags; }
+
+	void SetAnimationSet(UClawAnimationSet* InAnimationSet);
+
+	// the owner's first flipbook component when not set
+	void SetSprite(UPaperFlipbookComponent* InSprite) { Sprite = InSprite; }
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Animation)
+	UClawAnimationSet* AnimationSet;
+
+private:
+	void Apply();
+
+	UPROPERTY()
+	UPaperFlipbookComponent* Sprite;
+
+	EClawAnimationFlags AppliedFlags = EClawAnimationFlags::None;
+	bool bApplied = false;
+};
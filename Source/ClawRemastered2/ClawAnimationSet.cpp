@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawAnimationSet.h"
+#include "PaperFlipbook.h"
+
+void UClawAnimationSet::Compile()
+{
+	for (int32 Mask = 0; Mask < CLAW_NumAnimationMasks; ++Mask)
+	{
+		Table[Mask] = nullptr;
+		for (const FClawAnimationRule& Rule : Rules)
+		{
+			if ((Mask & Rule.RequiredFlags) == Rule.RequiredFlags)
+			{
+				Table[Mask] = Rule.Flipbook;
+				break;
+			}
+		}
+	}
+}
+
+void UClawAnimationSet::PostLoad()
+{
+	Super::PostLoad();
+	Compile();
+}
+
+#if WITH_EDITOR
+void UClawAnimationSet::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	Compile();
+}
+#endif
+
+UClawAnimationSet* UClawAnimationSet::MakeClawAnimationSet(UObject* Outer, UPaperFlipbook* Idle, UPaperFlipbook* Running, UPaperFlipbook* Jumping, UPaperFlipbook* Crouching,
+	UPaperFlipbook* Swording, UPaperFlipbook* JumpSwording, UPaperFlipbook* CrouchSwording,
+	UPaperFlipbook* Pistoling, UPaperFlipbook* JumpPistoling, UPaperFlipbook* CrouchPistoling,
+	UPaperFlipbook* Hurt, UPaperFlipbook* Dead)
+{
+	UClawAnimationSet* AnimationSet = NewObject<UClawAnimationSet>(Outer);
+
+	auto AddRule = [AnimationSet](EClawAnimationFlags Flags, UPaperFlipbook* Flipbook)
+	{
+		AnimationSet->Rules.Add({ (int32)Flags, Flipbook });
+	};
+
+	// in the order of the old branches, the first match wins
+	AddRule(EClawAnimationFlags::Dead, Dead);
+	AddRule(EClawAnimationFlags::Hurt, Hurt);
+	AddRule(EClawAnimationFlags::Swording | EClawAnimationFlags::Falling, JumpSwording);
+	AddRule(EClawAnimationFlags::Swording | EClawAnimationFlags::Crouching, CrouchSwording);
+	AddRule(EClawAnimationFlags::Swording, Swording);
+	AddRule(EClawAnimationFlags::Pistoling | EClawAnimationFlags::Falling, JumpPistoling);
+	AddRule(EClawAnimationFlags::Pistoling | EClawAnimationFlags::Crouching, CrouchPistoling);
+	AddRule(EClawAnimationFlags::Pistoling, Pistoling);
+	AddRule(EClawAnimationFlags::Falling, Jumping);
+	AddRule(EClawAnimationFlags::Crouching, Crouching);
+	AddRule(EClawAnimationFlags::Moving, Running);
+	AddRule(EClawAnimationFlags::None, Idle);
+
+	AnimationSet->Compile();
+	return AnimationSet;
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ClawAnimationSet.generated.h"
+
+class UPaperFlipbook;
+
+// what a character is doing, packed into the mask its animation is looked up with
+UENUM(meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EClawAnimationFlags : uint8
+{
+	None = 0 UMETA(Hidden),
+	Dead = 1 << 0,
+	Hurt = 1 << 1,
+	Swording = 1 << 2,
+	Pistoling = 1 << 3,
+	Falling = 1 << 4,
+	Crouching = 1 << 5,
+	Moving = 1 << 6
+};
+ENUM_CLASS_FLAGS(EClawAnimationFlags);
+
+static constexpr int32 CLAW_NumAnimationMasks = 1 << 7;
+
+USTRUCT()
+struct FClawAnimationRule
+{
+	GENERATED_BODY()
+
+	// the rule applies when all of these are set
+	UPROPERTY(EditAnywhere, meta = (Bitmask, BitmaskEnum = "EClawAnimationFlags"))
+	int32 RequiredFlags = 0;
+
+	UPROPERTY(EditAnywhere)
+	UPaperFlipbook* Flipbook = nullptr;
+};
+
+/**
+ * The flipbooks of a character, by what the character is doing.
+ *
+ * The rules are checked in order and the first one whose flags are all set wins. They're
+ * compiled into a table with a flipbook for every mask, so picking an animation is one
+ * lookup however many rules there are.
+ */
+UCLASS(BlueprintType)
+class CLAWREMASTERED2_API UClawAnimationSet : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = Animation)
+	TArray<FClawAnimationRule> Rules;
+
+	/** Rebuilds the lookup table, needed after Rules was changed. */
+	void Compile();
+
+	UPaperFlipbook* GetFlipbook(EClawAnimationFlags Flags) const { return Table[(uint8)Flags]; }
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// the animations Claw used to pick with a branch per flag
+	static UClawAnimationSet* MakeClawAnimationSet(UObject* Outer, UPaperFlipbook* Idle, UPaperFlipbook* Running, UPaperFlipbook* Jumping, UPaperFlipbook* Crouching,
+		UPaperFlipbook* Swording, UPaperFlipbook* JumpSwording, UPaperFlipbook* CrouchSwording,
+		UPaperFlipbook* Pistoling, UPaperFlipbook* JumpPistoling, UPaperFlipbook* CrouchPistoling,
+		UPaperFlipbook* Hurt, UPaperFlipbook* Dead);
+
+private:
+	UPaperFlipbook* Table[CLAW_NumAnimationMasks] = {};
+};
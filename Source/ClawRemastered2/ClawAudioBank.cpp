@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawAudioBank.h"
+#include "ClawRemastered2.h"
+#include "AudioDevice.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Sound/SoundCue.h"
+#include "Sound/SoundNodeWavePlayer.h"
+#include "Sound/SoundWave.h"
+#include "ClawStats.h"
+
+DECLARE_MEMORY_STAT(TEXT("Audio Bank Compressed"), STAT_ClawAudioBankCompressed, STATGROUP_Claw);
+DECLARE_MEMORY_STAT(TEXT("Audio Bank Decoded"), STAT_ClawAudioBankDecoded, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Unbanked Cue Plays"), STAT_ClawUnbankedCuePlays, STATGROUP_Claw);
+
+void UClawAudioBanks::Deinitialize()
+{
+	for (const TSharedPtr<FStreamableHandle>& Handle : LoadHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->CancelHandle();
+		}
+	}
+	LoadHandles.Empty();
+
+	DEC_MEMORY_STAT_BY(STAT_ClawAudioBankCompressed, CompressedBytes);
+	DEC_MEMORY_STAT_BY(STAT_ClawAudioBankDecoded, DecodedBytes);
+
+	Banks.Empty();
+	BankedSoundList.Empty();
+	BankedSounds.Empty();
+	Waves.Empty();
+	BankedWaves.Empty();
+	FirstPlays.Empty();
+	CompressedBytes = 0;
+	DecodedBytes = 0;
+
+	Super::Deinitialize();
+}
+
+void UClawAudioBanks::LoadBank(const TSoftObjectPtr<UClawAudioBank>& Bank)
+{
+	if (Bank.IsNull())
+	{
+		return;
+	}
+
+	FStreamableManager& Streamable = UAssetManager::GetStreamableManager();
+	LoadHandles.Add(Streamable.RequestAsyncLoad(Bank.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &UClawAudioBanks::OnBankLoaded, Bank),
+		FStreamableManager::AsyncLoadHighPriority));
+}
+
+double UClawAudioBanks::WaitForBanks()
+{
+	const uint64 Start = FPlatformTime::Cycles64();
+
+	// a loaded bank starts loading its cues, so the handles can grow while waiting
+	for (int32 Index = 0; Index < LoadHandles.Num(); ++Index)
+	{
+		TSharedPtr<FStreamableHandle> Handle = LoadHandles[Index];
+		if (Handle.IsValid() && Handle->IsLoadingInProgress())
+		{
+			Handle->WaitUntilComplete();
+		}
+	}
+
+	return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start);
+}
+
+void UClawAudioBanks::RecordPlay(USoundBase* Sound, uint64 Cycles)
+{
+	if (FirstPlays.Contains(Sound))
+	{
+		return;
+	}
+
+	const float Milliseconds = FPlatformTime::ToMilliseconds64(Cycles);
+	FirstPlays.Add(Sound, Milliseconds);
+
+	if (!BankedSounds.Contains(Sound))
+	{
+		INC_DWORD_STAT(STAT_ClawUnbankedCuePlays);
+		UE_LOG(LogClaw, Warning, TEXT("%s played without being in an audio bank, its first play took %.2f ms."), *GetNameSafe(Sound), Milliseconds);
+	}
+}
+
+void UClawAudioBanks::Report() const
+{
+	UE_LOG(LogClaw, Display, TEXT("Audio banks: %d banks, %d cues, %d waves, %.1f KB compressed, %.1f KB decoded."),
+		Banks.Num(), BankedSoundList.Num(), Waves.Num(), CompressedBytes / 1024.0, DecodedBytes / 1024.0);
+
+	for (const FBankedWave& Banked : Waves)
+	{
+		const bool bDecoded = Banked.Wave->GetPrecacheState() == ESoundWavePrecacheState::Done;
+		UE_LOG(LogClaw, Display, TEXT("  %s: %.1f KB compressed, %.1f KB decoded%s"),
+			*Banked.Wave->GetName(), Banked.CompressedBytes / 1024.0, Banked.DecodedBytes / 1024.0, bDecoded ? TEXT("") : TEXT(", still decoding"));
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("First plays:"));
+	for (const TPair<USoundBase*, float>& FirstPlay : FirstPlays)
+	{
+		UE_LOG(LogClaw, Display, TEXT("  %s: %.3f ms%s"), *GetNameSafe(FirstPlay.Key), FirstPlay.Value, BankedSounds.Contains(FirstPlay.Key) ? TEXT("") : TEXT(", not banked"));
+	}
+}
+
+void UClawAudioBanks::OnBankLoaded(TSoftObjectPtr<UClawAudioBank> Bank)
+{
+	UClawAudioBank* LoadedBank = Bank.Get();
+	if (!LoadedBank)
+	{
+		UE_LOG(LogClaw, Warning, TEXT("Audio bank %s failed to load."), *Bank.ToString());
+		return;
+	}
+
+	Banks.Add(LoadedBank);
+
+	TArray<FSoftObjectPath> CuePaths;
+	for (const TSoftObjectPtr<USoundBase>& Cue : LoadedBank->Cues)
+	{
+		if (!Cue.IsNull())
+		{
+			CuePaths.Add(Cue.ToSoftObjectPath());
+		}
+	}
+
+	FStreamableManager& Streamable = UAssetManager::GetStreamableManager();
+	LoadHandles.Add(Streamable.RequestAsyncLoad(CuePaths,
+		FStreamableDelegate::CreateUObject(this, &UClawAudioBanks::OnCuesLoaded, LoadedBank),
+		FStreamableManager::AsyncLoadHighPriority));
+}
+
+void UClawAudioBanks::OnCuesLoaded(UClawAudioBank* Bank)
+{
+	for (const TSoftObjectPtr<USoundBase>& Cue : Bank->Cues)
+	{
+		USoundBase* Sound = Cue.Get();
+		if (!Sound || BankedSounds.Contains(Sound))
+		{
+			continue;
+		}
+
+		BankedSounds.Add(Sound);
+		BankedSoundList.Add(Sound);
+
+		if (USoundWave* Wave = Cast<USoundWave>(Sound))
+		{
+			AddWave(Wave);
+		}
+		else if (USoundCue* SoundCue = Cast<USoundCue>(Sound))
+		{
+			TArray<USoundNodeWavePlayer*> WavePlayers;
+			SoundCue->RecursiveFindNode<USoundNodeWavePlayer>(SoundCue->FirstNode, WavePlayers);
+			for (USoundNodeWavePlayer* WavePlayer : WavePlayers)
+			{
+				AddWave(WavePlayer->GetSoundWave());
+			}
+		}
+	}
+}
+
+void UClawAudioBanks::AddWave(USoundWave* Wave)
+{
+	if (!Wave || BankedWaves.Contains(Wave))
+	{
+		return;
+	}
+	BankedWaves.Add(Wave);
+
+	// 16 bit samples once decoded
+	FBankedWave Banked;
+	Banked.Wave = Wave;
+	Banked.CompressedBytes = Wave->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	Banked.DecodedBytes = Wave->IsStreaming() ? 0 : FMath::CeilToInt(Wave->Duration * Wave->GetSampleRateForCurrentPlatform()) * Wave->NumChannels * sizeof(int16);
+	Waves.Add(Banked);
+
+	CompressedBytes += Banked.CompressedBytes;
+	DecodedBytes += Banked.DecodedBytes;
+	INC_MEMORY_STAT_BY(STAT_ClawAudioBankCompressed, Banked.CompressedBytes);
+	INC_MEMORY_STAT_BY(STAT_ClawAudioBankDecoded, Banked.DecodedBytes);
+
+	// decoded on the audio device's worker threads, long before the first play asks for it
+	if (FAudioDevice* AudioDevice = GetWorld()->GetAudioDeviceRaw())
+	{
+		if (!Wave->IsStreaming())
+		{
+			AudioDevice->Precache(Wave, false, true, true);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Audio.Banks
+
+namespace
+{
+	void ReportAudioBanks(const TArray<FString>& Args, UWorld* World)
+	{
+		UClawAudioBanks* AudioBanks = World ? World->GetSubsystem<UClawAudioBanks>() : nullptr;
+		if (AudioBanks)
+		{
+			AudioBanks->Report();
+		}
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs ReportAudioBanksCommand(
+		TEXT("claw.Audio.Banks"),
+		TEXT("Prints the memory of the loaded audio banks and how long the first play of every cue took."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportAudioBanks));
+}
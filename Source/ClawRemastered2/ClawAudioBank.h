@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/StreamableManager.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawAudioBank.generated.h"
+
+class USoundBase;
+class USoundWave;
+
+/**
+ * The sounds a level plays, loaded and decoded together while the level loads.
+ */
+UCLASS(BlueprintType)
+class CLAWREMASTERED2_API UClawAudioBank : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// waves or cues, the waves of a cue are decoded with it
+	UPROPERTY(EditAnywhere, Category = Audio)
+	TArray<TSoftObjectPtr<USoundBase>> Cues;
+};
+
+/**
+ * Keeps the audio banks of a world loaded and their waves decoded.
+ *
+ * A bank is loaded asynchronously when the level starts loading. Once it's in, every wave
+ * of it is precached by the audio device with full decompression, so the decoded PCM is
+ * resident before the first cue plays. WaitForBanks blocks on whatever is still loading,
+ * the game mode calls it before play begins. The sound pool reports how long the first play
+ * of every cue took and warns about cues that aren't in a bank. claw.Audio.Banks prints the
+ * memory of the banks and those latencies.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawAudioBanks : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Deinitialize() override;
+
+	/** Starts loading the bank, its waves are decoded once it's in. */
+	void LoadBank(const TSoftObjectPtr<UClawAudioBank>& Bank);
+
+	/** Finishes loading every bank now, returns the milliseconds it waited. */
+	double WaitForBanks();
+
+	bool IsBanked(USoundBase* Sound) const { return BankedSounds.Contains(Sound); }
+
+	/** Called by the sound pool with how long a cue took to start, only the first play is kept. */
+	void RecordPlay(USoundBase* Sound, uint64 Cycles);
+
+	/** Logs the memory of the loaded banks and the first play latency of every cue. */
+	void Report() const;
+
+private:
+	// a wave of a loaded bank and what it costs
+	struct FBankedWave
+	{
+		USoundWave* Wave;
+		int32 CompressedBytes;
+		int32 DecodedBytes;
+	};
+
+	void OnBankLoaded(TSoftObjectPtr<UClawAudioBank> Bank);
+	void OnCuesLoaded(UClawAudioBank* Bank);
+	void AddWave(USoundWave* Wave);
+
+	TArray<TSharedPtr<FStreamableHandle>> LoadHandles;
+
+	// keep the banks and their cues loaded, the waves come with the cues
+	UPROPERTY()
+	TArray<UClawAudioBank*> Banks;
+
+	UPROPERTY()
+	TArray<USoundBase*> BankedSoundList;
+
+	TSet<USoundBase*> BankedSounds;
+	TArray<FBankedWave> Waves;
+	TSet<USoundWave*> BankedWaves;
+
+	int64 CompressedBytes = 0;
+	int64 DecodedBytes = 0;
+
+	// milliseconds the first play of each cue took
+	TMap<USoundBase*, float> FirstPlays;
+};
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawBenchmark.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Enemy.h"
+#include "BlueOfficer.h"
+#include "EnemyCharacter.h"
+#include "TreasureObject.h"
+#include "ClawInputRecorder.h"
+#include "ClawRemastered2.h"
+#include "ClawStats.h"
+
+namespace
+{
+	struct FBenchmarkScenario
+	{
+		const TCHAR* Name;
+		int32 NumEnemies;
+		int32 NumOfficers;
+		int32 NumCharacters;
+		int32 NumTreasures;
+	};
+
+	const FBenchmarkScenario Scenarios[] =
+	{
+		{ TEXT("Empty"), 0, 0, 0, 0 },
+		{ TEXT("Crowd"), 32, 32, 32, 0 },
+		{ TEXT("Horde"), 256, 256, 256, 0 },
+		{ TEXT("Treasure"), 0, 0, 0, 2000 },
+		{ TEXT("Mixed"), 128, 128, 128, 1000 },
+	};
+
+	struct FScriptStep
+	{
+		int32 Frame;
+		const TCHAR* Key;
+		EInputEvent Event;
+	};
+
+	// one loop of Claw's input: run right while jumping, slashing and shooting, then crouch and run back
+	const FScriptStep Script[] =
+	{
+		{ 0, TEXT("D"), IE_Pressed },
+		{ 30, TEXT("SpaceBar"), IE_Pressed },
+		{ 32, TEXT("SpaceBar"), IE_Released },
+		{ 90, TEXT("LeftControl"), IE_Pressed },
+		{ 92, TEXT("LeftControl"), IE_Released },
+		{ 150, TEXT("E"), IE_Pressed },
+		{ 152, TEXT("E"), IE_Released },
+		{ 240, TEXT("D"), IE_Released },
+		{ 240, TEXT("A"), IE_Pressed },
+		{ 300, TEXT("S"), IE_Pressed },
+		{ 330, TEXT("S"), IE_Released },
+		{ 360, TEXT("LeftControl"), IE_Pressed },
+		{ 362, TEXT("LeftControl"), IE_Released },
+		{ 420, TEXT("E"), IE_Pressed },
+		{ 422, TEXT("E"), IE_Released },
+		{ 480, TEXT("A"), IE_Released },
+		{ 500, TEXT("SpaceBar"), IE_Pressed },
+		{ 502, TEXT("SpaceBar"), IE_Released },
+	};
+
+	const int32 ScriptLength = 600;
+
+	// nearest rank percentile of an unsorted set
+	float Percentile(TArray<float> Values, float Fraction)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0f;
+		}
+
+		Values.Sort();
+		const int32 Rank = FMath::Clamp(FMath::CeilToInt(Fraction * Values.Num()) - 1, 0, Values.Num() - 1);
+		return Values[Rank];
+	}
+
+	float Average(const TArray<float>& Values)
+	{
+		double Sum = 0.0;
+		for (float Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? Sum / Values.Num() : 0.0f;
+	}
+
+	void AddDistribution(FString& Csv, const TCHAR* Metric, const TArray<float>& Values)
+	{
+		Csv += FString::Printf(TEXT("%s.Avg,%.4f\n"), Metric, Average(Values));
+		Csv += FString::Printf(TEXT("%s.P50,%.4f\n"), Metric, Percentile(Values, 0.5f));
+		Csv += FString::Printf(TEXT("%s.P90,%.4f\n"), Metric, Percentile(Values, 0.9f));
+		Csv += FString::Printf(TEXT("%s.P99,%.4f\n"), Metric, Percentile(Values, 0.99f));
+		Csv += FString::Printf(TEXT("%s.Max,%.4f\n"), Metric, Percentile(Values, 1.0f));
+	}
+}
+
+void UClawBenchmark::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (!GetWorld()->IsGameWorld() || !FParse::Value(CommandLine, TEXT("ClawBenchmark="), ScenarioName))
+	{
+		return;
+	}
+
+	const FBenchmarkScenario* Scenario = nullptr;
+	for (const FBenchmarkScenario& Candidate : Scenarios)
+	{
+		if (ScenarioName.Equals(Candidate.Name, ESearchCase::IgnoreCase))
+		{
+			Scenario = &Candidate;
+		}
+	}
+
+	if (!Scenario)
+	{
+		UE_LOG(LogClaw, Error, TEXT("Unknown benchmark scenario %s."), *ScenarioName);
+		return;
+	}
+
+	NumEnemies = Scenario->NumEnemies;
+	NumOfficers = Scenario->NumOfficers;
+	NumCharacters = Scenario->NumCharacters;
+	NumTreasures = Scenario->NumTreasures;
+
+	FParse::Value(CommandLine, TEXT("Enemies="), NumEnemies);
+	FParse::Value(CommandLine, TEXT("Officers="), NumOfficers);
+	FParse::Value(CommandLine, TEXT("Characters="), NumCharacters);
+	FParse::Value(CommandLine, TEXT("Treasures="), NumTreasures);
+	FParse::Value(CommandLine, TEXT("Frames="), NumFrames);
+	FParse::Value(CommandLine, TEXT("Warmup="), NumWarmupFrames);
+	FParse::Value(CommandLine, TEXT("BenchmarkName="), ScenarioName);
+
+	NumFrames = FMath::Max(NumFrames, 1);
+
+	bActive = true;
+}
+
+void UClawBenchmark::Deinitialize()
+{
+	if (bActive)
+	{
+		FClawScopeTimers::SetEnabled(false);
+	}
+
+	Super::Deinitialize();
+}
+
+void UClawBenchmark::Tick(float DeltaSeconds)
+{
+	if (!bSpawned)
+	{
+		bSpawned = SpawnScenario();
+		LastTickSeconds = FPlatformTime::Seconds();
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const double FrameMilliseconds = (Now - LastTickSeconds) * 1000.0;
+	LastTickSeconds = Now;
+
+	if (Frame == NumWarmupFrames)
+	{
+		FClawScopeTimers::SetEnabled(true);
+	}
+	else if (Frame > NumWarmupFrames)
+	{
+		RecordFrame(FrameMilliseconds);
+	}
+
+	if (FrameTimes.Num() == NumFrames)
+	{
+		FClawScopeTimers::SetEnabled(false);
+		WriteResults();
+
+		bActive = false;
+		FPlatformMisc::RequestExit(false);
+		return;
+	}
+
+	PlayScript();
+	++Frame;
+}
+
+ETickableTickType UClawBenchmark::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawBenchmark::IsTickable() const
+{
+	return bActive;
+}
+
+TStatId UClawBenchmark::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawBenchmark, STATGROUP_Tickables);
+}
+
+UWorld* UClawBenchmark::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UClawBenchmark::SpawnScenario()
+{
+	UWorld* World = GetWorld();
+	APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (!World->HasBegunPlay() || !PlayerController || !PlayerController->GetPawn())
+	{
+		return false;
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("Benchmark %s: %d enemies, %d officers, %d enemy characters, %d treasures, %d frames."),
+		*ScenarioName, NumEnemies, NumOfficers, NumCharacters, NumTreasures, NumFrames);
+
+	// a row ahead of Claw, dropped from a little above so they land on whatever floor is there
+	const FVector Origin = PlayerController->GetPawn()->GetActorLocation() + FVector(256.0f, 0.0f, 64.0f);
+	int32 Slot = 0;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	auto SpawnRow = [&](UClass* Class, int32 Count)
+	{
+		for (int32 Index = 0; Index < Count; ++Index, ++Slot)
+		{
+			World->SpawnActor<AActor>(Class, Origin + FVector(Slot * Spacing, 0.0f, 0.0f), FRotator::ZeroRotator, SpawnParameters);
+		}
+	};
+
+	SpawnRow(EnemyClass.IsNull() ? AEnemy::StaticClass() : EnemyClass.LoadSynchronous(), NumEnemies);
+	SpawnRow(OfficerClass.IsNull() ? ABlueOfficer::StaticClass() : OfficerClass.LoadSynchronous(), NumOfficers);
+	SpawnRow(CharacterClass.IsNull() ? AEnemyCharacter::StaticClass() : CharacterClass.LoadSynchronous(), NumCharacters);
+
+	// the treasures are spread over the same stretch, a little higher up
+	const float TreasureSpacing = Spacing * FMath::Max(NumEnemies + NumOfficers + NumCharacters, 1) / FMath::Max(NumTreasures, 1);
+	UClass* Treasure = TreasureClass.IsNull() ? ATreasureObject::StaticClass() : TreasureClass.LoadSynchronous();
+	for (int32 Index = 0; Index < NumTreasures; ++Index)
+	{
+		World->SpawnActor<AActor>(Treasure, Origin + FVector(Index * TreasureSpacing, 0.0f, 64.0f), FRotator::ZeroRotator, SpawnParameters);
+	}
+
+	return true;
+}
+
+void UClawBenchmark::PlayScript()
+{
+	// a replayed recording drives Claw instead of the script
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	UClawInputRecorder* Recorder = GetWorld()->GetSubsystem<UClawInputRecorder>();
+	if (!PlayerController || (Recorder && Recorder->IsReplaying()))
+	{
+		return;
+	}
+
+	// through the player controller, so the keys take the same path as a player's
+	const int32 ScriptFrame = Frame % ScriptLength;
+	for (const FScriptStep& Step : Script)
+	{
+		if (Step.Frame == ScriptFrame)
+		{
+			PlayerController->InputKey(FKey(Step.Key), Step.Event, Step.Event == IE_Pressed ? 1.0f : 0.0f, false);
+		}
+	}
+}
+
+void UClawBenchmark::RecordFrame(double FrameMilliseconds)
+{
+	FrameTimes.Add(FrameMilliseconds);
+	GameThreadTimes.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+
+	const uint64 Used = FPlatformMemory::GetStats().UsedPhysical;
+	MemoryUsed.Add(Used / (1024.0 * 1024.0));
+	MemoryHighWater = FMath::Max(MemoryHighWater, Used);
+
+	FClawScopeTimers::EndFrame(ScopeTimes.AddDefaulted_GetRef());
+}
+
+void UClawBenchmark::WriteResults() const
+{
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("Benchmarks");
+	const FString BaseName = Directory / FString::Printf(TEXT("%s-%s"), *ScenarioName, *FDateTime::Now().ToString());
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	// scopes can first run after the warm up, the early frames have fewer of them
+	const TArray<FString>& ScopeNames = FClawScopeTimers::GetNames();
+
+	FString Summary = TEXT("Metric,Value\n");
+	Summary += FString::Printf(TEXT("Frames,%d\n"), FrameTimes.Num());
+	AddDistribution(Summary, TEXT("FrameMs"), FrameTimes);
+	AddDistribution(Summary, TEXT("GameThreadMs"), GameThreadTimes);
+
+	for (int32 ScopeIndex = 0; ScopeIndex < ScopeNames.Num(); ++ScopeIndex)
+	{
+		TArray<float> Times;
+		for (const TArray<double>& FrameScopes : ScopeTimes)
+		{
+			Times.Add(FrameScopes.IsValidIndex(ScopeIndex) ? FrameScopes[ScopeIndex] : 0.0);
+		}
+
+		Summary += FString::Printf(TEXT("Scope.%s.Avg,%.4f\n"), *ScopeNames[ScopeIndex], Average(Times));
+		Summary += FString::Printf(TEXT("Scope.%s.P99,%.4f\n"), *ScopeNames[ScopeIndex], Percentile(Times, 0.99f));
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	Summary += FString::Printf(TEXT("MemoryMB.HighWater,%.2f\n"), MemoryHighWater / (1024.0 * 1024.0));
+	Summary += FString::Printf(TEXT("MemoryMB.Peak,%.2f\n"), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+
+	FString Frames = TEXT("Frame,FrameMs,GameThreadMs,MemoryMB");
+	for (const FString& ScopeName : ScopeNames)
+	{
+		Frames += TEXT(",") + ScopeName;
+	}
+	Frames += TEXT("\n");
+
+	for (int32 Index = 0; Index < FrameTimes.Num(); ++Index)
+	{
+		Frames += FString::Printf(TEXT("%d,%.4f,%.4f,%.2f"), Index, FrameTimes[Index], GameThreadTimes[Index], MemoryUsed[Index]);
+		for (int32 ScopeIndex = 0; ScopeIndex < ScopeNames.Num(); ++ScopeIndex)
+		{
+			Frames += FString::Printf(TEXT(",%.4f"), ScopeTimes[Index].IsValidIndex(ScopeIndex) ? ScopeTimes[Index][ScopeIndex] : 0.0);
+		}
+		Frames += TEXT("\n");
+	}
+
+	FFileHelper::SaveStringToFile(Summary, *(BaseName + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(Frames, *(BaseName + TEXT("-Frames.csv")));
+
+	UE_LOG(LogClaw, Display, TEXT("Benchmark %s: frame %.2f ms median, %.2f ms P99, written to %s.csv."),
+		*ScenarioName, Percentile(FrameTimes, 0.5f), Percentile(FrameTimes, 0.99f), *BaseName);
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawBenchmark.generated.h"
+
+class AEnemy;
+class ABlueOfficer;
+class AEnemyCharacter;
+class ATreasureObject;
+
+/**
+ * Turns a level into a stress test and measures it, when the game runs with -ClawBenchmark.
+ *
+ * Once play began, the scenario's enemies, officers, enemy characters and treasures are
+ * spawned in a row ahead of Claw, and Claw is driven by a scripted key sequence through his
+ * player controller. After a warm up, every frame's time, game thread time, the time of
+ * each Claw scope and the memory in use are recorded. The run ends by writing a summary CSV
+ * (one metric per row, for ClawBenchmarkCompare) and a per frame CSV to Saved/Benchmarks,
+ * then the game exits.
+ *
+ * Usage: ClawRemastered2 <Map> -game -nullrhi -unattended -nosound -benchmark -fps=60
+ *        -ClawBenchmark=<Empty|Crowd|Horde|Treasure|Mixed> [-Enemies=N] [-Officers=N]
+ *        [-Characters=N] [-Treasures=N] [-Frames=1800] [-Warmup=120] [-BenchmarkName=Name]
+ */
+UCLASS(config = Game)
+class CLAWREMASTERED2_API UClawBenchmark : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	bool IsRunning() const { return bActive; }
+
+	// what gets spawned, the native classes when not set
+	UPROPERTY(config)
+	TSoftClassPtr<AEnemy> EnemyClass;
+
+	UPROPERTY(config)
+	TSoftClassPtr<ABlueOfficer> OfficerClass;
+
+	UPROPERTY(config)
+	TSoftClassPtr<AEnemyCharacter> CharacterClass;
+
+	UPROPERTY(config)
+	TSoftClassPtr<ATreasureObject> TreasureClass;
+
+	// distance between two spawned actors along X
+	UPROPERTY(config)
+	float Spacing = 48.0f;
+
+private:
+	bool SpawnScenario();
+	void PlayScript();
+	void RecordFrame(double FrameMilliseconds);
+	void WriteResults() const;
+
+	bool bActive = false;
+	bool bSpawned = false;
+
+	FString ScenarioName;
+	int32 NumEnemies = 0;
+	int32 NumOfficers = 0;
+	int32 NumCharacters = 0;
+	int32 NumTreasures = 0;
+
+	int32 NumWarmupFrames = 120;
+	int32 NumFrames = 1800;
+
+	// frames since the scenario was spawned
+	int32 Frame = 0;
+
+	double LastTickSeconds = 0.0;
+
+	// one entry per recorded frame
+	TArray<float> FrameTimes;
+	TArray<float> GameThreadTimes;
+	TArray<float> MemoryUsed;
+	TArray<TArray<double>> ScopeTimes;
+
+	uint64 MemoryHighWater = 0;
+};
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawBenchmarkCompareCommandlet.h"
+#include "Misc/FileHelper.h"
+#include "ClawRemastered2.h"
+
+namespace
+{
+	// the numeric rows of a summary, in file order
+	bool LoadSummary(const FString& Filename, TArray<TPair<FString, double>>& OutMetrics)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Filename))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't read %s."), *Filename);
+			return false;
+		}
+
+		for (const FString& Line : Lines)
+		{
+			FString Metric;
+			FString Value;
+			if (Line.Split(TEXT(","), &Metric, &Value) && Value.IsNumeric())
+			{
+				OutMetrics.Emplace(Metric, FCString::Atod(*Value));
+			}
+		}
+		return true;
+	}
+}
+
+UClawBenchmarkCompareCommandlet::UClawBenchmarkCompareCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClawBenchmarkCompareCommandlet::Main(const FString& Params)
+{
+	FString BaseFile;
+	FString TestFile;
+	if (!FParse::Value(*Params, TEXT("Base="), BaseFile) || !FParse::Value(*Params, TEXT("Test="), TestFile))
+	{
+		UE_LOG(LogClaw, Error, TEXT("Usage: -run=ClawBenchmarkCompare -Base=Before.csv -Test=After.csv [-Threshold=5] [-NoiseFloor=0.05]"));
+		return 2;
+	}
+
+	// percent a metric may grow before it counts as a regression
+	float Threshold = 5.0f;
+	FParse::Value(*Params, TEXT("Threshold="), Threshold);
+
+	float NoiseFloor = 0.05f;
+	FParse::Value(*Params, TEXT("NoiseFloor="), NoiseFloor);
+
+	TArray<TPair<FString, double>> BaseMetrics;
+	TArray<TPair<FString, double>> TestMetrics;
+	if (!LoadSummary(BaseFile, BaseMetrics) || !LoadSummary(TestFile, TestMetrics))
+	{
+		return 2;
+	}
+
+	TMap<FString, double> TestValues;
+	for (const TPair<FString, double>& Metric : TestMetrics)
+	{
+		TestValues.Add(Metric.Key, Metric.Value);
+	}
+
+	int32 NumRegressions = 0;
+	int32 NumImprovements = 0;
+
+	UE_LOG(LogClaw, Display, TEXT("%-40s %12s %12s %9s"), TEXT("Metric"), TEXT("Base"), TEXT("Test"), TEXT("Change"));
+	for (const TPair<FString, double>& Metric : BaseMetrics)
+	{
+		const double* TestValue = TestValues.Find(Metric.Key);
+		if (!TestValue)
+		{
+			UE_LOG(LogClaw, Display, TEXT("%-40s %12.4f %12s"), *Metric.Key, Metric.Value, TEXT("missing"));
+			continue;
+		}
+
+		// the frame count is the length of the run, not a cost
+		if (Metric.Key == TEXT("Frames") || FMath::Max(Metric.Value, *TestValue) < NoiseFloor)
+		{
+			continue;
+		}
+
+		const double Change = Metric.Value > 0.0 ? (*TestValue - Metric.Value) / Metric.Value * 100.0 : 100.0;
+		const TCHAR* Verdict = TEXT("");
+		if (Change > Threshold)
+		{
+			Verdict = TEXT("REGRESSION");
+			++NumRegressions;
+		}
+		else if (Change < -Threshold)
+		{
+			Verdict = TEXT("improved");
+			++NumImprovements;
+		}
+
+		UE_LOG(LogClaw, Display, TEXT("%-40s %12.4f %12.4f %+8.1f%% %s"), *Metric.Key, Metric.Value, *TestValue, Change, Verdict);
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("%d regressions and %d improvements past %.1f%%."), NumRegressions, NumImprovements, Threshold);
+
+	return NumRegressions > 0 ? 1 : 0;
+}
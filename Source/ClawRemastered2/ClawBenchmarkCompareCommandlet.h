@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClawBenchmarkCompareCommandlet.generated.h"
+
+/**
+ * Compares two summary CSVs written by the benchmark and flags the regressions.
+ *
+ * Every metric of the summaries is a time or a size, so a metric that grew by more than the
+ * threshold is a regression. Metrics under the noise floor in both runs are skipped, a scope
+ * going from 0.001 to 0.002 ms isn't worth a flag. Returns 1 when anything regressed, so
+ * a script can fail on it.
+ *
+ * Usage: -run=ClawBenchmarkCompare -Base=Before.csv -Test=After.csv [-Threshold=5] [-NoiseFloor=0.05]
+ */
+UCLASS()
+class UClawBenchmarkCompareCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClawBenchmarkCompareCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
@@ -6,13 +6,19 @@
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
 #include "EnemyCharacter.h"
-#include "Kismet/GameplayStatics.h"	
+#include "Kismet/GameplayStatics.h"
+#include "ClawDamageSystem.h"
 #include "Components/CapsuleComponent.h" 
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "ClawGameMode.h"
+#include "ClawProjectilePool.h"
+#include "ClawProjectileSystem.h"
+#include "ClawNet.h"
+#include "PaperSpriteComponent.h"
 #include "BlueOfficer.h"
 #include "Enemy.h"
 #include "Engine/Engine.h"
+#include "ClawStats.h"
 
 AClawBullet::AClawBullet()
 {
@@ -29,6 +35,12 @@ AClawBullet::AClawBullet()
 	HitCollisionBox->SetBoxExtent(FVector(5.0f, 5.0f, 5.0f));
 	HitCollisionBox->SetCollisionProfileName("Trigger");
 	HitCollisionBox->SetupAttachment(RootComponent);
+
+	// a bullet flies straight, whole units are enough for where the clients show it
+	bReplicates = true;
+	SetReplicatingMovement(true);
+	GetReplicatedMovement_Mutable().LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	GetReplicatedMovement_Mutable().VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
 }
 
 void AClawBullet::BeginPlay()
@@ -39,22 +51,126 @@ void AClawBullet::BeginPlay()
 	HitCollisionBox->OnComponentEndOverlap.AddDynamic(this, &AClawBullet::OnOverlapEnd);
 	
 	GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
+
+	ProjectilePool = GetWorld()->GetSubsystem<UClawProjectilePool>();
+	bArmed = true;
 }
 
 void AClawBullet::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
+	// a bullet only hits once, it might still overlap something until it's back in the pool
+	if (!bArmed) return;
+
 	// check it it's claw who's overlapping with the score object.
 	if (OtherActor && (OtherActor->IsA(AEnemyCharacter::StaticClass()) || OtherActor->IsA(ABlueOfficer::StaticClass()) || OtherActor->IsA(AEnemy::StaticClass())) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
 		// decrease the enemy health.
-		UGameplayStatics::ApplyDamage(OtherActor, Damage, GetInstigatorController(), this, DamageType);
+		UClawDamageSystem::ApplyDamage(OtherActor, Damage, GetInstigatorController(), this, DamageType);
 
-		// destroy the bullet.
-		this->Destroy();
+		// hand the bullet back to the pool.
+		bArmed = false;
+		ReturnToPool();
 	}
 }
 
 void AClawBullet::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	CLAW_SCOPE_OVERLAP();
+
+}
+
+void AClawBullet::OnAcquired()
+{
+	bArmed = true;
+
+	ClawNet::SetDormant(this, false);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// fly off along the new rotation at full speed, like a freshly spawned bullet
+	ProjectileMovement->SetUpdatedComponent(GetRootComponent());
+	ProjectileMovement->SetVelocityInLocalSpace(FVector(ProjectileMovement->InitialSpeed, 0.0f, 0.0f));
+	ProjectileMovement->Activate(true);
+	ProjectileMovement->UpdateComponentVelocity();
+
+	HitCollisionBox->UpdateOverlaps();
+
+	SetLifeSpan(InitialLifeSpan);
+}
+
+void AClawBullet::OnReleased()
+{
+	bArmed = false;
+
+	SetLifeSpan(0.0f);
+
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+
+	// the clients get the hidden bullet once, then it sleeps until it is fired again
+	ClawNet::SetDormant(this, true);
+}
+
+void AClawBullet::LifeSpanExpired()
+{
+	if (ProjectilePool || !HasAuthority())
+	{
+		ReturnToPool();
+	}
+	else
+	{
+		Super::LifeSpanExpired();
+	}
+}
+
+void AClawBullet::ReturnToPool()
+{
+	// the server still drives its bullet, a client mustn't hand it out for a predicted shot.
+	// Its copy only disappears until replication tears it down
+	if (!HasAuthority())
+	{
+		bArmed = false;
+		SetActorEnableCollision(false);
+		SetActorHiddenInGame(true);
+		return;
+	}
+
+	if (ProjectilePool)
+	{
+		ProjectilePool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+bool AClawBullet::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// the player who fired it shows its own predicted bullet
+	const APawn* Shooter = GetInstigator();
+	if (Shooter && Shooter == ViewTarget && !Shooter->IsLocallyControlled())
+	{
+		return false;
+	}
+
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
+}
+
+bool AClawBullet::DescribeSimulatedProjectile(FClawProjectileDesc& OutDesc) const
+{
+	OutDesc.Sprite = GetRenderComponent()->GetSprite();
+	OutDesc.DamageType = DamageType;
+	OutDesc.Speed = ProjectileMovement->InitialSpeed;
+	OutDesc.LifeSpan = InitialLifeSpan;
+	OutDesc.Damage = Damage;
+	OutDesc.Radius = HitCollisionBox->GetUnscaledBoxExtent().GetMax();
+	OutDesc.bHitsClaw = false;
+	return true;
 }
- 
\ No newline at end of file
@@ -5,13 +5,15 @@
 #include "CoreMinimal.h"
 #include "PaperSpriteActor.h"
 #include "GameFramework/ProjectileMovementComponent.h"
+#include "Interfaces/PooledProjectile.h"
 #include "ClawBullet.generated.h"
 
 
 class AClawGameMode;
+class UClawProjectilePool;
 
 UCLASS()
-class CLAWREMASTERED2_API AClawBullet : public APaperSpriteActor
+class CLAWREMASTERED2_API AClawBullet : public APaperSpriteActor, public IPooledProjectile
 {
 	GENERATED_BODY()
 
@@ -39,14 +41,31 @@ private:
 
 	AClawGameMode* GameModeRef;
 
+	UClawProjectilePool* ProjectilePool;
+
+	// false while the bullet waits in the pool, so it can't hit twice before it's back
+	bool bArmed = false;
+
+	// back to the pool, or only hidden when it is a client's copy of a server bullet
+	void ReturnToPool();
+
 public:
 	// class constructor
 	AClawBullet();
 
+	// IPooledProjectile interface
+	virtual void OnAcquired() override;
+	virtual void OnReleased() override;
+	virtual bool DescribeSimulatedProjectile(FClawProjectileDesc& OutDesc) const override;
+
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 protected:
 	// called when actor is spawned
 	virtual void BeginPlay() override;
 
+	// hands the bullet back to the pool instead of destroying it
+	virtual void LifeSpanExpired() override;
+
 
 };
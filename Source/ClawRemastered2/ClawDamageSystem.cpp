@@ -0,0 +1,378 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawDamageSystem.h"
+#include "ClawRemastered2.h"
+#include "HealthComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/DamageType.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Damage Resolve"), STAT_ClawDamageResolve, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Hits"), STAT_ClawDamageHits, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Damage Targets"), STAT_ClawDamageTargets, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawDamageBatched(
+	TEXT("claw.Damage.Batched"),
+	1,
+	TEXT("1: hits are queued and resolved in one pass per frame by the damage system.\n")
+	TEXT("0: every hit is applied by its health component when it happens.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+//////////////////////////////////////////////////////////////////////////
+// FClawHealthStore
+
+int32 FClawHealthStore::Add(float InHealth, float InMaxHealth)
+{
+	const int32 Index = Health.Add(InHealth);
+	MaxHealth.Add(InMaxHealth);
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = HandleToIndex.Add(INDEX_NONE);
+	}
+
+	HandleToIndex[Handle] = Index;
+	IndexToHandle.Add(Handle);
+
+	return Handle;
+}
+
+void FClawHealthStore::Remove(int32 Handle)
+{
+	const int32 Index = IndexOf(Handle);
+	const int32 LastHandle = IndexToHandle.Last();
+
+	Health.RemoveAtSwap(Index, 1, false);
+	MaxHealth.RemoveAtSwap(Index, 1, false);
+	IndexToHandle.RemoveAtSwap(Index, 1, false);
+
+	// the last target was moved into the freed slot
+	HandleToIndex[LastHandle] = Index;
+	HandleToIndex[Handle] = INDEX_NONE;
+	FreeHandles.Add(Handle);
+
+	// the handle can be handed out again, so its queued hits must not land on whoever gets it,
+	// they stay in the queue to keep the hit indices
+	for (FClawHit& Hit : Queue)
+	{
+		if (Hit.Target == Handle)
+		{
+			Hit.Target = INDEX_NONE;
+		}
+	}
+}
+
+float FClawHealthStore::ChangeHealth(int32 Handle, float Delta)
+{
+	const int32 Index = IndexOf(Handle);
+	Health[Index] = FMath::Clamp(Health[Index] + Delta, 0.0f, MaxHealth[Index]);
+	return Health[Index];
+}
+
+void FClawHealthStore::Resolve(TArray<FClawHitResult>& OutResults)
+{
+	float* RESTRICT Healths = Health.GetData();
+	const float* RESTRICT MaxHealths = MaxHealth.GetData();
+	const int32* RESTRICT Indices = HandleToIndex.GetData();
+
+	OutResults.Reserve(OutResults.Num() + Queue.Num());
+
+	for (int32 HitIndex = 0; HitIndex < Queue.Num(); ++HitIndex)
+	{
+		const FClawHit& Hit = Queue[HitIndex];
+		if (Hit.Target == INDEX_NONE)
+		{
+			continue;
+		}
+
+		// like the health component, no damage and hits on the dead do nothing
+		const int32 Index = Indices[Hit.Target];
+		if (Hit.Damage == 0.0f || Healths[Index] <= 0.0f)
+		{
+			continue;
+		}
+
+		const float NewHealth = FMath::Clamp(Healths[Index] - Hit.Damage, 0.0f, MaxHealths[Index]);
+		Healths[Index] = NewHealth;
+
+		OutResults.Add({ HitIndex, Hit.Target, Hit.Damage, NewHealth, NewHealth <= 0.0f });
+	}
+
+	Queue.Reset();
+}
+
+void FClawHealthStore::Empty()
+{
+	Health.Empty();
+	MaxHealth.Empty();
+	IndexToHandle.Empty();
+	HandleToIndex.Empty();
+	FreeHandles.Empty();
+	Queue.Empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UClawDamageSystem
+
+void UClawDamageSystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bBatched = CVarClawDamageBatched.GetValueOnGameThread() != 0;
+}
+
+void UClawDamageSystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawDamageTargets, Store.Num());
+
+	Store.Empty();
+	Components.Empty();
+	HitSources.Empty();
+	ResolvingSources.Empty();
+	ResolvingComponents.Empty();
+	Results.Empty();
+
+	Super::Deinitialize();
+}
+
+void UClawDamageSystem::Tick(float DeltaSeconds)
+{
+	ResolveHits();
+}
+
+ETickableTickType UClawDamageSystem::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawDamageSystem::IsTickable() const
+{
+	return !bFixedStep && Store.GetNumQueued() > 0;
+}
+
+TStatId UClawDamageSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawDamageSystem, STATGROUP_Tickables);
+}
+
+UWorld* UClawDamageSystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+float UClawDamageSystem::ApplyDamage(AActor* DamagedActor, float BaseDamage, AController* EventInstigator, AActor* DamageCauser, TSubclassOf<UDamageType> DamageTypeClass)
+{
+	if (!DamagedActor || BaseDamage == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	// combat is resolved on the server, clients only see the health it replicates
+	if (DamagedActor->GetWorld()->GetNetMode() == NM_Client)
+	{
+		return 0.0f;
+	}
+
+	UHealthComponent* Health = DamagedActor->FindComponentByClass<UHealthComponent>();
+	if (Health && Health->GetDamageHandle() != INDEX_NONE)
+	{
+		const UDamageType* DamageType = DamageTypeClass ? DamageTypeClass->GetDefaultObject<UDamageType>() : GetDefault<UDamageType>();
+		DamagedActor->GetWorld()->GetSubsystem<UClawDamageSystem>()->QueueHit(Health->GetDamageHandle(), BaseDamage, DamageType, EventInstigator, DamageCauser);
+		return BaseDamage;
+	}
+
+	return UGameplayStatics::ApplyDamage(DamagedActor, BaseDamage, EventInstigator, DamageCauser, DamageTypeClass);
+}
+
+int32 UClawDamageSystem::Register(UHealthComponent* Health, float InitialHealth, float MaxHealth)
+{
+	const int32 Handle = Store.Add(InitialHealth, MaxHealth);
+	if (Handle >= Components.Num())
+	{
+		Components.SetNumZeroed(Handle + 1);
+	}
+	Components[Handle] = Health;
+
+	INC_DWORD_STAT(STAT_ClawDamageTargets);
+
+	return Handle;
+}
+
+void UClawDamageSystem::Unregister(int32 Handle)
+{
+	if (!Store.Contains(Handle))
+	{
+		return;
+	}
+
+	Store.Remove(Handle);
+	Components[Handle] = nullptr;
+
+	DEC_DWORD_STAT(STAT_ClawDamageTargets);
+}
+
+void UClawDamageSystem::QueueHit(int32 Handle, float Damage, const UDamageType* DamageType, AController* EventInstigator, AActor* DamageCauser)
+{
+	Store.QueueHit(Handle, Damage);
+	HitSources.Add({ DamageType, EventInstigator, DamageCauser });
+}
+
+void UClawDamageSystem::ResolveHits()
+{
+	{
+		CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawDamageResolve);
+
+		INC_DWORD_STAT_BY(STAT_ClawDamageHits, Store.GetNumQueued());
+
+		Results.Reset();
+		Store.Resolve(Results);
+
+		// events can queue new hits, those wait for the next resolve
+		Swap(ResolvingSources, HitSources);
+		HitSources.Reset();
+
+		// taken before the events, which can unregister a target and hand its handle to another
+		ResolvingComponents.Reset(Results.Num());
+		for (const FClawHitResult& Result : Results)
+		{
+			ResolvingComponents.Add(Components[Result.Target]);
+		}
+	}
+
+	// the events come after the whole batch, a death can destroy actors and unregister their health
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		const FClawHitResult& Result = Results[Index];
+		UHealthComponent* Health = ResolvingComponents[Index];
+		if (Health && Health->GetDamageHandle() == Result.Target)
+		{
+			const FHitSource& Source = ResolvingSources[Result.Hit];
+			Health->ApplyResolvedDamage(Result.Health, Result.Damage, Source.DamageType, Source.Instigator.Get(), Source.Causer.Get());
+		}
+	}
+
+	ResolvingSources.Reset();
+	ResolvingComponents.Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Damage.Benchmark
+
+namespace
+{
+	// hits spread over a crowd of targets, most of which survive, like a long fight
+	void BenchmarkDamage(const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumTargets = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 4096;
+		const int32 NumHits = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000000;
+
+		FRandomStream Random(NumTargets);
+
+		FClawHealthStore Store;
+		TArray<int32> Handles;
+		for (int32 Index = 0; Index < NumTargets; ++Index)
+		{
+			Handles.Add(Store.Add(100000.0f, 100000.0f));
+		}
+
+		TArray<FClawHitResult> BenchmarkResults;
+
+		const uint64 Start = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < NumHits; ++Index)
+		{
+			Store.QueueHit(Handles[Random.RandHelper(NumTargets)], Random.FRandRange(0.5f, 2.0f));
+		}
+		const uint64 Queued = FPlatformTime::Cycles64();
+		Store.Resolve(BenchmarkResults);
+		const uint64 Resolved = FPlatformTime::Cycles64();
+
+		const double QueueMilliseconds = FPlatformTime::ToMilliseconds64(Queued - Start);
+		const double ResolveMilliseconds = FPlatformTime::ToMilliseconds64(Resolved - Queued);
+
+		UE_LOG(LogClaw, Display, TEXT("Damage benchmark, %d hits on %d targets: queued in %.2f ms, resolved in %.2f ms, %.0f hits per ms (%d results)."),
+			NumHits, NumTargets, QueueMilliseconds, ResolveMilliseconds, NumHits / FMath::Max(QueueMilliseconds + ResolveMilliseconds, 0.001), BenchmarkResults.Num());
+
+		// through the shim and the events of real health components, against applying every hit on the spot
+		if (!World || !World->HasBegunPlay())
+		{
+			return;
+		}
+
+		const int32 NumActors = FMath::Min(NumTargets, 1024);
+		const int32 NumActorHits = FMath::Min(NumHits, 100000);
+
+		UClawDamageSystem* DamageSystem = World->GetSubsystem<UClawDamageSystem>();
+		const bool bWasBatched = DamageSystem->IsBatched();
+
+		auto SpawnTargets = [World, NumActors](TArray<AActor*>& OutActors)
+		{
+			for (int32 Index = 0; Index < NumActors; ++Index)
+			{
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.ObjectFlags |= RF_Transient;
+				AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+				UHealthComponent* Health = NewObject<UHealthComponent>(Actor);
+				Health->RegisterComponent();
+				OutActors.Add(Actor);
+			}
+		};
+
+		// the batched targets join the damage system, the baseline ones take every hit on the spot
+		// like before it existed, otherwise both loops would time the batch
+		TArray<AActor*> Actors;
+		DamageSystem->SetBatched(true);
+		SpawnTargets(Actors);
+
+		TArray<AActor*> BaselineActors;
+		DamageSystem->SetBatched(false);
+		SpawnTargets(BaselineActors);
+
+		DamageSystem->SetBatched(bWasBatched);
+
+		// tiny hits, so nobody dies before the end
+		const float HitDamage = 0.0001f;
+
+		uint64 ActorStart = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < NumActorHits; ++Index)
+		{
+			UClawDamageSystem::ApplyDamage(Actors[Random.RandHelper(NumActors)], HitDamage, nullptr, nullptr, nullptr);
+		}
+		DamageSystem->ResolveHits();
+		const double ShimMilliseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - ActorStart);
+
+		ActorStart = FPlatformTime::Cycles64();
+		for (int32 Index = 0; Index < NumActorHits; ++Index)
+		{
+			UGameplayStatics::ApplyDamage(BaselineActors[Random.RandHelper(NumActors)], HitDamage, nullptr, nullptr, nullptr);
+		}
+		const double GameplayStaticsMilliseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - ActorStart);
+
+		UE_LOG(LogClaw, Display, TEXT("  %d hits on %d actors: %.0f hits per ms batched through the shim, %.0f hits per ms applied one by one through UGameplayStatics::ApplyDamage."),
+			NumActorHits, NumActors, NumActorHits / FMath::Max(ShimMilliseconds, 0.001), NumActorHits / FMath::Max(GameplayStaticsMilliseconds, 0.001));
+
+		for (AActor* Actor : Actors)
+		{
+			Actor->Destroy();
+		}
+		for (AActor* Actor : BaselineActors)
+		{
+			Actor->Destroy();
+		}
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs BenchmarkDamageCommand(
+		TEXT("claw.Damage.Benchmark"),
+		TEXT("Measures how many hits the damage system resolves per millisecond.\n")
+		TEXT("Usage: claw.Damage.Benchmark [Targets=4096] [Hits=1000000]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkDamage));
+}
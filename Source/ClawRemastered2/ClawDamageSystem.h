@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawDamageSystem.generated.h"
+
+class UHealthComponent;
+
+// a hit waiting for the next resolve
+struct FClawHit
+{
+	int32 Target;
+	float Damage;
+};
+
+// what a resolved hit did to its target
+struct FClawHitResult
+{
+	// index of the hit in the queue it was resolved from
+	int32 Hit;
+	int32 Target;
+	float Damage;
+	float Health;
+	bool bDied;
+};
+
+/**
+ * The health of everything that can be hurt, in packed arrays addressed by stable handles.
+ *
+ * Hits are queued and applied in one pass by Resolve, in the order they came in. A target
+ * whose health already ran out ignores the hits after the one that killed it, and hits on a
+ * target removed before the resolve are dropped.
+ */
+struct CLAWREMASTERED2_API FClawHealthStore
+{
+	int32 Add(float Health, float MaxHealth);
+	void Remove(int32 Handle);
+
+	bool Contains(int32 Handle) const { return HandleToIndex.IsValidIndex(Handle) && HandleToIndex[Handle] != INDEX_NONE; }
+
+	float GetHealth(int32 Handle) const { return Health[IndexOf(Handle)]; }
+
+	/** Changes the health right away, returns the new health. */
+	float ChangeHealth(int32 Handle, float Delta);
+
+	void QueueHit(int32 Handle, float Damage) { Queue.Add({ Handle, Damage }); }
+
+	int32 GetNumQueued() const { return Queue.Num(); }
+	int32 Num() const { return Health.Num(); }
+
+	/** Applies the queued hits, appends what each of them did to OutResults and empties the queue. */
+	void Resolve(TArray<FClawHitResult>& OutResults);
+
+	void Empty();
+
+private:
+	int32 IndexOf(int32 Handle) const
+	{
+		check(Contains(Handle));
+		return HandleToIndex[Handle];
+	}
+
+	// packed, all arrays share the same index
+	TArray<float> Health;
+	TArray<float> MaxHealth;
+
+	// handles stay stable while the packed arrays are compacted with swaps
+	TArray<int32> IndexToHandle;
+	TArray<int32> HandleToIndex;
+	TArray<int32> FreeHandles;
+
+	TArray<FClawHit> Queue;
+};
+
+/**
+ * Applies damage to the health components of a world in batches.
+ *
+ * Health components register their health in the store at BeginPlay. Damage is queued as
+ * it happens and resolved once per frame, then the components broadcast their health and
+ * death events and call ITakeDamage on their owner. Setting claw.Damage.Batched to 0 goes
+ * back to every hit being applied on the spot.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawDamageSystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/**
+	 * Drop-in for UGameplayStatics::ApplyDamage. Queues the hit when the damaged actor's health
+	 * is in a damage system, otherwise applies it the usual way.
+	 */
+	static float ApplyDamage(AActor* DamagedActor, float BaseDamage, AController* EventInstigator, AActor* DamageCauser, TSubclassOf<UDamageType> DamageTypeClass);
+
+	bool IsBatched() const { return bBatched; }
+
+	// health components that begin play afterwards only join the batch while it is on
+	void SetBatched(bool bInBatched) { bBatched = bInBatched; }
+
+	// while the fixed step simulation resolves the hits after every step, Tick doesn't
+	void SetFixedStep(bool bInFixedStep) { bFixedStep = bInFixedStep; }
+
+	int32 Register(UHealthComponent* Health, float InitialHealth, float MaxHealth);
+	void Unregister(int32 Handle);
+
+	float GetHealth(int32 Handle) const { return Store.GetHealth(Handle); }
+	float ChangeHealth(int32 Handle, float Delta) { return Store.ChangeHealth(Handle, Delta); }
+
+	void QueueHit(int32 Handle, float Damage, const UDamageType* DamageType, AController* EventInstigator, AActor* DamageCauser);
+
+	/** Resolves the queued hits now and sends their events, done every frame by Tick. */
+	void ResolveHits();
+
+private:
+	// why a queued hit happened, shares the index of the store's queue
+	struct FHitSource
+	{
+		const UDamageType* DamageType;
+		TWeakObjectPtr<AController> Instigator;
+		TWeakObjectPtr<AActor> Causer;
+	};
+
+	bool bBatched = true;
+	bool bFixedStep = false;
+
+	FClawHealthStore Store;
+
+	// by store handle
+	UPROPERTY()
+	TArray<UHealthComponent*> Components;
+
+	TArray<FHitSource> HitSources;
+	TArray<FHitSource> ResolvingSources;
+	TArray<FClawHitResult> Results;
+
+	// target of each result, while its events are sent
+	UPROPERTY()
+	TArray<UHealthComponent*> ResolvingComponents;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawDigitCounter.h"
+#include "Rendering/DrawElements.h"
+#include "Widgets/SLeafWidget.h"
+
+// draws the digits of a value with the glyph brushes of its counter
+class SClawDigitCounter : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SClawDigitCounter) {}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const UClawDigitCounter* InCounter)
+	{
+		Counter = InCounter;
+		SetCanTick(false);
+	}
+
+	// returns true when the widget has to be drawn again
+	bool SetValue(int32 Value, int32 MinDigits)
+	{
+		uint8 NewDigits[10];
+		int32 NewNumDigits = 0;
+
+		// least significant first, the paint walks them backwards
+		uint32 Left = (uint32)FMath::Max(Value, 0);
+		do
+		{
+			NewDigits[NewNumDigits++] = Left % 10;
+			Left /= 10;
+		}
+		while (Left > 0);
+
+		while (NewNumDigits < MinDigits)
+		{
+			NewDigits[NewNumDigits++] = 0;
+		}
+
+		if (NewNumDigits != NumDigits)
+		{
+			FMemory::Memcpy(DigitValues, NewDigits, NewNumDigits);
+			NumDigits = NewNumDigits;
+			Invalidate(EInvalidateWidgetReason::Layout);
+			return true;
+		}
+
+		if (FMemory::Memcmp(DigitValues, NewDigits, NumDigits) != 0)
+		{
+			FMemory::Memcpy(DigitValues, NewDigits, NumDigits);
+			Invalidate(EInvalidateWidgetReason::Paint);
+			return true;
+		}
+
+		return false;
+	}
+
+	void RefreshLayout()
+	{
+		Invalidate(EInvalidateWidgetReason::Layout);
+	}
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override
+	{
+		const ESlateDrawEffect DrawEffects = ShouldBeEnabled(bParentEnabled) ? ESlateDrawEffect::None : ESlateDrawEffect::DisabledEffect;
+
+		float X = 0.0f;
+		for (int32 Index = NumDigits - 1; Index >= 0; --Index)
+		{
+			const FSlateBrush& Glyph = Counter->Digits[DigitValues[Index]];
+			FSlateDrawElement::MakeBox(OutDrawElements, LayerId,
+				AllottedGeometry.ToPaintGeometry(FVector2D(X, 0.0f), Glyph.ImageSize),
+				&Glyph, DrawEffects, InWidgetStyle.GetColorAndOpacityTint() * Glyph.GetTint(InWidgetStyle));
+			X += Glyph.ImageSize.X + Counter->Spacing;
+		}
+
+		return LayerId;
+	}
+
+protected:
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override
+	{
+		FVector2D Size = FVector2D::ZeroVector;
+		for (int32 Index = 0; Index < NumDigits; ++Index)
+		{
+			const FVector2D& GlyphSize = Counter->Digits[DigitValues[Index]].ImageSize;
+			Size.X += GlyphSize.X;
+			Size.Y = FMath::Max(Size.Y, GlyphSize.Y);
+		}
+		Size.X += Counter->Spacing * FMath::Max(NumDigits - 1, 0);
+		return Size;
+	}
+
+private:
+	// the counter owns the brushes and outlives its slate widget
+	const UClawDigitCounter* Counter = nullptr;
+
+	uint8 DigitValues[10] = {};
+	int32 NumDigits = 0;
+};
+
+UClawDigitCounter::UClawDigitCounter()
+{
+	Visibility = ESlateVisibility::HitTestInvisible;
+}
+
+bool UClawDigitCounter::SetValue(int32 InValue)
+{
+	Value = InValue;
+	return MyCounter.IsValid() && MyCounter->SetValue(Value, MinDigits);
+}
+
+void UClawDigitCounter::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	// the brushes or the padding may have changed in the designer
+	MyCounter->SetValue(Value, MinDigits);
+	MyCounter->RefreshLayout();
+}
+
+void UClawDigitCounter::ReleaseSlateResources(bool bReleaseChildren)
+{
+	Super::ReleaseSlateResources(bReleaseChildren);
+
+	MyCounter.Reset();
+}
+
+TSharedRef<SWidget> UClawDigitCounter::RebuildWidget()
+{
+	MyCounter = SNew(SClawDigitCounter, this);
+	return MyCounter.ToSharedRef();
+}
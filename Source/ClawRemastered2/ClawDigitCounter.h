@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/Widget.h"
+#include "Styling/SlateBrush.h"
+#include "ClawDigitCounter.generated.h"
+
+class SClawDigitCounter;
+
+/**
+ * A number drawn with one brush per digit, like the bitmap counters of the original game.
+ *
+ * Nothing is formatted or shaped, the value is split into digits and every digit is a box
+ * drawn with its glyph. The widget only invalidates its paint when a digit changed, and its
+ * layout when the number of digits did.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawDigitCounter : public UWidget
+{
+	GENERATED_BODY()
+
+public:
+	UClawDigitCounter();
+
+	// the glyphs of 0 to 9
+	UPROPERTY(EditAnywhere, Category = Appearance)
+	FSlateBrush Digits[10];
+
+	// padded with zeros up to this many digits
+	UPROPERTY(EditAnywhere, Category = Appearance, meta = (ClampMin = "1", ClampMax = "10"))
+	int32 MinDigits = 1;
+
+	// space between two glyphs
+	UPROPERTY(EditAnywhere, Category = Appearance)
+	float Spacing = 0.0f;
+
+	/** Shows the value, negative values show as zero. Returns true when a digit changed. */
+	bool SetValue(int32 Value);
+
+	int32 GetValue() const { return Value; }
+
+	// UWidget interface
+	virtual void SynchronizeProperties() override;
+	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+
+protected:
+	// UWidget interface
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+
+private:
+	int32 Value = 0;
+
+	TSharedPtr<SClawDigitCounter> MyCounter;
+};
@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawEnemyBehaviour.h"
+#include "ClawRemastered2.h"
+#include "TimerManager.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+
+namespace
+{
+	FClawBehaviourTransition MakeTransition(EClawBehaviourCondition Condition, FName TargetState, bool bWaitForDuration, bool bTurnAround = false, int32 Count = 0)
+	{
+		FClawBehaviourTransition Transition;
+		Transition.Condition = Condition;
+		Transition.TargetState = TargetState;
+		Transition.bWaitForDuration = bWaitForDuration;
+		Transition.bTurnAround = bTurnAround;
+		Transition.Count = Count;
+		return Transition;
+	}
+
+	FClawBehaviourState& AddState(UClawEnemyBehaviour* Behaviour, FName Name, EClawEnemyState Pose, EClawBehaviourMovement Movement, float Duration)
+	{
+		FClawBehaviourState& State = Behaviour->States.AddDefaulted_GetRef();
+		State.Name = Name;
+		State.Pose = Pose;
+		State.Movement = Movement;
+		State.Duration = Duration;
+		return State;
+	}
+
+	bool PassesCondition(const FClawBehaviourTransition& Transition, uint8 ClawFlags, uint8 Repeats)
+	{
+		switch (Transition.Condition)
+		{
+		case EClawBehaviourCondition::Always:
+			return true;
+		case EClawBehaviourCondition::ClawInSight:
+			return (ClawFlags & CLAW_InSight) != 0;
+		case EClawBehaviourCondition::ClawOutOfSight:
+			return (ClawFlags & CLAW_InSight) == 0;
+		case EClawBehaviourCondition::ClawInReach:
+			return (ClawFlags & CLAW_InReach) != 0;
+		case EClawBehaviourCondition::ClawOutOfReach:
+			return (ClawFlags & CLAW_InReach) == 0;
+		case EClawBehaviourCondition::Repeated:
+			return Repeats >= Transition.Count;
+		}
+		return false;
+	}
+}
+
+void UClawEnemyBehaviour::Compile()
+{
+	auto FindState = [this](FName Name)
+	{
+		return States.IndexOfByPredicate([Name](const FClawBehaviourState& State) { return State.Name == Name; });
+	};
+
+	InitialIndex = FMath::Max(FindState(InitialState), 0);
+	DeadIndex = States.IndexOfByPredicate([](const FClawBehaviourState& State) { return State.Pose == EClawEnemyState::Dead; });
+
+	for (FClawBehaviourState& State : States)
+	{
+		for (FClawBehaviourTransition& Transition : State.Transitions)
+		{
+			Transition.TargetIndex = FindState(Transition.TargetState);
+			if (Transition.TargetIndex == INDEX_NONE)
+			{
+				UE_LOG(LogClaw, Warning, TEXT("%s: state %s has a transition to unknown state %s"), *GetName(), *State.Name.ToString(), *Transition.TargetState.ToString());
+			}
+		}
+	}
+}
+
+void UClawEnemyBehaviour::PostLoad()
+{
+	Super::PostLoad();
+
+	Compile();
+}
+
+#if WITH_EDITOR
+void UClawEnemyBehaviour::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Compile();
+}
+#endif
+
+UClawEnemyBehaviour* UClawEnemyBehaviour::MakeEnemyBehaviour(UObject* Outer, float WalkDuration, float IdlingDuration)
+{
+	UClawEnemyBehaviour* Behaviour = NewObject<UClawEnemyBehaviour>(Outer);
+	Behaviour->InitialState = TEXT("Walk");
+
+	// walks back and forth three times, then looks around for a while
+	FClawBehaviourState& Walk = AddState(Behaviour, TEXT("Walk"), EClawEnemyState::Walking, EClawBehaviourMovement::Patrol, WalkDuration);
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("Aggroed"), false));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::Repeated, TEXT("Idle"), true, false, 2));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true, true));
+
+	FClawBehaviourState& Idle = AddState(Behaviour, TEXT("Idle"), EClawEnemyState::Idling, EClawBehaviourMovement::Stand, IdlingDuration);
+	Idle.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInSight, TEXT("Aggroed"), false));
+	Idle.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true, true));
+
+	FClawBehaviourState& Aggroed = AddState(Behaviour, TEXT("Aggroed"), EClawEnemyState::Aggroed, EClawBehaviourMovement::TowardClaw, 0.0f);
+	Aggroed.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawOutOfSight, TEXT("Walk"), false));
+
+	FClawBehaviourState& Dead = AddState(Behaviour, TEXT("Dead"), EClawEnemyState::Dead, EClawBehaviourMovement::Keep, 1.6f);
+	Dead.Action = EClawBehaviourAction::Destroy;
+	Dead.ActionTime = 1.6f;
+
+	Behaviour->Compile();
+	return Behaviour;
+}
+
+UClawEnemyBehaviour* UClawEnemyBehaviour::MakeEnemyCharacterBehaviour(UObject* Outer)
+{
+	UClawEnemyBehaviour* Behaviour = NewObject<UClawEnemyBehaviour>(Outer);
+	Behaviour->InitialState = TEXT("Walk");
+
+	FClawBehaviourState& Walk = AddState(Behaviour, TEXT("Walk"), EClawEnemyState::Walking, EClawBehaviourMovement::Patrol, 2.2f);
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("Sword"), false));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true, true));
+
+	// keeps swinging for as long as Claw stays in reach
+	FClawBehaviourState& Sword = AddState(Behaviour, TEXT("Sword"), EClawEnemyState::Attacking, EClawBehaviourMovement::Stand, 0.6f);
+	Sword.bDisableMovement = true;
+	Sword.Action = EClawBehaviourAction::MeleeDamage;
+	Sword.ActionTime = 0.5f;
+	Sword.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("Sword"), true));
+	Sword.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true));
+
+	FClawBehaviourState& Dead = AddState(Behaviour, TEXT("Dead"), EClawEnemyState::Dead, EClawBehaviourMovement::Keep, 0.6f);
+	Dead.Action = EClawBehaviourAction::Destroy;
+	Dead.ActionTime = 0.6f;
+
+	Behaviour->Compile();
+	return Behaviour;
+}
+
+UClawEnemyBehaviour* UClawEnemyBehaviour::MakeBlueOfficerBehaviour(UObject* Outer)
+{
+	UClawEnemyBehaviour* Behaviour = NewObject<UClawEnemyBehaviour>(Outer);
+	Behaviour->InitialState = TEXT("Walk");
+
+	// patrols for six legs, then idles
+	FClawBehaviourState& Walk = AddState(Behaviour, TEXT("Walk"), EClawEnemyState::Walking, EClawBehaviourMovement::Patrol, 1.5f);
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("GunBash"), false));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInSight, TEXT("GunAttack"), false));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::Repeated, TEXT("Idle"), true, false, 5));
+	Walk.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true, true));
+
+	FClawBehaviourState& Idle = AddState(Behaviour, TEXT("Idle"), EClawEnemyState::Idling, EClawBehaviourMovement::Stand, 6.0f);
+	Idle.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("GunBash"), false));
+	Idle.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInSight, TEXT("GunAttack"), false));
+	Idle.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true));
+
+	// bashes Claw when he's close, shoots at him while he's in sight
+	FClawBehaviourState& GunAttack = AddState(Behaviour, TEXT("GunAttack"), EClawEnemyState::Attacking, EClawBehaviourMovement::Stand, 1.5f);
+	GunAttack.bDisableMovement = true;
+	GunAttack.bCrouchWithClaw = true;
+	GunAttack.Action = EClawBehaviourAction::FireBullet;
+	GunAttack.ActionTime = 0.75f;
+	GunAttack.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("GunBash"), true));
+	GunAttack.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInSight, TEXT("GunAttack"), true));
+	GunAttack.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true));
+
+	FClawBehaviourState& GunBash = AddState(Behaviour, TEXT("GunBash"), EClawEnemyState::Bashing, EClawBehaviourMovement::Stand, 0.8f);
+	GunBash.bDisableMovement = true;
+	GunBash.Action = EClawBehaviourAction::MeleeDamage;
+	GunBash.ActionTime = 0.4f;
+	GunBash.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInReach, TEXT("GunBash"), true));
+	GunBash.Transitions.Add(MakeTransition(EClawBehaviourCondition::ClawInSight, TEXT("GunAttack"), true));
+	GunBash.Transitions.Add(MakeTransition(EClawBehaviourCondition::Always, TEXT("Walk"), true));
+
+	FClawBehaviourState& Dead = AddState(Behaviour, TEXT("Dead"), EClawEnemyState::Dead, EClawBehaviourMovement::Stand, 0.6f);
+	Dead.Action = EClawBehaviourAction::Destroy;
+	Dead.ActionTime = 0.6f;
+
+	Behaviour->Compile();
+	return Behaviour;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FClawBehaviourBrains
+
+int32 FClawBehaviourBrains::Add(const UClawEnemyBehaviour* Behaviour)
+{
+	check(Behaviour && Behaviour->States.Num() > 0);
+
+	const int32 Index = Behaviours.Add(Behaviour);
+	StateIndices.Add(Behaviour->GetInitialIndex());
+	Elapsed.Add(0.0f);
+	Repeats.Add(0);
+	ActionsDone.Add(false);
+	ClawFlags.Add(0);
+	return Index;
+}
+
+void FClawBehaviourBrains::RemoveAtSwap(int32 Index)
+{
+	Behaviours.RemoveAtSwap(Index, 1, false);
+	StateIndices.RemoveAtSwap(Index, 1, false);
+	Elapsed.RemoveAtSwap(Index, 1, false);
+	Repeats.RemoveAtSwap(Index, 1, false);
+	ActionsDone.RemoveAtSwap(Index, 1, false);
+	ClawFlags.RemoveAtSwap(Index, 1, false);
+}
+
+void FClawBehaviourBrains::Empty()
+{
+	Behaviours.Empty();
+	StateIndices.Empty();
+	Elapsed.Empty();
+	Repeats.Empty();
+	ActionsDone.Empty();
+	ClawFlags.Empty();
+}
+
+void FClawBehaviourBrains::Enter(int32 Index, int32 StateIndex)
+{
+	if (StateIndices[Index] == StateIndex)
+	{
+		Repeats[Index] = FMath::Min<int32>(Repeats[Index] + 1, MAX_uint8);
+	}
+	else
+	{
+		Repeats[Index] = 0;
+	}
+
+	StateIndices[Index] = StateIndex;
+	Elapsed[Index] = 0.0f;
+	ActionsDone[Index] = false;
+}
+
+void FClawBehaviourBrains::Advance(int32 First, int32 Last, float DeltaSeconds, TArray<FClawBehaviourEvent>& OutEvents)
+{
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		Elapsed[Index] += DeltaSeconds;
+	}
+
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		const FClawBehaviourState& State = GetState(Index);
+
+		if (!ActionsDone[Index] && State.Action != EClawBehaviourAction::None && Elapsed[Index] >= State.ActionTime)
+		{
+			ActionsDone[Index] = true;
+			OutEvents.Add({ Index, State.Action, false });
+		}
+
+		for (const FClawBehaviourTransition& Transition : State.Transitions)
+		{
+			if (Transition.TargetIndex == INDEX_NONE || (Transition.bWaitForDuration && Elapsed[Index] < State.Duration))
+			{
+				continue;
+			}
+
+			if (PassesCondition(Transition, ClawFlags[Index], Repeats[Index]))
+			{
+				Enter(Index, Transition.TargetIndex);
+				OutEvents.Add({ Index, EClawBehaviourAction::None, Transition.bTurnAround });
+				break;
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Enemies.BenchmarkTimers
+
+namespace
+{
+	/**
+	 * Runs the officer patrol both as the timer chain the officers used to set up and as
+	 * behaviour brains, over the same frames, to compare what each costs per frame.
+	 */
+	class FClawEnemyTimerBenchmark
+	{
+	public:
+		FClawEnemyTimerBenchmark(int32 NumBrains, int32 InNumFrames)
+			: Behaviour(UClawEnemyBehaviour::MakeBlueOfficerBehaviour(GetTransientPackage()))
+			, NumFrames(InNumFrames)
+		{
+			Patrols.SetNumZeroed(NumBrains);
+			for (int32 Brain = 0; Brain < NumBrains; ++Brain)
+			{
+				StartWalking(Brain);
+				Brains.Add(Behaviour.Get());
+			}
+		}
+
+		bool Tick(float)
+		{
+			// both sides simulate the same time, whatever the frame rate of the editor is
+			const float DeltaSeconds = 1.0f / 60.0f;
+
+			uint64 Start = FPlatformTime::Cycles64();
+			TimerManager.Tick(DeltaSeconds);
+			TimerCycles += FPlatformTime::Cycles64() - Start;
+
+			Start = FPlatformTime::Cycles64();
+			Brains.Advance(0, Brains.Num(), DeltaSeconds, Events);
+			TableCycles += FPlatformTime::Cycles64() - Start;
+
+			TableEvents += Events.Num();
+			Events.Reset();
+
+			if (++Frame < NumFrames)
+			{
+				return true;
+			}
+
+			const double TimerMicroseconds = FPlatformTime::ToMilliseconds64(TimerCycles) * 1000.0 / NumFrames;
+			const double TableMicroseconds = FPlatformTime::ToMilliseconds64(TableCycles) * 1000.0 / NumFrames;
+
+			// every SetTimer pushes onto the timer heap and every fired timer pops from it
+			UE_LOG(LogClaw, Display, TEXT("Enemy timer benchmark, %d brains over %d frames:"), Brains.Num(), NumFrames);
+			UE_LOG(LogClaw, Display, TEXT("  timer chains:   %.2f heap operations per frame, %.3f us per frame"), double(TimersSet + TimersFired) / NumFrames, TimerMicroseconds);
+			UE_LOG(LogClaw, Display, TEXT("  behaviour table: 0 heap operations, %.2f events per frame, %.3f us per frame"), double(TableEvents) / NumFrames, TableMicroseconds);
+			return false;
+		}
+
+	private:
+		void StartWalking(int32 Brain)
+		{
+			SetTimer(FTimerDelegate::CreateLambda([this, Brain]() { EndWalk(Brain); }), 1.5f);
+		}
+
+		void EndWalk(int32 Brain)
+		{
+			++TimersFired;
+
+			if (Patrols[Brain]++ < 5)
+			{
+				StartWalking(Brain);
+				return;
+			}
+
+			Patrols[Brain] = 0;
+			SetTimer(FTimerDelegate::CreateLambda([this, Brain]() { ++TimersFired; StartWalking(Brain); }), 6.0f);
+		}
+
+		void SetTimer(const FTimerDelegate& Delegate, float Rate)
+		{
+			FTimerHandle UnusedHandle;
+			TimerManager.SetTimer(UnusedHandle, Delegate, Rate, false);
+			++TimersSet;
+		}
+
+		TStrongObjectPtr<UClawEnemyBehaviour> Behaviour;
+		FClawBehaviourBrains Brains;
+		TArray<FClawBehaviourEvent> Events;
+
+		FTimerManager TimerManager;
+		TArray<int32> Patrols;
+
+		int32 NumFrames;
+		int32 Frame = 0;
+
+		int64 TimersSet = 0;
+		int64 TimersFired = 0;
+		int64 TableEvents = 0;
+
+		uint64 TimerCycles = 0;
+		uint64 TableCycles = 0;
+	};
+
+	void BenchmarkEnemyTimers(const TArray<FString>& Args)
+	{
+		const int32 NumBrains = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+		const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 600;
+
+		// the timer manager only ticks once per engine frame, so the benchmark runs over real frames
+		TSharedRef<FClawEnemyTimerBenchmark> Benchmark = MakeShared<FClawEnemyTimerBenchmark>(NumBrains, NumFrames);
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Benchmark](float DeltaTime)
+		{
+			return Benchmark->Tick(DeltaTime);
+		}));
+	}
+
+	FAutoConsoleCommand BenchmarkEnemyTimersCommand(
+		TEXT("claw.Enemies.BenchmarkTimers"),
+		TEXT("Compares the old enemy timer chains with the behaviour table.\n")
+		TEXT("Usage: claw.Enemies.BenchmarkTimers [Brains=1000] [Frames=600]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkEnemyTimers));
+}
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ClawEnemyBehaviour.generated.h"
+
+// the pose of an enemy brain, picks the animation and how the enemy reacts
+UENUM()
+enum class EClawEnemyState : uint8
+{
+	Walking,
+	Idling,
+	Aggroed,
+	Attacking,
+	CrouchAttacking,
+	Bashing,
+	Hurt,
+	Dead,
+
+	Count UMETA(Hidden)
+};
+
+// how a behaviour state moves the enemy
+UENUM()
+enum class EClawBehaviourMovement : uint8
+{
+	// stand still
+	Stand,
+	// walk in the direction the enemy is facing
+	Patrol,
+	// turn to Claw and walk towards him
+	TowardClaw,
+	// keep whatever direction the enemy set itself, used by death slides
+	Keep
+};
+
+// what a behaviour state does once it ran for ActionTime seconds
+UENUM()
+enum class EClawBehaviourAction : uint8
+{
+	None,
+	FireBullet,
+	MeleeDamage,
+	Destroy
+};
+
+// what has to be true for a transition to be taken
+UENUM()
+enum class EClawBehaviourCondition : uint8
+{
+	Always,
+	ClawInSight,
+	ClawOutOfSight,
+	ClawInReach,
+	ClawOutOfReach,
+	// the state was re-entered from itself at least Count times in a row
+	Repeated
+};
+
+// bits of FClawBehaviourBrains::ClawFlags
+enum EClawBehaviourFlags : uint8
+{
+	CLAW_InSight = 1 << 0,
+	CLAW_InReach = 1 << 1
+};
+
+USTRUCT()
+struct FClawBehaviourTransition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	EClawBehaviourCondition Condition = EClawBehaviourCondition::Always;
+
+	// only used by the Repeated condition
+	UPROPERTY(EditAnywhere)
+	int32 Count = 0;
+
+	// wait until the state ran for its whole duration before checking the condition
+	UPROPERTY(EditAnywhere)
+	bool bWaitForDuration = true;
+
+	// turn the enemy around when the transition is taken
+	UPROPERTY(EditAnywhere)
+	bool bTurnAround = false;
+
+	UPROPERTY(EditAnywhere)
+	FName TargetState;
+
+	// TargetState resolved by UClawEnemyBehaviour::Compile
+	int32 TargetIndex = INDEX_NONE;
+};
+
+USTRUCT()
+struct FClawBehaviourState
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	FName Name;
+
+	UPROPERTY(EditAnywhere)
+	EClawEnemyState Pose = EClawEnemyState::Idling;
+
+	UPROPERTY(EditAnywhere)
+	EClawBehaviourMovement Movement = EClawBehaviourMovement::Stand;
+
+	// turn the movement component off for the whole state, used by attacks
+	UPROPERTY(EditAnywhere)
+	bool bDisableMovement = false;
+
+	// use the crouching variant of the pose when Claw is crouching
+	UPROPERTY(EditAnywhere)
+	bool bCrouchWithClaw = false;
+
+	// seconds the state lasts before transitions that wait for it are checked
+	UPROPERTY(EditAnywhere)
+	float Duration = 0.0f;
+
+	UPROPERTY(EditAnywhere)
+	EClawBehaviourAction Action = EClawBehaviourAction::None;
+
+	UPROPERTY(EditAnywhere)
+	float ActionTime = 0.0f;
+
+	// checked in order, the first one that passes is taken
+	UPROPERTY(EditAnywhere)
+	TArray<FClawBehaviourTransition> Transitions;
+};
+
+/**
+ * A compact state machine for enemy behaviour: states with a pose, a duration and an
+ * optional timed action, linked by transitions. Enemies advance through it from the
+ * elapsed time of their brain, without any timer manager entries.
+ */
+UCLASS(BlueprintType)
+class CLAWREMASTERED2_API UClawEnemyBehaviour : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = Behaviour)
+	FName InitialState;
+
+	UPROPERTY(EditAnywhere, Category = Behaviour)
+	TArray<FClawBehaviourState> States;
+
+	/** Resolves the state names of the transitions, needed after States was changed. */
+	void Compile();
+
+	int32 GetInitialIndex() const { return InitialIndex; }
+	int32 GetDeadIndex() const { return DeadIndex; }
+
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// the behaviours the enemies used to run with timer chains
+	static UClawEnemyBehaviour* MakeEnemyBehaviour(UObject* Outer, float WalkDuration, float IdlingDuration);
+	static UClawEnemyBehaviour* MakeEnemyCharacterBehaviour(UObject* Outer);
+	static UClawEnemyBehaviour* MakeBlueOfficerBehaviour(UObject* Outer);
+
+private:
+	int32 InitialIndex = 0;
+	int32 DeadIndex = INDEX_NONE;
+};
+
+// something the behaviour of a brain wants the enemy to do
+struct FClawBehaviourEvent
+{
+	int32 Index;
+
+	// the action to run, or None when the brain entered a new state
+	EClawBehaviourAction Action;
+
+	bool bTurnAround;
+};
+
+/**
+ * The behaviour part of the enemy brains, kept in packed arrays that share their
+ * index with the rest of the enemy manager's data.
+ */
+struct CLAWREMASTERED2_API FClawBehaviourBrains
+{
+	TArray<const UClawEnemyBehaviour*> Behaviours;
+	TArray<int32> StateIndices;
+	TArray<float> Elapsed;
+	TArray<uint8> Repeats;
+	TArray<bool> ActionsDone;
+	TArray<uint8> ClawFlags;
+
+	int32 Add(const UClawEnemyBehaviour* Behaviour);
+	void RemoveAtSwap(int32 Index);
+	void Empty();
+
+	int32 Num() const { return Behaviours.Num(); }
+
+	const FClawBehaviourState& GetState(int32 Index) const
+	{
+		return Behaviours[Index]->States[StateIndices[Index]];
+	}
+
+	void Enter(int32 Index, int32 StateIndex);
+
+	/** Advances the brains in [First, Last) and queues the state changes and actions they ran into. */
+	void Advance(int32 First, int32 Last, float DeltaSeconds, TArray<FClawBehaviourEvent>& OutEvents);
+};
@@ -0,0 +1,950 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawEnemyManager.h"
+#include "PaperCharacter.h"
+#include "PaperFlipbookComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "HealthComponent.h"
+#include "Enemy.h"
+#include "EnemyCharacter.h"
+#include "BlueOfficer.h"
+#include "ClawStats.h"
+#include "ClawSpatialHash.h"
+#include "ClawFlipbookRenderer.h"
+#include "ClawNet.h"
+#include "ClawRemastered2Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Enemy Batched Update"), STAT_ClawEnemyBatchedUpdate, STATGROUP_Claw);
+DECLARE_CYCLE_STAT(TEXT("Enemy Actor Tick"), STAT_ClawEnemyActorTick, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies Updated"), STAT_ClawEnemiesUpdated, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy State Changes"), STAT_ClawEnemyStateChanges, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Enemy Brains"), STAT_ClawEnemyBrains, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemy Net State Changes"), STAT_ClawEnemyNetStateChanges, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies Gone Dormant"), STAT_ClawEnemiesGoneDormant, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawEnemyBatchedUpdate(
+	TEXT("claw.Enemies.BatchedUpdate"),
+	1,
+	TEXT("1: all enemy brains are updated in one pass by the enemy manager.\n")
+	TEXT("0: every enemy ticks its own brain (the per-actor path).\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawEnemyInstancedSprites(
+	TEXT("claw.Enemies.InstancedSprites"),
+	1,
+	TEXT("1: enemies are drawn by the flipbook renderer, one instanced batch per texture.\n")
+	TEXT("0: every enemy ticks and draws its own flipbook component.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+void UClawEnemyManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bBatched = CVarClawEnemyBatchedUpdate.GetValueOnGameThread() != 0;
+	bInstancedSprites = CVarClawEnemyInstancedSprites.GetValueOnGameThread() != 0;
+	bNetDormancy = ClawNet::IsDormancyEnabled();
+	NetDormancyDelay = ClawNet::GetDormancyDelay();
+
+	SpatialHash = Collection.InitializeDependency<UClawSpatialHash>();
+	FlipbookRenderer = Collection.InitializeDependency<UClawFlipbookRenderer>();
+}
+
+void UClawEnemyManager::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawEnemyBrains, Proxies.Num());
+
+	Proxies.Empty();
+	Healths.Empty();
+	Kinds.Empty();
+	States.Empty();
+	Positions.Empty();
+	Moving.Empty();
+	MoveDirections.Empty();
+	Facings.Empty();
+	AppliedFacings.Empty();
+	MovementDisabled.Empty();
+	Flipbooks.Empty();
+	AppliedFlipbooks.Empty();
+	Senses.Empty();
+	SpatialHandles.Empty();
+	SpriteHandles.Empty();
+	Remote.Empty();
+	NetIdleTimes.Empty();
+	StepStartLocations.Empty();
+	SpriteLocations.Empty();
+	SightClaws.Empty();
+	ReachClaws.Empty();
+	ClawViews.Empty();
+	Brains.Empty();
+	IndexToHandle.Empty();
+	HandleToIndex.Empty();
+	FreeHandles.Empty();
+	DefaultBehaviourKeys.Empty();
+	DefaultBehaviours.Empty();
+
+	Super::Deinitialize();
+}
+
+void UClawEnemyManager::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawEnemyBatchedUpdate);
+
+	UpdateEnemies(0, Proxies.Num(), DeltaSeconds);
+}
+
+ETickableTickType UClawEnemyManager::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawEnemyManager::IsTickable() const
+{
+	return bBatched && !bFixedStep && Proxies.Num() > 0;
+}
+
+TStatId UClawEnemyManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawEnemyManager, STATGROUP_Tickables);
+}
+
+UWorld* UClawEnemyManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+int32 UClawEnemyManager::RegisterEnemy(APaperCharacter* Enemy, EClawEnemyKind Kind, UHealthComponent* Health, const FClawEnemyFlipbooks& EnemyFlipbooks, const FClawEnemySenses& EnemySenses, const UClawEnemyBehaviour* Behaviour)
+{
+	check(Enemy && Behaviour);
+
+	const FVector Location = Enemy->GetActorLocation();
+
+	const int32 Index = Proxies.Add(Enemy);
+	Healths.Add(Health);
+	Kinds.Add(Kind);
+	States.Add(EClawEnemyState::Walking);
+	Positions.Add(FVector2D(Location.X, Location.Z));
+	Moving.Add(false);
+	MoveDirections.Add(0.0f);
+	Facings.Add(1.0f);
+	// no facing has been applied yet, so the first update always sets the rotation
+	AppliedFacings.Add(0.0f);
+	MovementDisabled.Add(false);
+	Flipbooks.Add(EnemyFlipbooks);
+	AppliedFlipbooks.Add(nullptr);
+	Senses.Add(EnemySenses);
+	Brains.Add(Behaviour);
+
+	// the sense boxes are looked up in the spatial hash, so their overlaps are no longer needed
+	if (SpatialHash->IsQuerying())
+	{
+		const UCapsuleComponent* Capsule = Enemy->GetCapsuleComponent();
+		SpatialHandles.Add(SpatialHash->Insert(Enemy, FClawSpatialGrid::MakeBounds(Location, FVector(Capsule->GetScaledCapsuleRadius(), 0.0f, Capsule->GetScaledCapsuleHalfHeight())), CLAW_SpatialEnemy));
+
+		for (UBoxComponent* Box : { EnemySenses.Sight, EnemySenses.Reach })
+		{
+			if (Box)
+			{
+				Box->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			}
+		}
+	}
+	else
+	{
+		SpatialHandles.Add(INDEX_NONE);
+	}
+
+	// the renderer shows the flipbooks from now on, the component only keeps its transform
+	if (bInstancedSprites)
+	{
+		UPaperFlipbookComponent* Sprite = Enemy->GetSprite();
+		Sprite->SetVisibility(false);
+		Sprite->SetComponentTickEnabled(false);
+
+		SpriteHandles.Add(FlipbookRenderer->AddInstance(nullptr, Sprite->GetRelativeTransform(), Location, 1.0f));
+	}
+	else
+	{
+		SpriteHandles.Add(INDEX_NONE);
+	}
+
+	// the server moves and animates the enemy, the client only shows what it replicated,
+	// and the fixed step simulation moves it by hand
+	const bool bRemote = !Enemy->HasAuthority();
+	if (bRemote || bFixedStep)
+	{
+		Enemy->GetCharacterMovement()->SetComponentTickEnabled(false);
+	}
+	Remote.Add(bRemote);
+	NetIdleTimes.Add(0.0f);
+	StepStartLocations.Add(Location);
+	SpriteLocations.Add(Enemy->GetSprite()->GetRelativeLocation());
+	SightClaws.AddDefaulted();
+	ReachClaws.AddDefaulted();
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = HandleToIndex.Add(INDEX_NONE);
+	}
+
+	HandleToIndex[Handle] = Index;
+	IndexToHandle.Add(Handle);
+
+	if (Health)
+	{
+		Health->OnDeath().AddUObject(this, &UClawEnemyManager::OnEnemyDeath, Handle);
+	}
+
+	EnterState(Index, false);
+
+	// a spawned enemy got its first state before it began play, one placed in the level
+	// begins play before anything was replicated and still has the default state
+	const FClawNetEnemyState* NetState = GetNetState(Index);
+	if (bRemote && *NetState != FClawNetEnemyState())
+	{
+		ApplyNetState(Handle, *NetState);
+	}
+
+	INC_DWORD_STAT(STAT_ClawEnemyBrains);
+
+	return Handle;
+}
+
+void UClawEnemyManager::UnregisterEnemy(int32 Handle)
+{
+	if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Index = HandleToIndex[Handle];
+
+	// the packed arrays can't be compacted while they are being walked,
+	// so clear the proxy and remove the brain once the update is done
+	if (bUpdating)
+	{
+		Proxies[Index] = nullptr;
+		PendingRemovals.Add(Handle);
+		return;
+	}
+
+	RemoveEnemyAt(Index);
+}
+
+const UClawEnemyBehaviour* UClawEnemyManager::GetDefaultBehaviour(EClawEnemyKind Kind, float WalkDuration, float IdlingDuration)
+{
+	// enemies of a kind mostly share their durations, so only a handful of behaviours get built
+	for (int32 Index = 0; Index < DefaultBehaviourKeys.Num(); ++Index)
+	{
+		const FDefaultBehaviourKey& Key = DefaultBehaviourKeys[Index];
+		if (Key.Kind == Kind && Key.WalkDuration == WalkDuration && Key.IdlingDuration == IdlingDuration)
+		{
+			return DefaultBehaviours[Index];
+		}
+	}
+
+	UClawEnemyBehaviour* Behaviour = nullptr;
+	switch (Kind)
+	{
+	case EClawEnemyKind::Enemy:
+		Behaviour = UClawEnemyBehaviour::MakeEnemyBehaviour(this, WalkDuration, IdlingDuration);
+		break;
+	case EClawEnemyKind::EnemyCharacter:
+		Behaviour = UClawEnemyBehaviour::MakeEnemyCharacterBehaviour(this);
+		break;
+	case EClawEnemyKind::BlueOfficer:
+		Behaviour = UClawEnemyBehaviour::MakeBlueOfficerBehaviour(this);
+		break;
+	}
+
+	DefaultBehaviourKeys.Add({ Kind, WalkDuration, IdlingDuration });
+	DefaultBehaviours.Add(Behaviour);
+
+	return Behaviour;
+}
+
+void UClawEnemyManager::TickEnemy(int32 Handle, float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawEnemyActorTick);
+
+	const int32 Index = IndexOf(Handle);
+	UpdateEnemies(Index, Index + 1, DeltaSeconds);
+}
+
+void UClawEnemyManager::SimulateStep(float StepSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawEnemyBatchedUpdate);
+
+	UpdateEnemies(0, Proxies.Num(), StepSeconds);
+
+	// the movement components consume the input the brains just added
+	for (int32 Index = 0; Index < Proxies.Num(); ++Index)
+	{
+		APaperCharacter* Proxy = Proxies[Index];
+		if (Proxy && !Remote[Index])
+		{
+			StepStartLocations[Index] = Proxy->GetActorLocation();
+
+			UCharacterMovementComponent* Movement = Proxy->GetCharacterMovement();
+			Movement->TickComponent(StepSeconds, LEVELTICK_All, &Movement->PrimaryComponentTick);
+		}
+	}
+}
+
+void UClawEnemyManager::InterpolateStep(float Alpha)
+{
+	for (int32 Index = 0; Index < Proxies.Num(); ++Index)
+	{
+		APaperCharacter* Proxy = Proxies[Index];
+		if (!Proxy || Remote[Index])
+		{
+			continue;
+		}
+
+		const FVector Location = Proxy->GetActorLocation();
+		const FVector DrawnLocation = FMath::Lerp(StepStartLocations[Index], Location, Alpha);
+
+		if (SpriteHandles[Index] != INDEX_NONE)
+		{
+			// the update already put the instance of an enemy that stands still in place
+			if (!Location.Equals(StepStartLocations[Index]))
+			{
+				FlipbookRenderer->SetLocation(SpriteHandles[Index], DrawnLocation);
+			}
+		}
+		else
+		{
+			// the actor turns around to face right, so the offset goes into its space
+			const FVector Offset = Proxy->GetActorTransform().InverseTransformVectorNoScale(DrawnLocation - Location);
+			UPaperFlipbookComponent* Sprite = Proxy->GetSprite();
+			if (!Sprite->GetRelativeLocation().Equals(SpriteLocations[Index] + Offset))
+			{
+				Sprite->SetRelativeLocation(SpriteLocations[Index] + Offset);
+			}
+		}
+	}
+}
+
+void UClawEnemyManager::UpdateEnemies(int32 First, int32 Last, float DeltaSeconds)
+{
+	bUpdating = true;
+
+	const bool bServing = ClawNet::IsServing(GetWorld());
+
+	RefreshClaws();
+
+	// refresh the cached positions, an enemy is moving when it changed place since the last update
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		if (const APaperCharacter* Proxy = Proxies[Index])
+		{
+			const FVector Location = Proxy->GetActorLocation();
+			const FVector2D Position(Location.X, Location.Z);
+
+			Moving[Index] = !Position.Equals(Positions[Index], KINDA_SMALL_NUMBER);
+			Positions[Index] = Position;
+
+			if (Moving[Index] && SpriteHandles[Index] != INDEX_NONE)
+			{
+				FlipbookRenderer->SetLocation(SpriteHandles[Index], Location);
+			}
+
+			if (Moving[Index] && SpatialHandles[Index] != INDEX_NONE)
+			{
+				const UCapsuleComponent* Capsule = Proxy->GetCapsuleComponent();
+				SpatialHash->Move(SpatialHandles[Index], FClawSpatialGrid::MakeBounds(Location, FVector(Capsule->GetScaledCapsuleRadius(), 0.0f, Capsule->GetScaledCapsuleHalfHeight())));
+			}
+		}
+	}
+
+	UpdateSenses(First, Last);
+
+	// the enemies that ran out of health since the last update enter their dead state before the behaviours run
+	for (int32 Handle : PendingDeaths)
+	{
+		const int32 Index = HandleToIndex[Handle];
+		if (Index != INDEX_NONE && !Remote[Index] && States[Index] != EClawEnemyState::Dead)
+		{
+			DispatchDeath(Index);
+		}
+	}
+	PendingDeaths.Reset();
+
+	Brains.Advance(First, Last, DeltaSeconds, PendingEvents);
+
+	// apply the state changes first, so the passes below already see the new states
+	for (const FClawBehaviourEvent& Event : PendingEvents)
+	{
+		if (Event.Action == EClawBehaviourAction::None && !Remote[Event.Index])
+		{
+			EnterState(Event.Index, Event.bTurnAround);
+		}
+	}
+
+	// pick the walking direction from the movement of the current state
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		if (Remote[Index])
+		{
+			continue;
+		}
+
+		switch (Brains.GetState(Index).Movement)
+		{
+		case EClawBehaviourMovement::Stand:
+			MoveDirections[Index] = 0.0f;
+			break;
+		case EClawBehaviourMovement::Patrol:
+			MoveDirections[Index] = Facings[Index];
+			break;
+		case EClawBehaviourMovement::TowardClaw:
+		{
+			const int32 View = FindClawView(Index);
+			if (View != INDEX_NONE)
+			{
+				Facings[Index] = ClawViews[View].X > Positions[Index].X ? 1.0f : -1.0f;
+				MoveDirections[Index] = Facings[Index];
+			}
+			else
+			{
+				MoveDirections[Index] = 0.0f;
+			}
+			break;
+		}
+		case EClawBehaviourMovement::Keep:
+			break;
+		}
+	}
+
+	// feed the walking direction to the movement components
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		if (MoveDirections[Index] != 0.0f && Proxies[Index])
+		{
+			Proxies[Index]->AddMovementInput(FVector(MoveDirections[Index], 0.0f, 0.0f), 1);
+		}
+	}
+
+	// the sprites look to the left, so facing right means turning around
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		if (Facings[Index] != AppliedFacings[Index] && Proxies[Index])
+		{
+			Proxies[Index]->SetActorRotation(FRotator(0.0f, Facings[Index] > 0.0f ? 180.0f : 0.0f, 0.0f));
+			AppliedFacings[Index] = Facings[Index];
+
+			if (SpriteHandles[Index] != INDEX_NONE)
+			{
+				FlipbookRenderer->SetFacing(SpriteHandles[Index], Facings[Index]);
+			}
+		}
+	}
+
+	// only touch the flipbook component when the animation actually changes
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		// the replicated state of a remote enemy already tells whether it stands still
+		EClawEnemyState AnimationState = States[Index];
+		if (AnimationState == EClawEnemyState::Walking && Flipbooks[Index].bIdleWhenStill && !Moving[Index] && !Remote[Index])
+		{
+			AnimationState = EClawEnemyState::Idling;
+		}
+
+		if (bServing && Proxies[Index])
+		{
+			UpdateNetState(Index, AnimationState, DeltaSeconds);
+		}
+
+		UPaperFlipbook* DesiredAnimation = Flipbooks[Index].ByState[(int32)AnimationState];
+		if (DesiredAnimation != AppliedFlipbooks[Index] && Proxies[Index])
+		{
+			if (SpriteHandles[Index] != INDEX_NONE)
+			{
+				FlipbookRenderer->SetFlipbook(SpriteHandles[Index], DesiredAnimation);
+			}
+			else
+			{
+				Proxies[Index]->GetSprite()->SetFlipbook(DesiredAnimation);
+			}
+			AppliedFlipbooks[Index] = DesiredAnimation;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_ClawEnemiesUpdated, Last - First);
+
+	for (const FClawBehaviourEvent& Event : PendingEvents)
+	{
+		if (Event.Action != EClawBehaviourAction::None && !Remote[Event.Index])
+		{
+			DispatchAction(Event.Index, Event.Action);
+		}
+	}
+	PendingEvents.Reset();
+
+	bUpdating = false;
+
+	FlushPendingRemovals();
+}
+
+void UClawEnemyManager::RefreshClaws()
+{
+	// the batched update and the per-actor ticks share one lookup per frame, a fixed step
+	// looks again, the Claws moved since the last one
+	if (ClawFrame == GFrameCounter && !bFixedStep)
+	{
+		return;
+	}
+	ClawFrame = GFrameCounter;
+
+	// a server sees the Claws of every player, a client only has its own controller
+	ClawViews.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (const AClawRemastered2Character* ClawCharacter = PlayerController ? Cast<AClawRemastered2Character>(PlayerController->GetPawn()) : nullptr)
+		{
+			ClawViews.Add({ ClawCharacter, (float)ClawCharacter->GetActorLocation().X, ClawCharacter->isCrouching });
+		}
+	}
+}
+
+int32 UClawEnemyManager::FindClawView(int32 Index) const
+{
+	// the Claws in reach come first, they are the ones the attacks go for
+	const uint8 Flags = Brains.ClawFlags[Index];
+	int32 View = INDEX_NONE;
+	if (Flags & CLAW_InReach)
+	{
+		View = FindNearestClawView(Index, &ReachClaws[Index]);
+	}
+	if (View == INDEX_NONE && (Flags & CLAW_InSight))
+	{
+		View = FindNearestClawView(Index, &SightClaws[Index]);
+	}
+	return View != INDEX_NONE ? View : FindNearestClawView(Index, nullptr);
+}
+
+int32 UClawEnemyManager::FindNearestClawView(int32 Index, const FClawSensedClaws* Sensed) const
+{
+	int32 Nearest = INDEX_NONE;
+	for (int32 View = 0; View < ClawViews.Num(); ++View)
+	{
+		if (Sensed && !Sensed->Contains(ClawViews[View].Actor))
+		{
+			continue;
+		}
+		if (Nearest == INDEX_NONE || FMath::Abs(ClawViews[View].X - Positions[Index].X) < FMath::Abs(ClawViews[Nearest].X - Positions[Index].X))
+		{
+			Nearest = View;
+		}
+	}
+	return Nearest;
+}
+
+void UClawEnemyManager::UpdateSenses(int32 First, int32 Last)
+{
+	if (!SpatialHash->IsQuerying())
+	{
+		return;
+	}
+
+	// only the Claws are in the channel, a sense box senses every one the query finds
+	for (int32 Index = First; Index < Last; ++Index)
+	{
+		if (!Proxies[Index] || States[Index] == EClawEnemyState::Dead)
+		{
+			continue;
+		}
+
+		uint8 Flags = 0;
+		if (const UBoxComponent* Sight = Senses[Index].Sight)
+		{
+			SensedActors.Reset();
+			SpatialHash->QueryBox(FClawSpatialGrid::MakeBounds(Sight->GetComponentLocation(), Sight->GetScaledBoxExtent()), CLAW_SpatialClaw, SensedActors);
+			Flags |= SensedActors.Num() > 0 ? CLAW_InSight : 0;
+			SightClaws[Index].Reset();
+			SightClaws[Index].Append(SensedActors);
+		}
+		if (const UBoxComponent* Reach = Senses[Index].Reach)
+		{
+			SensedActors.Reset();
+			SpatialHash->QueryBox(FClawSpatialGrid::MakeBounds(Reach->GetComponentLocation(), Reach->GetScaledBoxExtent()), CLAW_SpatialClaw, SensedActors);
+			Flags |= SensedActors.Num() > 0 ? CLAW_InReach : 0;
+			ReachClaws[Index].Reset();
+			ReachClaws[Index].Append(SensedActors);
+		}
+		Brains.ClawFlags[Index] = Flags;
+	}
+}
+
+void UClawEnemyManager::EnterState(int32 Index, bool bTurnAround)
+{
+	const FClawBehaviourState& State = Brains.GetState(Index);
+
+	EClawEnemyState Pose = State.Pose;
+	if (State.bCrouchWithClaw && Pose == EClawEnemyState::Attacking)
+	{
+		const int32 View = FindClawView(Index);
+		if (View != INDEX_NONE && ClawViews[View].bCrouching)
+		{
+			Pose = EClawEnemyState::CrouchAttacking;
+		}
+	}
+	States[Index] = Pose;
+
+	if (bTurnAround)
+	{
+		Facings[Index] = -Facings[Index];
+	}
+
+	// attacks stop the movement component so the enemy doesn't slide while it strikes
+	APaperCharacter* Proxy = Proxies[Index];
+	if (State.bDisableMovement != MovementDisabled[Index] && Proxy)
+	{
+		if (State.bDisableMovement)
+		{
+			Proxy->GetCharacterMovement()->DisableMovement();
+		}
+		else
+		{
+			Proxy->GetCharacterMovement()->SetMovementMode(MOVE_Walking);
+		}
+		MovementDisabled[Index] = State.bDisableMovement;
+	}
+
+	INC_DWORD_STAT(STAT_ClawEnemyStateChanges);
+}
+
+void UClawEnemyManager::DispatchAction(int32 Index, EClawBehaviourAction Action)
+{
+	APaperCharacter* Proxy = Proxies[Index];
+	if (!Proxy)
+	{
+		return;
+	}
+
+	switch (Action)
+	{
+	case EClawBehaviourAction::FireBullet:
+		if (Kinds[Index] == EClawEnemyKind::BlueOfficer)
+		{
+			static_cast<ABlueOfficer*>(Proxy)->FireBullet();
+		}
+		break;
+	case EClawBehaviourAction::MeleeDamage:
+		if (Kinds[Index] == EClawEnemyKind::BlueOfficer)
+		{
+			static_cast<ABlueOfficer*>(Proxy)->DealDamage();
+		}
+		else if (Kinds[Index] == EClawEnemyKind::EnemyCharacter)
+		{
+			static_cast<AEnemyCharacter*>(Proxy)->DealDamage();
+		}
+		break;
+	case EClawBehaviourAction::Destroy:
+		// the brain is unregistered from EndPlay, which is deferred while the update runs
+		Proxy->Destroy();
+		break;
+	case EClawBehaviourAction::None:
+		break;
+	}
+}
+
+void UClawEnemyManager::OnEnemyDeath(UHealthComponent* Health, int32 Handle)
+{
+	// damage can arrive in the middle of the update, so the death waits for the next one
+	PendingDeaths.Add(Handle);
+}
+
+void UClawEnemyManager::DispatchDeath(int32 Index)
+{
+	APaperCharacter* Proxy = Proxies[Index];
+	if (!Proxy)
+	{
+		return;
+	}
+
+	switch (Kinds[Index])
+	{
+	case EClawEnemyKind::EnemyCharacter:
+		static_cast<AEnemyCharacter*>(Proxy)->HandleDeath();
+		break;
+	case EClawEnemyKind::BlueOfficer:
+		static_cast<ABlueOfficer*>(Proxy)->HandleDeath();
+		break;
+	case EClawEnemyKind::Enemy:
+		// AEnemy dies from its OnDamageTaken callback
+		break;
+	}
+}
+
+void UClawEnemyManager::RemoveEnemyAt(int32 Index)
+{
+	const int32 Handle = IndexToHandle[Index];
+	const int32 LastHandle = IndexToHandle.Last();
+
+	if (SpatialHandles[Index] != INDEX_NONE)
+	{
+		SpatialHash->Remove(SpatialHandles[Index]);
+	}
+	if (SpriteHandles[Index] != INDEX_NONE)
+	{
+		FlipbookRenderer->RemoveInstance(SpriteHandles[Index]);
+	}
+	if (Healths[Index])
+	{
+		Healths[Index]->OnDeath().RemoveAll(this);
+	}
+	PendingDeaths.Remove(Handle);
+
+	Proxies.RemoveAtSwap(Index, 1, false);
+	Healths.RemoveAtSwap(Index, 1, false);
+	Kinds.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	Positions.RemoveAtSwap(Index, 1, false);
+	Moving.RemoveAtSwap(Index, 1, false);
+	MoveDirections.RemoveAtSwap(Index, 1, false);
+	Facings.RemoveAtSwap(Index, 1, false);
+	AppliedFacings.RemoveAtSwap(Index, 1, false);
+	MovementDisabled.RemoveAtSwap(Index, 1, false);
+	Flipbooks.RemoveAtSwap(Index, 1, false);
+	AppliedFlipbooks.RemoveAtSwap(Index, 1, false);
+	Senses.RemoveAtSwap(Index, 1, false);
+	SpatialHandles.RemoveAtSwap(Index, 1, false);
+	SpriteHandles.RemoveAtSwap(Index, 1, false);
+	Remote.RemoveAtSwap(Index, 1, false);
+	NetIdleTimes.RemoveAtSwap(Index, 1, false);
+	StepStartLocations.RemoveAtSwap(Index, 1, false);
+	SpriteLocations.RemoveAtSwap(Index, 1, false);
+	SightClaws.RemoveAtSwap(Index, 1, false);
+	ReachClaws.RemoveAtSwap(Index, 1, false);
+	Brains.RemoveAtSwap(Index);
+	IndexToHandle.RemoveAtSwap(Index, 1, false);
+
+	// the last brain was moved into the freed slot
+	HandleToIndex[LastHandle] = Index;
+	HandleToIndex[Handle] = INDEX_NONE;
+	FreeHandles.Add(Handle);
+
+	DEC_DWORD_STAT(STAT_ClawEnemyBrains);
+}
+
+void UClawEnemyManager::FlushPendingRemovals()
+{
+	for (int32 Handle : PendingRemovals)
+	{
+		if (HandleToIndex[Handle] != INDEX_NONE)
+		{
+			RemoveEnemyAt(HandleToIndex[Handle]);
+		}
+	}
+	PendingRemovals.Reset();
+}
+
+void UClawEnemyManager::UpdateNetState(int32 Index, EClawEnemyState AnimationState, float DeltaSeconds)
+{
+	APaperCharacter* Proxy = Proxies[Index];
+	FClawNetEnemyState* NetState = GetNetState(Index);
+
+	const FClawNetEnemyState NewState(Proxy->GetActorLocation(), (uint8)AnimationState, Facings[Index] > 0.0f);
+	if (NewState == *NetState)
+	{
+		// a dormant enemy isn't compared against what the clients have on every net update
+		NetIdleTimes[Index] += DeltaSeconds;
+		if (bNetDormancy && NetIdleTimes[Index] >= NetDormancyDelay && Proxy->NetDormancy == DORM_Awake)
+		{
+			Proxy->SetNetDormancy(DORM_DormantAll);
+			INC_DWORD_STAT(STAT_ClawEnemiesGoneDormant);
+		}
+		return;
+	}
+
+	// waking up flushes the channels, so the clients get the new state with the next update
+	if (Proxy->NetDormancy != DORM_Awake)
+	{
+		Proxy->SetNetDormancy(DORM_Awake);
+	}
+
+	*NetState = NewState;
+	NetIdleTimes[Index] = 0.0f;
+
+	INC_DWORD_STAT(STAT_ClawEnemyNetStateChanges);
+}
+
+FClawNetEnemyState* UClawEnemyManager::GetNetState(int32 Index) const
+{
+	switch (Kinds[Index])
+	{
+	case EClawEnemyKind::Enemy:
+		return &static_cast<AEnemy*>(Proxies[Index])->NetState;
+	case EClawEnemyKind::EnemyCharacter:
+		return &static_cast<AEnemyCharacter*>(Proxies[Index])->NetState;
+	case EClawEnemyKind::BlueOfficer:
+		return &static_cast<ABlueOfficer*>(Proxies[Index])->NetState;
+	}
+	return nullptr;
+}
+
+void UClawEnemyManager::ApplyNetState(int32 Handle, const FClawNetEnemyState& NetState)
+{
+	const int32 Index = IndexOf(Handle);
+	APaperCharacter* Proxy = Proxies[Index];
+	if (!Proxy)
+	{
+		return;
+	}
+
+	// the next update sees the enemy moved, and turns and animates it like a local one
+	Proxy->SetActorLocation(NetState.Position.ToVector(Proxy->GetActorLocation().Y));
+	States[Index] = (EClawEnemyState)FMath::Min<uint8>(NetState.GetAnimationState(), (uint8)EClawEnemyState::Count - 1);
+	Facings[Index] = NetState.GetFacing();
+}
+
+int32 UClawEnemyManager::IndexOf(int32 Handle) const
+{
+	check(HandleToIndex.IsValidIndex(Handle) && HandleToIndex[Handle] != INDEX_NONE);
+	return HandleToIndex[Handle];
+}
+
+void UClawEnemyManager::GatherLiveEnemies(TArray<APaperCharacter*>& OutEnemies) const
+{
+	for (int32 Index = 0; Index < Proxies.Num(); ++Index)
+	{
+		if (Proxies[Index] && States[Index] != EClawEnemyState::Dead)
+		{
+			OutEnemies.Add(Proxies[Index]);
+		}
+	}
+}
+
+EClawEnemyState UClawEnemyManager::GetState(int32 Handle) const
+{
+	return States[IndexOf(Handle)];
+}
+
+void UClawEnemyManager::Kill(int32 Handle)
+{
+	const int32 Index = IndexOf(Handle);
+
+	const int32 DeadIndex = Brains.Behaviours[Index]->GetDeadIndex();
+	if (States[Index] == EClawEnemyState::Dead || DeadIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	Brains.Enter(Index, DeadIndex);
+	EnterState(Index, false);
+}
+
+float UClawEnemyManager::GetStateTime(int32 Handle) const
+{
+	return Brains.Elapsed[IndexOf(Handle)];
+}
+
+float UClawEnemyManager::GetMoveDirection(int32 Handle) const
+{
+	return MoveDirections[IndexOf(Handle)];
+}
+
+void UClawEnemyManager::SetMoveDirection(int32 Handle, float Direction)
+{
+	MoveDirections[IndexOf(Handle)] = Direction;
+}
+
+float UClawEnemyManager::GetFacing(int32 Handle) const
+{
+	return Facings[IndexOf(Handle)];
+}
+
+void UClawEnemyManager::SetFacing(int32 Handle, float Direction)
+{
+	Facings[IndexOf(Handle)] = Direction;
+}
+
+void UClawEnemyManager::SetClawSensed(FClawSensedClaws& Sensed, AActor* InClaw, bool bSensed)
+{
+	// a Claw destroyed inside the box never sends its end overlap
+	Sensed.RemoveAll([](const TWeakObjectPtr<AActor>& Claw) { return !Claw.IsValid(); });
+
+	if (bSensed)
+	{
+		Sensed.AddUnique(InClaw);
+	}
+	else
+	{
+		Sensed.Remove(InClaw);
+	}
+}
+
+void UClawEnemyManager::SetClawInSight(int32 Handle, AActor* InClaw, bool bInSight)
+{
+	const int32 Index = IndexOf(Handle);
+	SetClawSensed(SightClaws[Index], InClaw, bInSight);
+
+	// another Claw leaving the box doesn't blind the enemy to the ones still in it
+	uint8& Flags = Brains.ClawFlags[Index];
+	if (SightClaws[Index].Num() > 0)
+	{
+		Flags |= CLAW_InSight;
+	}
+	else
+	{
+		Flags &= ~CLAW_InSight;
+	}
+}
+
+void UClawEnemyManager::SetClawInReach(int32 Handle, AActor* InClaw, bool bInReach)
+{
+	const int32 Index = IndexOf(Handle);
+	SetClawSensed(ReachClaws[Index], InClaw, bInReach);
+
+	uint8& Flags = Brains.ClawFlags[Index];
+	if (ReachClaws[Index].Num() > 0)
+	{
+		Flags |= CLAW_InReach;
+	}
+	else
+	{
+		Flags &= ~CLAW_InReach;
+	}
+}
+
+AActor* UClawEnemyManager::GetClawInReach(int32 Handle) const
+{
+	const int32 Index = IndexOf(Handle);
+	if (!(Brains.ClawFlags[Index] & CLAW_InReach))
+	{
+		return nullptr;
+	}
+
+	// the nearest of the Claws in reach, the one the enemy faces
+	const int32 View = FindNearestClawView(Index, &ReachClaws[Index]);
+	const AActor* Nearest = View != INDEX_NONE ? ClawViews[View].Actor : nullptr;
+
+	AActor* Found = nullptr;
+	for (const TWeakObjectPtr<AActor>& Claw : ReachClaws[Index])
+	{
+		if (Claw.Get() == Nearest)
+		{
+			return Claw.Get();
+		}
+		if (!Found)
+		{
+			Found = Claw.Get();
+		}
+	}
+	return Found;
+}
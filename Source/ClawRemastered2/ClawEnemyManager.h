@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawEnemyBehaviour.h"
+#include "ClawEnemyManager.generated.h"
+
+class APaperCharacter;
+class UBoxComponent;
+class UHealthComponent;
+class UPaperFlipbook;
+class UClawSpatialHash;
+class UClawFlipbookRenderer;
+struct FClawNetEnemyState;
+
+// which enemy class owns a brain, so the manager can dispatch without virtual calls
+enum class EClawEnemyKind : uint8
+{
+	Enemy,
+	EnemyCharacter,
+	BlueOfficer
+};
+
+/**
+ * The flipbook an enemy shows in each brain state. It is registered once with the
+ * brain so that picking an animation is a single array lookup.
+ */
+struct FClawEnemyFlipbooks
+{
+	UPaperFlipbook* ByState[(int32)EClawEnemyState::Count] = {};
+
+	// show the idling flipbook while a walking enemy is not actually moving
+	bool bIdleWhenStill = false;
+};
+
+/**
+ * The boxes an enemy notices Claw with. With spatial queries on they are looked up in the
+ * spatial hash by the manager, otherwise their overlap events feed the brain.
+ */
+struct FClawEnemySenses
+{
+	UBoxComponent* Sight = nullptr;
+	UBoxComponent* Reach = nullptr;
+};
+
+// the Claws inside one sense box of an enemy, more than one only in co-op
+typedef TArray<TWeakObjectPtr<AActor>, TInlineAllocator<2>> FClawSensedClaws;
+
+/**
+ * Owns the brains of every enemy in the world.
+ *
+ * The state of each enemy (position, direction, state, timers) lives in packed arrays
+ * and is updated in one batched pass per frame, the enemy actors only act as visual
+ * proxies for it. Setting claw.Enemies.BatchedUpdate to 0 goes back to every enemy
+ * ticking its own brain, so both paths can be compared with "stat Claw".
+ *
+ * What the enemies do is described by a UClawEnemyBehaviour state machine that is
+ * advanced from the elapsed time of each brain, so no enemy needs a timer.
+ *
+ * With claw.Enemies.InstancedSprites on, the enemies are drawn by the flipbook renderer
+ * and their own flipbook components are hidden and stop ticking.
+ *
+ * On a server, the manager writes the position, animation and facing of every enemy into
+ * its replicated FClawNetEnemyState, and lets enemies that keep them for
+ * claw.Net.DormancyDelay seconds go dormant. Enemies a client doesn't own the authority of
+ * are only proxies of that state: their brains don't act, and their movement components
+ * don't tick.
+ *
+ * Under the fixed step simulation the manager doesn't tick. Each step updates every brain
+ * and then moves the enemies' movement components by hand, and the sprites are drawn
+ * between where the last step started and ended.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawEnemyManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/** Adds an enemy brain running Behaviour and returns the handle used to address it. */
+	int32 RegisterEnemy(APaperCharacter* Enemy, EClawEnemyKind Kind, UHealthComponent* Health, const FClawEnemyFlipbooks& Flipbooks, const FClawEnemySenses& Senses, const UClawEnemyBehaviour* Behaviour);
+	void UnregisterEnemy(int32 Handle);
+
+	/** Returns the behaviour enemies of a kind used to run with their timer chains. */
+	const UClawEnemyBehaviour* GetDefaultBehaviour(EClawEnemyKind Kind, float WalkDuration = 0.0f, float IdlingDuration = 0.0f);
+
+	/** Updates a single brain, used by enemies that tick on their own when batching is off. */
+	void TickEnemy(int32 Handle, float DeltaSeconds);
+
+	// true when the brains are updated by the manager instead of by each enemy's Tick,
+	// which the fixed step simulation always does
+	bool IsBatched() const { return bBatched || bFixedStep; }
+
+	/** Hands the updates to the fixed step simulation, set before any enemy registers. */
+	void SetFixedStep(bool bInFixedStep) { bFixedStep = bInFixedStep; }
+
+	/** Updates every brain and moves every enemy by one fixed step. */
+	void SimulateStep(float StepSeconds);
+
+	/** Draws the enemies at Alpha between the start and the end of the last step. */
+	void InterpolateStep(float Alpha);
+
+	// true when the enemies are drawn by the flipbook renderer instead of their flipbook components
+	bool IsInstancingSprites() const { return bInstancedSprites; }
+
+	int32 GetNumEnemies() const { return Proxies.Num(); }
+
+	/** Adds the enemies that aren't dead to OutEnemies. */
+	void GatherLiveEnemies(TArray<APaperCharacter*>& OutEnemies) const;
+
+	EClawEnemyState GetState(int32 Handle) const;
+
+	/** Shows the state the server replicated for an enemy without authority. */
+	void ApplyNetState(int32 Handle, const FClawNetEnemyState& NetState);
+
+	/** Switches the brain to the dead state of its behaviour. */
+	void Kill(int32 Handle);
+
+	// seconds spent in the current state
+	float GetStateTime(int32 Handle) const;
+
+	// direction the enemy walks in, 0 stands still, 1 is right and -1 is left
+	float GetMoveDirection(int32 Handle) const;
+	void SetMoveDirection(int32 Handle, float Direction);
+
+	// direction the enemy looks at, 1 is right and -1 is left
+	float GetFacing(int32 Handle) const;
+	void SetFacing(int32 Handle, float Direction);
+
+	// fed by the sight and reach boxes of the enemies with the Claw that entered or left them,
+	// a flag stays set while any Claw is still inside the box
+	void SetClawInSight(int32 Handle, AActor* InClaw, bool bInSight);
+	void SetClawInReach(int32 Handle, AActor* InClaw, bool bInReach);
+
+	/** Returns the Claw in the reach of an enemy, the one its attacks hit, or null. */
+	AActor* GetClawInReach(int32 Handle) const;
+
+private:
+	void UpdateEnemies(int32 First, int32 Last, float DeltaSeconds);
+	void RefreshClaws();
+
+	// the entry of ClawViews an enemy goes for, the nearest Claw it senses or else the nearest one
+	int32 FindClawView(int32 Index) const;
+	int32 FindNearestClawView(int32 Index, const FClawSensedClaws* Sensed) const;
+
+	static void SetClawSensed(FClawSensedClaws& Sensed, AActor* InClaw, bool bSensed);
+	void UpdateSenses(int32 First, int32 Last);
+	void EnterState(int32 Index, bool bTurnAround);
+	void DispatchAction(int32 Index, EClawBehaviourAction Action);
+	void OnEnemyDeath(UHealthComponent* Health, int32 Handle);
+	void DispatchDeath(int32 Index);
+	void RemoveEnemyAt(int32 Index);
+	void FlushPendingRemovals();
+
+	// writes what the clients see of an enemy and puts it to sleep while that doesn't change
+	void UpdateNetState(int32 Index, EClawEnemyState AnimationState, float DeltaSeconds);
+	FClawNetEnemyState* GetNetState(int32 Index) const;
+
+	int32 IndexOf(int32 Handle) const;
+
+	bool bBatched = true;
+	bool bInstancedSprites = true;
+	bool bUpdating = false;
+	bool bFixedStep = false;
+	bool bNetDormancy = true;
+	float NetDormancyDelay = 1.0f;
+
+	UPROPERTY()
+	UClawSpatialHash* SpatialHash;
+
+	UPROPERTY()
+	UClawFlipbookRenderer* FlipbookRenderer;
+
+	// where every player's Claw is and whether he crouches, read once per frame
+	struct FClawView
+	{
+		const AActor* Actor;
+		float X;
+		bool bCrouching;
+	};
+	uint64 ClawFrame = 0;
+	TArray<FClawView> ClawViews;
+
+	// packed per enemy data, all arrays share the same index
+	UPROPERTY()
+	TArray<APaperCharacter*> Proxies;
+
+	TArray<UHealthComponent*> Healths;
+	TArray<EClawEnemyKind> Kinds;
+	TArray<EClawEnemyState> States;
+	TArray<FVector2D> Positions;
+	TArray<bool> Moving;
+	TArray<float> MoveDirections;
+	TArray<float> Facings;
+	TArray<float> AppliedFacings;
+	TArray<bool> MovementDisabled;
+	TArray<FClawEnemyFlipbooks> Flipbooks;
+	TArray<UPaperFlipbook*> AppliedFlipbooks;
+	TArray<FClawEnemySenses> Senses;
+	TArray<int32> SpatialHandles;
+	TArray<int32> SpriteHandles;
+	// true for the enemies whose state comes from the server
+	TArray<bool> Remote;
+	// seconds the replicated state of an enemy didn't change
+	TArray<float> NetIdleTimes;
+	// where the enemy was before the last fixed step moved it
+	TArray<FVector> StepStartLocations;
+	// the relative location of the flipbook component, offset while drawing between steps
+	TArray<FVector> SpriteLocations;
+	// the Claws that set the sight and reach flags, with co-op it isn't always the same one
+	TArray<FClawSensedClaws> SightClaws;
+	TArray<FClawSensedClaws> ReachClaws;
+	FClawBehaviourBrains Brains;
+
+	// handles stay stable while the packed arrays are compacted with swaps
+	TArray<int32> IndexToHandle;
+	TArray<int32> HandleToIndex;
+	TArray<int32> FreeHandles;
+
+	TArray<FClawBehaviourEvent> PendingEvents;
+	// handles, their brains may be moved before the deaths are dispatched
+	TArray<int32> PendingDeaths;
+	TArray<int32> PendingRemovals;
+
+	TArray<AActor*> SensedActors;
+
+	// the behaviours built for enemies that don't have one assigned
+	struct FDefaultBehaviourKey
+	{
+		EClawEnemyKind Kind;
+		float WalkDuration;
+		float IdlingDuration;
+	};
+	TArray<FDefaultBehaviourKey> DefaultBehaviourKeys;
+
+	UPROPERTY()
+	TArray<UClawEnemyBehaviour*> DefaultBehaviours;
+};
@@ -0,0 +1,311 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawFlipbookRenderer.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "Engine/World.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flipbook Advance"), STAT_ClawFlipbookAdvance, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flipbook Instances"), STAT_ClawFlipbookInstances, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flipbook Batches"), STAT_ClawFlipbookBatches, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flipbook Keyframe Changes"), STAT_ClawFlipbookKeyFrameChanges, STATGROUP_Claw);
+
+void UClawFlipbookRenderer::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawFlipbookInstances, Flipbooks.Num());
+	DEC_DWORD_STAT_BY(STAT_ClawFlipbookBatches, Batches.Num());
+
+	// the sprite host is destroyed with the world
+	Flipbooks.Empty();
+	Times.Empty();
+	KeyFrames.Empty();
+	Locations.Empty();
+	Facings.Empty();
+	SpriteTransforms.Empty();
+	BatchIndices.Empty();
+	BatchInstances.Empty();
+	TransformsDirty.Empty();
+	IndexToHandle.Empty();
+	HandleToIndex.Empty();
+	FreeHandles.Empty();
+	Batches.Empty();
+	SpriteHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UClawFlipbookRenderer::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawFlipbookAdvance);
+
+	for (int32 Index = 0; Index < Flipbooks.Num(); ++Index)
+	{
+		const int32 BatchIndex = BatchIndices[Index];
+		if (BatchIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		// like a flipbook component left at its defaults, every flipbook loops
+		const UPaperFlipbook* Flipbook = Flipbooks[Index];
+		const float Duration = Flipbook->GetTotalDuration();
+		Times[Index] = Duration > 0.0f ? FMath::Fmod(Times[Index] + DeltaSeconds, Duration) : 0.0f;
+
+		FBatch& Batch = Batches[BatchIndex];
+
+		const int32 KeyFrame = Flipbook->GetKeyFrameIndexAtTime(Times[Index]);
+		if (KeyFrame != KeyFrames[Index])
+		{
+			Batch.Sprites->SetInstanceSprite(BatchInstances[Index], Flipbook->GetKeyFrameChecked(KeyFrame).Sprite);
+			KeyFrames[Index] = KeyFrame;
+			Batch.bDirty = true;
+
+			INC_DWORD_STAT(STAT_ClawFlipbookKeyFrameChanges);
+		}
+
+		if (TransformsDirty[Index])
+		{
+			Batch.Sprites->SetInstanceTransform(BatchInstances[Index], GetInstanceTransform(Index));
+			TransformsDirty[Index] = false;
+			Batch.bDirty = true;
+		}
+	}
+
+	// one render state update per batch, not per instance
+	for (FBatch& Batch : Batches)
+	{
+		if (Batch.bDirty)
+		{
+			Batch.Sprites->UpdateBounds();
+			Batch.Sprites->MarkRenderStateDirty();
+			Batch.bDirty = false;
+		}
+	}
+}
+
+ETickableTickType UClawFlipbookRenderer::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawFlipbookRenderer::IsTickable() const
+{
+	return Flipbooks.Num() > 0;
+}
+
+TStatId UClawFlipbookRenderer::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawFlipbookRenderer, STATGROUP_Tickables);
+}
+
+UWorld* UClawFlipbookRenderer::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+int32 UClawFlipbookRenderer::AddInstance(UPaperFlipbook* Flipbook, const FTransform& SpriteTransform, const FVector& Location, float Facing)
+{
+	const int32 Index = Flipbooks.Add(Flipbook);
+	Times.Add(0.0f);
+	KeyFrames.Add(INDEX_NONE);
+	Locations.Add(Location);
+	Facings.Add(Facing);
+	SpriteTransforms.Add(SpriteTransform);
+	BatchIndices.Add(INDEX_NONE);
+	BatchInstances.Add(INDEX_NONE);
+	TransformsDirty.Add(false);
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = HandleToIndex.Add(INDEX_NONE);
+	}
+
+	HandleToIndex[Handle] = Index;
+	IndexToHandle.Add(Handle);
+
+	AddToBatch(Index);
+
+	INC_DWORD_STAT(STAT_ClawFlipbookInstances);
+
+	return Handle;
+}
+
+void UClawFlipbookRenderer::RemoveInstance(int32 Handle)
+{
+	if (!HandleToIndex.IsValidIndex(Handle) || HandleToIndex[Handle] == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Index = HandleToIndex[Handle];
+	const int32 LastIndex = Flipbooks.Num() - 1;
+	const int32 LastHandle = IndexToHandle[LastIndex];
+
+	RemoveFromBatch(Index);
+
+	// the last instance moves into the freed slot, so its batch has to find it there
+	if (Index != LastIndex && BatchIndices[LastIndex] != INDEX_NONE)
+	{
+		Batches[BatchIndices[LastIndex]].InstanceToIndex[BatchInstances[LastIndex]] = Index;
+	}
+
+	Flipbooks.RemoveAtSwap(Index, 1, false);
+	Times.RemoveAtSwap(Index, 1, false);
+	KeyFrames.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Facings.RemoveAtSwap(Index, 1, false);
+	SpriteTransforms.RemoveAtSwap(Index, 1, false);
+	BatchIndices.RemoveAtSwap(Index, 1, false);
+	BatchInstances.RemoveAtSwap(Index, 1, false);
+	TransformsDirty.RemoveAtSwap(Index, 1, false);
+	IndexToHandle.RemoveAtSwap(Index, 1, false);
+
+	HandleToIndex[LastHandle] = Index;
+	HandleToIndex[Handle] = INDEX_NONE;
+	FreeHandles.Add(Handle);
+
+	DEC_DWORD_STAT(STAT_ClawFlipbookInstances);
+}
+
+void UClawFlipbookRenderer::SetFlipbook(int32 Handle, UPaperFlipbook* Flipbook)
+{
+	const int32 Index = IndexOf(Handle);
+	if (Flipbooks[Index] == Flipbook)
+	{
+		return;
+	}
+
+	// flipbooks of the same texture stay in their batch, the next tick shows the new keyframe
+	const int32 BatchIndex = Flipbook ? FindOrAddBatch(Flipbook) : INDEX_NONE;
+	if (BatchIndex != BatchIndices[Index] || BatchIndex == INDEX_NONE)
+	{
+		RemoveFromBatch(Index);
+		Flipbooks[Index] = Flipbook;
+		AddToBatch(Index);
+	}
+	else
+	{
+		Flipbooks[Index] = Flipbook;
+	}
+
+	Times[Index] = 0.0f;
+	KeyFrames[Index] = INDEX_NONE;
+}
+
+void UClawFlipbookRenderer::SetLocation(int32 Handle, const FVector& Location)
+{
+	const int32 Index = IndexOf(Handle);
+	Locations[Index] = Location;
+	TransformsDirty[Index] = true;
+}
+
+void UClawFlipbookRenderer::SetFacing(int32 Handle, float Facing)
+{
+	const int32 Index = IndexOf(Handle);
+	Facings[Index] = Facing;
+	TransformsDirty[Index] = true;
+}
+
+int32 UClawFlipbookRenderer::FindOrAddBatch(UPaperFlipbook* Flipbook)
+{
+	// the flipbooks of an atlas page all share its texture
+	UPaperSprite* FirstSprite = Flipbook->GetNumKeyFrames() > 0 ? Flipbook->GetKeyFrameChecked(0).Sprite : nullptr;
+	UTexture* Texture = FirstSprite ? FirstSprite->GetBakedTexture() : nullptr;
+	if (!Texture)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 BatchIndex = 0; BatchIndex < Batches.Num(); ++BatchIndex)
+	{
+		if (Batches[BatchIndex].Texture == Texture)
+		{
+			return BatchIndex;
+		}
+	}
+
+	if (!SpriteHost)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		SpriteHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+	}
+
+	UClawInstancedSpriteComponent* Sprites = NewObject<UClawInstancedSpriteComponent>(SpriteHost);
+	Sprites->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Sprites->SetGenerateOverlapEvents(false);
+	if (!SpriteHost->GetRootComponent())
+	{
+		SpriteHost->SetRootComponent(Sprites);
+	}
+	Sprites->RegisterComponent();
+
+	Batches.Add({ Texture, Sprites, {}, false });
+
+	INC_DWORD_STAT(STAT_ClawFlipbookBatches);
+
+	return Batches.Num() - 1;
+}
+
+void UClawFlipbookRenderer::AddToBatch(int32 Index)
+{
+	UPaperFlipbook* Flipbook = Flipbooks[Index];
+	const int32 BatchIndex = Flipbook ? FindOrAddBatch(Flipbook) : INDEX_NONE;
+	if (BatchIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FBatch& Batch = Batches[BatchIndex];
+	BatchIndices[Index] = BatchIndex;
+	BatchInstances[Index] = Batch.Sprites->AddInstance(GetInstanceTransform(Index), Flipbook->GetKeyFrameChecked(0).Sprite, true);
+	Batch.InstanceToIndex.Add(Index);
+	Batch.bDirty = true;
+
+	KeyFrames[Index] = 0;
+	TransformsDirty[Index] = false;
+}
+
+void UClawFlipbookRenderer::RemoveFromBatch(int32 Index)
+{
+	const int32 BatchIndex = BatchIndices[Index];
+	if (BatchIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// the last sprite instance of the batch moves into the freed one
+	FBatch& Batch = Batches[BatchIndex];
+	const int32 Instance = BatchInstances[Index];
+	Batch.Sprites->RemoveInstanceAtSwap(Instance);
+	Batch.InstanceToIndex.RemoveAtSwap(Instance, 1, false);
+	if (Instance < Batch.InstanceToIndex.Num())
+	{
+		BatchInstances[Batch.InstanceToIndex[Instance]] = Instance;
+	}
+	Batch.bDirty = true;
+
+	BatchIndices[Index] = INDEX_NONE;
+	BatchInstances[Index] = INDEX_NONE;
+}
+
+FTransform UClawFlipbookRenderer::GetInstanceTransform(int32 Index) const
+{
+	// facing right means turning around, like the enemy actors do
+	const FTransform Placement(FRotator(0.0f, Facings[Index] > 0.0f ? 180.0f : 0.0f, 0.0f), Locations[Index]);
+	return SpriteTransforms[Index] * Placement;
+}
+
+int32 UClawFlipbookRenderer::IndexOf(int32 Handle) const
+{
+	check(HandleToIndex.IsValidIndex(Handle) && HandleToIndex[Handle] != INDEX_NONE);
+	return HandleToIndex[Handle];
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "ClawFlipbookRenderer.generated.h"
+
+class UPaperFlipbook;
+
+/**
+ * A grouped sprite component whose instances can change their sprite and be removed with
+ * a swap, so the flipbook renderer can keep them in the order of its own packed arrays.
+ * Changes only reach the render thread with MarkRenderStateDirty.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawInstancedSpriteComponent : public UPaperGroupedSpriteComponent
+{
+	GENERATED_BODY()
+
+public:
+	void SetInstanceSprite(int32 InstanceIndex, UPaperSprite* Sprite) { PerInstanceSpriteData[InstanceIndex].SourceSprite = Sprite; }
+
+	void SetInstanceTransform(int32 InstanceIndex, const FTransform& Transform) { PerInstanceSpriteData[InstanceIndex].Transform = Transform.ToMatrixWithScale(); }
+
+	void RemoveInstanceAtSwap(int32 InstanceIndex) { PerInstanceSpriteData.RemoveAtSwap(InstanceIndex, 1, false); }
+};
+
+/**
+ * Draws flipbooks without a flipbook component per character.
+ *
+ * The flipbook, play time, keyframe, location and facing of every instance live in packed
+ * arrays and are advanced in one pass per frame. Instances whose flipbooks share a texture
+ * are drawn by one grouped sprite component, so the sprites of an atlas page are a single
+ * batch however many characters use them.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawFlipbookRenderer : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/**
+	 * Adds an instance that plays Flipbook at Location and returns the handle used to address it.
+	 * SpriteTransform is where the sprite sits relative to Location, like the relative transform
+	 * of a flipbook component.
+	 */
+	int32 AddInstance(UPaperFlipbook* Flipbook, const FTransform& SpriteTransform, const FVector& Location, float Facing);
+	void RemoveInstance(int32 Handle);
+
+	/** Plays Flipbook from its start, does nothing when it already plays. */
+	void SetFlipbook(int32 Handle, UPaperFlipbook* Flipbook);
+
+	void SetLocation(int32 Handle, const FVector& Location);
+
+	// 1 is right and -1 is left, the sprites look to the left
+	void SetFacing(int32 Handle, float Facing);
+
+	int32 GetNumInstances() const { return Flipbooks.Num(); }
+	int32 GetNumBatches() const { return Batches.Num(); }
+
+private:
+	// the instances of one texture, InstanceToIndex maps their sprite instance back to the packed arrays
+	struct FBatch
+	{
+		UTexture* Texture;
+		UClawInstancedSpriteComponent* Sprites;
+		TArray<int32> InstanceToIndex;
+		bool bDirty;
+	};
+
+	int32 FindOrAddBatch(UPaperFlipbook* Flipbook);
+	void AddToBatch(int32 Index);
+	void RemoveFromBatch(int32 Index);
+
+	FTransform GetInstanceTransform(int32 Index) const;
+
+	int32 IndexOf(int32 Handle) const;
+
+	// packed per instance data, all arrays share the same index
+	UPROPERTY()
+	TArray<UPaperFlipbook*> Flipbooks;
+
+	TArray<float> Times;
+	TArray<int32> KeyFrames;
+	TArray<FVector> Locations;
+	TArray<float> Facings;
+	TArray<FTransform> SpriteTransforms;
+	TArray<int32> BatchIndices;
+	TArray<int32> BatchInstances;
+	TArray<bool> TransformsDirty;
+
+	// handles stay stable while the packed arrays are compacted with swaps
+	TArray<int32> IndexToHandle;
+	TArray<int32> HandleToIndex;
+	TArray<int32> FreeHandles;
+
+	TArray<FBatch> Batches;
+
+	// owns the sprite components
+	UPROPERTY()
+	AActor* SpriteHost;
+};
@@ -3,25 +3,92 @@
 
 #include "ClawGameHUD.h"
 #include "ClawGameMode.h"
+#include "ClawDigitCounter.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("HUD Refresh"), STAT_ClawHUDRefresh, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Updates"), STAT_ClawHUDUpdates, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Invalidations"), STAT_ClawHUDInvalidations, STATGROUP_Claw);
 
 void UClawGameHUD::InitializeHUD(AClawGameMode* RunGameMode)
 {
 	if (RunGameMode)
 	{
-		ScoreCount->SetText(FText::AsNumber(0));
+		if (ScoreDigits)
+		{
+			ScoreCount->SetVisibility(ESlateVisibility::Collapsed);
+		}
 		RunGameMode->OnScoreCountChanged.AddDynamic(this, &UClawGameHUD::SetScoreCount);
 
-		HealthPane->SetText(FText::AsNumber(100));
+		if (HealthDigits)
+		{
+			HealthPane->SetVisibility(ESlateVisibility::Collapsed);
+		}
 		RunGameMode->OnHealthPaneChanged.AddDynamic(this, &UClawGameHUD::SetHealthCount);
+
+		SetScoreCount(0);
+		SetHealthCount(100);
 	}
 }
 
 void UClawGameHUD::SetScoreCount(int32 Count)
 {
-	ScoreCount->SetText(FText::AsNumber(Count));
+	INC_DWORD_STAT(STAT_ClawHUDUpdates);
+	Score = Count;
+	bDirty = true;
 }
 void UClawGameHUD::SetHealthCount(const int32 Count)
 {
-	HealthPane->SetText(FText::AsNumber(Count));
+	INC_DWORD_STAT(STAT_ClawHUDUpdates);
+	Health = Count;
+	bDirty = true;
 }
 
+void UClawGameHUD::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+
+	// a pile of treasure changes the score many times in a frame, only the last one is drawn
+	if (bDirty)
+	{
+		CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawHUDRefresh);
+
+		ShowCount(ScoreDigits, ScoreCount, Score, ShownScore);
+		ShowCount(HealthDigits, HealthPane, Health, ShownHealth);
+		bDirty = false;
+	}
+}
+
+void UClawGameHUD::ShowCount(UClawDigitCounter* Digits, UTextBlock* Text, int32 Count, int32& ShownCount)
+{
+	if (Count == ShownCount)
+	{
+		return;
+	}
+	ShownCount = Count;
+
+	if (Digits)
+	{
+		if (Digits->SetValue(Count))
+		{
+			INC_DWORD_STAT(STAT_ClawHUDInvalidations);
+		}
+		return;
+	}
+
+	// the digits written out by hand, the counters never need grouping or a culture
+	TCHAR Buffer[12];
+	TCHAR* Start = Buffer + UE_ARRAY_COUNT(Buffer);
+	*--Start = TEXT('\0');
+
+	uint32 Left = (uint32)FMath::Max(Count, 0);
+	do
+	{
+		*--Start = TEXT('0') + Left % 10;
+		Left /= 10;
+	}
+	while (Left > 0);
+
+	Text->SetText(FText::AsCultureInvariant(FString(Start)));
+	INC_DWORD_STAT(STAT_ClawHUDInvalidations);
+}
@@ -6,9 +6,12 @@
 #include "ClawGameMode.h"
 #include "ClawGameHUD.generated.h"
 
+class UClawDigitCounter;
 
 /**
- *
+ * Score and health changes only mark the HUD dirty, it applies the latest values once a
+ * frame. Digit counters draw them when the widget has them, the text blocks get a string
+ * of digits otherwise, without any number formatting.
  */
 UCLASS()
 class CLAWREMASTERED2_API UClawGameHUD : public UUserWidget
@@ -21,6 +24,16 @@ protected:
 
     UPROPERTY(BlueprintReadWrite, meta = (BindWidget))
     class UTextBlock* HealthPane;
+
+    // replace the text blocks when the widget has them
+    UPROPERTY(BlueprintReadWrite, meta = (BindWidgetOptional))
+    UClawDigitCounter* ScoreDigits;
+
+    UPROPERTY(BlueprintReadWrite, meta = (BindWidgetOptional))
+    UClawDigitCounter* HealthDigits;
+
+    virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
 public:
 
     UFUNCTION(BlueprintCallable)
@@ -30,4 +43,17 @@ public:
         void InitializeHUD(AClawGameMode* RunGameMode);
     UFUNCTION(BlueprintCallable)
         void SetScoreCount(int32 Count);
-};
\ No newline at end of file
+
+private:
+    // shows the value on the counter, or on the text block when there is no counter
+    void ShowCount(UClawDigitCounter* Digits, UTextBlock* Text, int32 Count, int32& ShownCount);
+
+    int32 Score = 0;
+    int32 Health = 100;
+
+    // what the widgets show, INDEX_NONE before the first update
+    int32 ShownScore = INDEX_NONE;
+    int32 ShownHealth = INDEX_NONE;
+
+    bool bDirty = false;
+};
@@ -2,16 +2,33 @@
 
 
 #include "ClawGameMode.h"
+#include "ClawRemastered2.h"
 #include "Blueprint/UserWidget.h"
 #include "Engine/GameInstance.h"
 #include "InputCoreTypes.h"
 #include "Kismet/GameplayStatics.h"
+#include "ClawSoundPool.h"
+#include "ClawAudioBank.h"
 #include "ClawGameHUD.h"
 
+void AClawGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	GetWorld()->GetSubsystem<UClawAudioBanks>()->LoadBank(AudioBank);
+}
+
 void AClawGameMode::BeginPlay()
 {
+	// no cue may hit the disk or the decoder once the level plays
+	const double BankWait = GetWorld()->GetSubsystem<UClawAudioBanks>()->WaitForBanks();
+	if (BankWait > 1.0)
+	{
+		UE_LOG(LogClaw, Display, TEXT("Waited %.1f ms for the audio banks."), BankWait);
+	}
+
 	Super::BeginPlay();
-	UGameplayStatics::SpawnSound2D(this, LevelSound, 1.0f, 1.0f, 0.0f);
+	UClawSoundPool::PlaySound2D(this, LevelSound, EClawSoundCategory::Music, 10.0f);
 	UGameplayStatics::GetPlayerController(GetWorld(), 0)->bShowMouseCursor = true;
 	ClawGameHUD = Cast<UClawGameHUD>(CreateWidget(GetWorld(), ClawGameHUDClass));
 	check(ClawGameHUD);
@@ -25,14 +42,14 @@ void AClawGameMode::BeginPlay()
 
 void AClawGameMode::ActorDied(AActor* DeadActor)
 {
-	UE_LOG(LogTemp, Warning, TEXT("Actor Died"));
+	UE_LOG(LogClaw, Verbose, TEXT("%s died"), *GetNameSafe(DeadActor));
 }
 
 
 void AClawGameMode::AddScore(int64 AdditionlaScore)
 {
 	PlayerScore += AdditionlaScore;
-	UE_LOG(LogTemp, Warning, TEXT("score is: %i"), PlayerScore);
+	UE_LOG(LogClaw, Verbose, TEXT("score is: %lld"), PlayerScore);
     OnScoreCountChanged.Broadcast(PlayerScore);
 }
 
@@ -45,6 +62,9 @@ int64 AClawGameMode::GetScore()
 
 void AClawGameMode::HandleGameOver(bool PlayerWon)
 {
+    bGameOver = true;
+    bPlayerWon = PlayerWon;
+
     if (PlayerWon)
     {
         //Selecting Game Win Widget
@@ -12,6 +12,7 @@
  * 
  */
 class UUserWidget;
+class UClawAudioBank;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnScoreCountChanged, int32, ScoreCount);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnHealthPaneChanged, int32, HealthPane);
@@ -25,6 +26,9 @@ class CLAWREMASTERED2_API AClawGameMode : public AGameModeBase
 private:
 	int64 PlayerScore = 0;
 
+	bool bGameOver = false;
+	bool bPlayerWon = false;
+
 
 public:
 	void HandleGameOver(bool PlayerWon);
@@ -33,6 +37,10 @@ public:
 	void AddScore(int64 AdditionlaScore);
 	int64 GetScore();
 
+	// set once HandleGameOver ran, the level objective wins the level and Claw's death loses it
+	bool IsGameOver() const { return bGameOver; }
+	bool HasPlayerWon() const { return bPlayerWon; }
+
 	UPROPERTY(EditAnywhere, Category = "Config")
 	TSubclassOf<class UUserWidget> ClawGameHUDClass;
 
@@ -48,11 +56,16 @@ public:
 
 protected:
 
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
 	virtual void BeginPlay() override;  
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sounds)
 	USoundBase* LevelSound;
 
+	// the cues of the level, loaded and decoded while the level loads
+	UPROPERTY(EditAnywhere, Category = Sounds)
+	TSoftObjectPtr<UClawAudioBank> AudioBank;
+
 	UPROPERTY(EditAnywhere)
 	TSubclassOf<class UUserWidget> GameOverScreenClass;
 	UPROPERTY(EditAnywhere)
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawInputRecorder.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "ClawSimulation.h"
+#include "ClawRemastered2.h"
+
+namespace
+{
+	const uint32 RecordingMagic = 0x52494C43; // CLIR
+	// 2 added the fixed steps
+	const int32 RecordingVersion = 2;
+
+	// loops a command line replay played so far, the recorder is recreated with every level
+	int32 ReplayLoopsPlayed = 0;
+	double ReplayLoopStart = 0.0;
+
+	// bare names go to Saved/InputReplays
+	FString GetRecordingFilename(const FString& Name)
+	{
+		if (FPaths::IsRelative(Name) && FPaths::GetPath(Name).IsEmpty())
+		{
+			return FPaths::ProjectSavedDir() / TEXT("InputReplays") / (FPaths::GetExtension(Name).IsEmpty() ? Name + TEXT(".clawinput") : Name);
+		}
+		return Name;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FClawInputRecording
+
+bool FClawInputRecording::Save(const FString& Filename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = RecordingMagic;
+	int32 Version = RecordingVersion;
+	FString Map = MapName;
+	int32 RecordedSeed = Seed;
+	float Delta = FixedDeltaTime;
+	bool bSteps = bFixedStep;
+	float Step = StepSeconds;
+	int32 NumFrames = Frames.Num();
+	Writer << Magic << Version << Map << RecordedSeed << Delta << bSteps << Step << NumFrames;
+
+	for (int32 Start = 0; Start < Frames.Num();)
+	{
+		int32 End = Start + 1;
+		while (End < Frames.Num() && End - Start < MAX_uint16 && Frames[End] == Frames[Start])
+		{
+			++End;
+		}
+
+		uint16 Count = End - Start;
+		int8 MoveRight = Frames[Start].MoveRight;
+		uint8 Actions = (uint8)Frames[Start].Actions;
+		Writer << Count << MoveRight << Actions;
+
+		Start = End;
+	}
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FClawInputRecording::Load(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 NumFrames = 0;
+	Reader << Magic << Version;
+	if (Magic != RecordingMagic || Version < 1 || Version > RecordingVersion)
+	{
+		return false;
+	}
+
+	// older recordings were all made with a frame per frame
+	Reader << MapName << Seed << FixedDeltaTime;
+	bFixedStep = false;
+	StepSeconds = 0.0f;
+	if (Version >= 2)
+	{
+		Reader << bFixedStep << StepSeconds;
+	}
+	Reader << NumFrames;
+
+	Frames.Reset(NumFrames);
+	while (Frames.Num() < NumFrames && !Reader.AtEnd())
+	{
+		uint16 Count = 0;
+		FClawInputFrame Frame;
+		uint8 Actions = 0;
+		Reader << Count << Frame.MoveRight << Actions;
+		Frame.Actions = (EClawInputAction)Actions;
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Frames.Add(Frame);
+		}
+	}
+
+	return !Reader.IsError() && Frames.Num() == NumFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UClawInputRecorder
+
+void UClawInputRecorder::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!GetWorld()->IsGameWorld())
+	{
+		return;
+	}
+
+	// the simulation decides whether a frame is a step, before anything is recorded
+	Simulation = Collection.InitializeDependency<UClawSimulation>();
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	FString Filename;
+	if (FParse::Value(CommandLine, TEXT("ClawReplay="), Filename))
+	{
+		bCommandLineReplay = true;
+		StartReplay(Filename);
+	}
+	else if (FParse::Value(CommandLine, TEXT("ClawRecord="), Filename))
+	{
+		int32 Seed = 0;
+		FParse::Value(CommandLine, TEXT("ClawSeed="), Seed);
+
+		// saved when the world goes away
+		RecordFilename = Filename;
+		StartRecording(Seed, 1.0f / 60.0f);
+	}
+}
+
+void UClawInputRecorder::Deinitialize()
+{
+	if (bRecording && !RecordFilename.IsEmpty())
+	{
+		StopRecording(RecordFilename);
+	}
+
+	if (bRecording || bReplaying)
+	{
+		RestoreTimestep();
+	}
+
+	bRecording = false;
+	bReplaying = false;
+
+	Super::Deinitialize();
+}
+
+void UClawInputRecorder::StartRecording(int32 Seed, float FixedDeltaTime)
+{
+	StopReplay();
+
+	Recording = FClawInputRecording();
+	Recording.MapName = UGameplayStatics::GetCurrentLevelName(this);
+	Recording.Seed = Seed;
+	Recording.FixedDeltaTime = FixedDeltaTime;
+	Recording.bFixedStep = Simulation && Simulation->IsFixedStep();
+	Recording.StepSeconds = Recording.bFixedStep ? Simulation->GetStepSeconds() : 0.0f;
+
+	ApplyDeterminism(Seed, FixedDeltaTime);
+	bRecording = true;
+
+	if (Recording.bFixedStep)
+	{
+		UE_LOG(LogClaw, Display, TEXT("Recording input on %s, seed %d, a frame per %.4f s simulation step."), *Recording.MapName, Seed, Recording.StepSeconds);
+	}
+	else
+	{
+		UE_LOG(LogClaw, Display, TEXT("Recording input on %s, seed %d, %.4f s frames."), *Recording.MapName, Seed, FixedDeltaTime);
+	}
+}
+
+bool UClawInputRecorder::StopRecording(const FString& Filename)
+{
+	if (!bRecording)
+	{
+		return false;
+	}
+
+	bRecording = false;
+	RestoreTimestep();
+
+	const FString Path = GetRecordingFilename(Filename);
+	if (!Recording.Save(Path))
+	{
+		UE_LOG(LogClaw, Error, TEXT("Couldn't write %s."), *Path);
+		return false;
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("Recorded %d frames of input to %s (%lld bytes)."), Recording.Frames.Num(), *Path, IFileManager::Get().FileSize(*Path));
+	return true;
+}
+
+bool UClawInputRecorder::StartReplay(const FString& Filename)
+{
+	// the frames recorded so far would be lost, and the replay's timestep taken for the player's
+	if (bRecording)
+	{
+		UE_LOG(LogClaw, Error, TEXT("Can't replay while recording, stop the recording with claw.Input.Stop first."));
+		return false;
+	}
+
+	// the recording only replaces the current one once it passed every check
+	const FString Path = GetRecordingFilename(Filename);
+	FClawInputRecording Loaded;
+	if (!Loaded.Load(Path))
+	{
+		UE_LOG(LogClaw, Error, TEXT("Couldn't read the input recording %s."), *Path);
+		return false;
+	}
+
+	const FString MapName = UGameplayStatics::GetCurrentLevelName(this);
+	if (Loaded.MapName != MapName)
+	{
+		UE_LOG(LogClaw, Warning, TEXT("%s was recorded on %s, replaying it on %s."), *Path, *Loaded.MapName, *MapName);
+	}
+
+	// other steps would read the same frames at other times, the replay would silently diverge
+	const bool bFixedStep = Simulation && Simulation->IsFixedStep();
+	const float StepSeconds = bFixedStep ? Simulation->GetStepSeconds() : 0.0f;
+	if (Loaded.bFixedStep != bFixedStep || !FMath::IsNearlyEqual(Loaded.StepSeconds, StepSeconds))
+	{
+		if (Loaded.bFixedStep)
+		{
+			UE_LOG(LogClaw, Error, TEXT("%s was recorded in fixed steps of %.4f s, replay it with -ClawFixedStep=%d."), *Path, Loaded.StepSeconds, FMath::RoundToInt(1.0f / Loaded.StepSeconds));
+		}
+		else
+		{
+			UE_LOG(LogClaw, Error, TEXT("%s was recorded a frame per frame, replay it without fixed steps."), *Path);
+		}
+		return false;
+	}
+
+	Recording = MoveTemp(Loaded);
+	ApplyDeterminism(Recording.Seed, Recording.FixedDeltaTime);
+	ReplayFrame = 0;
+	bReplaying = true;
+	ReplayLoopStart = FPlatformTime::Seconds();
+
+	return true;
+}
+
+void UClawInputRecorder::StopReplay()
+{
+	if (bReplaying)
+	{
+		bReplaying = false;
+		RestoreTimestep();
+	}
+}
+
+void UClawInputRecorder::RecordFrame(const FClawInputFrame& Frame)
+{
+	Recording.Frames.Add(Frame);
+}
+
+bool UClawInputRecorder::ReadFrame(FClawInputFrame& OutFrame)
+{
+	if (!Recording.Frames.IsValidIndex(ReplayFrame))
+	{
+		OnReplayFinished();
+		return false;
+	}
+
+	OutFrame = Recording.Frames[ReplayFrame++];
+	return true;
+}
+
+void UClawInputRecorder::ApplyDeterminism(int32 Seed, float FixedDeltaTime)
+{
+	if (!bRecording && !bReplaying)
+	{
+		bHadFixedTimeStep = FApp::UseFixedTimeStep();
+		PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	}
+
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(FixedDeltaTime);
+
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+}
+
+void UClawInputRecorder::RestoreTimestep()
+{
+	FApp::SetUseFixedTimeStep(bHadFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+}
+
+void UClawInputRecorder::OnReplayFinished()
+{
+	const int32 NumFrames = Recording.Frames.Num();
+	StopReplay();
+
+	UE_LOG(LogClaw, Display, TEXT("Replayed %d frames in %.2f s."), NumFrames, FPlatformTime::Seconds() - ReplayLoopStart);
+
+	if (!bCommandLineReplay)
+	{
+		return;
+	}
+
+	int32 NumLoops = 1;
+	FParse::Value(FCommandLine::Get(), TEXT("ClawReplayLoops="), NumLoops);
+
+	// every loop starts from a freshly loaded level, so it plays the same frames
+	if (++ReplayLoopsPlayed < NumLoops)
+	{
+		UGameplayStatics::OpenLevel(this, FName(*UGameplayStatics::GetCurrentLevelName(this)));
+	}
+	else
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Input.Record, claw.Input.Stop, claw.Input.Replay
+
+namespace
+{
+	void RecordInput(const TArray<FString>& Args, UWorld* World)
+	{
+		if (UClawInputRecorder* Recorder = World ? World->GetSubsystem<UClawInputRecorder>() : nullptr)
+		{
+			Recorder->StartRecording(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0, 1.0f / 60.0f);
+		}
+	}
+
+	void StopInput(const TArray<FString>& Args, UWorld* World)
+	{
+		if (UClawInputRecorder* Recorder = World ? World->GetSubsystem<UClawInputRecorder>() : nullptr)
+		{
+			if (Recorder->IsRecording())
+			{
+				Recorder->StopRecording(Args.Num() > 0 ? Args[0] : FString(TEXT("Recording")));
+			}
+			Recorder->StopReplay();
+		}
+	}
+
+	void ReplayInput(const TArray<FString>& Args, UWorld* World)
+	{
+		if (UClawInputRecorder* Recorder = World ? World->GetSubsystem<UClawInputRecorder>() : nullptr)
+		{
+			Recorder->StartReplay(Args.Num() > 0 ? Args[0] : FString(TEXT("Recording")));
+		}
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs RecordInputCommand(
+		TEXT("claw.Input.Record"),
+		TEXT("Starts recording Claw's input at a fixed timestep.\n")
+		TEXT("Usage: claw.Input.Record [Seed=0]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RecordInput));
+
+	FAutoConsoleCommandWithWorldAndArgs StopInputCommand(
+		TEXT("claw.Input.Stop"),
+		TEXT("Stops the recording and saves it, or stops the replay.\n")
+		TEXT("Usage: claw.Input.Stop [Name=Recording]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StopInput));
+
+	FAutoConsoleCommandWithWorldAndArgs ReplayInputCommand(
+		TEXT("claw.Input.Replay"),
+		TEXT("Feeds a recording back into Claw, the level should be freshly loaded.\n")
+		TEXT("Usage: claw.Input.Replay [Name=Recording]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReplayInput));
+}
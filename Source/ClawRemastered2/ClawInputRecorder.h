@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawInputRecorder.generated.h"
+
+class UClawSimulation;
+
+// the button events of Claw's input in one frame
+enum class EClawInputAction : uint8
+{
+	None = 0,
+	JumpPressed = 1 << 0,
+	JumpReleased = 1 << 1,
+	CrouchPressed = 1 << 2,
+	CrouchReleased = 1 << 3,
+	SwordPressed = 1 << 4,
+	PistolPressed = 1 << 5,
+};
+ENUM_CLASS_FLAGS(EClawInputAction);
+
+// Claw's input in one frame
+struct FClawInputFrame
+{
+	// MoveRight scaled to -127..127, keys only ever give -1, 0 or 1
+	int8 MoveRight = 0;
+	EClawInputAction Actions = EClawInputAction::None;
+
+	float GetMoveRight() const { return MoveRight / 127.0f; }
+
+	bool operator==(const FClawInputFrame& Other) const { return MoveRight == Other.MoveRight && Actions == Other.Actions; }
+};
+
+// a recorded run, with what it takes to play it the same way again
+struct CLAWREMASTERED2_API FClawInputRecording
+{
+	FString MapName;
+	int32 Seed = 0;
+	float FixedDeltaTime = 1.0f / 60.0f;
+
+	// a frame is one simulation step of StepSeconds when recorded under fixed steps, so the
+	// replay needs the same steps to play the same frames
+	bool bFixedStep = false;
+	float StepSeconds = 0.0f;
+
+	TArray<FClawInputFrame> Frames;
+
+	/**
+	 * Frames are run length encoded, a run of identical frames is a count and one frame, so
+	 * holding a key for a second costs four bytes.
+	 */
+	bool Save(const FString& Filename) const;
+	bool Load(const FString& Filename);
+};
+
+/**
+ * Records Claw's input frame by frame and feeds it back into him.
+ *
+ * The character hands its bound inputs to the recorder while recording, and takes them from
+ * it instead of the player while replaying. Both run at the recording's fixed timestep with
+ * the random generators seeded from it, so a replay plays the same frames on every build.
+ * Under the fixed step simulation a recorded frame is the input of one step instead, so the
+ * replay doesn't depend on how many steps each frame ran. The recording keeps the step rate,
+ * and isn't replayed with other steps than it was recorded with.
+ *
+ * Recording: -ClawRecord=File or claw.Input.Record File, then claw.Input.Stop.
+ * Replaying: -ClawReplay=File [-ClawReplayLoops=N] or claw.Input.Replay File. A replay from
+ * the command line restarts the level for every loop and exits after the last one, so it
+ * runs headless.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawInputRecorder : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void StartRecording(int32 Seed, float FixedDeltaTime);
+	bool StopRecording(const FString& Filename);
+
+	bool StartReplay(const FString& Filename);
+	void StopReplay();
+
+	bool IsRecording() const { return bRecording; }
+	bool IsReplaying() const { return bReplaying; }
+
+	/** Adds the frame the character was given to the recording. */
+	void RecordFrame(const FClawInputFrame& Frame);
+
+	/** The next frame of the replay, false once it ran out. */
+	bool ReadFrame(FClawInputFrame& OutFrame);
+
+private:
+	void ApplyDeterminism(int32 Seed, float FixedDeltaTime);
+	void RestoreTimestep();
+	void OnReplayFinished();
+
+	bool bRecording = false;
+	bool bReplaying = false;
+
+	// the replay came from the command line, it loops and exits on its own
+	bool bCommandLineReplay = false;
+
+	FString RecordFilename;
+
+	UPROPERTY()
+	UClawSimulation* Simulation;
+
+	FClawInputRecording Recording;
+	int32 ReplayFrame = 0;
+
+	bool bHadFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+};
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawLagCompensation.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "PaperCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "ClawEnemyManager.h"
+#include "ClawNet.h"
+#include "ClawSpatialHash.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_ClawLagCompensationRecord, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound Hit Checks"), STAT_ClawRewoundHitChecks, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawNetLagCompensation(
+	TEXT("claw.Net.LagCompensation"),
+	1,
+	TEXT("1: the server checks the attacks of a client against the enemies where that client saw them.\n")
+	TEXT("0: the attacks of every client are checked against the enemies where they are on the server.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarClawNetMaxRewind(
+	TEXT("claw.Net.MaxRewind"),
+	0.25f,
+	TEXT("The most seconds the server rewinds the enemies to check the attack of a client.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+void UClawLagCompensation::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bEnabled = CVarClawNetLagCompensation.GetValueOnGameThread() != 0;
+	MaxRewind = FMath::Max(CVarClawNetMaxRewind.GetValueOnGameThread(), 0.0f);
+
+	EnemyManager = Collection.InitializeDependency<UClawEnemyManager>();
+}
+
+void UClawLagCompensation::Deinitialize()
+{
+	for (FRewindFrame& Frame : Frames)
+	{
+		Frame.Enemies.Empty();
+		Frame.Bounds.Empty();
+	}
+	NumRecorded = 0;
+
+	Super::Deinitialize();
+}
+
+void UClawLagCompensation::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawLagCompensationRecord);
+
+	LiveEnemies.Reset();
+	EnemyManager->GatherLiveEnemies(LiveEnemies);
+
+	// the oldest frame is overwritten, its arrays keep their memory
+	FRewindFrame& Frame = Frames[Head];
+	Frame.Time = GetWorld()->GetTimeSeconds();
+	Frame.Enemies.Reset();
+	Frame.Bounds.Reset();
+
+	for (APaperCharacter* Enemy : LiveEnemies)
+	{
+		const UCapsuleComponent* Capsule = Enemy->GetCapsuleComponent();
+		Frame.Enemies.Add(Enemy);
+		Frame.Bounds.Add(FClawSpatialGrid::MakeBounds(Enemy->GetActorLocation(), FVector(Capsule->GetScaledCapsuleRadius(), 0.0f, Capsule->GetScaledCapsuleHalfHeight())));
+	}
+
+	Head = (Head + 1) % NumFrames;
+	NumRecorded = FMath::Min(NumRecorded + 1, NumFrames);
+}
+
+ETickableTickType UClawLagCompensation::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawLagCompensation::IsTickable() const
+{
+	return bEnabled && ClawNet::IsServing(GetWorld());
+}
+
+TStatId UClawLagCompensation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawLagCompensation, STATGROUP_Tickables);
+}
+
+UWorld* UClawLagCompensation::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+double UClawLagCompensation::GetViewTime(const APawn* Pawn) const
+{
+	// the client sees the server's enemies half a round trip late, and its attack arrives half a round trip later
+	const APlayerState* PlayerState = Pawn->GetPlayerState();
+	const float Latency = PlayerState ? PlayerState->ExactPing / 1000.0f : 0.0f;
+
+	return GetWorld()->GetTimeSeconds() - FMath::Clamp(Latency, 0.0f, MaxRewind);
+}
+
+void UClawLagCompensation::GatherEnemiesAt(const FBox2D& Area, double Time, TArray<AActor*>& OutEnemies) const
+{
+	if (NumRecorded == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_ClawRewoundHitChecks);
+
+	// walk back from the newest frame, the oldest one stands in for anything before it
+	int32 FrameIndex = (Head - 1 + NumFrames) % NumFrames;
+	for (int32 Step = 1; Step < NumRecorded && Frames[FrameIndex].Time > Time; ++Step)
+	{
+		FrameIndex = (FrameIndex - 1 + NumFrames) % NumFrames;
+	}
+
+	const FRewindFrame& Frame = Frames[FrameIndex];
+	for (int32 Index = 0; Index < Frame.Enemies.Num(); ++Index)
+	{
+		if (Frame.Bounds[Index].Intersect(Area))
+		{
+			if (AActor* Enemy = Frame.Enemies[Index].Get())
+			{
+				OutEnemies.Add(Enemy);
+			}
+		}
+	}
+}
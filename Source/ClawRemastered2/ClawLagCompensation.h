@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawLagCompensation.generated.h"
+
+class APawn;
+class APaperCharacter;
+class UClawEnemyManager;
+
+/**
+ * Remembers where the enemies were over the last moments on a server, so the attacks of
+ * a client can be checked against what that client saw.
+ *
+ * Every frame the bounds of the live enemies are recorded into a ring of frames. A swing
+ * of a remote Claw is then tested against the frame of its view time, which is its round
+ * trip behind the server, but never more than claw.Net.MaxRewind seconds. Setting
+ * claw.Net.LagCompensation to 0 tests every attack against the enemies where they are now.
+ *
+ * Combat can be tried with two local processes and the engine's network emulation, e.g.
+ * a server with -server -log and a client with 127.0.0.1 -game -PktLag=150 -PktLoss=5,
+ * or by entering NetEmulation.PktLag and NetEmulation.PktLoss on the client's console.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawLagCompensation : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	bool IsEnabled() const { return bEnabled; }
+
+	/** Returns the world time whose enemies the player of Pawn saw on its screen. */
+	double GetViewTime(const APawn* Pawn) const;
+
+	/** Adds the enemies whose bounds overlapped Area at Time, as recorded in the closest frame before it. */
+	void GatherEnemiesAt(const FBox2D& Area, double Time, TArray<AActor*>& OutEnemies) const;
+
+private:
+	struct FRewindFrame
+	{
+		double Time = 0.0;
+		TArray<TWeakObjectPtr<AActor>> Enemies;
+		TArray<FBox2D> Bounds;
+	};
+
+	// enough frames to cover the rewind window of a server running at well over 100 Hz
+	static constexpr int32 NumFrames = 64;
+
+	bool bEnabled = true;
+	float MaxRewind = 0.25f;
+
+	UPROPERTY()
+	UClawEnemyManager* EnemyManager;
+
+	FRewindFrame Frames[NumFrames];
+
+	// the next frame to write, and how many were written so far
+	int32 Head = 0;
+	int32 NumRecorded = 0;
+
+	TArray<APaperCharacter*> LiveEnemies;
+};
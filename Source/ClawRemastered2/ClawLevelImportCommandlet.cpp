@@ -0,0 +1,389 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawLevelImportCommandlet.h"
+#include "ClawRemastered2.h"
+#include "ClawTileMap.h"
+#include "HAL/FileManager.h"
+#include "Async/ParallelFor.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/Crc.h"
+#include "Modules/ModuleManager.h"
+
+namespace
+{
+	struct FImportImage
+	{
+		int32 Width = 0;
+		int32 Height = 0;
+		TArray<FColor> Pixels;
+	};
+
+	// what a 64px block looks like, for matching cells against tiles
+	struct FTileHash
+	{
+		// one bit per neighbouring pair of a 9x8 luminance grid, set where it gets brighter to the right
+		uint64 Gradient = 0;
+
+		// the average color, flat tiles all have the same gradient hash
+		int32 R = 0;
+		int32 G = 0;
+		int32 B = 0;
+	};
+
+	struct FImportTile
+	{
+		uint16 TileId;
+		EClawTileLayer Layer;
+		FTileHash Hash;
+
+		// identical tiles of different sets share an atlas slot
+		uint32 PixelCrc;
+
+		TArray<FColor> Pixels;
+	};
+
+	struct FLevelReport
+	{
+		bool bImported = false;
+		double Seconds = 0.0;
+		int32 NumCells = 0;
+		int32 NumMatched = 0;
+		int32 NumTiles = 0;
+		int32 NumAtlasTiles = 0;
+	};
+
+	const TCHAR* const LayerFolders[] = { TEXT("BACK"), TEXT("ACTION"), TEXT("FRONT") };
+
+	bool LoadPng(const FString& Filename, FImportImage& OutImage)
+	{
+		TArray<uint8> Compressed;
+		if (!FFileHelper::LoadFileToArray(Compressed, *Filename, FILEREAD_Silent))
+		{
+			return false;
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+
+		// paletted images come out expanded to BGRA as well
+		TArray<uint8> Raw;
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Compressed.GetData(), Compressed.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Raw))
+		{
+			return false;
+		}
+
+		OutImage.Width = ImageWrapper->GetWidth();
+		OutImage.Height = ImageWrapper->GetHeight();
+		OutImage.Pixels.SetNumUninitialized(OutImage.Width * OutImage.Height);
+		FMemory::Memcpy(OutImage.Pixels.GetData(), Raw.GetData(), Raw.Num());
+
+		return true;
+	}
+
+	bool SavePng(const FString& Filename, const FImportImage& Image)
+	{
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Image.Pixels.GetData(), Image.Pixels.Num() * sizeof(FColor), Image.Width, Image.Height, ERGBFormat::BGRA, 8))
+		{
+			return false;
+		}
+
+		return FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *Filename);
+	}
+
+	// hashes the Size x Size block at Pixels, transparent pixels count as black like the level images
+	FTileHash HashBlock(const FColor* Pixels, int32 Stride, int32 Size)
+	{
+		const int32 GridWidth = 9;
+		const int32 GridHeight = 8;
+
+		float Luminance[GridHeight][GridWidth] = {};
+		int32 Counts[GridHeight][GridWidth] = {};
+
+		FTileHash Hash;
+		for (int32 Y = 0; Y < Size; ++Y)
+		{
+			const FColor* Row = Pixels + Y * Stride;
+			const int32 GridY = Y * GridHeight / Size;
+
+			for (int32 X = 0; X < Size; ++X)
+			{
+				const FColor Color = Row[X];
+				const int32 R = Color.R * Color.A / 255;
+				const int32 G = Color.G * Color.A / 255;
+				const int32 B = Color.B * Color.A / 255;
+
+				const int32 GridX = X * GridWidth / Size;
+				Luminance[GridY][GridX] += 0.299f * R + 0.587f * G + 0.114f * B;
+				++Counts[GridY][GridX];
+
+				Hash.R += R;
+				Hash.G += G;
+				Hash.B += B;
+			}
+		}
+
+		for (int32 GridY = 0; GridY < GridHeight; ++GridY)
+		{
+			for (int32 GridX = 0; GridX < GridWidth - 1; ++GridX)
+			{
+				const float Left = Luminance[GridY][GridX] / Counts[GridY][GridX];
+				const float Right = Luminance[GridY][GridX + 1] / Counts[GridY][GridX + 1];
+
+				Hash.Gradient = (Hash.Gradient << 1) | (Left < Right ? 1 : 0);
+			}
+		}
+
+		const int32 NumPixels = Size * Size;
+		Hash.R /= NumPixels;
+		Hash.G /= NumPixels;
+		Hash.B /= NumPixels;
+
+		return Hash;
+	}
+
+	int32 ColorDistance(const FTileHash& A, const FTileHash& B)
+	{
+		return FMath::Abs(A.R - B.R) + FMath::Abs(A.G - B.G) + FMath::Abs(A.B - B.B);
+	}
+
+	void LoadTiles(const FString& TilesDir, int32 TileSize, TArray<FImportTile>& OutTiles)
+	{
+		for (int32 Layer = 0; Layer < (int32)EClawTileLayer::Count; ++Layer)
+		{
+			const FString LayerDir = TilesDir / LayerFolders[Layer];
+
+			TArray<FString> Filenames;
+			IFileManager::Get().FindFiles(Filenames, *(LayerDir / TEXT("*.png")), true, false);
+			Filenames.Sort();
+
+			for (const FString& Filename : Filenames)
+			{
+				FImportImage Image;
+				if (!LoadPng(LayerDir / Filename, Image) || Image.Width != TileSize || Image.Height != TileSize)
+				{
+					UE_LOG(LogClaw, Warning, TEXT("Skipped tile %s, it isn't a %dx%d png."), *(LayerDir / Filename), TileSize, TileSize);
+					continue;
+				}
+
+				FImportTile& Tile = OutTiles.AddDefaulted_GetRef();
+				Tile.TileId = (uint16)FCString::Atoi(*FPaths::GetBaseFilename(Filename));
+				Tile.Layer = (EClawTileLayer)Layer;
+				Tile.Hash = HashBlock(Image.Pixels.GetData(), TileSize, TileSize);
+				Tile.PixelCrc = FCrc::MemCrc32(Image.Pixels.GetData(), Image.Pixels.Num() * sizeof(FColor));
+				Tile.Pixels = MoveTemp(Image.Pixels);
+			}
+		}
+	}
+
+	// the tile that looks most like the block, INDEX_NONE when none is close enough
+	int32 MatchBlock(const FTileHash& Hash, const TArray<FImportTile>& Tiles, int32 MaxBitDistance, int32 MaxColorDistance)
+	{
+		int32 BestTile = INDEX_NONE;
+		int32 BestBits = MaxBitDistance + 1;
+		int32 BestColor = MaxColorDistance + 1;
+
+		for (int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex)
+		{
+			const FTileHash& TileHash = Tiles[TileIndex].Hash;
+
+			const int32 Bits = FPlatformMath::CountBits(Hash.Gradient ^ TileHash.Gradient);
+			if (Bits > MaxBitDistance || Bits > BestBits)
+			{
+				continue;
+			}
+
+			const int32 Color = ColorDistance(Hash, TileHash);
+			// fewer differing bits wins, the color only decides between equally close tiles
+			if (Color <= MaxColorDistance && (Bits < BestBits || Color < BestColor))
+			{
+				BestTile = TileIndex;
+				BestBits = Bits;
+				BestColor = Color;
+			}
+		}
+
+		return BestTile;
+	}
+
+	FLevelReport ImportLevel(int32 Level, const FString& SourceDir, const FString& DestDir, int32 MaxBitDistance, int32 MaxColorDistance)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		FLevelReport Report;
+
+		FClawTileMap TileMap;
+		const int32 TileSize = TileMap.TileSize;
+
+		FImportImage LevelImage;
+		if (!LoadPng(SourceDir / TEXT("Claw_Levels") / FString::Printf(TEXT("lvl%d.png"), Level), LevelImage))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Level %d: couldn't read lvl%d.png."), Level, Level);
+			return Report;
+		}
+
+		TArray<FImportTile> Tiles;
+		LoadTiles(SourceDir / FString::Printf(TEXT("LEVEL%d"), Level) / TEXT("TILES"), TileSize, Tiles);
+		Report.NumTiles = Tiles.Num();
+
+		TileMap.Width = LevelImage.Width / TileSize;
+		TileMap.Height = LevelImage.Height / TileSize;
+		for (TArray<uint16>& Layer : TileMap.Layers)
+		{
+			Layer.Init(CLAW_NoTile, TileMap.Width * TileMap.Height);
+		}
+
+		// tile index to atlas index, and atlas index to the tile holding its pixels
+		TArray<int32> AtlasIndices;
+		AtlasIndices.Init(INDEX_NONE, Tiles.Num());
+		TMap<uint32, int32> AtlasIndicesByCrc;
+		TArray<int32> AtlasSources;
+
+		for (int32 Y = 0; Y < TileMap.Height; ++Y)
+		{
+			for (int32 X = 0; X < TileMap.Width; ++X)
+			{
+				const FColor* Block = LevelImage.Pixels.GetData() + Y * TileSize * LevelImage.Width + X * TileSize;
+				const int32 TileIndex = MatchBlock(HashBlock(Block, LevelImage.Width, TileSize), Tiles, MaxBitDistance, MaxColorDistance);
+				if (TileIndex == INDEX_NONE)
+				{
+					continue;
+				}
+
+				const FImportTile& Tile = Tiles[TileIndex];
+				if (AtlasIndices[TileIndex] == INDEX_NONE)
+				{
+					if (const int32* Existing = AtlasIndicesByCrc.Find(Tile.PixelCrc))
+					{
+						AtlasIndices[TileIndex] = *Existing;
+					}
+					else
+					{
+						AtlasIndices[TileIndex] = AtlasSources.Add(TileIndex);
+						AtlasIndicesByCrc.Add(Tile.PixelCrc, AtlasIndices[TileIndex]);
+
+						FClawAtlasTile& AtlasTile = TileMap.AtlasTiles.AddDefaulted_GetRef();
+						AtlasTile.TileId = Tile.TileId;
+						AtlasTile.Layer = Tile.Layer;
+					}
+				}
+
+				// the level image is flattened, so a cell only gets the layer of the tile it matched
+				TileMap.Layers[(int32)Tile.Layer][Y * TileMap.Width + X] = (uint16)AtlasIndices[TileIndex];
+				++Report.NumMatched;
+			}
+		}
+
+		Report.NumCells = TileMap.Width * TileMap.Height;
+		Report.NumAtlasTiles = AtlasSources.Num();
+
+		// rows of AtlasColumns tiles on a power of two page
+		FImportImage Atlas;
+		Atlas.Width = TileMap.AtlasColumns * TileSize;
+		Atlas.Height = FMath::RoundUpToPowerOfTwo(FMath::Max(FMath::DivideAndRoundUp(AtlasSources.Num(), TileMap.AtlasColumns), 1) * TileSize);
+		Atlas.Pixels.SetNumZeroed(Atlas.Width * Atlas.Height);
+
+		for (int32 AtlasIndex = 0; AtlasIndex < AtlasSources.Num(); ++AtlasIndex)
+		{
+			const FIntPoint Offset = TileMap.GetAtlasOffset((uint16)AtlasIndex);
+			const FColor* Source = Tiles[AtlasSources[AtlasIndex]].Pixels.GetData();
+
+			for (int32 Row = 0; Row < TileSize; ++Row)
+			{
+				FMemory::Memcpy(&Atlas.Pixels[(Offset.Y + Row) * Atlas.Width + Offset.X], Source + Row * TileSize, TileSize * sizeof(FColor));
+			}
+		}
+
+		const FString TileMapFilename = DestDir / FPaths::GetCleanFilename(FClawTileMap::GetTileMapFilename(Level));
+		const FString AtlasFilename = DestDir / FPaths::GetCleanFilename(FClawTileMap::GetAtlasFilename(Level));
+		if (!TileMap.Save(TileMapFilename) || !SavePng(AtlasFilename, Atlas))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Level %d: couldn't write %s."), Level, *TileMapFilename);
+			return Report;
+		}
+
+		Report.bImported = true;
+		Report.Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		UE_LOG(LogClaw, Display, TEXT("Level %d: %d of %d cells matched against %d tiles, %d atlas tiles, %.1f ms"),
+			Level, Report.NumMatched, Report.NumCells, Report.NumTiles, Report.NumAtlasTiles, Report.Seconds * 1000.0);
+
+		return Report;
+	}
+}
+
+UClawLevelImportCommandlet::UClawLevelImportCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClawLevelImportCommandlet::Main(const FString& Params)
+{
+	FString SourceDir = FPaths::ProjectDir() / TEXT("Claw_Assets");
+	FParse::Value(*Params, TEXT("Source="), SourceDir);
+
+	FString DestDir = FClawTileMap::GetDirectory();
+	FParse::Value(*Params, TEXT("Dest="), DestDir);
+
+	// how far a cell may be from its tile, in bits of the gradient hash and in summed channels of the average color
+	int32 MaxBitDistance = 10;
+	FParse::Value(*Params, TEXT("Threshold="), MaxBitDistance);
+	int32 MaxColorDistance = 24;
+	FParse::Value(*Params, TEXT("ColorThreshold="), MaxColorDistance);
+
+	TArray<int32> Levels;
+	FString LevelList;
+	if (FParse::Value(*Params, TEXT("Levels="), LevelList, false))
+	{
+		TArray<FString> LevelNames;
+		LevelList.ParseIntoArray(LevelNames, TEXT(","));
+		for (const FString& LevelName : LevelNames)
+		{
+			Levels.Add(FCString::Atoi(*LevelName));
+		}
+	}
+	else
+	{
+		for (int32 Level = 1; Level <= 14; ++Level)
+		{
+			Levels.Add(Level);
+		}
+	}
+
+	// the module must be loaded on the game thread before the workers decode images
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	IFileManager::Get().MakeDirectory(*DestDir, true);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	TArray<FLevelReport> Reports;
+	Reports.SetNum(Levels.Num());
+	ParallelFor(Levels.Num(), [&](int32 Index)
+	{
+		Reports[Index] = ImportLevel(Levels[Index], SourceDir, DestDir, MaxBitDistance, MaxColorDistance);
+	});
+
+	const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	int32 NumFailed = 0;
+	double LevelSeconds = 0.0;
+	for (const FLevelReport& Report : Reports)
+	{
+		NumFailed += Report.bImported ? 0 : 1;
+		LevelSeconds += Report.Seconds;
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("Imported %d of %d levels to %s in %.2f s (%.2f s of level imports)."),
+		Levels.Num() - NumFailed, Levels.Num(), *DestDir, Seconds, LevelSeconds);
+
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClawLevelImportCommandlet.generated.h"
+
+/**
+ * Turns the level images of Claw_Assets/Claw_Levels into tile maps.
+ *
+ * Every 64px cell of lvlN.png is matched against the tiles of LEVELN/TILES/BACK, ACTION and
+ * FRONT through a perceptual hash, so cells that were scaled or recompressed still find
+ * their tile. The result is written to Content/TileMaps as a FClawTileMap with one uint16
+ * per cell and layer, plus an atlas that holds each tile the level uses once. The levels
+ * are imported in parallel.
+ *
+ * Usage: -run=ClawLevelImport [-Levels=1,2,3] [-Threshold=10] [-Source=Dir] [-Dest=Dir]
+ */
+UCLASS()
+class UClawLevelImportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClawLevelImportCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
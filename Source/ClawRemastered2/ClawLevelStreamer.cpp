@@ -0,0 +1,565 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawLevelStreamer.h"
+#include "ClawRemastered2.h"
+#include "ClawTileLevel.h"
+#include "ClawRemastered2Character.h"
+#include "ClawStats.h"
+#include "Async/Async.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/Texture2D.h"
+#include "HAL/IConsoleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Kismet/GameplayStatics.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Misc/FileHelper.h"
+#include "Modules/ModuleManager.h"
+#include "ProceduralMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Level Streaming"), STAT_ClawLevelStreaming, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Resident Chunks"), STAT_ClawResidentChunks, STATGROUP_Claw);
+DECLARE_MEMORY_STAT(TEXT("Streamed Level Memory"), STAT_ClawStreamedLevelMemory, STATGROUP_Claw);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Chunk Load Latency (ms)"), STAT_ClawChunkLoadLatency, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawStreamingChunked(
+	TEXT("claw.Streaming.Chunked"),
+	1,
+	TEXT("1: only the chunks of the tile level around the camera are resident.\n")
+	TEXT("0: the whole tile level is loaded when it opens.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawStreamingChunkTiles(
+	TEXT("claw.Streaming.ChunkTiles"),
+	16,
+	TEXT("Width of the streamed chunks of a tile level, in tile columns.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld ClawStreamingReportCommand(
+	TEXT("claw.Streaming.Report"),
+	TEXT("Logs the resident chunks, memory and chunk load latencies of the tile level."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UClawLevelStreamer* LevelStreamer = World->GetSubsystem<UClawLevelStreamer>())
+		{
+			LevelStreamer->LogReport();
+		}
+	}));
+
+namespace
+{
+	// the mesh sections are applied on the game thread, so keep it to one chunk per frame
+	const int32 ChunksAppliedPerFrame = 1;
+	const int32 SpawnsPerFrame = 4;
+
+	// along Y, the camera looks at the level from +Y
+	const float LayerDepths[] = { -20.0f, -10.0f, 20.0f };
+
+	const TCHAR* const DefaultTileMaterial = TEXT("/Paper2D/MaskedUnlitSpriteMaterial.MaskedUnlitSpriteMaterial");
+}
+
+int32 FClawChunkGeometry::GetAllocatedSize() const
+{
+	int32 Bytes = 0;
+	for (const FSection& Section : Sections)
+	{
+		Bytes += Section.Vertices.GetAllocatedSize() + Section.Triangles.GetAllocatedSize() + Section.UVs.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+void UClawLevelStreamer::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bChunked = CVarClawStreamingChunked.GetValueOnGameThread() != 0;
+	ChunkColumns = FMath::Max(CVarClawStreamingChunkTiles.GetValueOnGameThread(), 1);
+}
+
+void UClawLevelStreamer::Deinitialize()
+{
+	if (Level)
+	{
+		CloseLevel(Level);
+	}
+
+	Super::Deinitialize();
+}
+
+void UClawLevelStreamer::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawLevelStreaming);
+
+	// the tile map is loaded in the background, nothing streams before it's there
+	if (!TileMap.IsValid())
+	{
+		if (Loading.IsValid() && Loading.IsReady())
+		{
+			FinishOpening(Loading.Get());
+			Loading = {};
+		}
+		return;
+	}
+
+	UpdateWindow();
+
+	int32 NumApplied = 0;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num() && NumApplied < ChunksAppliedPerFrame; ++ChunkIndex)
+	{
+		FChunk& Chunk = Chunks[ChunkIndex];
+		if (Chunk.State == EClawChunkState::Building && Chunk.Build.IsReady())
+		{
+			const TSharedPtr<FClawChunkGeometry, ESPMode::ThreadSafe> Geometry = Chunk.Build.Get();
+			Chunk.Build = {};
+
+			ApplyChunk(ChunkIndex, *Geometry);
+			++NumApplied;
+		}
+	}
+
+	SpawnPending();
+}
+
+ETickableTickType UClawLevelStreamer::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawLevelStreamer::IsTickable() const
+{
+	return Level != nullptr;
+}
+
+TStatId UClawLevelStreamer::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawLevelStreamer, STATGROUP_Tickables);
+}
+
+UWorld* UClawLevelStreamer::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UClawLevelStreamer::OpenLevel(AClawTileLevel* InLevel)
+{
+	if (Level)
+	{
+		UE_LOG(LogClaw, Warning, TEXT("%s wasn't streamed, %s is already open."), *InLevel->GetName(), *Level->GetName());
+		return;
+	}
+
+	Level = InLevel;
+
+	// the workers decode the atlas, which needs the module loaded on the game thread first
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	const FString TileMapFilename = FClawTileMap::GetTileMapFilename(Level->LevelNumber);
+	const FString AtlasFilename = FClawTileMap::GetAtlasFilename(Level->LevelNumber);
+
+	Loading = Async(EAsyncExecution::ThreadPool, [TileMapFilename, AtlasFilename]()
+	{
+		TSharedPtr<FClawLoadedTileLevel, ESPMode::ThreadSafe> Loaded = MakeShared<FClawLoadedTileLevel, ESPMode::ThreadSafe>();
+
+		TArray<uint8> Compressed;
+		if (!Loaded->TileMap.Load(TileMapFilename) || !FFileHelper::LoadFileToArray(Compressed, *AtlasFilename, FILEREAD_Silent))
+		{
+			return Loaded;
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Compressed.GetData(), Compressed.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Loaded->AtlasPixels))
+		{
+			return Loaded;
+		}
+
+		Loaded->AtlasWidth = ImageWrapper->GetWidth();
+		Loaded->AtlasHeight = ImageWrapper->GetHeight();
+		Loaded->bLoaded = true;
+
+		return Loaded;
+	});
+}
+
+void UClawLevelStreamer::FinishOpening(const TSharedPtr<FClawLoadedTileLevel, ESPMode::ThreadSafe>& Loaded)
+{
+	if (!Loaded->bLoaded)
+	{
+		UE_LOG(LogClaw, Error, TEXT("Couldn't load %s, run the ClawLevelImport commandlet first."), *FClawTileMap::GetTileMapFilename(Level->LevelNumber));
+		return;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	// creating the texture is the only part of opening that has to run on the game thread
+	Atlas = UTexture2D::CreateTransient(Loaded->AtlasWidth, Loaded->AtlasHeight, PF_B8G8R8A8);
+	Atlas->Filter = TF_Nearest;
+	FTexture2DMipMap& Mip = Atlas->PlatformData->Mips[0];
+	FMemory::Memcpy(Mip.BulkData.Lock(LOCK_READ_WRITE), Loaded->AtlasPixels.GetData(), Loaded->AtlasPixels.Num());
+	Mip.BulkData.Unlock();
+	Atlas->UpdateResource();
+
+	UMaterialInterface* BaseMaterial = Level->TileMaterial ? Level->TileMaterial : LoadObject<UMaterialInterface>(nullptr, DefaultTileMaterial);
+	TileMaterial = UMaterialInstanceDynamic::Create(BaseMaterial, this);
+	TileMaterial->SetTextureParameterValue(TEXT("SpriteTexture"), Atlas);
+
+	TileMap = MakeShared<FClawTileMap, ESPMode::ThreadSafe>(MoveTemp(Loaded->TileMap));
+	Chunks.SetNum(FMath::DivideAndRoundUp(TileMap->Width, ChunkColumns));
+
+	// every spawn belongs to the chunk under it
+	const int32 NumSpawns = Level->Spawns.Num();
+	SpawnChunks.SetNum(NumSpawns);
+	SpawnStates.Init(ESpawnState::Idle, NumSpawns);
+	SpawnedActors.SetNum(NumSpawns);
+	for (int32 SpawnIndex = 0; SpawnIndex < NumSpawns; ++SpawnIndex)
+	{
+		const int32 Column = FMath::Clamp(FMath::FloorToInt(Level->Spawns[SpawnIndex].Location.X / TileMap->TileSize), 0, TileMap->Width - 1);
+		SpawnChunks[SpawnIndex] = Column / ChunkColumns;
+	}
+
+	UpdateResidentBytes();
+
+	UE_LOG(LogClaw, Display, TEXT("Opened tile level %d: %dx%d tiles in %d chunks, %.2f ms on the game thread."),
+		Level->LevelNumber, TileMap->Width, TileMap->Height, Chunks.Num(), FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+}
+
+void UClawLevelStreamer::CloseLevel(AClawTileLevel* InLevel)
+{
+	if (Level != InLevel)
+	{
+		return;
+	}
+
+	if (TileMap.IsValid())
+	{
+		LogReport();
+	}
+
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		if (Chunks[ChunkIndex].State == EClawChunkState::Resident)
+		{
+			UnloadChunk(ChunkIndex);
+		}
+	}
+
+	for (UProceduralMeshComponent* Mesh : ChunkMeshes)
+	{
+		if (Mesh)
+		{
+			Mesh->DestroyComponent();
+		}
+	}
+
+	// pending builds finish on their own, their geometry is simply dropped
+	Chunks.Empty();
+	ChunkMeshes.Empty();
+	FreeMeshes.Empty();
+	SpawnChunks.Empty();
+	SpawnStates.Empty();
+	SpawnedActors.Empty();
+	PendingSpawns.Empty();
+	Loading = {};
+	TileMap.Reset();
+	Atlas = nullptr;
+	TileMaterial = nullptr;
+	Level = nullptr;
+
+	UpdateResidentBytes();
+}
+
+void UClawLevelStreamer::UpdateWindow()
+{
+	float ViewX;
+	float ViewWidth;
+	if (bChunked)
+	{
+		const AClawRemastered2Character* Claw = Cast<AClawRemastered2Character>(UGameplayStatics::GetPlayerPawn(GetWorld(), 0));
+		if (!Claw)
+		{
+			return;
+		}
+
+		const UCameraComponent* Camera = Claw->GetSideViewCameraComponent();
+		ViewX = Camera->GetComponentLocation().X - Level->GetActorLocation().X;
+		ViewWidth = Camera->OrthoWidth;
+	}
+	else
+	{
+		// a window over the whole level
+		ViewWidth = TileMap->Width * TileMap->TileSize;
+		ViewX = ViewWidth * 0.5f;
+	}
+
+	// load the chunks within half a screen of the view, unload the ones a screen behind it
+	const float ChunkWidth = ChunkColumns * TileMap->TileSize;
+	const float LoadMin = ViewX - ViewWidth;
+	const float LoadMax = ViewX + ViewWidth;
+	const float UnloadMin = ViewX - ViewWidth * 1.5f;
+	const float UnloadMax = ViewX + ViewWidth * 1.5f;
+
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		const float ChunkMin = ChunkIndex * ChunkWidth;
+		const float ChunkMax = ChunkMin + ChunkWidth;
+
+		FChunk& Chunk = Chunks[ChunkIndex];
+		if (Chunk.State == EClawChunkState::Unloaded && ChunkMax >= LoadMin && ChunkMin <= LoadMax)
+		{
+			RequestChunk(ChunkIndex);
+		}
+		else if (ChunkMax < UnloadMin || ChunkMin > UnloadMax)
+		{
+			if (Chunk.State == EClawChunkState::Resident)
+			{
+				UnloadChunk(ChunkIndex);
+			}
+			else if (Chunk.State == EClawChunkState::Building)
+			{
+				// the camera turned back before the chunk was built
+				Chunk.Build = {};
+				Chunk.State = EClawChunkState::Unloaded;
+			}
+		}
+	}
+}
+
+void UClawLevelStreamer::RequestChunk(int32 ChunkIndex)
+{
+	FChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.State = EClawChunkState::Building;
+	Chunk.RequestCycles = FPlatformTime::Cycles64();
+
+	const int32 FirstColumn = ChunkIndex * ChunkColumns;
+	const int32 LastColumn = FMath::Min(FirstColumn + ChunkColumns, TileMap->Width) - 1;
+	const FVector2D AtlasSize(Atlas->GetSizeX(), Atlas->GetSizeY());
+
+	// the task holds on to the tile map, so closing the level doesn't pull it from under it
+	TSharedPtr<const FClawTileMap, ESPMode::ThreadSafe> Map = TileMap;
+	Chunk.Build = Async(EAsyncExecution::ThreadPool, [Map, FirstColumn, LastColumn, AtlasSize]()
+	{
+		return BuildChunk(*Map, FirstColumn, LastColumn, AtlasSize);
+	});
+}
+
+TSharedPtr<FClawChunkGeometry, ESPMode::ThreadSafe> UClawLevelStreamer::BuildChunk(const FClawTileMap& Map, int32 FirstColumn, int32 LastColumn, const FVector2D& AtlasSize)
+{
+	TSharedPtr<FClawChunkGeometry, ESPMode::ThreadSafe> Geometry = MakeShared<FClawChunkGeometry, ESPMode::ThreadSafe>();
+
+	const float Size = Map.TileSize;
+	const FVector2D UVSize = FVector2D(Size, Size) / AtlasSize;
+
+	for (int32 Layer = 0; Layer < (int32)EClawTileLayer::Count; ++Layer)
+	{
+		FClawChunkGeometry::FSection& Section = Geometry->Sections[Layer];
+		const float Depth = LayerDepths[Layer];
+
+		for (int32 Y = 0; Y < Map.Height; ++Y)
+		{
+			for (int32 X = FirstColumn; X <= LastColumn; ++X)
+			{
+				const uint16 Tile = Map.GetTile((EClawTileLayer)Layer, X, Y);
+				if (Tile == CLAW_NoTile)
+				{
+					continue;
+				}
+
+				// the rows of the tile map go down from the top of the level
+				const float Left = X * Size;
+				const float Top = -Y * Size;
+				const FVector2D UV = FVector2D(Map.GetAtlasOffset(Tile)) / AtlasSize;
+
+				const int32 First = Section.Vertices.Num();
+				Section.Vertices.Add(FVector(Left, Depth, Top));
+				Section.Vertices.Add(FVector(Left + Size, Depth, Top));
+				Section.Vertices.Add(FVector(Left + Size, Depth, Top - Size));
+				Section.Vertices.Add(FVector(Left, Depth, Top - Size));
+
+				Section.UVs.Add(UV);
+				Section.UVs.Add(FVector2D(UV.X + UVSize.X, UV.Y));
+				Section.UVs.Add(UV + UVSize);
+				Section.UVs.Add(FVector2D(UV.X, UV.Y + UVSize.Y));
+
+				Section.Triangles.Append({ First, First + 2, First + 1, First, First + 3, First + 2 });
+			}
+		}
+	}
+
+	return Geometry;
+}
+
+void UClawLevelStreamer::ApplyChunk(int32 ChunkIndex, const FClawChunkGeometry& Geometry)
+{
+	FChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.Mesh = AcquireMesh();
+	Chunk.Bytes = Geometry.GetAllocatedSize();
+	Chunk.State = EClawChunkState::Resident;
+
+	UProceduralMeshComponent* Mesh = ChunkMeshes[Chunk.Mesh];
+	for (int32 Layer = 0; Layer < (int32)EClawTileLayer::Count; ++Layer)
+	{
+		const FClawChunkGeometry::FSection& Section = Geometry.Sections[Layer];
+		if (Section.Vertices.Num() > 0)
+		{
+			Mesh->CreateMeshSection(Layer, Section.Vertices, Section.Triangles, TArray<FVector>(), Section.UVs, TArray<FColor>(), TArray<FProcMeshTangent>(), false);
+			Mesh->SetMaterial(Layer, TileMaterial);
+		}
+	}
+	Mesh->SetVisibility(true);
+
+	// queue the spawns standing on the chunk, they are spread over the next frames
+	for (int32 SpawnIndex = 0; SpawnIndex < SpawnChunks.Num(); ++SpawnIndex)
+	{
+		if (SpawnChunks[SpawnIndex] == ChunkIndex && SpawnStates[SpawnIndex] == ESpawnState::Idle)
+		{
+			SpawnStates[SpawnIndex] = ESpawnState::Queued;
+			PendingSpawns.Add(SpawnIndex);
+		}
+	}
+
+	const double Latency = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Chunk.RequestCycles);
+	++NumChunkLoads;
+	TotalLatency += Latency;
+	MaxLatency = FMath::Max(MaxLatency, Latency);
+	SET_FLOAT_STAT(STAT_ClawChunkLoadLatency, Latency);
+	INC_DWORD_STAT(STAT_ClawResidentChunks);
+
+	UpdateResidentBytes();
+
+	const int32 FirstColumn = ChunkIndex * ChunkColumns;
+	ChunkStreamed.Broadcast(ChunkIndex, FirstColumn, FMath::Min(FirstColumn + ChunkColumns, TileMap->Width) - 1, true);
+}
+
+void UClawLevelStreamer::UnloadChunk(int32 ChunkIndex)
+{
+	FChunk& Chunk = Chunks[ChunkIndex];
+
+	UProceduralMeshComponent* Mesh = ChunkMeshes[Chunk.Mesh];
+	Mesh->ClearAllMeshSections();
+	Mesh->SetVisibility(false);
+	FreeMeshes.Add(Chunk.Mesh);
+
+	Chunk.Mesh = INDEX_NONE;
+	Chunk.Bytes = 0;
+	Chunk.State = EClawChunkState::Unloaded;
+
+	// spawns that are gone were picked up or killed, the rest leave with the chunk and come back with it
+	for (int32 SpawnIndex = 0; SpawnIndex < SpawnChunks.Num(); ++SpawnIndex)
+	{
+		if (SpawnChunks[SpawnIndex] != ChunkIndex)
+		{
+			continue;
+		}
+
+		if (SpawnStates[SpawnIndex] == ESpawnState::Spawned)
+		{
+			if (AActor* Actor = SpawnedActors[SpawnIndex].Get())
+			{
+				Actor->Destroy();
+				SpawnStates[SpawnIndex] = ESpawnState::Idle;
+			}
+			else
+			{
+				SpawnStates[SpawnIndex] = ESpawnState::Consumed;
+			}
+			SpawnedActors[SpawnIndex] = nullptr;
+		}
+		else if (SpawnStates[SpawnIndex] == ESpawnState::Queued)
+		{
+			// SpawnPending skips it
+			SpawnStates[SpawnIndex] = ESpawnState::Idle;
+		}
+	}
+
+	DEC_DWORD_STAT(STAT_ClawResidentChunks);
+
+	UpdateResidentBytes();
+
+	const int32 FirstColumn = ChunkIndex * ChunkColumns;
+	ChunkStreamed.Broadcast(ChunkIndex, FirstColumn, FMath::Min(FirstColumn + ChunkColumns, TileMap->Width) - 1, false);
+}
+
+void UClawLevelStreamer::SpawnPending()
+{
+	int32 NumSpawned = 0;
+	while (PendingSpawns.Num() > 0 && NumSpawned < SpawnsPerFrame)
+	{
+		const int32 SpawnIndex = PendingSpawns[0];
+		PendingSpawns.RemoveAt(0, 1, false);
+
+		if (SpawnStates[SpawnIndex] != ESpawnState::Queued)
+		{
+			continue;
+		}
+
+		const FClawTileSpawn& Spawn = Level->Spawns[SpawnIndex];
+		if (!Spawn.ActorClass)
+		{
+			SpawnStates[SpawnIndex] = ESpawnState::Consumed;
+			continue;
+		}
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		SpawnedActors[SpawnIndex] = GetWorld()->SpawnActor<AActor>(Spawn.ActorClass, Level->GetActorTransform().TransformPosition(Spawn.Location), FRotator::ZeroRotator, SpawnParameters);
+		SpawnStates[SpawnIndex] = ESpawnState::Spawned;
+		++NumSpawned;
+	}
+}
+
+void UClawLevelStreamer::UpdateResidentBytes()
+{
+	ResidentBytes = 0;
+	if (TileMap.IsValid())
+	{
+		for (const TArray<uint16>& Layer : TileMap->Layers)
+		{
+			ResidentBytes += Layer.GetAllocatedSize();
+		}
+		ResidentBytes += TileMap->AtlasTiles.GetAllocatedSize();
+	}
+	if (Atlas)
+	{
+		ResidentBytes += Atlas->GetSizeX() * Atlas->GetSizeY() * sizeof(FColor);
+	}
+	for (const FChunk& Chunk : Chunks)
+	{
+		ResidentBytes += Chunk.Bytes;
+	}
+
+	PeakResidentBytes = FMath::Max(PeakResidentBytes, ResidentBytes);
+	SET_MEMORY_STAT(STAT_ClawStreamedLevelMemory, ResidentBytes);
+}
+
+int32 UClawLevelStreamer::AcquireMesh()
+{
+	if (FreeMeshes.Num() > 0)
+	{
+		return FreeMeshes.Pop(false);
+	}
+
+	UProceduralMeshComponent* Mesh = NewObject<UProceduralMeshComponent>(Level);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Mesh->SetupAttachment(Level->GetRootComponent());
+	Mesh->RegisterComponent();
+
+	return ChunkMeshes.Add(Mesh);
+}
+
+void UClawLevelStreamer::LogReport() const
+{
+	int32 NumResident = 0;
+	for (const FChunk& Chunk : Chunks)
+	{
+		NumResident += Chunk.State == EClawChunkState::Resident ? 1 : 0;
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("Tile level streaming: %d of %d chunks resident, %.1f KB resident (peak %.1f KB), %d chunk loads, latency %.2f ms average, %.2f ms max"),
+		NumResident, Chunks.Num(), ResidentBytes / 1024.0f, PeakResidentBytes / 1024.0f, NumChunkLoads,
+		NumChunkLoads > 0 ? TotalLatency / NumChunkLoads : 0.0, MaxLatency);
+}
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "ClawTileMap.h"
+#include "ClawLevelStreamer.generated.h"
+
+class AClawTileLevel;
+class UProceduralMeshComponent;
+class UMaterialInstanceDynamic;
+class UTexture2D;
+
+// called when a chunk became resident or was unloaded, with the first and last tile column of the chunk
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnClawChunkStreamed, int32 /* Chunk */, int32 /* FirstColumn */, int32 /* LastColumn */, bool /* bResident */);
+
+// the quads of a chunk, one mesh section per layer, built off the game thread
+struct FClawChunkGeometry
+{
+	struct FSection
+	{
+		TArray<FVector> Vertices;
+		TArray<int32> Triangles;
+		TArray<FVector2D> UVs;
+	};
+
+	FSection Sections[(int32)EClawTileLayer::Count];
+
+	int32 GetAllocatedSize() const;
+};
+
+// what the loading task hands back to the game thread
+struct FClawLoadedTileLevel
+{
+	bool bLoaded = false;
+
+	FClawTileMap TileMap;
+
+	// the atlas decoded to BGRA, turned into a texture on the game thread
+	int32 AtlasWidth = 0;
+	int32 AtlasHeight = 0;
+	TArray<uint8> AtlasPixels;
+};
+
+enum class EClawChunkState : uint8
+{
+	Unloaded,
+	Building,
+	Resident
+};
+
+/**
+ * Streams the tile level of the world in chunks along X.
+ *
+ * The levels are very wide, so instead of building them whole the tile map is cut into
+ * chunks of claw.Streaming.ChunkTiles columns and only the chunks around the side view
+ * camera are resident: the ones within an ortho width of the screen are loaded, the ones
+ * that fall further behind are unloaded again. Chunk geometry is built on worker threads
+ * and at most one chunk is applied per frame, so streaming never stalls the game thread.
+ * Spawned actors come and go with their chunk, collision hooks in through OnChunkStreamed.
+ * Setting claw.Streaming.Chunked to 0 loads every chunk as soon as the level opens.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawLevelStreamer : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/** Starts loading the tile map of the level in the background, chunks stream once it's there. */
+	void OpenLevel(AClawTileLevel* InLevel);
+
+	/** Unloads every chunk and destroys what the level spawned. */
+	void CloseLevel(AClawTileLevel* InLevel);
+
+	FOnClawChunkStreamed& OnChunkStreamed() { return ChunkStreamed; }
+
+	// null until the tile map finished loading
+	const FClawTileMap* GetTileMap() const { return TileMap.Get(); }
+
+	const AClawTileLevel* GetLevel() const { return Level; }
+
+	int32 GetNumChunks() const { return Chunks.Num(); }
+	int32 GetChunkColumns() const { return ChunkColumns; }
+	bool IsChunkResident(int32 Chunk) const { return Chunks.IsValidIndex(Chunk) && Chunks[Chunk].State == EClawChunkState::Resident; }
+
+	int32 GetResidentBytes() const { return ResidentBytes; }
+
+	/** Logs the resident chunks, memory and load latencies. */
+	void LogReport() const;
+
+private:
+	struct FChunk
+	{
+		EClawChunkState State = EClawChunkState::Unloaded;
+
+		// when the chunk was asked for, for the load latency
+		uint64 RequestCycles = 0;
+
+		TFuture<TSharedPtr<FClawChunkGeometry, ESPMode::ThreadSafe>> Build;
+
+		int32 Bytes = 0;
+
+		// index into ChunkMeshes, INDEX_NONE while not resident
+		int32 Mesh = INDEX_NONE;
+	};
+
+	enum class ESpawnState : uint8
+	{
+		Idle,
+		Queued,
+		Spawned,
+
+		// picked up or killed, never spawns again
+		Consumed
+	};
+
+	void FinishOpening(const TSharedPtr<FClawLoadedTileLevel, ESPMode::ThreadSafe>& Loaded);
+	void UpdateWindow();
+	void RequestChunk(int32 ChunkIndex);
+	void ApplyChunk(int32 ChunkIndex, const FClawChunkGeometry& Geometry);
+	void UnloadChunk(int32 ChunkIndex);
+	void SpawnPending();
+	void UpdateResidentBytes();
+
+	int32 AcquireMesh();
+
+	static TSharedPtr<FClawChunkGeometry, ESPMode::ThreadSafe> BuildChunk(const FClawTileMap& Map, int32 FirstColumn, int32 LastColumn, const FVector2D& AtlasSize);
+
+	bool bChunked = true;
+	int32 ChunkColumns = 16;
+
+	FOnClawChunkStreamed ChunkStreamed;
+
+	UPROPERTY()
+	AClawTileLevel* Level;
+
+	TFuture<TSharedPtr<FClawLoadedTileLevel, ESPMode::ThreadSafe>> Loading;
+
+	// shared with the build tasks
+	TSharedPtr<const FClawTileMap, ESPMode::ThreadSafe> TileMap;
+
+	UPROPERTY()
+	UTexture2D* Atlas;
+
+	UPROPERTY()
+	UMaterialInstanceDynamic* TileMaterial;
+
+	TArray<FChunk> Chunks;
+
+	// reused by the chunks, the ones not in FreeMeshes hold a resident chunk
+	UPROPERTY()
+	TArray<UProceduralMeshComponent*> ChunkMeshes;
+	TArray<int32> FreeMeshes;
+
+	// per spawn of the level
+	TArray<int32> SpawnChunks;
+	TArray<ESpawnState> SpawnStates;
+	TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+	TArray<int32> PendingSpawns;
+
+	int32 ResidentBytes = 0;
+	int32 PeakResidentBytes = 0;
+
+	int32 NumChunkLoads = 0;
+	double TotalLatency = 0.0;
+	double MaxLatency = 0.0;
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawNet.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarClawNetRelevancyDistance(
+	TEXT("claw.Net.RelevancyDistance"),
+	1536.0f,
+	TEXT("Horizontal distance from a client's camera within which enemies, pickups and bullets are replicated to it.\n")
+	TEXT("Read every time relevancy is checked."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawNetDormancy(
+	TEXT("claw.Net.Dormancy"),
+	1,
+	TEXT("1: idle enemies, parked bullets and untouched pickups go dormant and aren't considered for replication.\n")
+	TEXT("0: they stay awake and are compared every net update.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarClawNetDormancyDelay(
+	TEXT("claw.Net.DormancyDelay"),
+	1.0f,
+	TEXT("Seconds an enemy has to keep its place and animation before it goes dormant.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+namespace
+{
+	// zigzag encoding, so small negative coordinates pack as small as positive ones
+	uint32 ZigZag(int32 Value)
+	{
+		return ((uint32)Value << 1) ^ (uint32)(Value >> 31);
+	}
+
+	int32 UnZigZag(uint32 Value)
+	{
+		return (int32)(Value >> 1) ^ -(int32)(Value & 1);
+	}
+}
+
+bool FClawQuantizedXZ::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 PackedX = ZigZag(X);
+	uint32 PackedZ = ZigZag(Z);
+
+	Ar.SerializeIntPacked(PackedX);
+	Ar.SerializeIntPacked(PackedZ);
+
+	if (Ar.IsLoading())
+	{
+		X = UnZigZag(PackedX);
+		Z = UnZigZag(PackedZ);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FClawNetEnemyState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Position.NetSerialize(Ar, Map, bOutSuccess);
+	Ar << Animation;
+
+	bOutSuccess &= !Ar.IsError();
+	return true;
+}
+
+bool ClawNet::IsRelevant(const AActor* Actor, const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation)
+{
+	if (Actor->bAlwaysRelevant || Actor == ViewTarget || Actor->IsOwnedBy(ViewTarget) || Actor->IsOwnedBy(RealViewer) || (ViewTarget && ViewTarget == Actor->GetInstigator()))
+	{
+		return true;
+	}
+
+	// the camera looks along Y, so only the horizontal distance decides whether the actor can be on screen
+	return FMath::Abs(Actor->GetActorLocation().X - SrcLocation.X) <= CVarClawNetRelevancyDistance.GetValueOnGameThread();
+}
+
+bool ClawNet::IsServing(const UWorld* World)
+{
+	const ENetMode NetMode = World->GetNetMode();
+	return NetMode == NM_ListenServer || NetMode == NM_DedicatedServer;
+}
+
+void ClawNet::SetDormant(AActor* Actor, bool bDormant)
+{
+	if (!Actor->HasAuthority() || !Actor->GetIsReplicated())
+	{
+		return;
+	}
+
+	if (bDormant && IsDormancyEnabled())
+	{
+		// actors placed in the level sleep from the start, spawned ones are sent once first
+		if (Actor->NetDormancy != DORM_Initial || !Actor->IsNetStartupActor())
+		{
+			Actor->SetNetDormancy(DORM_DormantAll);
+		}
+	}
+	else if (Actor->NetDormancy != DORM_Awake)
+	{
+		Actor->SetNetDormancy(DORM_Awake);
+	}
+}
+
+bool ClawNet::IsDormancyEnabled()
+{
+	return CVarClawNetDormancy.GetValueOnGameThread() != 0;
+}
+
+float ClawNet::GetDormancyDelay()
+{
+	return CVarClawNetDormancyDelay.GetValueOnGameThread();
+}
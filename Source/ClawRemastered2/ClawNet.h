@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ClawNet.generated.h"
+
+/**
+ * A location on the XZ plane the game plays in, rounded to whole units. Y never changes
+ * on the side view, so it isn't sent, and both coordinates go out as packed integers of
+ * one to three bytes.
+ */
+USTRUCT()
+struct CLAWREMASTERED2_API FClawQuantizedXZ
+{
+	GENERATED_BODY()
+
+	int32 X = 0;
+	int32 Z = 0;
+
+	FClawQuantizedXZ() {}
+	explicit FClawQuantizedXZ(const FVector& Location)
+		: X(FMath::RoundToInt(Location.X))
+		, Z(FMath::RoundToInt(Location.Z))
+	{
+	}
+
+	// the location on the plane at depth Y
+	FVector ToVector(float Y) const { return FVector(X, Y, Z); }
+
+	bool operator==(const FClawQuantizedXZ& Other) const { return X == Other.X && Z == Other.Z; }
+	bool operator!=(const FClawQuantizedXZ& Other) const { return !(*this == Other); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FClawQuantizedXZ> : public TStructOpsTypeTraitsBase2<FClawQuantizedXZ>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/**
+ * What the clients see of an enemy: where it is, the animation it shows and the direction
+ * it looks at. It replaces the replicated movement and flipbook component of the enemies,
+ * and is written by the enemy manager on the server.
+ */
+USTRUCT()
+struct CLAWREMASTERED2_API FClawNetEnemyState
+{
+	GENERATED_BODY()
+
+	FClawQuantizedXZ Position;
+
+	// the EClawEnemyState shown, with the top bit set when the enemy faces right
+	uint8 Animation = 0;
+
+	static constexpr uint8 FacingRightBit = 0x80;
+
+	FClawNetEnemyState() {}
+	FClawNetEnemyState(const FVector& Location, uint8 AnimationState, bool bFacingRight)
+		: Position(Location)
+		, Animation(AnimationState | (bFacingRight ? FacingRightBit : 0))
+	{
+	}
+
+	uint8 GetAnimationState() const { return Animation & ~FacingRightBit; }
+	float GetFacing() const { return (Animation & FacingRightBit) ? 1.0f : -1.0f; }
+
+	bool operator==(const FClawNetEnemyState& Other) const { return Position == Other.Position && Animation == Other.Animation; }
+	bool operator!=(const FClawNetEnemyState& Other) const { return !(*this == Other); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FClawNetEnemyState> : public TStructOpsTypeTraitsBase2<FClawNetEnemyState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+namespace ClawNet
+{
+	/**
+	 * The relevancy rule of the replicated Claw actors. The side view camera shows a window
+	 * around the player, so an actor is relevant while its horizontal distance to the
+	 * viewer's camera is within claw.Net.RelevancyDistance, whatever the height. Actors the
+	 * viewer owns, instigates or looks through are always relevant.
+	 */
+	CLAWREMASTERED2_API bool IsRelevant(const AActor* Actor, const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation);
+
+	// true on a listen or dedicated server, where actor state is sent to clients
+	CLAWREMASTERED2_API bool IsServing(const UWorld* World);
+
+	/**
+	 * Lets a replicated actor that won't change for a while stop being considered for
+	 * replication, or wakes it up again. Only the server does anything.
+	 */
+	CLAWREMASTERED2_API void SetDormant(AActor* Actor, bool bDormant);
+
+	// true when idle actors may go dormant
+	CLAWREMASTERED2_API bool IsDormancyEnabled();
+
+	// seconds an actor has to stay unchanged before it goes dormant
+	CLAWREMASTERED2_API float GetDormancyDelay();
+}
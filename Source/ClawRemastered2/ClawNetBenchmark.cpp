@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawNetBenchmark.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ClawRemastered2.h"
+
+namespace
+{
+	// nearest rank percentile of an unsorted set
+	float Percentile(TArray<float> Values, float Fraction)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0f;
+		}
+
+		Values.Sort();
+		const int32 Rank = FMath::Clamp(FMath::CeilToInt(Fraction * Values.Num()) - 1, 0, Values.Num() - 1);
+		return Values[Rank];
+	}
+
+	float Average(const TArray<float>& Values)
+	{
+		double Sum = 0.0;
+		for (float Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? Sum / Values.Num() : 0.0f;
+	}
+
+	void AddDistribution(FString& Csv, const FString& Metric, const TArray<float>& Values)
+	{
+		Csv += FString::Printf(TEXT("%s.Avg,%.2f\n"), *Metric, Average(Values));
+		Csv += FString::Printf(TEXT("%s.P50,%.2f\n"), *Metric, Percentile(Values, 0.5f));
+		Csv += FString::Printf(TEXT("%s.P99,%.2f\n"), *Metric, Percentile(Values, 0.99f));
+		Csv += FString::Printf(TEXT("%s.Max,%.2f\n"), *Metric, Percentile(Values, 1.0f));
+	}
+}
+
+void UClawNetBenchmark::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (!GetWorld()->IsGameWorld() || !FParse::Value(CommandLine, TEXT("ClawNetBenchmark="), Seconds))
+	{
+		return;
+	}
+
+	BenchmarkName = TEXT("Net");
+	FParse::Value(CommandLine, TEXT("ClawNetClients="), NumClients);
+	FParse::Value(CommandLine, TEXT("NetWarmup="), WarmupSeconds);
+	FParse::Value(CommandLine, TEXT("BenchmarkName="), BenchmarkName);
+
+	NumClients = FMath::Max(NumClients, 1);
+	Seconds = FMath::Max(Seconds, 1.0f);
+
+	bActive = true;
+}
+
+void UClawNetBenchmark::Tick(float DeltaSeconds)
+{
+	if (!bSampling)
+	{
+		bSampling = StartSampling();
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now < NextSampleSeconds)
+	{
+		return;
+	}
+
+	// the connections update their rates once per second, so sampling faster only repeats them
+	NextSampleSeconds += 1.0;
+	Sample();
+
+	if (Now - StartSeconds >= WarmupSeconds + Seconds)
+	{
+		WriteResults();
+
+		bActive = false;
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+ETickableTickType UClawNetBenchmark::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawNetBenchmark::IsTickable() const
+{
+	return bActive;
+}
+
+TStatId UClawNetBenchmark::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawNetBenchmark, STATGROUP_Tickables);
+}
+
+UWorld* UClawNetBenchmark::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UClawNetBenchmark::StartSampling()
+{
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver || !NetDriver->IsServer())
+	{
+		return false;
+	}
+
+	// a client counts once its Claw was spawned, before that it only loads the map
+	Connections.Reset();
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection && Connection->PlayerController && Connection->PlayerController->GetPawn())
+		{
+			Connections.Add(Connection);
+		}
+	}
+
+	if (Connections.Num() < NumClients)
+	{
+		return false;
+	}
+
+	OutRates.SetNum(Connections.Num());
+	InRates.SetNum(Connections.Num());
+	OpenChannels.SetNum(Connections.Num());
+
+	StartSeconds = FPlatformTime::Seconds();
+	NextSampleSeconds = StartSeconds + WarmupSeconds;
+
+	UE_LOG(LogClaw, Display, TEXT("Net benchmark %s: %d clients, %.0f seconds after a %.0f second warm up."),
+		*BenchmarkName, Connections.Num(), Seconds, WarmupSeconds);
+
+	return true;
+}
+
+void UClawNetBenchmark::Sample()
+{
+	// a client that left keeps the samples it had
+	for (int32 Index = 0; Index < Connections.Num(); ++Index)
+	{
+		if (const UNetConnection* Connection = Connections[Index].Get())
+		{
+			OutRates[Index].Add(Connection->OutBytesPerSecond);
+			InRates[Index].Add(Connection->InBytesPerSecond);
+			OpenChannels[Index].Add(Connection->OpenChannels.Num());
+		}
+	}
+}
+
+void UClawNetBenchmark::WriteResults() const
+{
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("Benchmarks");
+	const FString BaseName = Directory / FString::Printf(TEXT("%s-%s"), *BenchmarkName, *FDateTime::Now().ToString());
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	TArray<float> AllOutRates;
+	TArray<float> AllInRates;
+	TArray<float> AllOpenChannels;
+	for (int32 Index = 0; Index < Connections.Num(); ++Index)
+	{
+		AllOutRates.Append(OutRates[Index]);
+		AllInRates.Append(InRates[Index]);
+		AllOpenChannels.Append(OpenChannels[Index]);
+	}
+
+	FString Summary = TEXT("Metric,Value\n");
+	Summary += FString::Printf(TEXT("Clients,%d\n"), Connections.Num());
+	Summary += FString::Printf(TEXT("Samples,%d\n"), AllOutRates.Num());
+	AddDistribution(Summary, TEXT("OutBytesPerSecondPerClient"), AllOutRates);
+	AddDistribution(Summary, TEXT("InBytesPerSecondPerClient"), AllInRates);
+	AddDistribution(Summary, TEXT("OpenChannelsPerClient"), AllOpenChannels);
+
+	for (int32 Index = 0; Index < Connections.Num(); ++Index)
+	{
+		Summary += FString::Printf(TEXT("Client%d.OutBytesPerSecond.Avg,%.2f\n"), Index, Average(OutRates[Index]));
+		Summary += FString::Printf(TEXT("Client%d.InBytesPerSecond.Avg,%.2f\n"), Index, Average(InRates[Index]));
+	}
+
+	FFileHelper::SaveStringToFile(Summary, *(BaseName + TEXT(".csv")));
+
+	UE_LOG(LogClaw, Display, TEXT("Net benchmark %s: %.0f bytes/s sent per client on average, %.0f at P99, written to %s.csv."),
+		*BenchmarkName, Average(AllOutRates), Percentile(AllOutRates, 0.99f), *BaseName);
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawNetBenchmark.generated.h"
+
+class UNetConnection;
+
+/**
+ * Measures what the server sends to each client, when a server runs with -ClawNetBenchmark.
+ *
+ * Once the expected number of clients joined and got their Claws, and a warm up passed,
+ * the bytes per second sent to and received from every client connection, and the number
+ * of channels it has open, are sampled once per second. The run ends by writing a summary
+ * CSV (one metric per row, for ClawBenchmarkCompare) to Saved/Benchmarks, then the server
+ * exits.
+ *
+ * The clients can run the Empty -ClawBenchmark scenario, so their Claws run around the
+ * level, and the server any other one to fill the level with enemies and treasure.
+ *
+ * Usage: ClawRemastered2 <Map>?listen -server -nullrhi -unattended -nosound
+ *        -ClawNetBenchmark=<Seconds> [-ClawNetClients=4] [-NetWarmup=5] [-BenchmarkName=Name]
+ *        [-ClawBenchmark=Crowd -Frames=100000]
+ *        then, for every client:
+ *        ClawRemastered2 127.0.0.1 -game -nullrhi -unattended -nosound
+ *        -ClawBenchmark=Empty -Frames=100000
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawNetBenchmark : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+private:
+	bool StartSampling();
+	void Sample();
+	void WriteResults() const;
+
+	bool bActive = false;
+	bool bSampling = false;
+
+	FString BenchmarkName;
+	int32 NumClients = 1;
+	float WarmupSeconds = 5.0f;
+	float Seconds = 60.0f;
+
+	// when the clients were all in, and when the next sample is due
+	double StartSeconds = 0.0;
+	double NextSampleSeconds = 0.0;
+
+	// per client connection, one entry per sample
+	TArray<TWeakObjectPtr<UNetConnection>> Connections;
+	TArray<TArray<float>> OutRates;
+	TArray<TArray<float>> InRates;
+	TArray<TArray<float>> OpenChannels;
+};
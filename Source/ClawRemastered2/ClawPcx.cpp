@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawPcx.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#include <emmintrin.h>
+#define CLAW_PCX_SSE 1
+#elif PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#include <arm_neon.h>
+#define CLAW_PCX_NEON 1
+#endif
+
+namespace
+{
+	const int32 HeaderSize = 128;
+
+	// the 256 color palette follows a marker byte at the end of the file
+	const int32 PaletteSize = 769;
+	const uint8 PaletteMarker = 12;
+
+	struct FPcxHeader
+	{
+		uint8 Manufacturer;
+		uint8 Version;
+		uint8 Encoding;
+		uint8 BitsPerPixel;
+		int32 Width;
+		int32 Height;
+		uint8 NumPlanes;
+		int32 BytesPerLine;
+	};
+
+	uint16 ReadUInt16(const uint8* Data)
+	{
+		return Data[0] | (Data[1] << 8);
+	}
+
+	FPcxHeader ReadHeader(const uint8* Data)
+	{
+		FPcxHeader Header;
+		Header.Manufacturer = Data[0];
+		Header.Version = Data[1];
+		Header.Encoding = Data[2];
+		Header.BitsPerPixel = Data[3];
+		Header.Width = ReadUInt16(Data + 8) - ReadUInt16(Data + 4) + 1;
+		Header.Height = ReadUInt16(Data + 10) - ReadUInt16(Data + 6) + 1;
+		Header.NumPlanes = Data[65];
+		Header.BytesPerLine = ReadUInt16(Data + 66);
+		return Header;
+	}
+
+	// a byte with the two top bits set repeats the next byte by its low six bits, any other byte is itself
+	void DecodeRle(const uint8* Source, const uint8* SourceEnd, uint8* Dest, uint8* DestEnd)
+	{
+		while (Dest < DestEnd && Source < SourceEnd)
+		{
+			const uint8 Byte = *Source++;
+			if ((Byte & 0xc0) != 0xc0)
+			{
+				*Dest++ = Byte;
+				continue;
+			}
+
+			if (Source == SourceEnd)
+			{
+				break;
+			}
+
+			const int32 Count = FMath::Min<int32>(Byte & 0x3f, DestEnd - Dest);
+			FMemory::Memset(Dest, *Source++, Count);
+			Dest += Count;
+		}
+
+		// a truncated file leaves the rest black
+		if (Dest < DestEnd)
+		{
+			FMemory::Memzero(Dest, DestEnd - Dest);
+		}
+	}
+
+	// the lookups are gathers, so this is left to the compiler, four pixels at a time
+	void ExpandPaletted(const uint8* Indices, const uint32* Palette, int32 Width, FColor* Out)
+	{
+		uint32* Dest = reinterpret_cast<uint32*>(Out);
+
+		int32 X = 0;
+		for (; X + 4 <= Width; X += 4)
+		{
+			Dest[X] = Palette[Indices[X]];
+			Dest[X + 1] = Palette[Indices[X + 1]];
+			Dest[X + 2] = Palette[Indices[X + 2]];
+			Dest[X + 3] = Palette[Indices[X + 3]];
+		}
+		for (; X < Width; ++X)
+		{
+			Dest[X] = Palette[Indices[X]];
+		}
+	}
+
+	// interleaves a row of red, green and blue planes into BGRA, sixteen pixels at a time
+	void ExpandPlanes(const uint8* Red, const uint8* Green, const uint8* Blue, int32 Width, FColor* Out)
+	{
+		uint8* Dest = reinterpret_cast<uint8*>(Out);
+
+		int32 X = 0;
+#if CLAW_PCX_SSE
+		const __m128i Alpha = _mm_set1_epi8((char)0xff);
+		for (; X + 16 <= Width; X += 16)
+		{
+			const __m128i R = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Red + X));
+			const __m128i G = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Green + X));
+			const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Blue + X));
+
+			const __m128i BlueGreenLow = _mm_unpacklo_epi8(B, G);
+			const __m128i BlueGreenHigh = _mm_unpackhi_epi8(B, G);
+			const __m128i RedAlphaLow = _mm_unpacklo_epi8(R, Alpha);
+			const __m128i RedAlphaHigh = _mm_unpackhi_epi8(R, Alpha);
+
+			__m128i* Pixels = reinterpret_cast<__m128i*>(Dest + X * 4);
+			_mm_storeu_si128(Pixels, _mm_unpacklo_epi16(BlueGreenLow, RedAlphaLow));
+			_mm_storeu_si128(Pixels + 1, _mm_unpackhi_epi16(BlueGreenLow, RedAlphaLow));
+			_mm_storeu_si128(Pixels + 2, _mm_unpacklo_epi16(BlueGreenHigh, RedAlphaHigh));
+			_mm_storeu_si128(Pixels + 3, _mm_unpackhi_epi16(BlueGreenHigh, RedAlphaHigh));
+		}
+#elif CLAW_PCX_NEON
+		for (; X + 16 <= Width; X += 16)
+		{
+			uint8x16x4_t Pixels;
+			Pixels.val[0] = vld1q_u8(Blue + X);
+			Pixels.val[1] = vld1q_u8(Green + X);
+			Pixels.val[2] = vld1q_u8(Red + X);
+			Pixels.val[3] = vdupq_n_u8(0xff);
+			vst4q_u8(Dest + X * 4, Pixels);
+		}
+#endif
+		for (; X < Width; ++X)
+		{
+			Out[X] = FColor(Red[X], Green[X], Blue[X], 255);
+		}
+	}
+}
+
+bool ClawPcx::IsPcx(const uint8* Data, int32 Size)
+{
+	return Size > HeaderSize && Data[0] == 0x0a && Data[2] <= 1;
+}
+
+bool ClawPcx::Decode(const uint8* Data, int32 Size, FClawPcxImage& OutImage, FString* OutError)
+{
+	auto Fail = [OutError](const TCHAR* Reason)
+	{
+		if (OutError)
+		{
+			*OutError = Reason;
+		}
+		return false;
+	};
+
+	if (!IsPcx(Data, Size))
+	{
+		return Fail(TEXT("not a PCX file"));
+	}
+
+	const FPcxHeader Header = ReadHeader(Data);
+	if (Header.BitsPerPixel != 8 || (Header.NumPlanes != 1 && Header.NumPlanes != 3))
+	{
+		return Fail(TEXT("only 8 bit paletted and 24 bit images are supported"));
+	}
+	if (Header.Width <= 0 || Header.Height <= 0 || Header.Width > 16384 || Header.Height > 16384 || Header.BytesPerLine < Header.Width)
+	{
+		return Fail(TEXT("bad image size"));
+	}
+
+	const bool bPaletted = Header.NumPlanes == 1;
+	const uint8* DataEnd = Data + Size;
+	if (bPaletted)
+	{
+		if (Size < HeaderSize + PaletteSize || DataEnd[-PaletteSize] != PaletteMarker)
+		{
+			return Fail(TEXT("the palette is missing"));
+		}
+		DataEnd -= PaletteSize;
+	}
+
+	// the decoded rows, with every plane of a row after the other
+	const int32 RowSize = Header.NumPlanes * Header.BytesPerLine;
+	TArray<uint8> Rows;
+	Rows.SetNumUninitialized(RowSize * Header.Height);
+
+	if (Header.Encoding == 1)
+	{
+		DecodeRle(Data + HeaderSize, DataEnd, Rows.GetData(), Rows.GetData() + Rows.Num());
+	}
+	else
+	{
+		const int32 Available = FMath::Min<int32>(DataEnd - (Data + HeaderSize), Rows.Num());
+		FMemory::Memcpy(Rows.GetData(), Data + HeaderSize, Available);
+		FMemory::Memzero(Rows.GetData() + Available, Rows.Num() - Available);
+	}
+
+	OutImage.Width = Header.Width;
+	OutImage.Height = Header.Height;
+	OutImage.Pixels.SetNumUninitialized(Header.Width * Header.Height);
+
+	if (bPaletted)
+	{
+		uint32 Palette[256];
+		const uint8* Colors = DataEnd + 1;
+		for (int32 Index = 0; Index < 256; ++Index)
+		{
+			Palette[Index] = FColor(Colors[Index * 3], Colors[Index * 3 + 1], Colors[Index * 3 + 2], 255).DWColor();
+		}
+
+		for (int32 Y = 0; Y < Header.Height; ++Y)
+		{
+			ExpandPaletted(Rows.GetData() + Y * RowSize, Palette, Header.Width, OutImage.Pixels.GetData() + Y * Header.Width);
+		}
+	}
+	else
+	{
+		for (int32 Y = 0; Y < Header.Height; ++Y)
+		{
+			const uint8* Row = Rows.GetData() + Y * RowSize;
+			ExpandPlanes(Row, Row + Header.BytesPerLine, Row + Header.BytesPerLine * 2, Header.Width, OutImage.Pixels.GetData() + Y * Header.Width);
+		}
+	}
+
+	return true;
+}
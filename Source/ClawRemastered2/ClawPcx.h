@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// a decoded PCX image, BGRA rows from the top
+struct FClawPcxImage
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	TArray<FColor> Pixels;
+};
+
+/**
+ * Decodes the PCX files of the original games.
+ *
+ * Handles the RLE encoded 8 bit images, either paletted with one plane and the 256 color
+ * palette at the end of the file, or true color with a red, green and blue plane per row.
+ */
+namespace ClawPcx
+{
+	/** Returns false with the reason in OutError when the data isn't a PCX image this can decode. */
+	CLAWREMASTERED2_API bool Decode(const uint8* Data, int32 Size, FClawPcxImage& OutImage, FString* OutError = nullptr);
+
+	CLAWREMASTERED2_API bool IsPcx(const uint8* Data, int32 Size);
+}
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawPcxConvertCommandlet.h"
+#include "ClawRemastered2.h"
+#include "ClawPcx.h"
+#include "Async/ParallelFor.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+
+namespace
+{
+	const TCHAR* const CacheFilename = TEXT("PcxCache.txt");
+
+	enum class EConvertResult : uint8
+	{
+		Converted,
+		Skipped,
+		Failed
+	};
+
+	// one "relative path<TAB>hash" line per converted file
+	void LoadCache(const FString& Filename, TMap<FString, uint64>& OutHashes)
+	{
+		TArray<FString> Lines;
+		FFileHelper::LoadFileToStringArray(Lines, *Filename);
+
+		for (const FString& Line : Lines)
+		{
+			FString Path;
+			FString Hash;
+			if (Line.Split(TEXT("\t"), &Path, &Hash))
+			{
+				OutHashes.Add(Path, FCString::Strtoui64(*Hash, nullptr, 16));
+			}
+		}
+	}
+
+	void SaveCache(const FString& Filename, const TArray<FString>& Paths, const TArray<uint64>& Hashes)
+	{
+		FString Text;
+		for (int32 Index = 0; Index < Paths.Num(); ++Index)
+		{
+			// files that failed have no hash and get another try next time
+			if (Hashes[Index] != 0)
+			{
+				Text += FString::Printf(TEXT("%s\t%016llx\n"), *Paths[Index], Hashes[Index]);
+			}
+		}
+		FFileHelper::SaveStringToFile(Text, *Filename);
+	}
+
+	EConvertResult ConvertFile(const FString& SourceFile, const FString& DestFile, uint64 CachedHash, uint64& OutHash)
+	{
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *SourceFile))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't read %s."), *SourceFile);
+			return EConvertResult::Failed;
+		}
+
+		OutHash = CityHash64(reinterpret_cast<const char*>(Data.GetData()), Data.Num());
+		if (OutHash == CachedHash && IFileManager::Get().FileExists(*DestFile))
+		{
+			return EConvertResult::Skipped;
+		}
+
+		FClawPcxImage Image;
+		FString Error;
+		if (!ClawPcx::Decode(Data.GetData(), Data.Num(), Image, &Error))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't decode %s: %s."), *SourceFile, *Error);
+			OutHash = 0;
+			return EConvertResult::Failed;
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Image.Pixels.GetData(), Image.Pixels.Num() * sizeof(FColor), Image.Width, Image.Height, ERGBFormat::BGRA, 8)
+			|| !FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *DestFile))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't write %s."), *DestFile);
+			OutHash = 0;
+			return EConvertResult::Failed;
+		}
+
+		return EConvertResult::Converted;
+	}
+}
+
+UClawPcxConvertCommandlet::UClawPcxConvertCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClawPcxConvertCommandlet::Main(const FString& Params)
+{
+	FString SourceDir = FPaths::ProjectDir() / TEXT("Claw_Assets");
+	FParse::Value(*Params, TEXT("Source="), SourceDir);
+
+	FString DestDir = FPaths::ProjectSavedDir() / TEXT("ClawPcx");
+	FParse::Value(*Params, TEXT("Dest="), DestDir);
+
+	const bool bForce = FParse::Param(*Params, TEXT("Force"));
+
+	FPaths::NormalizeDirectoryName(SourceDir);
+	FPaths::NormalizeDirectoryName(DestDir);
+
+	TArray<FString> SourceFiles;
+	IFileManager::Get().FindFilesRecursive(SourceFiles, *SourceDir, TEXT("*.pcx"), true, false);
+	SourceFiles.Sort();
+
+	const FString CachePath = DestDir / CacheFilename;
+	TMap<FString, uint64> CachedHashes;
+	if (!bForce)
+	{
+		LoadCache(CachePath, CachedHashes);
+	}
+
+	// relative to the source folder, which is how the cache knows them
+	TArray<FString> RelativePaths;
+	for (const FString& SourceFile : SourceFiles)
+	{
+		FString RelativePath = SourceFile;
+		FPaths::MakePathRelativeTo(RelativePath, *(SourceDir + TEXT("/")));
+		RelativePaths.Add(RelativePath);
+
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(DestDir / RelativePath), true);
+	}
+
+	// the module must be loaded on the game thread before the workers encode images
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	TArray<EConvertResult> Results;
+	Results.SetNum(SourceFiles.Num());
+	TArray<uint64> Hashes;
+	Hashes.SetNumZeroed(SourceFiles.Num());
+
+	ParallelFor(SourceFiles.Num(), [&](int32 Index)
+	{
+		const uint64* CachedHash = CachedHashes.Find(RelativePaths[Index]);
+		const FString DestFile = FPaths::ChangeExtension(DestDir / RelativePaths[Index], TEXT("png"));
+
+		Results[Index] = ConvertFile(SourceFiles[Index], DestFile, CachedHash ? *CachedHash : 0, Hashes[Index]);
+	});
+
+	const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	SaveCache(CachePath, RelativePaths, Hashes);
+
+	int32 Counts[3] = {};
+	for (EConvertResult Result : Results)
+	{
+		++Counts[(int32)Result];
+	}
+
+	UE_LOG(LogClaw, Display, TEXT("PCX files under %s: %d converted, %d unchanged, %d failed, in %.2f s."),
+		*SourceDir, Counts[(int32)EConvertResult::Converted], Counts[(int32)EConvertResult::Skipped], Counts[(int32)EConvertResult::Failed], Seconds);
+
+	return Counts[(int32)EConvertResult::Failed] > 0 ? 1 : 0;
+}
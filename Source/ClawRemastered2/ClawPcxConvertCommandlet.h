@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClawPcxConvertCommandlet.generated.h"
+
+/**
+ * Converts every PCX file under Claw_Assets to a PNG the editor can import.
+ *
+ * The files are converted in parallel into the same folders under Dest. A cache file
+ * there keeps the content hash of every converted file, so files that didn't change
+ * since the last run are skipped.
+ *
+ * Usage: -run=ClawPcxConvert [-Source=Dir] [-Dest=Dir] [-Force]
+ */
+UCLASS()
+class UClawPcxConvertCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClawPcxConvertCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
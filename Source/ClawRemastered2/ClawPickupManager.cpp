@@ -0,0 +1,307 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawPickupManager.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "PaperFlipbook.h"
+#include "PaperSprite.h"
+#include "ClawFlipbookRenderer.h"
+#include "ClawGameMode.h"
+#include "ClawSoundPool.h"
+#include "HealthComponent.h"
+#include "ClawRemastered2Character.h"
+#include "ClawRemastered2.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Collect"), STAT_ClawPickupCollect, STATGROUP_Claw);
+DECLARE_CYCLE_STAT(TEXT("Pickup Animate"), STAT_ClawPickupAnimate, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickups"), STAT_ClawPickups, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickup Types"), STAT_ClawPickupTypes, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Collected"), STAT_ClawPickupsCollected, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawPickupsManaged(
+	TEXT("claw.Pickups.Managed"),
+	1,
+	TEXT("1: treasures and potions are records of the pickup manager, drawn with one instanced batch per type.\n")
+	TEXT("0: every pickup is an actor with its own sprite and trigger box.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+void UClawPickupManager::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bManaging = CVarClawPickupsManaged.GetValueOnGameThread() != 0 && GetWorld()->IsGameWorld();
+	if (bManaging && GetWorld()->GetNetMode() != NM_Standalone)
+	{
+		// the clients see the pickups the server replicates, records aren't sent to them
+		UE_LOG(LogClaw, Verbose, TEXT("Pickups stay actors in the networked game of %s."), *GetWorld()->GetMapName());
+		bManaging = false;
+	}
+
+	bDrawing = FApp::CanEverRender();
+}
+
+void UClawPickupManager::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawPickups, Kinds.Num());
+	DEC_DWORD_STAT_BY(STAT_ClawPickupTypes, Types.Num());
+
+	// the sprite host is destroyed with the world
+	Grid.Empty();
+	Kinds.Empty();
+	Scores.Empty();
+	Healths.Empty();
+	TypeIndices.Empty();
+	TypeInstances.Empty();
+	GridHandles.Empty();
+	Sounds.Empty();
+	GridToIndex.Empty();
+	Types.Empty();
+	TypeFlipbooks.Empty();
+	TypeSprites.Empty();
+	SpriteHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UClawPickupManager::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawPickupAnimate);
+
+	for (int32 TypeIndex = 0; TypeIndex < Types.Num(); ++TypeIndex)
+	{
+		FType& Type = Types[TypeIndex];
+		const UPaperFlipbook* Flipbook = TypeFlipbooks[TypeIndex];
+		if (Flipbook && Type.Sprites && Type.InstanceToIndex.Num() > 0)
+		{
+			// like a flipbook component left at its defaults, every flipbook loops
+			const float Duration = Flipbook->GetTotalDuration();
+			Type.Time = Duration > 0.0f ? FMath::Fmod(Type.Time + DeltaSeconds, Duration) : 0.0f;
+
+			// all pickups of a type show the same keyframe, they only change together
+			const int32 KeyFrame = Flipbook->GetKeyFrameIndexAtTime(Type.Time);
+			if (KeyFrame != Type.KeyFrame)
+			{
+				UPaperSprite* Sprite = Flipbook->GetKeyFrameChecked(KeyFrame).Sprite;
+				for (int32 Instance = 0; Instance < Type.InstanceToIndex.Num(); ++Instance)
+				{
+					Type.Sprites->SetInstanceSprite(Instance, Sprite);
+				}
+				Type.KeyFrame = KeyFrame;
+				Type.bDirty = true;
+			}
+		}
+
+		// one render state update per type, not per pickup
+		if (Type.bDirty)
+		{
+			Type.Sprites->UpdateBounds();
+			Type.Sprites->MarkRenderStateDirty();
+			Type.bDirty = false;
+		}
+	}
+}
+
+ETickableTickType UClawPickupManager::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawPickupManager::IsTickable() const
+{
+	return bDrawing && Types.Num() > 0;
+}
+
+TStatId UClawPickupManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawPickupManager, STATGROUP_Tickables);
+}
+
+UWorld* UClawPickupManager::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UClawPickupManager::AddTreasure(const FBox2D& Bounds, UPaperFlipbook* Flipbook, const FTransform& SpriteTransform, int64 Score, USoundBase* Sound)
+{
+	const int32 Index = AddPickup(EClawPickupKind::Treasure, Bounds, Flipbook, nullptr, SpriteTransform);
+	Scores[Index] = Score;
+	Sounds[Index] = Sound;
+}
+
+void UClawPickupManager::AddPotion(const FBox2D& Bounds, UPaperSprite* Sprite, const FTransform& SpriteTransform, float Health)
+{
+	const int32 Index = AddPickup(EClawPickupKind::Potion, Bounds, nullptr, Sprite, SpriteTransform);
+	Healths[Index] = Health;
+}
+
+void UClawPickupManager::CollectPickups(AClawRemastered2Character* Claw, const FBox2D& Bounds)
+{
+	if (Kinds.Num() == 0)
+	{
+		return;
+	}
+
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawPickupCollect);
+
+	TouchedHandles.Reset();
+	Grid.QueryBox(Bounds, CLAW_SpatialPickup, TouchedHandles);
+
+	// removing a pickup swaps another into its index, the grid handles still find it
+	for (const int32 GridHandle : TouchedHandles)
+	{
+		const int32 Index = GridToIndex[GridHandle];
+		if (Kinds[Index] == EClawPickupKind::Treasure)
+		{
+			if (AClawGameMode* GameMode = Cast<AClawGameMode>(GetWorld()->GetAuthGameMode()))
+			{
+				GameMode->AddScore(Scores[Index]);
+			}
+			UClawSoundPool::PlaySound2D(this, Sounds[Index], EClawSoundCategory::Pickup);
+		}
+		else
+		{
+			// a potion stays where it is while Claw's health is full
+			if (Claw->ClawHealth->GetHealth() == 100)
+			{
+				continue;
+			}
+			Claw->ClawHealth->SetHealth(Healths[Index]);
+		}
+
+		RemovePickup(Index);
+
+		INC_DWORD_STAT(STAT_ClawPickupsCollected);
+	}
+}
+
+int32 UClawPickupManager::AddPickup(EClawPickupKind Kind, const FBox2D& Bounds, UPaperFlipbook* Flipbook, UPaperSprite* Sprite, const FTransform& SpriteTransform)
+{
+	const int32 Index = Kinds.Add(Kind);
+	Scores.Add(0);
+	Healths.Add(0.0f);
+	Sounds.Add(nullptr);
+	TypeIndices.Add(INDEX_NONE);
+	TypeInstances.Add(INDEX_NONE);
+
+	const int32 GridHandle = Grid.Insert(Bounds, CLAW_SpatialPickup);
+	GridHandles.Add(GridHandle);
+	if (GridHandle >= GridToIndex.Num())
+	{
+		GridToIndex.SetNum(GridHandle + 1);
+	}
+	GridToIndex[GridHandle] = Index;
+
+	const int32 TypeIndex = bDrawing ? FindOrAddType(Flipbook, Sprite) : INDEX_NONE;
+	if (TypeIndex != INDEX_NONE)
+	{
+		FType& Type = Types[TypeIndex];
+		TypeIndices[Index] = TypeIndex;
+		TypeInstances[Index] = Type.Sprites->AddInstance(SpriteTransform, GetTypeSprite(TypeIndex), true);
+		Type.InstanceToIndex.Add(Index);
+		Type.bDirty = true;
+	}
+
+	INC_DWORD_STAT(STAT_ClawPickups);
+
+	return Index;
+}
+
+void UClawPickupManager::RemovePickup(int32 Index)
+{
+	const int32 LastIndex = Kinds.Num() - 1;
+
+	const int32 TypeIndex = TypeIndices[Index];
+	if (TypeIndex != INDEX_NONE)
+	{
+		// the last sprite instance of the type moves into the freed one
+		FType& Type = Types[TypeIndex];
+		const int32 Instance = TypeInstances[Index];
+		Type.Sprites->RemoveInstanceAtSwap(Instance);
+		Type.InstanceToIndex.RemoveAtSwap(Instance, 1, false);
+		if (Instance < Type.InstanceToIndex.Num())
+		{
+			TypeInstances[Type.InstanceToIndex[Instance]] = Instance;
+		}
+		Type.bDirty = true;
+	}
+
+	// the last pickup moves into the freed slot, so its type and the grid have to find it there
+	if (Index != LastIndex)
+	{
+		if (TypeIndices[LastIndex] != INDEX_NONE)
+		{
+			Types[TypeIndices[LastIndex]].InstanceToIndex[TypeInstances[LastIndex]] = Index;
+		}
+		GridToIndex[GridHandles[LastIndex]] = Index;
+	}
+
+	Grid.Remove(GridHandles[Index]);
+	GridToIndex[GridHandles[Index]] = INDEX_NONE;
+
+	Kinds.RemoveAtSwap(Index, 1, false);
+	Scores.RemoveAtSwap(Index, 1, false);
+	Healths.RemoveAtSwap(Index, 1, false);
+	Sounds.RemoveAtSwap(Index, 1, false);
+	TypeIndices.RemoveAtSwap(Index, 1, false);
+	TypeInstances.RemoveAtSwap(Index, 1, false);
+	GridHandles.RemoveAtSwap(Index, 1, false);
+
+	DEC_DWORD_STAT(STAT_ClawPickups);
+}
+
+int32 UClawPickupManager::FindOrAddType(UPaperFlipbook* Flipbook, UPaperSprite* Sprite)
+{
+	// a flipbook of a single keyframe never changes, it is drawn like a sprite
+	if (Flipbook && Flipbook->GetNumKeyFrames() <= 1)
+	{
+		Sprite = Flipbook->GetNumKeyFrames() == 1 ? Flipbook->GetKeyFrameChecked(0).Sprite : nullptr;
+		Flipbook = nullptr;
+	}
+	if (!Flipbook && !Sprite)
+	{
+		return INDEX_NONE;
+	}
+
+	for (int32 TypeIndex = 0; TypeIndex < Types.Num(); ++TypeIndex)
+	{
+		if (TypeFlipbooks[TypeIndex] == Flipbook && TypeSprites[TypeIndex] == Sprite)
+		{
+			return TypeIndex;
+		}
+	}
+
+	if (!SpriteHost)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		SpriteHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+	}
+
+	UClawInstancedSpriteComponent* Sprites = NewObject<UClawInstancedSpriteComponent>(SpriteHost);
+	Sprites->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Sprites->SetGenerateOverlapEvents(false);
+	if (!SpriteHost->GetRootComponent())
+	{
+		SpriteHost->SetRootComponent(Sprites);
+	}
+	Sprites->RegisterComponent();
+
+	Types.Add({ Sprites, {}, 0.0f, 0, false });
+	TypeFlipbooks.Add(Flipbook);
+	TypeSprites.Add(Sprite);
+
+	INC_DWORD_STAT(STAT_ClawPickupTypes);
+
+	return Types.Num() - 1;
+}
+
+UPaperSprite* UClawPickupManager::GetTypeSprite(int32 TypeIndex) const
+{
+	const UPaperFlipbook* Flipbook = TypeFlipbooks[TypeIndex];
+	return Flipbook ? Flipbook->GetKeyFrameChecked(Types[TypeIndex].KeyFrame).Sprite : TypeSprites[TypeIndex];
+}
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawSpatialHash.h"
+#include "ClawPickupManager.generated.h"
+
+class AClawRemastered2Character;
+class UClawInstancedSpriteComponent;
+class UPaperFlipbook;
+class UPaperSprite;
+class USoundBase;
+
+// what collecting a pickup does
+enum class EClawPickupKind : uint8
+{
+	Treasure,
+	Potion
+};
+
+/**
+ * Keeps the treasures and potions of the world as records instead of actors.
+ *
+ * A treasure or potion that begins play hands its kind, trigger box, score or health and
+ * look to the manager and destroys itself. The records live in packed arrays and their
+ * boxes in a grid of their own, which Claw's capsule is tested against on every frame or
+ * step, so no pickup ticks, has a physics body or gets overlap callbacks.
+ *
+ * Pickups that look the same are one type: every type is drawn by one grouped sprite
+ * component, and its flipbook plays on one clock for all of them, so a level of a few
+ * hundred coins draws a handful of batches and changes sprites a few times a second.
+ *
+ * Only standalone games are managed, on a network the pickups stay replicated actors.
+ * Setting claw.Pickups.Managed to 0 keeps them actors everywhere.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawPickupManager : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	// true when pickups are handed to the manager instead of staying actors
+	bool IsManaging() const { return bManaging; }
+
+	/**
+	 * Adds a treasure worth Score that Claw collects by touching Bounds. SpriteTransform is
+	 * the world transform of its flipbook.
+	 */
+	void AddTreasure(const FBox2D& Bounds, UPaperFlipbook* Flipbook, const FTransform& SpriteTransform, int64 Score, USoundBase* Sound);
+
+	/** Adds a potion that changes Claw's health by Health, unless his health is full. */
+	void AddPotion(const FBox2D& Bounds, UPaperSprite* Sprite, const FTransform& SpriteTransform, float Health);
+
+	/** Collects every pickup that overlaps Bounds, Claw's capsule on the XZ plane. */
+	void CollectPickups(AClawRemastered2Character* Claw, const FBox2D& Bounds);
+
+	int32 GetNumPickups() const { return Kinds.Num(); }
+	int32 GetNumTypes() const { return Types.Num(); }
+
+private:
+	// the pickups that share a look, InstanceToIndex maps their sprite instance back to the packed arrays
+	struct FType
+	{
+		UClawInstancedSpriteComponent* Sprites;
+		TArray<int32> InstanceToIndex;
+		float Time;
+		int32 KeyFrame;
+		bool bDirty;
+	};
+
+	int32 AddPickup(EClawPickupKind Kind, const FBox2D& Bounds, UPaperFlipbook* Flipbook, UPaperSprite* Sprite, const FTransform& SpriteTransform);
+	void RemovePickup(int32 Index);
+
+	int32 FindOrAddType(UPaperFlipbook* Flipbook, UPaperSprite* Sprite);
+
+	// the sprite a type shows now
+	UPaperSprite* GetTypeSprite(int32 TypeIndex) const;
+
+	bool bManaging = false;
+
+	// false under -nullrhi, the records are kept but nothing is drawn
+	bool bDrawing = false;
+
+	FClawSpatialGrid Grid;
+
+	// packed per pickup data, all arrays share the same index
+	TArray<EClawPickupKind> Kinds;
+	TArray<int64> Scores;
+	TArray<float> Healths;
+	TArray<int32> TypeIndices;
+	TArray<int32> TypeInstances;
+	TArray<int32> GridHandles;
+
+	UPROPERTY()
+	TArray<USoundBase*> Sounds;
+
+	// the grid handles stay stable while the packed arrays are compacted with swaps
+	TArray<int32> GridToIndex;
+
+	// indexed like Types, a type shows either a flipbook or a single sprite
+	TArray<FType> Types;
+
+	UPROPERTY()
+	TArray<UPaperFlipbook*> TypeFlipbooks;
+
+	UPROPERTY()
+	TArray<UPaperSprite*> TypeSprites;
+
+	// owns the sprite components
+	UPROPERTY()
+	AActor* SpriteHost;
+
+	TArray<int32> TouchedHandles;
+};
@@ -2,13 +2,22 @@
 
 
 #include "ClawPotion.h"
+#include "ClawRemastered2.h"
 #include "PaperFlipbookComponent.h" 
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
 #include "Kismet/GameplayStatics.h"
 #include "Components/CapsuleComponent.h" 
 #include "ClawGameMode.h"
+#include "ClawSpatialHash.h"
+#include "ClawPickupManager.h"
+#include "PaperSpriteComponent.h"
+#include "ClawNet.h"
 #include "Engine/Engine.h"
+#include "ClawStats.h"
+
+// what a potion does to Claw's health, negative heals
+static const float PotionHealth = -20.0f;
 
 AClawPotion::AClawPotion()
 {
@@ -22,6 +31,10 @@ AClawPotion::AClawPotion()
 
     HitCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AClawPotion::OnOverlapBegin);
     HitCollisionBox->OnComponentEndOverlap.AddDynamic(this, &AClawPotion::OnOverlapEnd);
+
+    // a potion doesn't change until it is drunk, so only its removal is sent to clients
+    bReplicates = true;
+    NetDormancy = DORM_Initial;
 }
 
 
@@ -29,32 +42,74 @@ void AClawPotion::BeginPlay()
 {
     Super::BeginPlay();
     // the potion has touched claw
-    UE_LOG(LogTemp, Warning, TEXT("potion"));
+    UE_LOG(LogClaw, Verbose, TEXT("potion"));
 
     GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
+
+    // the pickup manager keeps the potion as a record, the actor isn't needed anymore
+    UClawPickupManager* PickupManager = GetWorld()->GetSubsystem<UClawPickupManager>();
+    if (PickupManager->IsManaging())
+    {
+        PickupManager->AddPotion(FClawSpatialGrid::MakeBounds(HitCollisionBox->GetComponentLocation(), HitCollisionBox->GetScaledBoxExtent()),
+            GetRenderComponent()->GetSprite(), GetRenderComponent()->GetComponentTransform(), PotionHealth);
+        Destroy();
+        return;
+    }
+
+    ClawNet::SetDormant(this, true);
+
+    // Claw finds the potion through the spatial hash, the trigger box is only needed without it
+    SpatialHash = GetWorld()->GetSubsystem<UClawSpatialHash>();
+    if (SpatialHash->IsQuerying())
+    {
+        SpatialHandle = SpatialHash->Insert(this, FClawSpatialGrid::MakeBounds(HitCollisionBox->GetComponentLocation(), HitCollisionBox->GetScaledBoxExtent()), CLAW_SpatialPickup);
+        HitCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    }
 }
 
+void AClawPotion::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (SpatialHandle != INDEX_NONE)
+    {
+        SpatialHash->Remove(SpatialHandle);
+        SpatialHandle = INDEX_NONE;
+    }
+
+    Super::EndPlay(EndPlayReason);
+}
+
+
+bool AClawPotion::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+    return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
+}
 
 void AClawPotion::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+    CLAW_SCOPE_OVERLAP();
+
     // check it it's claw who's overlapping with the score object.
     if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
     {
-        UE_LOG(LogTemp, Warning, TEXT("potion touched"));
+        UE_LOG(LogClaw, Verbose, TEXT("potion touched"));
 
-        AClawRemastered2Character* clawCharacter;
-        clawCharacter = Cast<AClawRemastered2Character>(OtherActor);
+        OnPickedUp(Cast<AClawRemastered2Character>(OtherActor));
+    }
+}
 
-        if (clawCharacter->ClawHealth->GetHealth() != 100)
-        {
-            clawCharacter->ClawHealth->SetHealth(-20);
+void AClawPotion::OnPickedUp(AClawRemastered2Character* Claw)
+{
+    if (Claw->ClawHealth->GetHealth() != 100)
+    {
+        Claw->ClawHealth->SetHealth(PotionHealth);
 
-            // destroy the potion
-            this->Destroy();
-        } 
-    }
+        // destroy the potion
+        this->Destroy();
+    } 
 }
 
 void AClawPotion::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	CLAW_SCOPE_OVERLAP();
+
 }
\ No newline at end of file
@@ -4,12 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "PaperSpriteActor.h"
+#include "Interfaces/Pickup.h"
 #include "ClawPotion.generated.h"
 
 class AClawGameMode;
 
 UCLASS()
-class CLAWREMASTERED2_API AClawPotion : public APaperSpriteActor
+class CLAWREMASTERED2_API AClawPotion : public APaperSpriteActor, public IPickup
 {
     GENERATED_BODY()
 
@@ -30,13 +31,21 @@ class CLAWREMASTERED2_API AClawPotion : public APaperSpriteActor
 
     AClawGameMode* GameModeRef;
 
+    class UClawSpatialHash* SpatialHash;
+
+    int32 SpatialHandle = INDEX_NONE;
+
 public:
     // class constructor
     AClawPotion();
 
+    virtual void OnPickedUp(AClawRemastered2Character* Claw) override;
+
+    virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 protected:
     // called when actor is spawned
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 };
\ No newline at end of file
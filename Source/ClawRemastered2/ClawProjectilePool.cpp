@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawProjectilePool.h"
+#include "ClawRemastered2.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Interfaces/PooledProjectile.h"
+#include "ClawStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_ClawProjectilePoolHits, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_ClawProjectilePoolMisses, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles Live"), STAT_ClawProjectilesLive, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles Pooled"), STAT_ClawProjectilesPooled, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectile Pool High Water"), STAT_ClawProjectilePoolHighWater, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawProjectilePool(
+	TEXT("claw.Projectiles.Pool"),
+	1,
+	TEXT("1: bullets are recycled by the projectile pool.\n")
+	TEXT("0: every shot spawns a bullet and every hit destroys it.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+// where released projectiles wait, far away from anything they could overlap
+static const FVector PooledProjectileLocation(0.0f, 0.0f, -100000.0f);
+
+void UClawProjectilePool::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bPooling = CVarClawProjectilePool.GetValueOnGameThread() != 0;
+}
+
+void UClawProjectilePool::Deinitialize()
+{
+	for (const TPair<UClass*, FClawProjectileFreeList>& Pair : FreeLists)
+	{
+		const FClawProjectileFreeList& List = Pair.Value;
+		UE_LOG(LogClaw, Verbose, TEXT("Projectile pool %s: %d hits, %d misses, high water %d"), *GetNameSafe(Pair.Key), List.Hits, List.Misses, List.HighWater);
+
+		DEC_DWORD_STAT_BY(STAT_ClawProjectilesPooled, List.Free.Num());
+	}
+
+	DEC_DWORD_STAT_BY(STAT_ClawProjectilesLive, Live);
+	SET_DWORD_STAT(STAT_ClawProjectilePoolHighWater, 0);
+
+	// the projectiles themselves are destroyed with the world
+	FreeLists.Empty();
+	Live = 0;
+	HighWater = 0;
+
+	Super::Deinitialize();
+}
+
+void UClawProjectilePool::Prewarm(TSubclassOf<AActor> ProjectileClass, int32 Count)
+{
+	if (!bPooling || !ProjectileClass || !ProjectileClass->ImplementsInterface(UPooledProjectile::StaticClass()))
+	{
+		return;
+	}
+
+	FClawProjectileFreeList& List = FreeLists.FindOrAdd(ProjectileClass.Get());
+
+	// several shooters share a class, so only top the pool up to Count
+	for (int32 Missing = Count - List.Free.Num() - List.Live; Missing > 0; --Missing)
+	{
+		AActor* Projectile = SpawnReleased(ProjectileClass);
+		if (!Projectile)
+		{
+			break;
+		}
+
+		List.Free.Add(Projectile);
+		INC_DWORD_STAT(STAT_ClawProjectilesPooled);
+	}
+}
+
+AActor* UClawProjectilePool::Acquire(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	if (!bPooling || !ProjectileClass->ImplementsInterface(UPooledProjectile::StaticClass()))
+	{
+		return GetWorld()->SpawnActor<AActor>(ProjectileClass, Location, Rotation);
+	}
+
+	FClawProjectileFreeList& List = FreeLists.FindOrAdd(ProjectileClass.Get());
+
+	// released projectiles can still be destroyed with their level, skip those
+	AActor* Projectile = nullptr;
+	while (!Projectile && List.Free.Num() > 0)
+	{
+		AActor* Candidate = List.Free.Pop(false);
+		DEC_DWORD_STAT(STAT_ClawProjectilesPooled);
+
+		if (IsValid(Candidate))
+		{
+			Projectile = Candidate;
+		}
+	}
+
+	if (Projectile)
+	{
+		++List.Hits;
+		INC_DWORD_STAT(STAT_ClawProjectilePoolHits);
+	}
+	else
+	{
+		Projectile = SpawnReleased(ProjectileClass);
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+
+		++List.Misses;
+		INC_DWORD_STAT(STAT_ClawProjectilePoolMisses);
+	}
+
+	++List.Live;
+	List.HighWater = FMath::Max(List.HighWater, List.Live);
+
+	++Live;
+	INC_DWORD_STAT(STAT_ClawProjectilesLive);
+	if (Live > HighWater)
+	{
+		HighWater = Live;
+		SET_DWORD_STAT(STAT_ClawProjectilePoolHighWater, HighWater);
+	}
+
+	// counted as live first, a bullet handed out right onto Claw is released again from in here
+	Projectile->SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	Cast<IPooledProjectile>(Projectile)->OnAcquired();
+
+	return Projectile;
+}
+
+void UClawProjectilePool::Release(AActor* Projectile)
+{
+	// a client's copy of a replicated projectile belongs to the server, it never joins the free list
+	if (!IsValid(Projectile) || Projectile->GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	IPooledProjectile* PooledProjectile = Cast<IPooledProjectile>(Projectile);
+	if (!bPooling || !PooledProjectile)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	PooledProjectile->OnReleased();
+	Projectile->SetActorLocation(PooledProjectileLocation, false, nullptr, ETeleportType::ResetPhysics);
+
+	FClawProjectileFreeList& List = FreeLists.FindOrAdd(Projectile->GetClass());
+	List.Free.Add(Projectile);
+	INC_DWORD_STAT(STAT_ClawProjectilesPooled);
+
+	// bullets placed in the level were never handed out by the pool
+	if (List.Live > 0)
+	{
+		--List.Live;
+		--Live;
+		DEC_DWORD_STAT(STAT_ClawProjectilesLive);
+	}
+}
+
+AActor* UClawProjectilePool::SpawnReleased(UClass* ProjectileClass)
+{
+	const FTransform SpawnTransform(PooledProjectileLocation);
+
+	// the collision is turned off before the components register, so a new bullet never
+	// overlaps anything on its way to the pool
+	AActor* Projectile = GetWorld()->SpawnActorDeferred<AActor>(ProjectileClass, SpawnTransform);
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	Projectile->SetActorEnableCollision(false);
+	Projectile->FinishSpawning(SpawnTransform);
+
+	Cast<IPooledProjectile>(Projectile)->OnReleased();
+
+	return Projectile;
+}
+
+int32 UClawProjectilePool::GetHits(TSubclassOf<AActor> ProjectileClass) const
+{
+	const FClawProjectileFreeList* List = FreeLists.Find(ProjectileClass.Get());
+	return List ? List->Hits : 0;
+}
+
+int32 UClawProjectilePool::GetMisses(TSubclassOf<AActor> ProjectileClass) const
+{
+	const FClawProjectileFreeList* List = FreeLists.Find(ProjectileClass.Get());
+	return List ? List->Misses : 0;
+}
+
+int32 UClawProjectilePool::GetHighWater(TSubclassOf<AActor> ProjectileClass) const
+{
+	const FClawProjectileFreeList* List = FreeLists.Find(ProjectileClass.Get());
+	return List ? List->HighWater : 0;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawProjectilePool.generated.h"
+
+// the projectiles of one class the pool keeps around
+USTRUCT()
+struct FClawProjectileFreeList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AActor*> Free;
+
+	// projectiles handed out and not released yet
+	int32 Live = 0;
+
+	// the most projectiles of the class that were live at once
+	int32 HighWater = 0;
+
+	int32 Hits = 0;
+	int32 Misses = 0;
+};
+
+/**
+ * Recycles the bullets of Claw and the officers.
+ *
+ * Instead of spawning a bullet for every shot and destroying it on hit or when its
+ * lifespan runs out, projectiles that implement IPooledProjectile are hidden and kept
+ * per class, then handed out again for the next shot. Firefights no longer create
+ * garbage for every bullet. Setting claw.Projectiles.Pool to 0 spawns and destroys
+ * every bullet again, so both paths can be compared with "stat Claw".
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawProjectilePool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Makes sure Count projectiles of the class are around before the first shot needs them. */
+	void Prewarm(TSubclassOf<AActor> ProjectileClass, int32 Count);
+
+	/** Returns a projectile of the class flying from Location, reusing a released one when there is one. */
+	AActor* Acquire(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation);
+
+	template<class T>
+	T* Acquire(TSubclassOf<AActor> ProjectileClass, const FVector& Location, const FRotator& Rotation)
+	{
+		return Cast<T>(Acquire(ProjectileClass, Location, Rotation));
+	}
+
+	/**
+	 * Takes a projectile back once it hit something or its lifespan ran out. Projectiles this
+	 * machine has no authority over are left alone.
+	 */
+	void Release(AActor* Projectile);
+
+	bool IsPooling() const { return bPooling; }
+
+	int32 GetHits(TSubclassOf<AActor> ProjectileClass) const;
+	int32 GetMisses(TSubclassOf<AActor> ProjectileClass) const;
+	int32 GetHighWater(TSubclassOf<AActor> ProjectileClass) const;
+
+private:
+	AActor* SpawnReleased(UClass* ProjectileClass);
+
+	bool bPooling = true;
+
+	// over all classes, for the stats
+	int32 Live = 0;
+	int32 HighWater = 0;
+
+	UPROPERTY()
+	TMap<UClass*, FClawProjectileFreeList> FreeLists;
+};
@@ -0,0 +1,433 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawProjectileSystem.h"
+#include "PaperCharacter.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "PaperSprite.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "ClawDamageSystem.h"
+#include "Math/VectorRegister.h"
+#include "Interfaces/PooledProjectile.h"
+#include "ClawEnemyManager.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Simulation"), STAT_ClawProjectileSimulation, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simulated Projectiles"), STAT_ClawSimulatedProjectiles, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Simulated Projectile Hits"), STAT_ClawSimulatedProjectileHits, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawProjectilesSimulated(
+	TEXT("claw.Projectiles.Simulated"),
+	1,
+	TEXT("1: bullets are simulated by the projectile system, without actors.\n")
+	TEXT("0: every bullet is an actor handed out by the projectile pool.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+// cells a grid may have, the cells get wider on levels that are longer than that
+static const int32 MaxGridCells = 1024;
+
+void UClawProjectileSystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bSimulating = CVarClawProjectilesSimulated.GetValueOnGameThread() != 0;
+}
+
+void UClawProjectileSystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawSimulatedProjectiles, NumProjectiles);
+
+	// the sprite host is destroyed with the world
+	Kinds.Empty();
+	SpriteHost = nullptr;
+	NumProjectiles = 0;
+
+	Super::Deinitialize();
+}
+
+void UClawProjectileSystem::Tick(float DeltaSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawProjectileSimulation);
+
+	GatherTargets();
+
+	for (int32 KindIndex = 0; KindIndex < Kinds.Num(); ++KindIndex)
+	{
+		Integrate(Kinds[KindIndex], DeltaSeconds);
+		SweepKind(KindIndex, DeltaSeconds);
+		RemoveSpent(Kinds[KindIndex]);
+		UpdateSprites(Kinds[KindIndex]);
+	}
+
+	// damage can kill enemies and end the level, so it's only dealt once the arrays are settled
+	ApplyHits();
+}
+
+ETickableTickType UClawProjectileSystem::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawProjectileSystem::IsTickable() const
+{
+	return !bFixedStep && NumProjectiles > 0;
+}
+
+TStatId UClawProjectileSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawProjectileSystem, STATGROUP_Tickables);
+}
+
+UWorld* UClawProjectileSystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UClawProjectileSystem::Fire(TSubclassOf<AActor> BulletClass, const FVector& Location, const FRotator& Rotation, AActor* Shooter)
+{
+	if (!bSimulating || !BulletClass)
+	{
+		return false;
+	}
+
+	const int32 KindIndex = FindOrAddKind(BulletClass);
+	if (KindIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FClawProjectileKind& Kind = Kinds[KindIndex];
+
+	// bullets fly straight along the X axis, left or right
+	const float Direction = Rotation.Vector().X < 0.0f ? -1.0f : 1.0f;
+
+	Kind.X.Add(Location.X);
+	Kind.Z.Add(Location.Z);
+	Kind.Depth.Add(Location.Y);
+	Kind.VelocityX.Add(Direction * Kind.Desc.Speed);
+	Kind.LifeLeft.Add(Kind.Desc.LifeSpan);
+	Kind.Shooters.Add(Shooter);
+
+	const FTransform InstanceTransform(FRotator(0.0f, Direction < 0.0f ? 180.0f : 0.0f, 0.0f), Location);
+	Kind.Sprites->AddInstance(InstanceTransform, Kind.Desc.Sprite, true);
+
+	++NumProjectiles;
+	INC_DWORD_STAT(STAT_ClawSimulatedProjectiles);
+
+	return true;
+}
+
+int32 UClawProjectileSystem::FindOrAddKind(UClass* BulletClass)
+{
+	for (int32 KindIndex = 0; KindIndex < Kinds.Num(); ++KindIndex)
+	{
+		if (Kinds[KindIndex].BulletClass == BulletClass)
+		{
+			return KindIndex;
+		}
+	}
+
+	// the bullet class describes itself from its defaults
+	const IPooledProjectile* Defaults = Cast<IPooledProjectile>(BulletClass->GetDefaultObject());
+
+	FClawProjectileDesc Desc;
+	if (!Defaults || !Defaults->DescribeSimulatedProjectile(Desc))
+	{
+		return INDEX_NONE;
+	}
+
+	if (!SpriteHost)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		SpriteHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+	}
+
+	UPaperGroupedSpriteComponent* Sprites = NewObject<UPaperGroupedSpriteComponent>(SpriteHost);
+	Sprites->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Sprites->SetGenerateOverlapEvents(false);
+	if (!SpriteHost->GetRootComponent())
+	{
+		SpriteHost->SetRootComponent(Sprites);
+	}
+	Sprites->RegisterComponent();
+
+	FClawProjectileKind& Kind = Kinds.AddDefaulted_GetRef();
+	Kind.BulletClass = BulletClass;
+	Kind.Desc = Desc;
+	Kind.Sprites = Sprites;
+
+	return Kinds.Num() - 1;
+}
+
+void UClawProjectileSystem::Integrate(FClawProjectileKind& Kind, float DeltaSeconds)
+{
+	const int32 Num = Kind.X.Num();
+
+	float* RESTRICT X = Kind.X.GetData();
+	float* RESTRICT LifeLeft = Kind.LifeLeft.GetData();
+	const float* RESTRICT VelocityX = Kind.VelocityX.GetData();
+
+	// four bullets at a time, then the ones that are left over
+	const VectorRegister Delta = VectorSetFloat1(DeltaSeconds);
+
+	int32 Index = 0;
+	for (; Index + 4 <= Num; Index += 4)
+	{
+		VectorStore(VectorMultiplyAdd(VectorLoad(VelocityX + Index), Delta, VectorLoad(X + Index)), X + Index);
+		VectorStore(VectorSubtract(VectorLoad(LifeLeft + Index), Delta), LifeLeft + Index);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		X[Index] += VelocityX[Index] * DeltaSeconds;
+		LifeLeft[Index] -= DeltaSeconds;
+	}
+}
+
+void UClawProjectileSystem::GatherTargets()
+{
+	auto MakeTarget = [](ACharacter* Character) -> FTarget
+	{
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		const FVector Location = Capsule->GetComponentLocation();
+		const float Radius = Capsule->GetScaledCapsuleRadius();
+		const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+
+		return { Location.X - Radius, Location.X + Radius, Location.Z - HalfHeight, Location.Z + HalfHeight, Character };
+	};
+
+	// dead characters turn their collision off, bullets fly through them. A server sees the
+	// Claws of every player, so officer bullets can hit any of them in co-op
+	ClawTargets.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		ACharacter* Claw = PlayerController ? PlayerController->GetCharacter() : nullptr;
+		if (Claw && Claw->GetActorEnableCollision())
+		{
+			ClawTargets.Add(MakeTarget(Claw));
+		}
+	}
+
+	EnemyTargets.Reset();
+	if (const UClawEnemyManager* EnemyManager = GetWorld()->GetSubsystem<UClawEnemyManager>())
+	{
+		LiveEnemies.Reset();
+		EnemyManager->GatherLiveEnemies(LiveEnemies);
+
+		for (APaperCharacter* Enemy : LiveEnemies)
+		{
+			if (Enemy->GetActorEnableCollision())
+			{
+				EnemyTargets.Add(MakeTarget(Enemy));
+			}
+		}
+	}
+
+	BuildGrid(EnemyTargets);
+}
+
+void UClawProjectileSystem::BuildGrid(const TArray<FTarget>& InTargets)
+{
+	CellStarts.Reset();
+	CellTargets.Reset();
+
+	if (InTargets.Num() == 0)
+	{
+		return;
+	}
+
+	float MinX = InTargets[0].MinX;
+	float MaxX = InTargets[0].MaxX;
+	for (const FTarget& Target : InTargets)
+	{
+		MinX = FMath::Min(MinX, Target.MinX);
+		MaxX = FMath::Max(MaxX, Target.MaxX);
+	}
+
+	GridOriginX = MinX;
+	GridCellSize = FMath::Max(256.0f, (MaxX - MinX) / MaxGridCells);
+	const int32 NumCells = FMath::FloorToInt((MaxX - MinX) / GridCellSize) + 1;
+
+	// count the targets per cell, turn the counts into offsets, then fill the cells
+	CellStarts.SetNumZeroed(NumCells + 1);
+	for (const FTarget& Target : InTargets)
+	{
+		const int32 FirstCell = FMath::FloorToInt((Target.MinX - GridOriginX) / GridCellSize);
+		const int32 LastCell = FMath::Min(FMath::FloorToInt((Target.MaxX - GridOriginX) / GridCellSize), NumCells - 1);
+		for (int32 Cell = FirstCell; Cell <= LastCell; ++Cell)
+		{
+			++CellStarts[Cell + 1];
+		}
+	}
+
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		CellStarts[Cell + 1] += CellStarts[Cell];
+	}
+
+	CellTargets.SetNumUninitialized(CellStarts[NumCells]);
+
+	TArray<int32, TInlineAllocator<MaxGridCells>> Fill;
+	Fill.Append(CellStarts.GetData(), NumCells);
+
+	for (int32 TargetIndex = 0; TargetIndex < InTargets.Num(); ++TargetIndex)
+	{
+		const FTarget& Target = InTargets[TargetIndex];
+		const int32 FirstCell = FMath::FloorToInt((Target.MinX - GridOriginX) / GridCellSize);
+		const int32 LastCell = FMath::Min(FMath::FloorToInt((Target.MaxX - GridOriginX) / GridCellSize), NumCells - 1);
+		for (int32 Cell = FirstCell; Cell <= LastCell; ++Cell)
+		{
+			CellTargets[Fill[Cell]++] = TargetIndex;
+		}
+	}
+}
+
+void UClawProjectileSystem::SweepKind(int32 KindIndex, float DeltaSeconds)
+{
+	FClawProjectileKind& Kind = Kinds[KindIndex];
+	const float Radius = Kind.Desc.Radius;
+	const int32 NumCells = CellStarts.Num() - 1;
+
+	// a bullet hits the first target its path of this frame runs into
+	auto TestTarget = [Radius](const FTarget& Target, float FromX, float ToX, float Z, float& BestDistance) -> bool
+	{
+		if (Z + Radius < Target.MinZ || Z - Radius > Target.MaxZ)
+		{
+			return false;
+		}
+
+		const float SegmentMin = FMath::Min(FromX, ToX) - Radius;
+		const float SegmentMax = FMath::Max(FromX, ToX) + Radius;
+		if (SegmentMax < Target.MinX || SegmentMin > Target.MaxX)
+		{
+			return false;
+		}
+
+		const float Distance = ToX > FromX ? Target.MinX - FromX : FromX - Target.MaxX;
+		if (Distance < BestDistance)
+		{
+			BestDistance = Distance;
+			return true;
+		}
+		return false;
+	};
+
+	for (int32 Index = 0; Index < Kind.X.Num(); ++Index)
+	{
+		if (Kind.LifeLeft[Index] <= 0.0f)
+		{
+			continue;
+		}
+
+		const float ToX = Kind.X[Index];
+		const float FromX = ToX - Kind.VelocityX[Index] * DeltaSeconds;
+		const float Z = Kind.Z[Index];
+
+		float BestDistance = MAX_flt;
+		AActor* HitActor = nullptr;
+
+		if (Kind.Desc.bHitsClaw)
+		{
+			for (const FTarget& Target : ClawTargets)
+			{
+				if (TestTarget(Target, FromX, ToX, Z, BestDistance))
+				{
+					HitActor = Target.Actor;
+				}
+			}
+		}
+		else if (NumCells > 0)
+		{
+			const int32 FirstCell = FMath::Max(FMath::FloorToInt((FMath::Min(FromX, ToX) - Radius - GridOriginX) / GridCellSize), 0);
+			const int32 LastCell = FMath::Min(FMath::FloorToInt((FMath::Max(FromX, ToX) + Radius - GridOriginX) / GridCellSize), NumCells - 1);
+
+			for (int32 Cell = FirstCell; Cell <= LastCell; ++Cell)
+			{
+				for (int32 Item = CellStarts[Cell]; Item < CellStarts[Cell + 1]; ++Item)
+				{
+					const FTarget& Target = EnemyTargets[CellTargets[Item]];
+					if (TestTarget(Target, FromX, ToX, Z, BestDistance))
+					{
+						HitActor = Target.Actor;
+					}
+				}
+			}
+		}
+
+		if (HitActor)
+		{
+			PendingHits.Add({ KindIndex, HitActor, Kind.Shooters[Index] });
+
+			// spent, removed with the expired bullets
+			Kind.LifeLeft[Index] = 0.0f;
+		}
+	}
+}
+
+void UClawProjectileSystem::RemoveSpent(FClawProjectileKind& Kind)
+{
+	// walk backwards so the swapped in bullet has already been looked at
+	for (int32 Index = Kind.X.Num() - 1; Index >= 0; --Index)
+	{
+		if (Kind.LifeLeft[Index] > 0.0f)
+		{
+			continue;
+		}
+
+		Kind.X.RemoveAtSwap(Index, 1, false);
+		Kind.Z.RemoveAtSwap(Index, 1, false);
+		Kind.Depth.RemoveAtSwap(Index, 1, false);
+		Kind.VelocityX.RemoveAtSwap(Index, 1, false);
+		Kind.LifeLeft.RemoveAtSwap(Index, 1, false);
+		Kind.Shooters.RemoveAtSwap(Index, 1, false);
+
+		// all instances of a kind share the sprite, so dropping the last one is enough,
+		// the transforms are rewritten below
+		Kind.Sprites->RemoveInstance(Kind.Sprites->GetInstanceCount() - 1);
+
+		--NumProjectiles;
+		DEC_DWORD_STAT(STAT_ClawSimulatedProjectiles);
+	}
+}
+
+void UClawProjectileSystem::UpdateSprites(FClawProjectileKind& Kind)
+{
+	for (int32 Index = 0; Index < Kind.X.Num(); ++Index)
+	{
+		const FVector Location(Kind.X[Index], Kind.Depth[Index], Kind.Z[Index]);
+		const FRotator Rotation(0.0f, Kind.VelocityX[Index] < 0.0f ? 180.0f : 0.0f, 0.0f);
+
+		Kind.Sprites->UpdateInstanceTransform(Index, FTransform(Rotation, Location), true, false, true);
+	}
+
+	if (Kind.X.Num() > 0)
+	{
+		Kind.Sprites->MarkRenderStateDirty();
+	}
+}
+
+void UClawProjectileSystem::ApplyHits()
+{
+	INC_DWORD_STAT_BY(STAT_ClawSimulatedProjectileHits, PendingHits.Num());
+
+	// TakeDamage can destroy targets or shooters, so only weak references are trusted from here on
+	for (const FHit& Hit : PendingHits)
+	{
+		const FClawProjectileDesc& Desc = Kinds[Hit.Kind].Desc;
+
+		AActor* Shooter = Hit.Shooter.Get();
+		if (IsValid(Hit.Target))
+		{
+			UClawDamageSystem::ApplyDamage(Hit.Target, Desc.Damage, Shooter ? Shooter->GetInstigatorController() : nullptr, Shooter, Desc.DamageType);
+		}
+	}
+	PendingHits.Reset();
+}
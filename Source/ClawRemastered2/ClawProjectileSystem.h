@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawProjectileSystem.generated.h"
+
+class APaperCharacter;
+class UPaperSprite;
+class UPaperGroupedSpriteComponent;
+
+// what a bullet class looks and behaves like once it's simulated without its actor
+USTRUCT()
+struct FClawProjectileDesc
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UPaperSprite* Sprite = nullptr;
+
+	UPROPERTY()
+	TSubclassOf<UDamageType> DamageType;
+
+	float Speed = 0.0f;
+	float LifeSpan = 0.0f;
+	float Damage = 0.0f;
+
+	// half the size of the bullet's hit box
+	float Radius = 0.0f;
+
+	// true for enemy bullets, which only hit Claw, false for Claw's bullets, which only hit enemies
+	bool bHitsClaw = false;
+};
+
+// the bullets of one class, kept in packed arrays that share the index of their sprite instance
+USTRUCT()
+struct FClawProjectileKind
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UClass* BulletClass = nullptr;
+
+	UPROPERTY()
+	FClawProjectileDesc Desc;
+
+	UPROPERTY()
+	UPaperGroupedSpriteComponent* Sprites = nullptr;
+
+	TArray<float> X;
+	TArray<float> Z;
+	TArray<float> Depth;
+	TArray<float> VelocityX;
+	TArray<float> LifeLeft;
+	TArray<TWeakObjectPtr<AActor>> Shooters;
+};
+
+/**
+ * Simulates bullets without actors.
+ *
+ * A bullet only moves along X on the XZ plane, so it's kept as a few floats instead of an
+ * actor with a sprite, a trigger box and a projectile movement component. All bullets are
+ * moved in one vectorized loop, swept against the capsules of their targets through a grid
+ * along X, and drawn by one grouped sprite component per bullet class. Setting
+ * claw.Projectiles.Simulated to 0 fires bullet actors from the projectile pool again.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawProjectileSystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/**
+	 * Fires a bullet of the class from Location. Returns false when the class can't be
+	 * simulated or simulation is off, the caller then spawns the bullet actor instead.
+	 */
+	bool Fire(TSubclassOf<AActor> BulletClass, const FVector& Location, const FRotator& Rotation, AActor* Shooter);
+
+	bool IsSimulating() const { return bSimulating; }
+
+	int32 GetNumProjectiles() const { return NumProjectiles; }
+
+	// while the fixed step simulation calls Tick with every step, the bullets don't tick with the frames
+	void SetFixedStep(bool bInFixedStep) { bFixedStep = bInFixedStep; }
+
+private:
+	struct FTarget
+	{
+		float MinX;
+		float MaxX;
+		float MinZ;
+		float MaxZ;
+		AActor* Actor;
+	};
+
+	struct FHit
+	{
+		int32 Kind;
+		AActor* Target;
+		TWeakObjectPtr<AActor> Shooter;
+	};
+
+	int32 FindOrAddKind(UClass* BulletClass);
+
+	void Integrate(FClawProjectileKind& Kind, float DeltaSeconds);
+	void GatherTargets();
+	void BuildGrid(const TArray<FTarget>& InTargets);
+	void SweepKind(int32 KindIndex, float DeltaSeconds);
+	void RemoveSpent(FClawProjectileKind& Kind);
+	void UpdateSprites(FClawProjectileKind& Kind);
+	void ApplyHits();
+
+	bool bSimulating = true;
+	bool bFixedStep = false;
+
+	int32 NumProjectiles = 0;
+
+	UPROPERTY()
+	TArray<FClawProjectileKind> Kinds;
+
+	// owns the sprite components
+	UPROPERTY()
+	AActor* SpriteHost;
+
+	// rebuilt every frame
+	TArray<APaperCharacter*> LiveEnemies;
+	TArray<FTarget> EnemyTargets;
+	TArray<FTarget> ClawTargets;
+
+	// the enemy targets bucketed into cells along X
+	float GridOriginX = 0.0f;
+	float GridCellSize = 256.0f;
+	TArray<int32> CellStarts;
+	TArray<int32> CellTargets;
+
+	TArray<FHit> PendingHits;
+};
@@ -9,5 +9,11 @@ public class ClawRemastered2 : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "Paper2D" });
+
+		// decodes the level images and tiles for the level importer, and draws the streamed tile levels
+		PrivateDependencyModuleNames.AddRange(new string[] { "ImageWrapper", "ProceduralMeshComponent" });
+
+		// the HUD widgets and the digit counters they draw with
+		PrivateDependencyModuleNames.AddRange(new string[] { "UMG", "Slate", "SlateCore" });
 	}
 }
@@ -2,5 +2,11 @@
 
 #include "ClawRemastered2.h"
 #include "Modules/ModuleManager.h"
+#include "ClawStats.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ClawRemastered2, "ClawRemastered2" );
+
+DEFINE_LOG_CATEGORY(LogClaw);
+
+DEFINE_STAT(STAT_ClawOverlaps);
+DEFINE_STAT(STAT_ClawOverlapsHandled);
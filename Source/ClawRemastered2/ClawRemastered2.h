@@ -3,3 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+// gameplay chatter, the hot paths log at Verbose so "log LogClaw Verbose" shows them,
+// shipping builds compile all of it out
+#if UE_BUILD_SHIPPING
+CLAWREMASTERED2_API DECLARE_LOG_CATEGORY_EXTERN(LogClaw, Log, NoLogging);
+#else
+CLAWREMASTERED2_API DECLARE_LOG_CATEGORY_EXTERN(LogClaw, Log, All);
+#endif
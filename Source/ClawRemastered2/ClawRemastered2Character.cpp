@@ -1,6 +1,9 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "ClawRemastered2Character.h"
+#include "ClawTileMovementComponent.h"
+#include "ClawAnimationComponent.h"
+#include "ClawTileCollision.h"
 #include "PaperFlipbookComponent.h"
 #include "Components/TextRenderComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -12,20 +15,39 @@
 #include "BlueOfficer.h"
 #include "ClawGameMode.h"
 #include "ClawBullet.h"
+#include "ClawProjectilePool.h"
+#include "ClawProjectileSystem.h"
+#include "ClawSpatialHash.h"
+#include "ClawPickupManager.h"
+#include "Interfaces/Pickup.h"
 #include "Kismet/GameplayStatics.h"
+#include "ClawSoundPool.h"
+#include "ClawDamageSystem.h"
 #include "Camera/CameraComponent.h"
 #include "Blueprint/UserWidget.h"
 #include "InputCoreTypes.h"
 #include "Enemy.h"
 #include "HealthComponent.h"
 #include "ClawGameMode.h"
+#include "ClawNet.h"
+#include "ClawLagCompensation.h"
+#include "ClawSimulation.h"
+#include "ClawRemastered2.h"
+#include "Net/UnrealNetwork.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Claw Tick"), STAT_ClawCharacterTick, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predicted Attacks"), STAT_ClawPredictedAttacks, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rejected Attacks"), STAT_ClawRejectedAttacks, STATGROUP_Claw);
 
 DEFINE_LOG_CATEGORY_STATIC(SideScrollerCharacter, Log, All);
 
 //////////////////////////////////////////////////////////////////////////
 // AClawRemastered2Character
 
-AClawRemastered2Character::AClawRemastered2Character()
+// the level collides through the tile grid instead of physics bodies
+AClawRemastered2Character::AClawRemastered2Character(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UClawTileMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Use only Yaw from the controller and ignore the rest of the rotation.
 	bUseControllerRotationPitch = false;
@@ -86,9 +108,15 @@ AClawRemastered2Character::AClawRemastered2Character()
 	BulletSpawnLocation = CreateDefaultSubobject<USceneComponent>(TEXT("Bullet Spawn Point"));
 	BulletSpawnLocation->SetupAttachment(RootComponent);
 
-	// Enable replication on the Sprite component so animations show up when networked
-	GetSprite()->SetIsReplicated(true);
+	Animation = CreateDefaultSubobject<UClawAnimationComponent>(TEXT("Animation"));
+	Animation->SetSprite(GetSprite());
+
+	// the other players see Claw through his animation flags and a whole unit location,
+	// the flipbook component isn't replicated
 	bReplicates = true;
+	GetReplicatedMovement_Mutable().LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	GetReplicatedMovement_Mutable().VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	GetReplicatedMovement_Mutable().RotationQuantizationLevel = ERotatorQuantization::ByteComponents;
 }
 
 void AClawRemastered2Character::BeginPlay()
@@ -96,95 +124,276 @@ void AClawRemastered2Character::BeginPlay()
 	Super::BeginPlay();
 
 	GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
+	InputRecorder = GetWorld()->GetSubsystem<UClawInputRecorder>();
+
+	// the simulation steps the movement, the actor only ticks for its blueprint
+	Simulation = GetWorld()->GetSubsystem<UClawSimulation>();
+	bFixedStep = Simulation->IsFixedStep();
+	if (bFixedStep)
+	{
+		Simulation->AddCharacter(this);
+		GetCharacterMovement()->SetComponentTickEnabled(false);
+
+		StepStartLocation = GetActorLocation();
+		SpriteLocation = GetSprite()->GetRelativeLocation();
+		CameraBoomLocation = CameraBoom->GetRelativeLocation();
+	}
 
 	clawCapsuleComponent = Cast<UCapsuleComponent>(RootComponent);
 	JumpMaxHoldTime = 2.0f;
+
+	// the health component started with the actor, so it already has its default health
+	ClawHealth->OnHealthChanged().AddUObject(this, &AClawRemastered2Character::OnHealthChanged);
+	ClawHealth->OnDeath().AddUObject(this, &AClawRemastered2Character::OnDeath);
+	GameModeRef->OnHealthPaneChanged.Broadcast(ClawHealth->GetHealth());
+
+	if (!Animation->AnimationSet)
+	{
+		Animation->SetAnimationSet(UClawAnimationSet::MakeClawAnimationSet(this, IdleAnimation, RunningAnimation, JumpingAnimation, CrouchingAnimation,
+			SwordingAnimation, JumpSwordingAnimation, CrouchSwordingAnimation,
+			PistolingAnimation, JumpPistolingAnimation, CrouchPistolingAnimation,
+			HurtAnimation, DeadAnimation));
+	}
+
+	// enough bullets for a full burst, so the first shots don't spawn actors
+	ProjectileSystem = GetWorld()->GetSubsystem<UClawProjectileSystem>();
+	ProjectilePool = GetWorld()->GetSubsystem<UClawProjectilePool>();
+	LagCompensation = GetWorld()->GetSubsystem<UClawLagCompensation>();
+	if (!ProjectileSystem->IsSimulating())
+	{
+		ProjectilePool->Prewarm(BulletClass, 8);
+	}
+
+	PickupManager = GetWorld()->GetSubsystem<UClawPickupManager>();
+
+	SpatialHash = GetWorld()->GetSubsystem<UClawSpatialHash>();
+	if (SpatialHash->IsQuerying())
+	{
+		const UCapsuleComponent* Capsule = GetCapsuleComponent();
+		SpatialHandle = SpatialHash->Insert(this, FClawSpatialGrid::MakeBounds(Capsule->GetComponentLocation(), FVector(Capsule->GetScaledCapsuleRadius(), 0.0f, Capsule->GetScaledCapsuleHalfHeight())), CLAW_SpatialClaw);
+	}
+}
+
+void AClawRemastered2Character::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (SpatialHandle != INDEX_NONE)
+	{
+		SpatialHash->Remove(SpatialHandle);
+		SpatialHandle = INDEX_NONE;
+	}
+
+	if (bFixedStep)
+	{
+		Simulation->RemoveCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AClawRemastered2Character::UpdateSpatial()
+{
+	const UCapsuleComponent* Capsule = GetCapsuleComponent();
+	const FBox2D Bounds = FClawSpatialGrid::MakeBounds(Capsule->GetComponentLocation(), FVector(Capsule->GetScaledCapsuleRadius(), 0.0f, Capsule->GetScaledCapsuleHalfHeight()));
+
+	// the pickup manager has a grid of its own, it doesn't need the spatial hash
+	if (!isDead)
+	{
+		PickupManager->CollectPickups(this, Bounds);
+	}
+
+	if (SpatialHandle == INDEX_NONE)
+	{
+		return;
+	}
+
+	SpatialHash->Move(SpatialHandle, Bounds);
+
+	// the dead don't collect anything
+	if (isDead)
+	{
+		return;
+	}
+
+	// picking something up destroys it and takes it out of the hash, so collect first
+	TouchedPickups.Reset();
+	SpatialHash->QueryBox(Bounds, CLAW_SpatialPickup, TouchedPickups);
+	for (AActor* Actor : TouchedPickups)
+	{
+		if (IPickup* Pickup = Cast<IPickup>(Actor))
+		{
+			Pickup->OnPickedUp(this);
+		}
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Animation
 
+void AClawRemastered2Character::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// the owner picks its own flags
+	DOREPLIFETIME_CONDITION(AClawRemastered2Character, NetAnimationFlags, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AClawRemastered2Character, ammo, COND_OwnerOnly);
+}
+
+bool AClawRemastered2Character::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
+}
+
+void AClawRemastered2Character::ServerSetAnimationFlags_Implementation(uint8 Flags)
+{
+	NetAnimationFlags = Flags;
+
+	// the enemies react to Claw crouching, and the capsule decides what hits him
+	SetCrouching(EnumHasAnyFlags((EClawAnimationFlags)Flags, EClawAnimationFlags::Crouching));
+}
+
 void AClawRemastered2Character::UpdateAnimation()
 {
-	const FVector PlayerVelocity = GetVelocity();
-	const float PlayerSpeedSqr = PlayerVelocity.SizeSquared();
+	// only the controlling player knows whether Claw swings or shoots, the others show what it sent
+	if (!IsLocallyControlled() && GetNetMode() != NM_Standalone)
+	{
+		Animation->SetFlags((EClawAnimationFlags)NetAnimationFlags);
+		return;
+	}
+
+	EClawAnimationFlags Flags = EClawAnimationFlags::None;
+	Flags |= isDead ? EClawAnimationFlags::Dead : EClawAnimationFlags::None;
+	Flags |= isHurt ? EClawAnimationFlags::Hurt : EClawAnimationFlags::None;
+	Flags |= isSwording ? EClawAnimationFlags::Swording : EClawAnimationFlags::None;
+	Flags |= isPistoling ? EClawAnimationFlags::Pistoling : EClawAnimationFlags::None;
+	Flags |= isCrouching ? EClawAnimationFlags::Crouching : EClawAnimationFlags::None;
+	Flags |= GetCharacterMovement()->IsFalling() ? EClawAnimationFlags::Falling : EClawAnimationFlags::None;
+	Flags |= GetVelocity().SizeSquared() > 0.0f ? EClawAnimationFlags::Moving : EClawAnimationFlags::None;
 
-	UPaperFlipbook* DesiredAnimation;
+	// the flipbook only changes when the flags do
+	Animation->SetFlags(Flags);
 
-	if (isDead) {
-		DesiredAnimation = DeadAnimation;
+	if ((uint8)Flags != NetAnimationFlags)
+	{
+		NetAnimationFlags = (uint8)Flags;
+		if (!HasAuthority())
+		{
+			ServerSetAnimationFlags(NetAnimationFlags);
+		}
 	}
-	else if (isHurt) {
-		DesiredAnimation = HurtAnimation;
+}
+
+void AClawRemastered2Character::Tick(float DeltaSeconds)
+{
+	if (bFixedStep)
+	{
+		Super::Tick(DeltaSeconds);
+		return;
 	}
-	else if (isSwording) {
-		// using the sword mid air
-		if (GetCharacterMovement()->IsFalling()) {
-			DesiredAnimation = JumpSwordingAnimation;
-		}
-		// using the sword while crouching
-		else if (isCrouching) {
-			DesiredAnimation = CrouchSwordingAnimation;
-		}
-		// using the sword on the ground
-		else {
-			DesiredAnimation = SwordingAnimation;
-		}
+
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawCharacterTick);
+
+	// the player controller handled this frame's input before Claw ticks
+	if (InputRecorder && InputRecorder->IsRecording())
+	{
+		InputRecorder->RecordFrame(LiveInput);
 	}
-	else if (isPistoling) {
-		// firing the pistol mid air
-		if (GetCharacterMovement()->IsFalling()) {
-			DesiredAnimation = JumpPistolingAnimation;
-		}
-		// firing the pistol while crouching
-		else if (isCrouching) {
-			DesiredAnimation = CrouchPistolingAnimation;
-		}
-		// firing the pistol on the ground
-		else {
-			DesiredAnimation = PistolingAnimation;
+	else if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		FClawInputFrame Frame;
+		if (InputRecorder->ReadFrame(Frame))
+		{
+			ApplyInputFrame(Frame);
 		}
 	}
-	else if (GetCharacterMovement()->IsFalling()) {
-		// if falling then render falling animation.
-		DesiredAnimation = JumpingAnimation;
+	LiveInput.Actions = EClawInputAction::None;
+
+	Super::Tick(DeltaSeconds);
+
+	UpdateGameplay();
+}
+
+void AClawRemastered2Character::SimulateStep(float StepSeconds)
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawCharacterTick);
+
+	StepStartLocation = GetActorLocation();
+
+	// the bindings only noted the input, every step plays it like a replayed frame
+	FClawInputFrame Frame = LiveInput;
+	bool bHasFrame = true;
+	if (InputRecorder && InputRecorder->IsRecording())
+	{
+		InputRecorder->RecordFrame(Frame);
 	}
-	else if (isCrouching) {
-		DesiredAnimation = CrouchingAnimation;
+	else if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		bHasFrame = InputRecorder->ReadFrame(Frame);
 	}
-	else {
-		// else render running or idle animation
-		DesiredAnimation = (PlayerSpeedSqr > 0.0f) ? RunningAnimation : IdleAnimation;
+	if (bHasFrame)
+	{
+		ApplyInputFrame(Frame);
 	}
+	LiveInput.Actions = EClawInputAction::None;
+
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->TickComponent(StepSeconds, LEVELTICK_All, &Movement->PrimaryComponentTick);
 
-	// Are we moving or standing still?
-	if( GetSprite()->GetFlipbook() != DesiredAnimation )
+	UpdateGameplay();
+
+	// the player controller only turns Claw once per frame
+	if (Controller != nullptr)
 	{
-		GetSprite()->SetFlipbook(DesiredAnimation);
+		FaceRotation(Controller->GetControlRotation(), StepSeconds);
 	}
 }
 
-void AClawRemastered2Character::Tick(float DeltaSeconds)
+void AClawRemastered2Character::InterpolateStep(float Alpha)
 {
-	Super::Tick(DeltaSeconds);
-	
-	if (!isDead && ClawHealth->GetHealth() <= 0) {
-		HandleDeath();
-	}
+	// Claw turns around to face left, so the offset goes into his space
+	const FVector Location = GetActorLocation();
+	const FVector Offset = GetActorTransform().InverseTransformVectorNoScale(FMath::Lerp(StepStartLocation, Location, Alpha) - Location);
 
-	if (currentHealth != ClawHealth->GetHealth()) {
-		if (currentHealth > ClawHealth->GetHealth())
-		{
-			UGameplayStatics::SpawnSound2D(this, ClawHurtSound, 1.0f, 1.0f, 0.0f);
-			StartHurt();
-		} 
-		GameModeRef->OnHealthPaneChanged.Broadcast(ClawHealth->GetHealth());
-		currentHealth = ClawHealth->GetHealth();
+	GetSprite()->SetRelativeLocation(SpriteLocation + Offset);
+	CameraBoom->SetRelativeLocation(CameraBoomLocation + Offset);
+}
+
+void AClawRemastered2Character::UpdateGameplay()
+{
+	UpdateSpatial();
+
+	// death tiles kill outright, whatever health is left
+	if (!isDead && (CastChecked<UClawTileMovementComponent>(GetCharacterMovement())->GetTouchedTileFlags() & CLAW_TileDeath))
+	{
+		UClawDamageSystem::ApplyDamage(this, ClawHealth->GetHealth(), GetController(), this, DamageType);
 	}
 
 	UpdateCharacter();
 }
 
+void AClawRemastered2Character::SetGameplayTimer(FTimerHandle& Handle, uint32& StepHandle, void (AClawRemastered2Character::*Function)(), float Delay)
+{
+	if (bFixedStep)
+	{
+		Simulation->SetTimer(StepHandle, FTimerDelegate::CreateUObject(this, Function), Delay);
+	}
+	else
+	{
+		GetWorldTimerManager().SetTimer(Handle, this, Function, Delay, false);
+	}
+}
+
+void AClawRemastered2Character::ClearGameplayTimer(FTimerHandle& Handle, uint32& StepHandle)
+{
+	if (bFixedStep)
+	{
+		Simulation->ClearTimer(StepHandle);
+	}
+	else
+	{
+		GetWorldTimerManager().ClearTimer(Handle);
+	}
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 // Input
@@ -192,13 +401,143 @@ void AClawRemastered2Character::Tick(float DeltaSeconds)
 void AClawRemastered2Character::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
 {
 	// Note: the 'Jump' action and the 'MoveRight' axis are bound to actual keys/buttons/sticks in DefaultInput.ini (editable from Project Settings..Input)
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
-	PlayerInputComponent->BindAxis("MoveRight", this, &AClawRemastered2Character::MoveRight);
-	PlayerInputComponent->BindAction("Crouch", IE_Pressed, this, &AClawRemastered2Character::CrouchClaw);
-	PlayerInputComponent->BindAction("Crouch", IE_Released, this, &AClawRemastered2Character::StopCrouching);
-	PlayerInputComponent->BindAction("Sword", IE_Pressed, this, &AClawRemastered2Character::StartSwording);
-	PlayerInputComponent->BindAction("Pistol", IE_Pressed, this, &AClawRemastered2Character::StartPistoling); 
+	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &AClawRemastered2Character::InputJump);
+	PlayerInputComponent->BindAction("Jump", IE_Released, this, &AClawRemastered2Character::InputStopJumping);
+	PlayerInputComponent->BindAxis("MoveRight", this, &AClawRemastered2Character::InputMoveRight);
+	PlayerInputComponent->BindAction("Crouch", IE_Pressed, this, &AClawRemastered2Character::InputCrouch);
+	PlayerInputComponent->BindAction("Crouch", IE_Released, this, &AClawRemastered2Character::InputStopCrouching);
+	PlayerInputComponent->BindAction("Sword", IE_Pressed, this, &AClawRemastered2Character::InputSword);
+	PlayerInputComponent->BindAction("Pistol", IE_Pressed, this, &AClawRemastered2Character::InputPistol); 
+}
+
+void AClawRemastered2Character::InputMoveRight(float Value)
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.MoveRight = (int8)FMath::RoundToInt(FMath::Clamp(Value, -1.0f, 1.0f) * 127.0f);
+	if (!bFixedStep)
+	{
+		MoveRight(Value);
+	}
+}
+
+void AClawRemastered2Character::InputJump()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::JumpPressed;
+	if (!bFixedStep)
+	{
+		Jump();
+	}
+}
+
+void AClawRemastered2Character::InputStopJumping()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::JumpReleased;
+	if (!bFixedStep)
+	{
+		StopJumping();
+	}
+}
+
+void AClawRemastered2Character::InputCrouch()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::CrouchPressed;
+	if (!bFixedStep)
+	{
+		CrouchClaw();
+	}
+}
+
+void AClawRemastered2Character::InputStopCrouching()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::CrouchReleased;
+	if (!bFixedStep)
+	{
+		StopCrouching();
+	}
+}
+
+void AClawRemastered2Character::InputSword()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::SwordPressed;
+	if (!bFixedStep)
+	{
+		StartSwording();
+	}
+}
+
+void AClawRemastered2Character::InputPistol()
+{
+	if (InputRecorder && InputRecorder->IsReplaying())
+	{
+		return;
+	}
+
+	LiveInput.Actions |= EClawInputAction::PistolPressed;
+	if (!bFixedStep)
+	{
+		StartPistoling();
+	}
+}
+
+void AClawRemastered2Character::ApplyInputFrame(const FClawInputFrame& Frame)
+{
+	// in the order the input component would call the bindings
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::JumpPressed))
+	{
+		Jump();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::JumpReleased))
+	{
+		StopJumping();
+	}
+
+	MoveRight(Frame.GetMoveRight());
+
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::CrouchPressed))
+	{
+		CrouchClaw();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::CrouchReleased))
+	{
+		StopCrouching();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::SwordPressed))
+	{
+		StartSwording();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EClawInputAction::PistolPressed))
+	{
+		StartPistoling();
+	}
 }
 
 void AClawRemastered2Character::MoveRight(float Value)
@@ -241,12 +580,11 @@ void AClawRemastered2Character::StartSwording()
 	if (isSwording == false)
 	{
 		isSwording = true;
-		UGameplayStatics::SpawnSound2D(this, ClawSwordSound, 1.0f, 1.0f, 0.0f);
+		UClawSoundPool::PlaySound2D(this, ClawSwordSound, EClawSoundCategory::Weapon);
 
 		if (GetCharacterMovement()->IsFalling() == false || isCrouching == true)
 		{ 
-			FTimerHandle UnusedHandle;
-			GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::DealDamage, 0.3f, false);
+			SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::DealDamage, 0.3f);
 
 			//GetCharacterMovement()->StopMovementImmediately();
 			GetCharacterMovement()->DisableMovement();
@@ -254,31 +592,56 @@ void AClawRemastered2Character::StartSwording()
 		// using the sword mid air
 		else
 		{ 
-			FTimerHandle UnusedHandle;
-			GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::DealDamage, 0.3f, false);
+			SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::DealDamage, 0.3f);
+		}
+
+		// the owning client only predicts the swing, the server decides what it hits
+		if (IsPredictingAttacks())
+		{
+			ServerSword(++LastAttackId, isCrouching);
+			INC_DWORD_STAT(STAT_ClawPredictedAttacks);
 		}
 	}
 }
 
 void AClawRemastered2Character::DealDamage()
 {
-	TSet<UPrimitiveComponent*> OverlappingComponents;
+	// a client sent its swing to the server when it started, only the server hurts enemies
+	if (GetNetMode() != NM_Client)
+	{
+		TArray<AActor*> Targets;
+
+		// a remote player swung at the enemies where they were on its screen
+		if (!IsLocallyControlled() && LagCompensation && LagCompensation->IsEnabled())
+		{
+			const FBox2D AttackBounds = FClawSpatialGrid::MakeBounds(attackCollisionBox->GetComponentLocation(), attackCollisionBox->GetScaledBoxExtent());
+			LagCompensation->GatherEnemiesAt(AttackBounds, LagCompensation->GetViewTime(this), Targets);
+		}
+		else
+		{
+			TSet<UPrimitiveComponent*> OverlappingComponents;
 	
-	attackCollisionBox->GetOverlappingComponents(OverlappingComponents);
+			attackCollisionBox->GetOverlappingComponents(OverlappingComponents);
 	
-	for (auto& Component : OverlappingComponents)
-	{
-		if (Component->IsA(UCapsuleComponent::StaticClass()))
-		{ 
-			if (Component->GetOwner()->IsA(AEnemyCharacter::StaticClass()) || Component->GetOwner()->IsA(ABlueOfficer::StaticClass()) || Component->GetOwner()->IsA(AEnemy::StaticClass()))
+			for (auto& Component : OverlappingComponents)
 			{
-				UGameplayStatics::ApplyDamage(Component->GetOwner(), 300, GetOwner()->GetInstigatorController(), this, DamageType);
+				if (Component->IsA(UCapsuleComponent::StaticClass()))
+				{ 
+					if (Component->GetOwner()->IsA(AEnemyCharacter::StaticClass()) || Component->GetOwner()->IsA(ABlueOfficer::StaticClass()) || Component->GetOwner()->IsA(AEnemy::StaticClass()))
+					{
+						Targets.AddUnique(Component->GetOwner());
+					}
+				}
 			}
 		}
+
+		for (AActor* Target : Targets)
+		{
+			UClawDamageSystem::ApplyDamage(Target, 300, GetOwner()->GetInstigatorController(), this, DamageType);
+		}
 	}
 
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::StopSwording, 0.3f, false);
+	SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::StopSwording, 0.3f);
 }
 
 // called when the timer for the swording animation ends
@@ -298,16 +661,21 @@ void AClawRemastered2Character::StartPistoling()
 		// firing the pistol on the ground
 		if (GetCharacterMovement()->IsFalling() == false)
 		{ 
-			FTimerHandle UnusedHandle;
-			GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::SpawnBullet, 0.3f, false);
+			SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::SpawnBullet, 0.3f);
 
 			GetCharacterMovement()->DisableMovement();
 		}
 		// firing the pistol mid air
 		else 
 		{ 
-			FTimerHandle UnusedHandle;
-			GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::SpawnBullet, 0.2f, false);
+			SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::SpawnBullet, 0.2f);
+		}
+
+		// the owning client shows a predicted bullet, the server fires the one that hits
+		if (IsPredictingAttacks())
+		{
+			ServerPistol(++LastAttackId, isCrouching);
+			INC_DWORD_STAT(STAT_ClawPredictedAttacks);
 		}
 	}
 }
@@ -319,9 +687,10 @@ void AClawRemastered2Character::SpawnBullet()
 	{
 		if (ammo > 0)
 		{
+			// predicted on the owning client, until the server's count replicates back
 			ammo--;
 
-			UGameplayStatics::SpawnSound2D(this, pistolFiringSound, 1.0f, 1.0f, 0.0f);
+			UClawSoundPool::PlaySound2D(this, pistolFiringSound, EClawSoundCategory::Weapon);
 
 			FRotator SpawnRotation = GetActorRotation();
 			FVector SpawnLocation;
@@ -337,21 +706,32 @@ void AClawRemastered2Character::SpawnBullet()
 				SpawnLocation += FVector(0.0, 0.0f, -40.0f);
 			}
 
-			GetWorld()->SpawnActor<AClawBullet>(BulletClass, SpawnLocation, SpawnRotation);
+			// bullets the projectile system can't simulate are still actors, a client's bullet
+			// doesn't deal damage, so it only shows where the server's will fly
+			if (!ProjectileSystem->Fire(BulletClass, SpawnLocation, SpawnRotation, this))
+			{
+				if (AClawBullet* Bullet = ProjectilePool->Acquire<AClawBullet>(BulletClass, SpawnLocation, SpawnRotation))
+				{
+					Bullet->SetInstigator(this);
+				}
+			}
+
+			if (ClawNet::IsServing(GetWorld()))
+			{
+				MulticastFireBullet(SpawnLocation, SpawnRotation);
+			}
 		}
 		else
 		{
-			UGameplayStatics::SpawnSound2D(this, EmptyPistolSound, 1.0f, 1.0f, 0.0f);
+			UClawSoundPool::PlaySound2D(this, EmptyPistolSound, EClawSoundCategory::Weapon);
 		}
 	}
 
 	if (GetCharacterMovement()->IsFalling()) {
-		FTimerHandle UnusedHandle;
-		GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::StopPistoling, 0.3f, false);
+		SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::StopPistoling, 0.3f);
 	}
 	else {
-		FTimerHandle UnusedHandle;
-		GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::StopPistoling, 0.45f, false);
+		SetGameplayTimer(AttackTimer, AttackStepTimer, &AClawRemastered2Character::StopPistoling, 0.45f);
 	}
 	
 }
@@ -362,6 +742,83 @@ void AClawRemastered2Character::StopPistoling()
 	GetCharacterMovement()->SetMovementMode(MOVE_Walking); 
 }
 
+bool AClawRemastered2Character::IsPredictingAttacks() const
+{
+	return IsLocallyControlled() && GetLocalRole() == ROLE_AutonomousProxy;
+}
+
+void AClawRemastered2Character::ServerSword_Implementation(uint8 AttackId, bool bCrouching)
+{
+	// the client swung while the server's Claw still couldn't, it takes the swing back
+	if (isSwording || isDead)
+	{
+		ClientRejectAttack(AttackId, ammo);
+		return;
+	}
+
+	SetCrouching(bCrouching);
+	StartSwording();
+}
+
+void AClawRemastered2Character::ServerPistol_Implementation(uint8 AttackId, bool bCrouching)
+{
+	if (isPistoling || isDead)
+	{
+		ClientRejectAttack(AttackId, ammo);
+		return;
+	}
+
+	SetCrouching(bCrouching);
+	StartPistoling();
+}
+
+void AClawRemastered2Character::ClientRejectAttack_Implementation(uint8 AttackId, int32 ServerAmmo)
+{
+	INC_DWORD_STAT(STAT_ClawRejectedAttacks);
+	UE_LOG(LogClaw, Verbose, TEXT("%s: the server rejected attack %d"), *GetName(), AttackId);
+
+	// a newer attack already replaced the rejected one
+	if (AttackId != LastAttackId)
+	{
+		return;
+	}
+
+	ammo = ServerAmmo;
+
+	ClearGameplayTimer(AttackTimer, AttackStepTimer);
+	if (isSwording)
+	{
+		StopSwording();
+	}
+	if (isPistoling)
+	{
+		StopPistoling();
+	}
+}
+
+void AClawRemastered2Character::MulticastFireBullet_Implementation(FVector_NetQuantize Location, FRotator Rotation)
+{
+	// the server and the owning client fired it already, and bullet actors are replicated
+	if (HasAuthority() || IsLocallyControlled())
+	{
+		return;
+	}
+
+	ProjectileSystem->Fire(BulletClass, Location, Rotation, this);
+}
+
+void AClawRemastered2Character::SetCrouching(bool bCrouching)
+{
+	if (bCrouching && !isCrouching)
+	{
+		CrouchClaw();
+	}
+	else if (!bCrouching && isCrouching)
+	{
+		StopCrouching();
+	}
+}
+
 
 // start hurt and stop hurt are implemented but not used yet. I realised it would 
 void AClawRemastered2Character::StartHurt()
@@ -370,7 +827,8 @@ void AClawRemastered2Character::StartHurt()
 	GetCharacterMovement()->DisableMovement();
 
 	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AClawRemastered2Character::StopHurt, 0.2f, false);
+	uint32 UnusedStepHandle = 0;
+	SetGameplayTimer(UnusedHandle, UnusedStepHandle, &AClawRemastered2Character::StopHurt, 0.2f);
 }
 
 void AClawRemastered2Character::StopHurt()
@@ -401,6 +859,28 @@ void AClawRemastered2Character::UpdateCharacter()
 	}
 }
 
+void AClawRemastered2Character::OnHealthChanged(UHealthComponent* HealthComponent, float Health, float Delta)
+{
+	if (Delta < 0.0f)
+	{
+		UClawSoundPool::PlaySound2D(this, ClawHurtSound, EClawSoundCategory::Voice, 3.0f);
+		StartHurt();
+	}
+	// clients have no game mode
+	if (GameModeRef)
+	{
+		GameModeRef->OnHealthPaneChanged.Broadcast(Health);
+	}
+}
+
+void AClawRemastered2Character::OnDeath(UHealthComponent* HealthComponent)
+{
+	if (!isDead)
+	{
+		HandleDeath();
+	}
+}
+
 void AClawRemastered2Character::HandleDeath()
 {
 	isDead = true;
@@ -410,8 +890,11 @@ void AClawRemastered2Character::HandleDeath()
 
 	//TODO: Disable Claw movement and make him fall 
 	//SetActorLocation(ClawLocation + FVector(0.0f, 1.0f, 0.0f));
-	GameModeRef->HandleGameOver(false);
-	UGameplayStatics::SpawnSound2D(this, ClawDeathSound, 1.0f, 1.0f, 0.0f);
+	if (GameModeRef)
+	{
+		GameModeRef->HandleGameOver(false);
+	}
+	UClawSoundPool::PlaySound2D(this, ClawDeathSound, EClawSoundCategory::Voice, 4.0f);
 
 	// disable claw's movement and input
 	this->TurnOff();
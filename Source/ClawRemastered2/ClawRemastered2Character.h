@@ -10,6 +10,7 @@
 #include "Components/BoxComponent.h"
 #include "PaperSpriteActor.h"
 #include "Sound/SoundBase.h"
+#include "ClawInputRecorder.h"
 #include "ClawRemastered2Character.generated.h"
 
 class UTextRenderComponent;
@@ -43,6 +44,10 @@ class AClawRemastered2Character : public APaperCharacter
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Projectile, meta = (AllowPrivateAccess = "true"))
 	TSubclassOf<APaperSpriteActor> BulletClass; 
+
+	/** Picks the flipbook from the flags of UpdateAnimation, built from the animations below when it has no set */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Animations, meta = (AllowPrivateAccess = "true"))
+	class UClawAnimationComponent* Animation;
 	
 protected:
 	// The animation to play while running around
@@ -96,6 +101,13 @@ protected:
 	/** Called to choose the correct animation to play based on the character's movement state */
 	void UpdateAnimation();
 
+	// the animation flags of the controlling player, shown by the other players instead of the replicated flipbook
+	UPROPERTY(Replicated)
+	uint8 NetAnimationFlags = 0;
+
+	UFUNCTION(Server, Reliable)
+	void ServerSetAnimationFlags(uint8 Flags);
+
 	/** Called for side to side input */
 	void MoveRight(float Value);
 
@@ -111,24 +123,88 @@ protected:
 	void SpawnBullet();
 	void StopPistoling();
 
+	// networked play, the owning client predicts its attacks and the server resolves them
+	bool IsPredictingAttacks() const;
+
+	UFUNCTION(Server, Reliable)
+	void ServerSword(uint8 AttackId, bool bCrouching);
+
+	UFUNCTION(Server, Reliable)
+	void ServerPistol(uint8 AttackId, bool bCrouching);
+
+	// cancels a predicted attack the server couldn't start
+	UFUNCTION(Client, Reliable)
+	void ClientRejectAttack(uint8 AttackId, int32 ServerAmmo);
+
+	// shows a shot on the other clients, the simulated bullets aren't actors
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireBullet(FVector_NetQuantize Location, FRotator Rotation);
+
+	// matches the crouch of the owning client on the server
+	void SetCrouching(bool bCrouching);
+
+	// the timer of the running attack, cleared when the server rejects it
+	FTimerHandle AttackTimer;
+	uint32 AttackStepTimer = 0;
+
+	// the attack and hurt windows, counted in steps while the fixed step simulation runs Claw
+	void SetGameplayTimer(FTimerHandle& Handle, uint32& StepHandle, void (AClawRemastered2Character::*Function)(), float Delay);
+	void ClearGameplayTimer(FTimerHandle& Handle, uint32& StepHandle);
+
+	// the last attack the owning client predicted
+	uint8 LastAttackId = 0;
+
 	void StartHurt();
 	void StopHurt();
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	void UpdateCharacter();
 
+	// what Claw does once he moved, every frame or every fixed step
+	void UpdateGameplay();
+
+	// moves Claw's entry in the spatial hash and collects the pickups it touches
+	void UpdateSpatial();
+
+	// bound to ClawHealth, damage hurts Claw and every change goes to the health pane
+	void OnHealthChanged(UHealthComponent* HealthComponent, float Health, float Delta);
+	void OnDeath(UHealthComponent* HealthComponent);
+
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* InputComponent) override;
 	// End of APawn interface
 
+	// the bound inputs, they note what the player did for the input recorder and are ignored during a replay,
+	// under fixed steps they are only noted and the next step applies them
+	void InputMoveRight(float Value);
+	void InputJump();
+	void InputStopJumping();
+	void InputCrouch();
+	void InputStopCrouching();
+	void InputSword();
+	void InputPistol();
+
+	// plays one frame of recorded input
+	void ApplyInputFrame(const FClawInputFrame& Frame);
+
+	// the player's input this frame, recorded when the frame is done
+	FClawInputFrame LiveInput;
+
+	// true when the fixed step simulation moves Claw instead of his ticks
+	bool bFixedStep = false;
+
+	// where the last fixed step started, and where the sprite and the camera sit when drawn at its end
+	FVector StepStartLocation = FVector::ZeroVector;
+	FVector SpriteLocation = FVector::ZeroVector;
+	FVector CameraBoomLocation = FVector::ZeroVector;
+
 	
 	bool isHurt = false;
 	bool isDead = false;
 	bool isSwording = false; 
 	bool isPistoling = false; 
 
-	float currentHealth = 100.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Ammo)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Replicated, Category = Ammo)
 	int32 ammo = 13;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sounds)
@@ -155,7 +231,16 @@ protected:
 	UCapsuleComponent* clawCapsuleComponent;
 
 public:
-	AClawRemastered2Character();
+	AClawRemastered2Character(const FObjectInitializer& ObjectInitializer);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Moves Claw by one fixed step with the input of that step. */
+	void SimulateStep(float StepSeconds);
+
+	/** Draws Claw at Alpha between the start and the end of the last step. */
+	void InterpolateStep(float Alpha);
 
 	/** Returns SideViewCameraComponent subobject **/
 	FORCEINLINE class UCameraComponent* GetSideViewCameraComponent() const { return SideViewCameraComponent; }
@@ -169,6 +254,24 @@ public:
 	
 	AClawGameMode* GameModeRef;
 
+	class UClawProjectileSystem* ProjectileSystem;
+
+	class UClawProjectilePool* ProjectilePool;
+
+	class UClawLagCompensation* LagCompensation = nullptr;
+
+	class UClawSpatialHash* SpatialHash;
+
+	class UClawPickupManager* PickupManager = nullptr;
+
+	class UClawInputRecorder* InputRecorder = nullptr;
+
+	class UClawSimulation* Simulation = nullptr;
+
+	int32 SpatialHandle = INDEX_NONE;
+
+	TArray<AActor*> TouchedPickups;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	class UBoxComponent* attackCollisionBox;
 
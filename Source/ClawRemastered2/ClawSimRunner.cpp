@@ -0,0 +1,327 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSimRunner.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PaperCharacter.h"
+#include "HealthComponent.h"
+#include "ClawGameMode.h"
+#include "ClawEnemyManager.h"
+#include "ClawInputRecorder.h"
+#include "ClawSimulation.h"
+#include "ClawRemastered2Character.h"
+#include "ClawRemastered2.h"
+
+namespace
+{
+	// how far ahead the bot swings, a little past the reach of the attack box
+	const float SwordReach = 120.0f;
+	const float PistolRange = 700.0f;
+
+	// Claw counts as stuck once he didn't get further right for that long
+	const float StuckSeconds = 0.25f;
+	const float SwordCooldownSeconds = 0.65f;
+
+	// a held jump key jumps higher, the bot holds it for a random time in between
+	const float MinJumpSeconds = 0.05f;
+	const float MaxJumpSeconds = 0.4f;
+
+	// chances per frame to jump or shoot for no reason, what makes the seeds play differently
+	const float RandomJumpChance = 0.005f;
+	const float PistolChance = 0.02f;
+
+	int32 SecondsToFrames(float Seconds)
+	{
+		return FMath::Max(FMath::CeilToInt(Seconds / FApp::GetFixedDeltaTime()), 1);
+	}
+}
+
+void UClawSimRunner::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (!GetWorld()->IsGameWorld() || !FParse::Value(CommandLine, TEXT("ClawSimRun="), RunName))
+	{
+		return;
+	}
+
+	Simulation = Collection.InitializeDependency<UClawSimulation>();
+	EnemyManager = Collection.InitializeDependency<UClawEnemyManager>();
+	InputRecorder = Collection.InitializeDependency<UClawInputRecorder>();
+
+	FParse::Value(CommandLine, TEXT("ClawSeed="), Seed);
+	FParse::Value(CommandLine, TEXT("SimSeconds="), MaxGameSeconds);
+
+	Random.Initialize(Seed);
+
+	// one step per frame, and the engine doesn't wait for the clock between fixed frames.
+	// A replay already brought its own seed and frame time.
+	if (!InputRecorder->IsReplaying())
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(Simulation->IsFixedStep() ? Simulation->GetStepSeconds() : 1.0f / 60.0f);
+
+		FMath::RandInit(Seed);
+		FMath::SRandInit(Seed);
+	}
+
+	if (!Simulation->IsFixedStep())
+	{
+		UE_LOG(LogClaw, Warning, TEXT("Run %s isn't in fixed steps, add -ClawFixedStep=120 to play the same way every time."), *RunName);
+	}
+
+	bActive = true;
+}
+
+void UClawSimRunner::Deinitialize()
+{
+	// a replay exits the game when it runs out
+	if (bActive && bStarted)
+	{
+		WriteResults(TEXT("the game exited"));
+	}
+	bActive = false;
+
+	if (AClawRemastered2Character* ClawCharacter = Claw.Get())
+	{
+		ClawCharacter->ClawHealth->OnHealthChanged().RemoveAll(this);
+		ClawCharacter->ClawHealth->OnDeath().RemoveAll(this);
+	}
+
+	Super::Deinitialize();
+}
+
+void UClawSimRunner::Tick(float DeltaSeconds)
+{
+	if (!bStarted)
+	{
+		bStarted = StartRun();
+		return;
+	}
+
+	AClawRemastered2Character* ClawCharacter = Claw.Get();
+	if (!ClawCharacter)
+	{
+		FinishRun(TEXT("Claw left the world"));
+		return;
+	}
+
+	FurthestX = FMath::Max(FurthestX, ClawCharacter->GetActorLocation().X);
+
+	const AClawGameMode* GameMode = Cast<AClawGameMode>(GetWorld()->GetAuthGameMode());
+	if (GameMode && GameMode->IsGameOver())
+	{
+		FinishRun(GameMode->HasPlayerWon() ? TEXT("completed") : TEXT("died"));
+		return;
+	}
+	if (Deaths > 0)
+	{
+		FinishRun(TEXT("died"));
+		return;
+	}
+	if (GetWorld()->GetTimeSeconds() - StartGameSeconds >= MaxGameSeconds)
+	{
+		FinishRun(TEXT("ran out of time"));
+		return;
+	}
+
+	if (!InputRecorder->IsReplaying())
+	{
+		DriveClaw();
+	}
+}
+
+ETickableTickType UClawSimRunner::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawSimRunner::IsTickable() const
+{
+	return bActive;
+}
+
+TStatId UClawSimRunner::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawSimRunner, STATGROUP_Tickables);
+}
+
+UWorld* UClawSimRunner::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+bool UClawSimRunner::StartRun()
+{
+	UWorld* World = GetWorld();
+	APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (!World->HasBegunPlay() || !PlayerController)
+	{
+		return false;
+	}
+
+	AClawRemastered2Character* ClawCharacter = Cast<AClawRemastered2Character>(PlayerController->GetPawn());
+	if (!ClawCharacter)
+	{
+		return false;
+	}
+
+	Claw = ClawCharacter;
+	ClawCharacter->ClawHealth->OnHealthChanged().AddUObject(this, &UClawSimRunner::OnClawHealthChanged);
+	ClawCharacter->ClawHealth->OnDeath().AddUObject(this, &UClawSimRunner::OnClawDeath);
+
+	StartX = ClawCharacter->GetActorLocation().X;
+	FurthestX = StartX;
+	ProgressX = StartX;
+	StartWallSeconds = FPlatformTime::Seconds();
+	StartGameSeconds = World->GetTimeSeconds();
+	StartStep = Simulation->GetStepCount();
+
+	UE_LOG(LogClaw, Display, TEXT("Run %s: seed %d on %s, at most %.0f s of play."), *RunName, Seed, *World->GetMapName(), MaxGameSeconds);
+
+	// the levels are played from left to right, the bot holds right for the whole run
+	if (!InputRecorder->IsReplaying())
+	{
+		PressKey(TEXT("D"), true);
+	}
+
+	return true;
+}
+
+void UClawSimRunner::DriveClaw()
+{
+	const FVector Location = Claw->GetActorLocation();
+
+	// the jump and sword keys are let go after a few frames
+	if (JumpFramesLeft > 0 && --JumpFramesLeft == 0)
+	{
+		PressKey(TEXT("SpaceBar"), false);
+	}
+	if (SwordFramesLeft > 0 && --SwordFramesLeft == 0)
+	{
+		PressKey(TEXT("LeftControl"), false);
+	}
+	SwordCooldown = FMath::Max(SwordCooldown - 1, 0);
+
+	if (Location.X > ProgressX + 8.0f)
+	{
+		ProgressX = Location.X;
+		FramesWithoutProgress = 0;
+	}
+	else
+	{
+		++FramesWithoutProgress;
+	}
+
+	// something stops him, or the seed says so
+	const bool bStuck = FramesWithoutProgress >= SecondsToFrames(StuckSeconds);
+	if (JumpFramesLeft == 0 && (bStuck || Random.FRand() < RandomJumpChance))
+	{
+		PressKey(TEXT("SpaceBar"), true);
+		JumpFramesLeft = SecondsToFrames(Random.FRandRange(MinJumpSeconds, MaxJumpSeconds));
+		FramesWithoutProgress = 0;
+	}
+
+	if (SwordCooldown > 0)
+	{
+		return;
+	}
+
+	// swing at an enemy in reach ahead of him, and now and then shoot at one further away
+	LiveEnemies.Reset();
+	EnemyManager->GatherLiveEnemies(LiveEnemies);
+	for (const APaperCharacter* Enemy : LiveEnemies)
+	{
+		const FVector ToEnemy = Enemy->GetActorLocation() - Location;
+		if (FMath::Abs(ToEnemy.Z) > 96.0f || ToEnemy.X < -32.0f || ToEnemy.X > PistolRange)
+		{
+			continue;
+		}
+
+		if (ToEnemy.X < SwordReach)
+		{
+			PressKey(TEXT("LeftControl"), true);
+			SwordFramesLeft = 2;
+			SwordCooldown = SecondsToFrames(SwordCooldownSeconds);
+			break;
+		}
+
+		if (Random.FRand() < PistolChance)
+		{
+			PressKey(TEXT("E"), true);
+			PressKey(TEXT("E"), false);
+			SwordCooldown = SecondsToFrames(SwordCooldownSeconds);
+			break;
+		}
+	}
+}
+
+void UClawSimRunner::PressKey(const TCHAR* Key, bool bPressed)
+{
+	// through the player controller, so the keys take the same path as a player's
+	if (APlayerController* PlayerController = GetWorld()->GetFirstPlayerController())
+	{
+		PlayerController->InputKey(FKey(Key), bPressed ? IE_Pressed : IE_Released, bPressed ? 1.0f : 0.0f, false);
+	}
+}
+
+void UClawSimRunner::FinishRun(const TCHAR* Reason)
+{
+	WriteResults(Reason);
+
+	bActive = false;
+	FPlatformMisc::RequestExit(false);
+}
+
+void UClawSimRunner::WriteResults(const TCHAR* Reason) const
+{
+	const UWorld* World = GetWorld();
+	AClawGameMode* GameMode = Cast<AClawGameMode>(World->GetAuthGameMode());
+
+	const bool bCompleted = GameMode && GameMode->IsGameOver() && GameMode->HasPlayerWon();
+	const float GameSeconds = World->GetTimeSeconds() - StartGameSeconds;
+	const double WallSeconds = FPlatformTime::Seconds() - StartWallSeconds;
+
+	FString Results = TEXT("Metric,Value\n");
+	Results += FString::Printf(TEXT("Seed,%d\n"), Seed);
+	Results += FString::Printf(TEXT("Completed,%d\n"), bCompleted ? 1 : 0);
+	Results += FString::Printf(TEXT("Deaths,%d\n"), Deaths);
+	Results += FString::Printf(TEXT("DamageTaken,%.1f\n"), DamageTaken);
+	Results += FString::Printf(TEXT("Hits,%d\n"), Hits);
+	Results += FString::Printf(TEXT("Score,%lld\n"), GameMode ? GameMode->GetScore() : 0);
+	Results += FString::Printf(TEXT("Distance,%.1f\n"), FurthestX - StartX);
+	Results += FString::Printf(TEXT("GameSeconds,%.3f\n"), GameSeconds);
+	Results += FString::Printf(TEXT("Steps,%lld\n"), Simulation->GetStepCount() - StartStep);
+	Results += FString::Printf(TEXT("WallSeconds,%.3f\n"), WallSeconds);
+	Results += FString::Printf(TEXT("SpeedUp,%.2f\n"), WallSeconds > 0.0 ? GameSeconds / WallSeconds : 0.0);
+
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("SimRuns") / RunName;
+	const FString Filename = Directory / FString::Printf(TEXT("Seed-%d.csv"), Seed);
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	FFileHelper::SaveStringToFile(Results, *Filename);
+
+	UE_LOG(LogClaw, Display, TEXT("Run %s seed %d %s after %.1f s of play in %.1f s, score %lld, %.0f damage taken, written to %s."),
+		*RunName, Seed, Reason, GameSeconds, WallSeconds, GameMode ? GameMode->GetScore() : 0, DamageTaken, *Filename);
+}
+
+void UClawSimRunner::OnClawHealthChanged(UHealthComponent* HealthComponent, float Health, float Delta)
+{
+	if (Delta < 0.0f)
+	{
+		DamageTaken -= Delta;
+		++Hits;
+	}
+}
+
+void UClawSimRunner::OnClawDeath(UHealthComponent* HealthComponent)
+{
+	++Deaths;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Math/RandomStream.h"
+#include "ClawSimRunner.generated.h"
+
+class UHealthComponent;
+class UClawEnemyManager;
+class UClawInputRecorder;
+class UClawSimulation;
+class AClawRemastered2Character;
+class APaperCharacter;
+
+/**
+ * Plays one run of a level as fast as the machine allows and reports how it went, when the
+ * game runs with -ClawSimRun.
+ *
+ * Every frame is one fixed step of the simulation, and the engine doesn't wait for the
+ * wall clock between fixed frames, so a headless process runs far ahead of real time. Claw
+ * is driven by a replayed recording when there is one, otherwise by a bot that runs right,
+ * jumps over what stops him and swings at the enemies ahead, with its choices drawn from
+ * the run's seed. The run ends when the level is won, Claw dies or -SimSeconds of game time
+ * passed, then Saved/SimRuns/<Name>/Seed-<Seed>.csv gets the outcome (one metric per row)
+ * and the game exits.
+ *
+ * Usage: ClawRemastered2 <Map> -game -nullrhi -nosound -unattended -ClawFixedStep=120
+ *        -ClawSimRun=<Name> [-ClawSeed=N] [-SimSeconds=300] [-ClawReplay=File]
+ *
+ * ClawSimSweep starts many of these in parallel, one seed each.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawSimRunner : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	bool IsRunning() const { return bActive; }
+
+private:
+	bool StartRun();
+	void DriveClaw();
+	void PressKey(const TCHAR* Key, bool bPressed);
+	void FinishRun(const TCHAR* Reason);
+	void WriteResults(const TCHAR* Reason) const;
+
+	void OnClawHealthChanged(UHealthComponent* HealthComponent, float Health, float Delta);
+	void OnClawDeath(UHealthComponent* HealthComponent);
+
+	bool bActive = false;
+	bool bStarted = false;
+
+	FString RunName;
+	int32 Seed = 0;
+	float MaxGameSeconds = 300.0f;
+
+	UPROPERTY()
+	UClawSimulation* Simulation;
+
+	UPROPERTY()
+	UClawEnemyManager* EnemyManager;
+
+	UPROPERTY()
+	UClawInputRecorder* InputRecorder;
+
+	TWeakObjectPtr<AClawRemastered2Character> Claw;
+
+	// the bot's choices, apart from the game's own random numbers
+	FRandomStream Random;
+
+	// frames the jump and sword keys stay down, and until the bot may swing again
+	int32 JumpFramesLeft = 0;
+	int32 SwordFramesLeft = 0;
+	int32 SwordCooldown = 0;
+
+	// where Claw was when the bot last checked that he gets anywhere
+	float ProgressX = 0.0f;
+	int32 FramesWithoutProgress = 0;
+
+	TArray<APaperCharacter*> LiveEnemies;
+
+	// the outcome
+	int32 Deaths = 0;
+	float DamageTaken = 0.0f;
+	int32 Hits = 0;
+	float StartX = 0.0f;
+	float FurthestX = 0.0f;
+	double StartWallSeconds = 0.0;
+	float StartGameSeconds = 0.0f;
+	int64 StartStep = 0;
+};
@@ -0,0 +1,223 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSimSweepCommandlet.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ClawRemastered2.h"
+
+namespace
+{
+	struct FSweepRun
+	{
+		int32 Seed;
+		FProcHandle Process;
+		double StartSeconds;
+	};
+
+	// the columns of Sweep.csv, in the order ClawSimRunner writes them
+	const TCHAR* const Columns[] =
+	{
+		TEXT("Seed"), TEXT("Completed"), TEXT("Deaths"), TEXT("DamageTaken"), TEXT("Hits"), TEXT("Score"),
+		TEXT("Distance"), TEXT("GameSeconds"), TEXT("Steps"), TEXT("WallSeconds"), TEXT("SpeedUp"),
+	};
+
+	FString GetRunFilename(const FString& Directory, int32 Seed)
+	{
+		return Directory / FString::Printf(TEXT("Seed-%d.csv"), Seed);
+	}
+
+	// the metrics a run wrote, false when it wrote none
+	bool LoadRun(const FString& Filename, TMap<FString, double>& OutMetrics)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Filename))
+		{
+			return false;
+		}
+
+		for (const FString& Line : Lines)
+		{
+			FString Metric;
+			FString Value;
+			if (Line.Split(TEXT(","), &Metric, &Value) && Value.IsNumeric())
+			{
+				OutMetrics.Add(Metric, FCString::Atod(*Value));
+			}
+		}
+		return OutMetrics.Num() > 0;
+	}
+}
+
+UClawSimSweepCommandlet::UClawSimSweepCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClawSimSweepCommandlet::Main(const FString& Params)
+{
+	FString Map;
+	if (!FParse::Value(*Params, TEXT("Map="), Map))
+	{
+		UE_LOG(LogClaw, Error, TEXT("Usage: -run=ClawSimSweep -Map=<Map> [-Seeds=100] [-FirstSeed=0] [-Jobs=<cores>] [-Name=Sweep] [-SimSeconds=300] [-StepRate=120] [-Timeout=600] [-Replay=File]"));
+		return 2;
+	}
+
+	int32 NumSeeds = 100;
+	int32 FirstSeed = 0;
+	int32 NumJobs = FPlatformMisc::NumberOfCoresIncludingHyperthreads();
+	int32 StepRate = 120;
+	float SimSeconds = 300.0f;
+	float Timeout = 600.0f;
+	FString Name = TEXT("Sweep");
+	FString Replay;
+	FParse::Value(*Params, TEXT("Seeds="), NumSeeds);
+	FParse::Value(*Params, TEXT("FirstSeed="), FirstSeed);
+	FParse::Value(*Params, TEXT("Jobs="), NumJobs);
+	FParse::Value(*Params, TEXT("StepRate="), StepRate);
+	FParse::Value(*Params, TEXT("SimSeconds="), SimSeconds);
+	FParse::Value(*Params, TEXT("Timeout="), Timeout);
+	FParse::Value(*Params, TEXT("Name="), Name);
+	FParse::Value(*Params, TEXT("Replay="), Replay);
+
+	NumSeeds = FMath::Max(NumSeeds, 1);
+	NumJobs = FMath::Clamp(NumJobs, 1, NumSeeds);
+
+	// the same executable plays the runs, as a game without a renderer or sound
+	const FString Executable = FPlatformProcess::ExecutablePath();
+	FString RunParams = FString::Printf(TEXT("\"%s\" %s -game -nullrhi -nosound -unattended -nosplash -ClawSimRun=%s -ClawFixedStep=%d -SimSeconds=%.1f"),
+		*FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()), *Map, *Name, StepRate, SimSeconds);
+	if (!Replay.IsEmpty())
+	{
+		RunParams += FString::Printf(TEXT(" -ClawReplay=\"%s\""), *Replay);
+	}
+
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("SimRuns") / Name;
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	UE_LOG(LogClaw, Display, TEXT("Sweeping %s with seeds %d to %d, %d at a time."), *Map, FirstSeed, FirstSeed + NumSeeds - 1, NumJobs);
+
+	const double SweepStart = FPlatformTime::Seconds();
+	const int32 EndSeed = FirstSeed + NumSeeds;
+	int32 NextSeed = FirstSeed;
+	int32 NumFinished = 0;
+	TArray<FSweepRun> Running;
+
+	while (NextSeed < EndSeed || Running.Num() > 0)
+	{
+		while (Running.Num() < NumJobs && NextSeed < EndSeed)
+		{
+			// a result left by an earlier sweep of the same name would hide a failed run
+			const FString RunFilename = GetRunFilename(Directory, NextSeed);
+			IFileManager::Get().Delete(*RunFilename, false, true, true);
+
+			const FString Args = RunParams + FString::Printf(TEXT(" -ClawSeed=%d"), NextSeed);
+			FProcHandle Process = FPlatformProcess::CreateProc(*Executable, *Args, false, true, true, nullptr, 0, nullptr, nullptr);
+			if (Process.IsValid())
+			{
+				Running.Add({ NextSeed, Process, FPlatformTime::Seconds() });
+			}
+			else
+			{
+				UE_LOG(LogClaw, Error, TEXT("Couldn't start the run of seed %d."), NextSeed);
+				++NumFinished;
+			}
+			++NextSeed;
+		}
+
+		FPlatformProcess::Sleep(0.1f);
+
+		for (int32 Index = Running.Num() - 1; Index >= 0; --Index)
+		{
+			FSweepRun& Run = Running[Index];
+			if (FPlatformProcess::IsProcRunning(Run.Process))
+			{
+				if (FPlatformTime::Seconds() - Run.StartSeconds < Timeout)
+				{
+					continue;
+				}
+
+				UE_LOG(LogClaw, Warning, TEXT("The run of seed %d took longer than %.0f s, stopping it."), Run.Seed, Timeout);
+				FPlatformProcess::TerminateProc(Run.Process, true);
+			}
+
+			FPlatformProcess::CloseProc(Run.Process);
+			Running.RemoveAtSwap(Index, 1, false);
+
+			++NumFinished;
+			UE_LOG(LogClaw, Display, TEXT("%d of %d runs done."), NumFinished, NumSeeds);
+		}
+	}
+
+	// one row per run, the totals go to the log
+	TArray<FString> Header;
+	for (const TCHAR* Column : Columns)
+	{
+		Header.Add(Column);
+	}
+	FString Sweep = FString::Join(Header, TEXT(",")) + TEXT("\n");
+
+	TArray<int32> FailedSeeds;
+	int32 NumRuns = 0;
+	double Completed = 0.0;
+	double Deaths = 0.0;
+	double DamageTaken = 0.0;
+	double Score = 0.0;
+	double MinScore = 0.0;
+	double MaxScore = 0.0;
+	double SpeedUp = 0.0;
+
+	for (int32 Seed = FirstSeed; Seed < EndSeed; ++Seed)
+	{
+		TMap<FString, double> Metrics;
+		if (!LoadRun(GetRunFilename(Directory, Seed), Metrics))
+		{
+			FailedSeeds.Add(Seed);
+			continue;
+		}
+
+		TArray<FString> Row;
+		for (const TCHAR* Column : Columns)
+		{
+			Row.Add(FString::Printf(TEXT("%g"), Metrics.FindRef(Column)));
+		}
+		Sweep += FString::Join(Row, TEXT(",")) + TEXT("\n");
+
+		const double RunScore = Metrics.FindRef(TEXT("Score"));
+		MinScore = NumRuns > 0 ? FMath::Min(MinScore, RunScore) : RunScore;
+		MaxScore = NumRuns > 0 ? FMath::Max(MaxScore, RunScore) : RunScore;
+
+		Completed += Metrics.FindRef(TEXT("Completed"));
+		Deaths += Metrics.FindRef(TEXT("Deaths"));
+		DamageTaken += Metrics.FindRef(TEXT("DamageTaken"));
+		Score += RunScore;
+		SpeedUp += Metrics.FindRef(TEXT("SpeedUp"));
+		++NumRuns;
+	}
+
+	const FString SweepFilename = Directory / TEXT("Sweep.csv");
+	FFileHelper::SaveStringToFile(Sweep, *SweepFilename);
+
+	const double Runs = FMath::Max(NumRuns, 1);
+	UE_LOG(LogClaw, Display, TEXT("%d of %d runs reported in %.1f s, written to %s."), NumRuns, NumSeeds, FPlatformTime::Seconds() - SweepStart, *SweepFilename);
+	UE_LOG(LogClaw, Display, TEXT("Completed %.1f%%, died %.1f%%, %.1f damage taken and a score of %.0f (%.0f to %.0f) per run, %.1fx real time."),
+		Completed / Runs * 100.0, Deaths / Runs * 100.0, DamageTaken / Runs, Score / Runs, MinScore, MaxScore, SpeedUp / Runs);
+
+	if (FailedSeeds.Num() > 0)
+	{
+		TArray<FString> Seeds;
+		for (int32 Seed : FailedSeeds)
+		{
+			Seeds.Add(FString::FromInt(Seed));
+		}
+		UE_LOG(LogClaw, Error, TEXT("%d runs failed, seeds %s."), FailedSeeds.Num(), *FString::Join(Seeds, TEXT(", ")));
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClawSimSweepCommandlet.generated.h"
+
+/**
+ * Plays a level with many seeds, each in its own headless game process, and sums up how
+ * the runs went.
+ *
+ * Up to -Jobs processes run at once, every one a ClawSimRunner with -nullrhi -nosound and
+ * fixed steps, so no GPU is needed. Once they're done, their results are gathered into
+ * Saved/SimRuns/<Name>/Sweep.csv (one run per row) and the completion rate, deaths, damage
+ * and score over all runs are logged. A run that crashes, hangs past -Timeout seconds or
+ * writes nothing counts as failed. Returns 1 when any run failed, so a script can flag it.
+ *
+ * Usage: -run=ClawSimSweep -Map=<Map> [-Seeds=100] [-FirstSeed=0] [-Jobs=<cores>] [-Name=Sweep]
+ *        [-SimSeconds=300] [-StepRate=120] [-Timeout=600] [-Replay=File]
+ */
+UCLASS()
+class UClawSimSweepCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClawSimSweepCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};
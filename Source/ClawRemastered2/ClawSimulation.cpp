@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSimulation.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "ClawEnemyManager.h"
+#include "ClawProjectileSystem.h"
+#include "ClawDamageSystem.h"
+#include "ClawRemastered2Character.h"
+#include "ClawRemastered2.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Fixed Step"), STAT_ClawFixedStep, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fixed Steps"), STAT_ClawFixedSteps, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped Steps"), STAT_ClawDroppedSteps, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawSimFixedStep(
+	TEXT("claw.Sim.FixedStep"),
+	0,
+	TEXT("1: the Claw gameplay runs in fixed steps of claw.Sim.StepRate, and is drawn in between.\n")
+	TEXT("0: every system advances by the frame time when it ticks.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawSimStepRate(
+	TEXT("claw.Sim.StepRate"),
+	120,
+	TEXT("Fixed steps per second of the gameplay, -ClawFixedStep=<Hz> overrides it.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawSimMaxStepsPerFrame(
+	TEXT("claw.Sim.MaxStepsPerFrame"),
+	8,
+	TEXT("The most steps a frame runs, a longer frame drops the rest of its time and the game slows down.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+void UClawSimulation::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// the systems need to know before anything registers with them
+	EnemyManager = Collection.InitializeDependency<UClawEnemyManager>();
+	ProjectileSystem = Collection.InitializeDependency<UClawProjectileSystem>();
+	DamageSystem = Collection.InitializeDependency<UClawDamageSystem>();
+
+	int32 StepRate = CVarClawSimStepRate.GetValueOnGameThread();
+	bFixedStep = FParse::Value(FCommandLine::Get(), TEXT("ClawFixedStep="), StepRate) || CVarClawSimFixedStep.GetValueOnGameThread() != 0;
+
+	if (!bFixedStep || !GetWorld()->IsGameWorld())
+	{
+		bFixedStep = false;
+		return;
+	}
+
+	if (GetWorld()->GetNetMode() != NM_Standalone)
+	{
+		UE_LOG(LogClaw, Warning, TEXT("Fixed steps only run in standalone games, %s ticks with the frames."), *GetWorld()->GetMapName());
+		bFixedStep = false;
+		return;
+	}
+
+	StepSeconds = 1.0f / FMath::Clamp(StepRate, 1, 1000);
+	MaxStepsPerFrame = FMath::Max(CVarClawSimMaxStepsPerFrame.GetValueOnGameThread(), 1);
+
+	EnemyManager->SetFixedStep(true);
+	ProjectileSystem->SetFixedStep(true);
+	DamageSystem->SetFixedStep(true);
+
+	UE_LOG(LogClaw, Display, TEXT("Running %s in fixed steps of %.4f s."), *GetWorld()->GetMapName(), StepSeconds);
+}
+
+void UClawSimulation::Deinitialize()
+{
+	Characters.Empty();
+	Timers.Empty();
+
+	Super::Deinitialize();
+}
+
+void UClawSimulation::Tick(float DeltaSeconds)
+{
+	Accumulator += DeltaSeconds;
+
+	// a frame of exactly N steps, like the fixed frames of a replay, mustn't lose one to rounding
+	const double Tolerance = StepSeconds * 1.0e-4;
+
+	int32 NumSteps = 0;
+	while (Accumulator + Tolerance >= StepSeconds)
+	{
+		if (NumSteps == MaxStepsPerFrame)
+		{
+			INC_DWORD_STAT_BY(STAT_ClawDroppedSteps, FMath::FloorToInt(Accumulator / StepSeconds));
+			Accumulator = 0.0;
+			break;
+		}
+
+		Step();
+		Accumulator = FMath::Max(Accumulator - StepSeconds, 0.0);
+		++NumSteps;
+	}
+
+	// nothing is drawn under -nullrhi, headless runs skip the sprites
+	if (FApp::CanEverRender())
+	{
+		Interpolate((float)(Accumulator / StepSeconds));
+	}
+}
+
+ETickableTickType UClawSimulation::GetTickableTickType() const
+{
+	// the class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UClawSimulation::IsTickable() const
+{
+	return bFixedStep;
+}
+
+TStatId UClawSimulation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClawSimulation, STATGROUP_Tickables);
+}
+
+UWorld* UClawSimulation::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+void UClawSimulation::AddCharacter(AClawRemastered2Character* Character)
+{
+	Characters.AddUnique(Character);
+}
+
+void UClawSimulation::RemoveCharacter(AClawRemastered2Character* Character)
+{
+	Characters.Remove(Character);
+}
+
+void UClawSimulation::SetTimer(uint32& InOutHandle, const FTimerDelegate& Delegate, float Delay)
+{
+	ClearTimer(InOutHandle);
+
+	FStepTimer Timer;
+	Timer.Id = NextTimerId++;
+	Timer.DueStep = StepCount + FMath::Max(FMath::RoundToInt(Delay / StepSeconds), 1);
+	Timer.Delegate = Delegate;
+
+	// ids only grow, so a timer goes after the ones due in the same step
+	int32 Index = Timers.Num();
+	while (Index > 0 && Timers[Index - 1].DueStep > Timer.DueStep)
+	{
+		--Index;
+	}
+	Timers.Insert(MoveTemp(Timer), Index);
+
+	InOutHandle = Timers[Index].Id;
+}
+
+void UClawSimulation::ClearTimer(uint32& InOutHandle)
+{
+	if (InOutHandle != 0)
+	{
+		Timers.RemoveAll([InOutHandle](const FStepTimer& Timer) { return Timer.Id == InOutHandle; });
+		InOutHandle = 0;
+	}
+}
+
+void UClawSimulation::Step()
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawFixedStep);
+
+	++StepCount;
+
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		if (AClawRemastered2Character* Character = Characters[Index].Get())
+		{
+			Character->SimulateStep(StepSeconds);
+		}
+	}
+
+	EnemyManager->SimulateStep(StepSeconds);
+
+	if (ProjectileSystem->GetNumProjectiles() > 0)
+	{
+		ProjectileSystem->Tick(StepSeconds);
+	}
+
+	// the hits of this step land before the next one starts
+	DamageSystem->ResolveHits();
+
+	FireTimers();
+
+	INC_DWORD_STAT(STAT_ClawFixedSteps);
+}
+
+void UClawSimulation::FireTimers()
+{
+	// a fired timer may set another, which is due one step later at the earliest
+	while (Timers.Num() > 0 && Timers[0].DueStep <= StepCount)
+	{
+		const FTimerDelegate Delegate = MoveTemp(Timers[0].Delegate);
+		Timers.RemoveAt(0, 1, false);
+		Delegate.ExecuteIfBound();
+	}
+}
+
+void UClawSimulation::Interpolate(float Alpha)
+{
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		if (AClawRemastered2Character* Character = Characters[Index].Get())
+		{
+			Character->InterpolateStep(Alpha);
+		}
+	}
+
+	EnemyManager->InterpolateStep(Alpha);
+}
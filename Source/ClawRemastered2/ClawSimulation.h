@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClawSimulation.generated.h"
+
+class AClawRemastered2Character;
+class UClawEnemyManager;
+class UClawProjectileSystem;
+class UClawDamageSystem;
+
+/**
+ * Runs the Claw gameplay in fixed steps, so the same input always gives the same state.
+ *
+ * With claw.Sim.FixedStep on, or -ClawFixedStep=<Hz> on the command line, the frame time is
+ * added to an accumulator and spent in steps of 1 / claw.Sim.StepRate seconds. Every step
+ * moves Claw with the input of that step, then the enemies, the bullets and the damage, in
+ * that order, and fires the gameplay timers that came due. None of those tick on their own
+ * while the simulation runs, and their timers count steps instead of seconds, so neither
+ * the frame rate nor the timer manager's ordering changes what happens.
+ *
+ * Between two steps the sprites are drawn where they would be at the leftover time of the
+ * accumulator, which keeps the motion smooth at any frame rate.
+ *
+ * Only standalone worlds step, a server and its clients don't share their steps.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawSimulation : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaSeconds) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	// true when the gameplay runs in fixed steps
+	bool IsFixedStep() const { return bFixedStep; }
+
+	float GetStepSeconds() const { return StepSeconds; }
+
+	// steps run since the world started
+	int64 GetStepCount() const { return StepCount; }
+
+	/** Steps Claw from now on, his actor and movement component stop ticking. */
+	void AddCharacter(AClawRemastered2Character* Character);
+	void RemoveCharacter(AClawRemastered2Character* Character);
+
+	/**
+	 * Calls Delegate once Delay seconds worth of steps ran, but at least one. Timers due in
+	 * the same step fire in the order they were set. InOutHandle is cleared first when it
+	 * still names a timer, and then names the new one.
+	 */
+	void SetTimer(uint32& InOutHandle, const FTimerDelegate& Delegate, float Delay);
+	void ClearTimer(uint32& InOutHandle);
+
+private:
+	void Step();
+	void FireTimers();
+	void Interpolate(float Alpha);
+
+	struct FStepTimer
+	{
+		uint32 Id;
+		int64 DueStep;
+		FTimerDelegate Delegate;
+	};
+
+	bool bFixedStep = false;
+	float StepSeconds = 1.0f / 120.0f;
+	int32 MaxStepsPerFrame = 8;
+
+	// frame time not spent in steps yet
+	double Accumulator = 0.0;
+	int64 StepCount = 0;
+
+	UPROPERTY()
+	UClawEnemyManager* EnemyManager;
+
+	UPROPERTY()
+	UClawProjectileSystem* ProjectileSystem;
+
+	UPROPERTY()
+	UClawDamageSystem* DamageSystem;
+
+	// stepped in the order they began play
+	TArray<TWeakObjectPtr<AClawRemastered2Character>> Characters;
+
+	// sorted by due step, then by id
+	TArray<FStepTimer> Timers;
+	uint32 NextTimerId = 1;
+};
@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSoundPool.h"
+#include "ClawRemastered2.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+#include "Sound/SoundWave.h"
+#include "ClawAudioBank.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Sound Play"), STAT_ClawSoundPlay, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sounds Played"), STAT_ClawSoundsPlayed, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sound Voices Spawned"), STAT_ClawSoundVoicesSpawned, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sound Voices Reused"), STAT_ClawSoundVoicesReused, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sound Voices Stolen"), STAT_ClawSoundVoicesStolen, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sound Cues Deduplicated"), STAT_ClawSoundCuesDeduplicated, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sound Cues Dropped"), STAT_ClawSoundCuesDropped, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawSoundPooled(
+	TEXT("claw.Sound.Pooled"),
+	1,
+	TEXT("1: 2D sounds play on the reused voices of the sound pool.\n")
+	TEXT("0: every 2D sound spawns its own audio component.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarClawSoundMaxConcurrency(
+	TEXT("claw.Sound.MaxConcurrency"),
+	4,
+	TEXT("How many instances of one sound may play at once, unless the sound has its own limit.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+// voices allocated for each category, the music only ever plays one track
+static const int32 VoicesPerCategory[(int32)EClawSoundCategory::Num] =
+{
+	1,	// Music
+	4,	// Voice
+	12,	// Weapon
+	6,	// Pickup
+	8,	// Effect
+};
+
+void UClawSoundPool::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bPooled = CVarClawSoundPooled.GetValueOnGameThread() != 0;
+	DefaultMaxConcurrency = FMath::Max(CVarClawSoundMaxConcurrency.GetValueOnGameThread(), 1);
+
+	Categories.SetNum((int32)EClawSoundCategory::Num);
+}
+
+void UClawSoundPool::Deinitialize()
+{
+	// the voice host is destroyed with the world
+	Categories.Empty();
+	VoiceHost = nullptr;
+	MaxConcurrencies.Empty();
+	StartFrames.Empty();
+
+	Super::Deinitialize();
+}
+
+UAudioComponent* UClawSoundPool::PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound, EClawSoundCategory Category, float Priority)
+{
+	if (!Sound)
+	{
+		return nullptr;
+	}
+
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawSoundPlay);
+	INC_DWORD_STAT(STAT_ClawSoundsPlayed);
+
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	UClawSoundPool* Pool = World ? World->GetSubsystem<UClawSoundPool>() : nullptr;
+
+	const uint64 Start = FPlatformTime::Cycles64();
+
+	UAudioComponent* Voice;
+	if (Pool && Pool->IsPooled())
+	{
+		Voice = Pool->Play(Sound, Category, Priority);
+	}
+	else
+	{
+		Voice = UGameplayStatics::SpawnSound2D(WorldContextObject, Sound, 1.0f, 1.0f, 0.0f);
+	}
+
+	// a cue that isn't loaded and decoded yet shows up in the banks' first play latencies
+	if (UClawAudioBanks* AudioBanks = World ? World->GetSubsystem<UClawAudioBanks>() : nullptr)
+	{
+		AudioBanks->RecordPlay(Sound, FPlatformTime::Cycles64() - Start);
+	}
+
+	return Voice;
+}
+
+UAudioComponent* UClawSoundPool::Play(USoundBase* Sound, EClawSoundCategory Category, float Priority, float VolumeMultiplier, float PitchMultiplier)
+{
+	if (!Sound)
+	{
+		return nullptr;
+	}
+
+	// a crowd of identical cues in one frame sounds like one louder cue at best
+	uint64& StartFrame = StartFrames.FindOrAdd(Sound, MAX_uint64);
+	if (StartFrame == GFrameCounter)
+	{
+		INC_DWORD_STAT(STAT_ClawSoundCuesDeduplicated);
+		return nullptr;
+	}
+
+	if (!VoiceHost)
+	{
+		AllocateVoices();
+	}
+
+	FClawSoundVoices& Voices = Categories[(int32)Category];
+	const double Now = GetNow();
+
+	const int32 Index = FindVoice(Voices, Sound, Priority, Now);
+	if (Index == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_ClawSoundCuesDropped);
+		return nullptr;
+	}
+
+	if (Voices.EndTimes[Index] > Now)
+	{
+		INC_DWORD_STAT(STAT_ClawSoundVoicesStolen);
+	}
+	INC_DWORD_STAT(STAT_ClawSoundVoicesReused);
+
+	StartFrame = GFrameCounter;
+
+	const float Pitch = FMath::Max(PitchMultiplier, KINDA_SMALL_NUMBER);
+
+	UAudioComponent* Voice = Voices.Components[Index];
+	Voice->SetSound(Sound);
+	Voice->SetVolumeMultiplier(VolumeMultiplier);
+	Voice->SetPitchMultiplier(Pitch);
+	Voice->Play();
+
+	// looping sounds report a huge duration and keep their voice until stopped
+	Voices.Sounds[Index] = Sound;
+	Voices.Priorities[Index] = Priority;
+	Voices.StartTimes[Index] = Now;
+	Voices.EndTimes[Index] = Now + Sound->GetDuration() / Pitch;
+
+	return Voice;
+}
+
+void UClawSoundPool::SetMaxConcurrency(USoundBase* Sound, int32 MaxConcurrency)
+{
+	MaxConcurrencies.Add(Sound, FMath::Max(MaxConcurrency, 1));
+}
+
+void UClawSoundPool::StopCategory(EClawSoundCategory Category)
+{
+	FClawSoundVoices& Voices = Categories[(int32)Category];
+	const double Now = GetNow();
+
+	for (int32 Index = 0; Index < Voices.Components.Num(); ++Index)
+	{
+		if (Voices.EndTimes[Index] > Now)
+		{
+			Voices.Components[Index]->Stop();
+			Voices.EndTimes[Index] = Now;
+		}
+	}
+}
+
+int32 UClawSoundPool::GetNumPlaying(EClawSoundCategory Category) const
+{
+	const FClawSoundVoices& Voices = Categories[(int32)Category];
+	const double Now = GetNow();
+
+	int32 NumPlaying = 0;
+	for (double EndTime : Voices.EndTimes)
+	{
+		NumPlaying += EndTime > Now ? 1 : 0;
+	}
+	return NumPlaying;
+}
+
+void UClawSoundPool::AllocateVoices()
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	VoiceHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+	for (int32 CategoryIndex = 0; CategoryIndex < Categories.Num(); ++CategoryIndex)
+	{
+		FClawSoundVoices& Voices = Categories[CategoryIndex];
+		const int32 NumVoices = VoicesPerCategory[CategoryIndex];
+
+		for (int32 Index = 0; Index < NumVoices; ++Index)
+		{
+			// set up like the components UGameplayStatics::CreateSound2D makes
+			UAudioComponent* Voice = NewObject<UAudioComponent>(VoiceHost);
+			Voice->bAutoActivate = false;
+			Voice->bAutoDestroy = false;
+			Voice->bAllowSpatialization = false;
+			Voice->bIsUISound = true;
+			Voice->bIgnoreForFlushing = true;
+			Voice->RegisterComponent();
+
+			Voices.Components.Add(Voice);
+			Voices.Sounds.Add(nullptr);
+			Voices.Priorities.Add(0.0f);
+			Voices.StartTimes.Add(0.0);
+			Voices.EndTimes.Add(0.0);
+		}
+
+		INC_DWORD_STAT_BY(STAT_ClawSoundVoicesSpawned, NumVoices);
+	}
+}
+
+int32 UClawSoundPool::FindVoice(const FClawSoundVoices& Voices, USoundBase* Sound, float Priority, double Now) const
+{
+	const int32* SoundMaxConcurrency = MaxConcurrencies.Find(Sound);
+	const int32 MaxConcurrency = SoundMaxConcurrency ? *SoundMaxConcurrency : DefaultMaxConcurrency;
+
+	int32 FreeVoice = INDEX_NONE;
+	int32 OldestInstance = INDEX_NONE;
+	int32 NumInstances = 0;
+	int32 Weakest = INDEX_NONE;
+
+	for (int32 Index = 0; Index < Voices.Components.Num(); ++Index)
+	{
+		if (Voices.EndTimes[Index] <= Now)
+		{
+			if (FreeVoice == INDEX_NONE)
+			{
+				FreeVoice = Index;
+			}
+			continue;
+		}
+
+		if (Voices.Sounds[Index] == Sound)
+		{
+			++NumInstances;
+			if (OldestInstance == INDEX_NONE || Voices.StartTimes[Index] < Voices.StartTimes[OldestInstance])
+			{
+				OldestInstance = Index;
+			}
+		}
+
+		// the lowest priority, the oldest of those on a tie
+		if (Weakest == INDEX_NONE
+			|| Voices.Priorities[Index] < Voices.Priorities[Weakest]
+			|| (Voices.Priorities[Index] == Voices.Priorities[Weakest] && Voices.StartTimes[Index] < Voices.StartTimes[Weakest]))
+		{
+			Weakest = Index;
+		}
+	}
+
+	// past its concurrency the sound replaces its own oldest instance
+	if (NumInstances >= MaxConcurrency)
+	{
+		return OldestInstance;
+	}
+
+	if (FreeVoice != INDEX_NONE)
+	{
+		return FreeVoice;
+	}
+
+	return Weakest != INDEX_NONE && Priority >= Voices.Priorities[Weakest] ? Weakest : INDEX_NONE;
+}
+
+double UClawSoundPool::GetNow() const
+{
+	return GetWorld()->GetAudioTimeSeconds();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Sound.Test
+
+namespace
+{
+	// plays bursts of silent sounds through a pool, the bookkeeping doesn't need an audio device
+	void TestSoundPool(const TArray<FString>& Args, UWorld* World)
+	{
+		UClawSoundPool* Pool = World ? World->GetSubsystem<UClawSoundPool>() : nullptr;
+		if (!Pool)
+		{
+			UE_LOG(LogClaw, Warning, TEXT("claw.Sound.Test needs a game world."));
+			return;
+		}
+
+		const int32 NumSounds = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 2) : 16;
+		const EClawSoundCategory Category = EClawSoundCategory::Effect;
+		const int32 NumVoices = VoicesPerCategory[(int32)Category];
+
+		TArray<USoundWave*> Sounds;
+		for (int32 Index = 0; Index < NumSounds; ++Index)
+		{
+			USoundWave* Sound = NewObject<USoundWave>(GetTransientPackage());
+			Sound->Duration = 60.0f;
+			Sounds.Add(Sound);
+		}
+
+		Pool->StopCategory(Category);
+
+		int32 NumFailed = 0;
+		auto Expect = [&NumFailed](bool bPassed, const TCHAR* What)
+		{
+			UE_LOG(LogClaw, Display, TEXT("  %s: %s"), bPassed ? TEXT("passed") : TEXT("FAILED"), What);
+			NumFailed += bPassed ? 0 : 1;
+		};
+
+		// the same sound twice in one frame
+		Expect(Pool->Play(Sounds[0], Category) != nullptr && Pool->Play(Sounds[0], Category) == nullptr, TEXT("same frame cues are deduplicated"));
+
+		// more sounds than voices, all of them at the same priority
+		for (int32 Index = 1; Index < NumSounds; ++Index)
+		{
+			Pool->Play(Sounds[Index], Category);
+		}
+		Expect(Pool->GetNumVoices(Category) == NumVoices && Pool->GetNumPlaying(Category) == FMath::Min(NumSounds, NumVoices), TEXT("voices are reused and never grow"));
+
+		// a quieter cue can't take a voice from the playing ones
+		USoundWave* Quiet = NewObject<USoundWave>(GetTransientPackage());
+		Quiet->Duration = 60.0f;
+		Expect(NumSounds < NumVoices || Pool->Play(Quiet, Category, 0.5f) == nullptr, TEXT("low priority cues are dropped when every voice is busy"));
+
+		USoundWave* Loud = NewObject<USoundWave>(GetTransientPackage());
+		Loud->Duration = 60.0f;
+		Expect(Pool->Play(Loud, Category, 2.0f) != nullptr, TEXT("high priority cues steal a voice"));
+
+		Pool->StopCategory(Category);
+
+		// the same sound over several frames, past its concurrency
+		Pool->SetMaxConcurrency(Sounds[1], 2);
+		UAudioComponent* First = nullptr;
+		for (int32 Index = 0; Index < 3; ++Index)
+		{
+			Pool->ForgetStartFrames();
+			UAudioComponent* Voice = Pool->Play(Sounds[1], Category);
+			First = First ? First : Voice;
+			if (Index == 2)
+			{
+				Expect(Voice == First && Pool->GetNumPlaying(Category) == 2, TEXT("a sound past its concurrency replaces its oldest instance"));
+			}
+		}
+
+		Pool->StopCategory(Category);
+
+		UE_LOG(LogClaw, Display, TEXT("Sound pool test: %d failed."), NumFailed);
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs TestSoundPoolCommand(
+		TEXT("claw.Sound.Test"),
+		TEXT("Checks the voice reuse, stealing, concurrency and deduplication of the sound pool, works with -nosound.\n")
+		TEXT("Usage: claw.Sound.Test [Sounds=16]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&TestSoundPool));
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawSoundPool.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+// what a 2D sound is, each category has its own voices
+UENUM()
+enum class EClawSoundCategory : uint8
+{
+	Music,
+	Voice,
+	Weapon,
+	Pickup,
+	Effect,
+
+	Num UMETA(Hidden)
+};
+
+// the voices of one category, in packed arrays that share the same index
+USTRUCT()
+struct FClawSoundVoices
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UAudioComponent*> Components;
+
+	UPROPERTY()
+	TArray<USoundBase*> Sounds;
+
+	TArray<float> Priorities;
+	TArray<double> StartTimes;
+
+	// audio time the sound ends at, a voice is free again after it
+	TArray<double> EndTimes;
+};
+
+/**
+ * Plays the 2D sounds of a world on a fixed set of reused audio components.
+ *
+ * UGameplayStatics::SpawnSound2D creates a new audio component for every cue. The pool
+ * allocates the voices of every category once, then plays each cue on a free voice of its
+ * category. When none is free, the voice playing the cue with the lowest priority is
+ * stolen, or the cue is dropped if its own priority is lower still. A sound plays at most
+ * its max concurrency at once, its oldest instance is stolen past that, and the same sound
+ * is only started once per frame. Whether a voice is busy is tracked from the length of its
+ * sound, so the pool behaves the same with the null audio device. Setting
+ * claw.Sound.Pooled to 0 goes back to spawning a component per cue.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawSoundPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Drop-in for UGameplayStatics::SpawnSound2D. Plays the sound on the pool of the world
+	 * when pooling is on, otherwise spawns a component for it the usual way.
+	 */
+	static UAudioComponent* PlaySound2D(const UObject* WorldContextObject, USoundBase* Sound, EClawSoundCategory Category, float Priority = 1.0f);
+
+	/**
+	 * Plays the sound on a voice of the category. Returns the voice, or nullptr when the cue
+	 * was dropped or already started this frame.
+	 */
+	UAudioComponent* Play(USoundBase* Sound, EClawSoundCategory Category, float Priority = 1.0f, float VolumeMultiplier = 1.0f, float PitchMultiplier = 1.0f);
+
+	/** How many instances of the sound may play at once, claw.Sound.MaxConcurrency when not set. */
+	void SetMaxConcurrency(USoundBase* Sound, int32 MaxConcurrency);
+
+	/** Lets every sound start again this frame, for tests that play one sound several times. */
+	void ForgetStartFrames() { StartFrames.Reset(); }
+
+	/** Stops every voice of the category. */
+	void StopCategory(EClawSoundCategory Category);
+
+	bool IsPooled() const { return bPooled; }
+
+	int32 GetNumVoices(EClawSoundCategory Category) const { return Categories[(int32)Category].Components.Num(); }
+	int32 GetNumPlaying(EClawSoundCategory Category) const;
+
+private:
+	void AllocateVoices();
+
+	// a free voice, a voice to steal, or INDEX_NONE to drop the cue
+	int32 FindVoice(const FClawSoundVoices& Voices, USoundBase* Sound, float Priority, double Now) const;
+
+	double GetNow() const;
+
+	bool bPooled = true;
+
+	int32 DefaultMaxConcurrency = 4;
+
+	UPROPERTY()
+	TArray<FClawSoundVoices> Categories;
+
+	// owns the voices
+	UPROPERTY()
+	AActor* VoiceHost;
+
+	TMap<USoundBase*, int32> MaxConcurrencies;
+
+	// frame each sound was last started on
+	TMap<USoundBase*, uint64> StartFrames;
+};
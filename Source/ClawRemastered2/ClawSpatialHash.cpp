@@ -0,0 +1,494 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSpatialHash.h"
+#include "ClawRemastered2.h"
+#include "Components/BoxComponent.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "ClawStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spatial Hash Query"), STAT_ClawSpatialQuery, STATGROUP_Claw);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spatial Hash Queries"), STAT_ClawSpatialQueries, STATGROUP_Claw);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spatial Hash Entries"), STAT_ClawSpatialEntries, STATGROUP_Claw);
+
+static TAutoConsoleVariable<int32> CVarClawSpatialQueries(
+	TEXT("claw.Spatial.Queries"),
+	1,
+	TEXT("1: sight, reach and pickups are checked with the spatial hash.\n")
+	TEXT("0: they are checked with trigger box overlaps.\n")
+	TEXT("Read when a world starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarClawSpatialCellSize(
+	TEXT("claw.Spatial.CellSize"),
+	128.0f,
+	TEXT("Size of the cells of the spatial hash, in world units. Read when a world starts."),
+	ECVF_Default);
+
+namespace
+{
+	bool Overlaps(const FBox2D& A, const FBox2D& B)
+	{
+		return A.Min.X <= B.Max.X && A.Max.X >= B.Min.X && A.Min.Y <= B.Max.Y && A.Max.Y >= B.Min.Y;
+	}
+
+	// returns where along the segment it enters the box, from 0 to 1
+	bool SegmentEntersBox(const FVector2D& Start, const FVector2D& Delta, const FBox2D& Box, float& OutTime)
+	{
+		float Enter = 0.0f;
+		float Exit = 1.0f;
+
+		for (int32 Axis = 0; Axis < 2; ++Axis)
+		{
+			if (FMath::Abs(Delta[Axis]) < KINDA_SMALL_NUMBER)
+			{
+				if (Start[Axis] < Box.Min[Axis] || Start[Axis] > Box.Max[Axis])
+				{
+					return false;
+				}
+				continue;
+			}
+
+			const float InvDelta = 1.0f / Delta[Axis];
+			float Near = (Box.Min[Axis] - Start[Axis]) * InvDelta;
+			float Far = (Box.Max[Axis] - Start[Axis]) * InvDelta;
+			if (Near > Far)
+			{
+				Swap(Near, Far);
+			}
+
+			Enter = FMath::Max(Enter, Near);
+			Exit = FMath::Min(Exit, Far);
+			if (Enter > Exit)
+			{
+				return false;
+			}
+		}
+
+		OutTime = Enter;
+		return true;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FClawSpatialGrid
+
+FClawSpatialGrid::FClawSpatialGrid(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+	, InvCellSize(1.0f / FMath::Max(InCellSize, 1.0f))
+{
+}
+
+int32 FClawSpatialGrid::Insert(const FBox2D& Bounds, uint8 Channels)
+{
+	check(Channels != 0);
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Handle = Entries.AddUninitialized();
+		Stamps.Add(0);
+	}
+
+	FEntry& Entry = Entries[Handle];
+	Entry.Bounds = Bounds;
+	Entry.MinCell = ToCell(Bounds.Min);
+	Entry.MaxCell = ToCell(Bounds.Max);
+	Entry.Channels = Channels;
+
+	Link(Handle);
+
+	return Handle;
+}
+
+void FClawSpatialGrid::Move(int32 Handle, const FBox2D& Bounds)
+{
+	check(IsValid(Handle));
+
+	FEntry& Entry = Entries[Handle];
+	Entry.Bounds = Bounds;
+
+	// most moves stay inside the same cells
+	const FIntPoint MinCell = ToCell(Bounds.Min);
+	const FIntPoint MaxCell = ToCell(Bounds.Max);
+	if (MinCell == Entry.MinCell && MaxCell == Entry.MaxCell)
+	{
+		return;
+	}
+
+	Unlink(Handle);
+	Entry.MinCell = MinCell;
+	Entry.MaxCell = MaxCell;
+	Link(Handle);
+}
+
+void FClawSpatialGrid::Remove(int32 Handle)
+{
+	if (!IsValid(Handle))
+	{
+		return;
+	}
+
+	Unlink(Handle);
+	Entries[Handle].Channels = 0;
+	FreeHandles.Add(Handle);
+}
+
+void FClawSpatialGrid::Empty()
+{
+	Entries.Empty();
+	FreeHandles.Empty();
+	Cells.Empty();
+	Stamps.Empty();
+	Stamp = 0;
+}
+
+void FClawSpatialGrid::QueryBox(const FBox2D& Box, uint8 Channels, TArray<int32>& OutHandles) const
+{
+	const FIntPoint MinCell = ToCell(Box.Min);
+	const FIntPoint MaxCell = ToCell(Box.Max);
+	const uint32 QueryStamp = NextStamp();
+
+	for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+	{
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			const TArray<int32>* Cell = Cells.Find(FIntPoint(CellX, CellY));
+			if (!Cell)
+			{
+				continue;
+			}
+
+			// entries that span several cells are only looked at once
+			for (int32 Handle : *Cell)
+			{
+				if (Stamps[Handle] == QueryStamp)
+				{
+					continue;
+				}
+				Stamps[Handle] = QueryStamp;
+
+				const FEntry& Entry = Entries[Handle];
+				if ((Entry.Channels & Channels) != 0 && Overlaps(Entry.Bounds, Box))
+				{
+					OutHandles.Add(Handle);
+				}
+			}
+		}
+	}
+}
+
+bool FClawSpatialGrid::Raycast(const FVector2D& Start, const FVector2D& End, uint8 Channels, int32& OutHandle, float& OutTime) const
+{
+	const FVector2D Delta = End - Start;
+	const uint32 QueryStamp = NextStamp();
+
+	FIntPoint Cell = ToCell(Start);
+	const FIntPoint EndCell = ToCell(End);
+
+	// walk the cells the segment crosses in order, see "A Fast Voxel Traversal Algorithm" by Amanatides and Woo
+	const int32 StepX = Delta.X > 0.0f ? 1 : -1;
+	const int32 StepY = Delta.Y > 0.0f ? 1 : -1;
+
+	const float DeltaTimeX = Delta.X != 0.0f ? FMath::Abs(CellSize / Delta.X) : MAX_flt;
+	const float DeltaTimeY = Delta.Y != 0.0f ? FMath::Abs(CellSize / Delta.Y) : MAX_flt;
+
+	const float NextBoundaryX = (Cell.X + (StepX > 0 ? 1 : 0)) * CellSize;
+	const float NextBoundaryY = (Cell.Y + (StepY > 0 ? 1 : 0)) * CellSize;
+
+	float TimeX = Delta.X != 0.0f ? (NextBoundaryX - Start.X) / Delta.X : MAX_flt;
+	float TimeY = Delta.Y != 0.0f ? (NextBoundaryY - Start.Y) / Delta.Y : MAX_flt;
+
+	OutHandle = INDEX_NONE;
+	OutTime = MAX_flt;
+
+	const int32 MaxSteps = FMath::Abs(EndCell.X - Cell.X) + FMath::Abs(EndCell.Y - Cell.Y) + 1;
+	for (int32 Step = 0; Step < MaxSteps; ++Step)
+	{
+		if (const TArray<int32>* Handles = Cells.Find(Cell))
+		{
+			for (int32 Handle : *Handles)
+			{
+				if (Stamps[Handle] == QueryStamp)
+				{
+					continue;
+				}
+				Stamps[Handle] = QueryStamp;
+
+				float Time;
+				const FEntry& Entry = Entries[Handle];
+				if ((Entry.Channels & Channels) != 0 && SegmentEntersBox(Start, Delta, Entry.Bounds, Time) && Time < OutTime)
+				{
+					OutHandle = Handle;
+					OutTime = Time;
+				}
+			}
+		}
+
+		// nothing in a later cell can be hit before a hit inside this one
+		if (OutHandle != INDEX_NONE && OutTime <= FMath::Min(TimeX, TimeY))
+		{
+			break;
+		}
+
+		if (TimeX < TimeY)
+		{
+			Cell.X += StepX;
+			TimeX += DeltaTimeX;
+		}
+		else
+		{
+			Cell.Y += StepY;
+			TimeY += DeltaTimeY;
+		}
+	}
+
+	return OutHandle != INDEX_NONE;
+}
+
+FIntPoint FClawSpatialGrid::ToCell(const FVector2D& Point) const
+{
+	return FIntPoint(FMath::FloorToInt(Point.X * InvCellSize), FMath::FloorToInt(Point.Y * InvCellSize));
+}
+
+void FClawSpatialGrid::Link(int32 Handle)
+{
+	const FEntry& Entry = Entries[Handle];
+	for (int32 CellY = Entry.MinCell.Y; CellY <= Entry.MaxCell.Y; ++CellY)
+	{
+		for (int32 CellX = Entry.MinCell.X; CellX <= Entry.MaxCell.X; ++CellX)
+		{
+			Cells.FindOrAdd(FIntPoint(CellX, CellY)).Add(Handle);
+		}
+	}
+}
+
+void FClawSpatialGrid::Unlink(int32 Handle)
+{
+	const FEntry& Entry = Entries[Handle];
+	for (int32 CellY = Entry.MinCell.Y; CellY <= Entry.MaxCell.Y; ++CellY)
+	{
+		for (int32 CellX = Entry.MinCell.X; CellX <= Entry.MaxCell.X; ++CellX)
+		{
+			const FIntPoint Key(CellX, CellY);
+			TArray<int32>& Cell = Cells.FindChecked(Key);
+			Cell.RemoveSingleSwap(Handle, false);
+
+			// empty cells are kept for whoever walks back into them, until they pile up
+			if (Cell.Num() == 0 && Cells.Num() > Entries.Num() * 4)
+			{
+				Cells.Remove(Key);
+			}
+		}
+	}
+}
+
+uint32 FClawSpatialGrid::NextStamp() const
+{
+	if (++Stamp == 0)
+	{
+		// wrapped around, forget every old stamp
+		FMemory::Memzero(Stamps.GetData(), Stamps.Num() * sizeof(uint32));
+		Stamp = 1;
+	}
+	return Stamp;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UClawSpatialHash
+
+void UClawSpatialHash::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bQuerying = CVarClawSpatialQueries.GetValueOnGameThread() != 0;
+	Grid = FClawSpatialGrid(CVarClawSpatialCellSize.GetValueOnGameThread());
+}
+
+void UClawSpatialHash::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ClawSpatialEntries, Grid.Num());
+
+	Grid.Empty();
+	Actors.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UClawSpatialHash::Insert(AActor* Actor, const FBox2D& Bounds, uint8 Channels)
+{
+	const int32 Handle = Grid.Insert(Bounds, Channels);
+	if (Handle >= Actors.Num())
+	{
+		Actors.SetNumZeroed(Handle + 1);
+	}
+	Actors[Handle] = Actor;
+
+	INC_DWORD_STAT(STAT_ClawSpatialEntries);
+
+	return Handle;
+}
+
+void UClawSpatialHash::Move(int32 Handle, const FBox2D& Bounds)
+{
+	Grid.Move(Handle, Bounds);
+}
+
+void UClawSpatialHash::Remove(int32 Handle)
+{
+	if (!Grid.IsValid(Handle))
+	{
+		return;
+	}
+
+	Grid.Remove(Handle);
+	Actors[Handle] = nullptr;
+
+	DEC_DWORD_STAT(STAT_ClawSpatialEntries);
+}
+
+void UClawSpatialHash::QueryBox(const FBox2D& Box, uint8 Channels, TArray<AActor*>& OutActors) const
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawSpatialQuery);
+	INC_DWORD_STAT(STAT_ClawSpatialQueries);
+
+	QueryHandles.Reset();
+	Grid.QueryBox(Box, Channels, QueryHandles);
+
+	for (int32 Handle : QueryHandles)
+	{
+		if (Actors[Handle])
+		{
+			OutActors.Add(Actors[Handle]);
+		}
+	}
+}
+
+AActor* UClawSpatialHash::Raycast(const FVector2D& Start, const FVector2D& End, uint8 Channels) const
+{
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawSpatialQuery);
+	INC_DWORD_STAT(STAT_ClawSpatialQueries);
+
+	int32 Handle;
+	float Time;
+	return Grid.Raycast(Start, End, Channels, Handle, Time) ? Actors[Handle] : nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// claw.Spatial.Benchmark
+
+namespace
+{
+	// boxes the size of enemies spread over a level, like the sight checks of a crowded level
+	void BenchmarkSpatialQueries(const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 MaxObjects = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 4096;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000;
+
+		const float LevelLength = 20000.0f;
+		const float LevelHeight = 2000.0f;
+		const FVector ObjectExtent(32.0f, 32.0f, 60.0f);
+		const FVector QueryExtent(300.0f, 20.0f, 60.0f);
+
+		UE_LOG(LogClaw, Display, TEXT("Spatial benchmark, %d queries per object count:"), NumQueries);
+
+		for (int32 NumObjects = 64; NumObjects <= MaxObjects; NumObjects *= 4)
+		{
+			FRandomStream Random(NumObjects);
+
+			TArray<FVector> Locations;
+			for (int32 Index = 0; Index < NumObjects; ++Index)
+			{
+				Locations.Add(FVector(Random.FRandRange(0.0f, LevelLength), 0.0f, Random.FRandRange(0.0f, LevelHeight)));
+			}
+
+			TArray<FVector> QueryLocations;
+			for (int32 Index = 0; Index < NumQueries; ++Index)
+			{
+				QueryLocations.Add(FVector(Random.FRandRange(0.0f, LevelLength), 0.0f, Random.FRandRange(0.0f, LevelHeight)));
+			}
+
+			// the spatial hash
+			FClawSpatialGrid Grid;
+			for (const FVector& Location : Locations)
+			{
+				Grid.Insert(FClawSpatialGrid::MakeBounds(Location, ObjectExtent), CLAW_SpatialEnemy);
+			}
+
+			TArray<int32> Found;
+			int64 HashHits = 0;
+
+			uint64 Start = FPlatformTime::Cycles64();
+			for (const FVector& Location : QueryLocations)
+			{
+				Found.Reset();
+				Grid.QueryBox(FClawSpatialGrid::MakeBounds(Location, QueryExtent), CLAW_SpatialEnemy, Found);
+				HashHits += Found.Num();
+			}
+			const double HashMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / NumQueries;
+
+			// the trigger boxes, a sight box moved around between trigger actors like the enemies do
+			double OverlapMicroseconds = 0.0;
+			int64 OverlapHits = 0;
+			if (World)
+			{
+				auto SpawnTrigger = [World](const FVector& Location, const FVector& Extent) -> UBoxComponent*
+				{
+					FActorSpawnParameters SpawnParameters;
+					SpawnParameters.ObjectFlags |= RF_Transient;
+					AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(Location), SpawnParameters);
+
+					UBoxComponent* Box = NewObject<UBoxComponent>(Actor);
+					Box->SetBoxExtent(Extent);
+					Box->SetCollisionProfileName("Trigger");
+					Actor->SetRootComponent(Box);
+					Box->SetWorldLocation(Location);
+					Box->RegisterComponent();
+					return Box;
+				};
+
+				TArray<AActor*> Triggers;
+				for (const FVector& Location : Locations)
+				{
+					Triggers.Add(SpawnTrigger(Location, ObjectExtent)->GetOwner());
+				}
+
+				UBoxComponent* Probe = SpawnTrigger(FVector(-LevelLength, 0.0f, 0.0f), QueryExtent);
+
+				TArray<UPrimitiveComponent*> Overlapping;
+
+				Start = FPlatformTime::Cycles64();
+				for (const FVector& Location : QueryLocations)
+				{
+					Probe->SetWorldLocation(Location);
+					Probe->GetOverlappingComponents(Overlapping);
+					OverlapHits += Overlapping.Num();
+				}
+				OverlapMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Start) * 1000.0 / NumQueries;
+
+				Probe->GetOwner()->Destroy();
+				for (AActor* Trigger : Triggers)
+				{
+					Trigger->Destroy();
+				}
+			}
+
+			UE_LOG(LogClaw, Display, TEXT("  %6d objects: spatial hash %.3f us per query (%lld found), trigger overlaps %.3f us per query (%lld found)"),
+				NumObjects, HashMicroseconds, HashHits, OverlapMicroseconds, OverlapHits);
+		}
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs BenchmarkSpatialQueriesCommand(
+		TEXT("claw.Spatial.Benchmark"),
+		TEXT("Compares box queries on the spatial hash with moving a trigger box, for growing object counts.\n")
+		TEXT("Usage: claw.Spatial.Benchmark [MaxObjects=4096] [Queries=1000]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkSpatialQueries));
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawSpatialHash.generated.h"
+
+// what an entry of the spatial hash is, queries only return the channels they ask for
+enum EClawSpatialChannel : uint8
+{
+	CLAW_SpatialClaw = 1 << 0,
+	CLAW_SpatialEnemy = 1 << 1,
+	CLAW_SpatialPickup = 1 << 2,
+
+	CLAW_SpatialAll = 0xff
+};
+
+/**
+ * A uniform grid of square cells on the XZ plane, hashed so only the cells that hold
+ * something take memory. Entries are boxes that are linked into every cell they touch.
+ */
+struct CLAWREMASTERED2_API FClawSpatialGrid
+{
+	explicit FClawSpatialGrid(float InCellSize = 128.0f);
+
+	int32 Insert(const FBox2D& Bounds, uint8 Channels);
+
+	/** Moves an entry, only touching the cells when it crossed into other ones. */
+	void Move(int32 Handle, const FBox2D& Bounds);
+
+	void Remove(int32 Handle);
+	void Empty();
+
+	/** Adds the entries of the channels that overlap Box to OutHandles, each one once. */
+	void QueryBox(const FBox2D& Box, uint8 Channels, TArray<int32>& OutHandles) const;
+
+	/** Finds the first entry of the channels the segment from Start to End runs into. */
+	bool Raycast(const FVector2D& Start, const FVector2D& End, uint8 Channels, int32& OutHandle, float& OutTime) const;
+
+	bool IsValid(int32 Handle) const { return Entries.IsValidIndex(Handle) && Entries[Handle].Channels != 0; }
+	const FBox2D& GetBounds(int32 Handle) const { return Entries[Handle].Bounds; }
+
+	int32 Num() const { return Entries.Num() - FreeHandles.Num(); }
+
+	float GetCellSize() const { return CellSize; }
+
+	// a box on the XZ plane from a world space center and extent
+	static FBox2D MakeBounds(const FVector& Center, const FVector& Extent)
+	{
+		return FBox2D(FVector2D(Center.X - Extent.X, Center.Z - Extent.Z), FVector2D(Center.X + Extent.X, Center.Z + Extent.Z));
+	}
+
+private:
+	struct FEntry
+	{
+		FBox2D Bounds;
+		FIntPoint MinCell;
+		FIntPoint MaxCell;
+
+		// 0 for free entries
+		uint8 Channels;
+	};
+
+	FIntPoint ToCell(const FVector2D& Point) const;
+
+	void Link(int32 Handle);
+	void Unlink(int32 Handle);
+
+	// starts a query, entries stamped with the returned value were already visited
+	uint32 NextStamp() const;
+
+	float CellSize;
+	float InvCellSize;
+
+	TArray<FEntry> Entries;
+	TArray<int32> FreeHandles;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	// the query that last visited each entry
+	mutable TArray<uint32> Stamps;
+	mutable uint32 Stamp = 0;
+};
+
+/**
+ * The spatial hash of the world, used for gameplay queries instead of trigger boxes.
+ *
+ * The game is locked to the XZ plane, so sight, reach and pickup checks only need 2D
+ * boxes. Claw, the enemies and the pickups keep their box in here and gameplay asks the
+ * hash directly, so the trigger boxes need no physics body nor an overlap update on every
+ * move. Setting claw.Spatial.Queries to 0 goes back to the trigger box overlaps.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawSpatialHash : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	int32 Insert(AActor* Actor, const FBox2D& Bounds, uint8 Channels);
+	void Move(int32 Handle, const FBox2D& Bounds);
+	void Remove(int32 Handle);
+
+	/** Adds the actors of the channels that overlap Box to OutActors. */
+	void QueryBox(const FBox2D& Box, uint8 Channels, TArray<AActor*>& OutActors) const;
+
+	/** Returns the first actor of the channels the segment from Start to End runs into. */
+	AActor* Raycast(const FVector2D& Start, const FVector2D& End, uint8 Channels) const;
+
+	// true when gameplay uses the hash instead of trigger box overlaps
+	bool IsQuerying() const { return bQuerying; }
+
+	const FClawSpatialGrid& GetGrid() const { return Grid; }
+
+private:
+	bool bQuerying = true;
+
+	FClawSpatialGrid Grid;
+
+	// indexed by the handles of the grid
+	UPROPERTY()
+	TArray<AActor*> Actors;
+
+	mutable TArray<int32> QueryHandles;
+};
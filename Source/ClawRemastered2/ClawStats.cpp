@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawStats.h"
+
+bool FClawScopeTimers::bEnabled = false;
+TArray<FString> FClawScopeTimers::Names;
+TArray<uint64> FClawScopeTimers::FrameCycles;
+
+int32 FClawScopeTimers::Register(const TCHAR* StatName)
+{
+	check(IsInGameThread());
+
+	// STAT_ClawDamageResolve is listed as DamageResolve
+	FString Name = StatName;
+	Name.RemoveFromStart(TEXT("STAT_Claw"));
+
+	const int32 Existing = Names.IndexOfByKey(Name);
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	FrameCycles.Add(0);
+	return Names.Add(MoveTemp(Name));
+}
+
+void FClawScopeTimers::SetEnabled(bool bInEnabled)
+{
+	bEnabled = bInEnabled;
+	FMemory::Memzero(FrameCycles.GetData(), FrameCycles.Num() * sizeof(uint64));
+}
+
+void FClawScopeTimers::Add(int32 Index, uint64 Cycles)
+{
+	// the frame is the game thread's
+	if (IsInGameThread())
+	{
+		FrameCycles[Index] += Cycles;
+	}
+}
+
+void FClawScopeTimers::EndFrame(TArray<double>& OutMilliseconds)
+{
+	OutMilliseconds.SetNumUninitialized(FrameCycles.Num());
+	for (int32 Index = 0; Index < FrameCycles.Num(); ++Index)
+	{
+		OutMilliseconds[Index] = FPlatformTime::ToMilliseconds64(FrameCycles[Index]);
+		FrameCycles[Index] = 0;
+	}
+}
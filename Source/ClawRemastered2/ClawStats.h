@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/**
+ * Stat group shared by every gameplay system in the module.
+ * Use "stat Claw" in the console to display it.
+ */
+DECLARE_STATS_GROUP(TEXT("Claw"), STATGROUP_Claw, STATCAT_Advanced);
+
+// the overlap handlers are spread over every actor class, they share their stats
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Overlap Handling"), STAT_ClawOverlaps, STATGROUP_Claw, CLAWREMASTERED2_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlaps Handled"), STAT_ClawOverlapsHandled, STATGROUP_Claw, CLAWREMASTERED2_API);
+
+/**
+ * Game thread time of the Claw scopes per frame, collected while the benchmark runs. Unlike
+ * the stats it works in Test builds, and costs one branch per scope when it's off.
+ */
+struct CLAWREMASTERED2_API FClawScopeTimers
+{
+	/** Returns the index of the scope, scopes of the same stat share it. */
+	static int32 Register(const TCHAR* StatName);
+
+	static bool IsEnabled() { return bEnabled; }
+	static void SetEnabled(bool bInEnabled);
+
+	static void Add(int32 Index, uint64 Cycles);
+
+	/** Moves the milliseconds of every scope this frame to OutMilliseconds, by index. */
+	static void EndFrame(TArray<double>& OutMilliseconds);
+
+	static const TArray<FString>& GetNames() { return Names; }
+
+private:
+	static bool bEnabled;
+	static TArray<FString> Names;
+	static TArray<uint64> FrameCycles;
+};
+
+// times one scope for FClawScopeTimers
+struct FClawScopeTimer
+{
+	explicit FClawScopeTimer(int32 InIndex)
+		: Index(InIndex)
+		, Start(FClawScopeTimers::IsEnabled() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FClawScopeTimer()
+	{
+		if (Start)
+		{
+			FClawScopeTimers::Add(Index, FPlatformTime::Cycles64() - Start);
+		}
+	}
+
+private:
+	int32 Index;
+	uint64 Start;
+};
+
+/**
+ * Counts the scope in a cycle stat of STATGROUP_Claw and shows it as a CPU scope of the same
+ * name in Unreal Insights, so "stat Claw" and a trace line up. The benchmark times it too.
+ */
+#define CLAW_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Stat); \
+	static const int32 PREPROCESSOR_JOIN(ClawScopeIndex_, Stat) = FClawScopeTimers::Register(TEXT(#Stat)); \
+	FClawScopeTimer PREPROCESSOR_JOIN(ClawScopeTimer_, Stat)(PREPROCESSOR_JOIN(ClawScopeIndex_, Stat))
+
+/** Starts every overlap handler. */
+#define CLAW_SCOPE_OVERLAP() \
+	CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawOverlaps); \
+	INC_DWORD_STAT(STAT_ClawOverlapsHandled)
@@ -0,0 +1,234 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawTileCollision.h"
+#include "ClawLevelStreamer.h"
+#include "ClawTileLevel.h"
+
+namespace
+{
+	// boxes that only touch a cell don't overlap it
+	const float EdgeTolerance = 1.0e-4f;
+
+	int32 FirstCell(float Min) { return FMath::FloorToInt(Min + EdgeTolerance); }
+	int32 LastCell(float Max) { return FMath::CeilToInt(Max - EdgeTolerance) - 1; }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FClawTileGrid
+
+void FClawTileGrid::Init(const FVector2D& InOrigin, int32 InWidth, int32 InHeight, float InTileSize)
+{
+	Origin = InOrigin;
+	Width = InWidth;
+	Height = InHeight;
+	TileSize = InTileSize;
+
+	Flags.Init(0, Width * Height);
+}
+
+void FClawTileGrid::Empty()
+{
+	Width = 0;
+	Height = 0;
+	Flags.Empty();
+}
+
+uint8 FClawTileGrid::OverlapFlags(const FBox2D& Box) const
+{
+	const FVector2D Min = ToGrid(FVector2D(Box.Min.X, Box.Max.Y));
+	const FVector2D Max = ToGrid(FVector2D(Box.Max.X, Box.Min.Y));
+
+	uint8 Result = 0;
+	for (int32 Row = FMath::Max(FirstCell(Min.Y), 0); Row <= FMath::Min(LastCell(Max.Y), Height - 1); ++Row)
+	{
+		for (int32 Column = FMath::Max(FirstCell(Min.X), 0); Column <= FMath::Min(LastCell(Max.X), Width - 1); ++Column)
+		{
+			Result |= Flags[Row * Width + Column];
+		}
+	}
+	return Result;
+}
+
+bool FClawTileGrid::IsSpanBlocked(bool bColumn, int32 Line, float SpanMin, float SpanMax, uint8 Mask, FIntPoint& OutCell, uint8& OutFlags) const
+{
+	for (int32 Cell = FirstCell(SpanMin); Cell <= LastCell(SpanMax); ++Cell)
+	{
+		const FIntPoint Point = bColumn ? FIntPoint(Line, Cell) : FIntPoint(Cell, Line);
+		const uint8 CellFlags = GetFlags(Point.X, Point.Y);
+		if (CellFlags & Mask)
+		{
+			OutCell = Point;
+			OutFlags = CellFlags;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FClawTileGrid::SweepBox(const FBox2D& Box, const FVector2D& Delta, uint8 Mask, FClawTileHit& OutHit) const
+{
+	OutHit = FClawTileHit();
+	if (Flags.Num() == 0 || Delta.IsNearlyZero())
+	{
+		return false;
+	}
+
+	// in grid space Y goes down, so the top of the box is its min
+	const FVector2D Min = ToGrid(FVector2D(Box.Min.X, Box.Max.Y));
+	const FVector2D Max = ToGrid(FVector2D(Box.Max.X, Box.Min.Y));
+	const FVector2D Move(Delta.X / TileSize, -Delta.Y / TileSize);
+
+	const int32 StepX = Move.X > 0.0f ? 1 : (Move.X < 0.0f ? -1 : 0);
+	const int32 StepY = Move.Y > 0.0f ? 1 : (Move.Y < 0.0f ? -1 : 0);
+
+	// the next grid line each leading edge crosses, and when it does
+	int32 LineX = 0;
+	float NextX = BIG_NUMBER;
+	float StepTimeX = BIG_NUMBER;
+	if (StepX != 0)
+	{
+		const float Lead = StepX > 0 ? Max.X : Min.X;
+		LineX = StepX > 0 ? FMath::CeilToInt(Lead - EdgeTolerance) : FMath::FloorToInt(Lead + EdgeTolerance);
+		NextX = (LineX - Lead) / Move.X;
+		StepTimeX = 1.0f / FMath::Abs(Move.X);
+	}
+
+	int32 LineY = 0;
+	float NextY = BIG_NUMBER;
+	float StepTimeY = BIG_NUMBER;
+	if (StepY != 0)
+	{
+		const float Lead = StepY > 0 ? Max.Y : Min.Y;
+		LineY = StepY > 0 ? FMath::CeilToInt(Lead - EdgeTolerance) : FMath::FloorToInt(Lead + EdgeTolerance);
+		NextY = (LineY - Lead) / Move.Y;
+		StepTimeY = 1.0f / FMath::Abs(Move.Y);
+	}
+
+	// one-way cells only stop the bottom edge coming down onto them
+	const uint8 SideMask = Mask & ~CLAW_TileOneWay;
+	const uint8 VerticalMask = StepY > 0 ? Mask : SideMask;
+
+	while (true)
+	{
+		const bool bCrossX = NextX <= NextY;
+		const float Time = bCrossX ? NextX : NextY;
+		if (Time > 1.0f)
+		{
+			return false;
+		}
+
+		if (bCrossX)
+		{
+			const int32 Column = StepX > 0 ? LineX : LineX - 1;
+			if (IsSpanBlocked(true, Column, Min.Y + Move.Y * Time, Max.Y + Move.Y * Time, SideMask, OutHit.Cell, OutHit.Flags))
+			{
+				OutHit.Time = Time;
+				OutHit.Normal = FVector2D(-StepX, 0.0f);
+				return true;
+			}
+
+			LineX += StepX;
+			NextX += StepTimeX;
+		}
+		else
+		{
+			const int32 Row = StepY > 0 ? LineY : LineY - 1;
+			if (IsSpanBlocked(false, Row, Min.X + Move.X * Time, Max.X + Move.X * Time, VerticalMask, OutHit.Cell, OutHit.Flags))
+			{
+				OutHit.Time = Time;
+
+				// back to the XZ plane, where Z goes up
+				OutHit.Normal = FVector2D(0.0f, StepY);
+				return true;
+			}
+
+			LineY += StepY;
+			NextY += StepTimeY;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UClawTileCollision
+
+void UClawTileCollision::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelStreamer = Collection.InitializeDependency<UClawLevelStreamer>();
+	ChunkStreamedHandle = LevelStreamer->OnChunkStreamed().AddUObject(this, &UClawTileCollision::OnChunkStreamed);
+}
+
+void UClawTileCollision::Deinitialize()
+{
+	LevelStreamer->OnChunkStreamed().Remove(ChunkStreamedHandle);
+	Grid.Empty();
+
+	Super::Deinitialize();
+}
+
+void UClawTileCollision::OnChunkStreamed(int32 Chunk, int32 FirstColumn, int32 LastColumn, bool bResident)
+{
+	const AClawTileLevel* Level = LevelStreamer->GetLevel();
+	const FClawTileMap* TileMap = LevelStreamer->GetTileMap();
+
+	if (Grid.IsEmpty())
+	{
+		if (!bResident)
+		{
+			return;
+		}
+
+		const FVector Origin = Level->GetActorLocation();
+		Grid.Init(FVector2D(Origin.X, Origin.Z), TileMap->Width, TileMap->Height, TileMap->TileSize);
+	}
+
+	for (int32 Row = 0; Row < Grid.Height; ++Row)
+	{
+		for (int32 Column = FirstColumn; Column <= LastColumn; ++Column)
+		{
+			Grid.SetFlags(Column, Row, bResident ? GetCellFlags(*Level, Column, Row) : 0);
+		}
+	}
+
+	// the level closed once its last chunk is gone
+	if (!bResident)
+	{
+		for (int32 Index = 0; Index < LevelStreamer->GetNumChunks(); ++Index)
+		{
+			if (LevelStreamer->IsChunkResident(Index))
+			{
+				return;
+			}
+		}
+		Grid.Empty();
+	}
+}
+
+uint8 UClawTileCollision::GetCellFlags(const AClawTileLevel& Level, int32 Column, int32 Row) const
+{
+	// like the original games, only the action plane collides
+	const FClawTileMap& TileMap = *LevelStreamer->GetTileMap();
+	const uint16 Tile = TileMap.GetTile(EClawTileLayer::Action, Column, Row);
+	if (Tile == CLAW_NoTile)
+	{
+		return 0;
+	}
+
+	const EClawTileAttribute* Attribute = Level.TileAttributes.Find(TileMap.AtlasTiles[Tile].TileId);
+	switch (Attribute ? *Attribute : Level.DefaultActionAttribute)
+	{
+	case EClawTileAttribute::Solid:
+		return CLAW_TileSolid;
+	case EClawTileAttribute::Ground:
+		return CLAW_TileOneWay;
+	case EClawTileAttribute::Climb:
+		return CLAW_TileLadder;
+	case EClawTileAttribute::Death:
+		return CLAW_TileDeath;
+	case EClawTileAttribute::Clear:
+		break;
+	}
+	return 0;
+}
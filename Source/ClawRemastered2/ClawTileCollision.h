@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ClawTileCollision.generated.h"
+
+class AClawTileLevel;
+class UClawLevelStreamer;
+
+// the attributes the original games give their tiles
+UENUM(BlueprintType)
+enum class EClawTileAttribute : uint8
+{
+	Clear,
+	Solid,
+
+	// can be stood on and jumped through from below
+	Ground,
+
+	Climb,
+	Death
+};
+
+// bits of a cell of the collision grid
+enum EClawTileFlags : uint8
+{
+	CLAW_TileSolid = 1 << 0,
+	CLAW_TileOneWay = 1 << 1,
+	CLAW_TileLadder = 1 << 2,
+	CLAW_TileDeath = 1 << 3,
+
+	// what stops movement, one-way cells only when coming from above
+	CLAW_TileBlocking = CLAW_TileSolid | CLAW_TileOneWay
+};
+
+// where a sweep ran into the grid, on the XZ plane
+struct FClawTileHit
+{
+	// fraction of the move done before the hit
+	float Time = 1.0f;
+
+	FVector2D Normal = FVector2D::ZeroVector;
+
+	FIntPoint Cell = FIntPoint::NoneValue;
+	uint8 Flags = 0;
+};
+
+/**
+ * The tile collision of a level as one byte of flags per cell.
+ *
+ * Rows go down from Origin, the top left corner of the level. Boxes are swept through
+ * the cells with a DDA over their leading edges, so the cost of a move depends on the
+ * cells it crosses and not on the size of the level.
+ */
+struct CLAWREMASTERED2_API FClawTileGrid
+{
+	void Init(const FVector2D& InOrigin, int32 InWidth, int32 InHeight, float InTileSize);
+	void Empty();
+
+	bool IsEmpty() const { return Flags.Num() == 0; }
+
+	uint8 GetFlags(int32 Column, int32 Row) const
+	{
+		return Column >= 0 && Column < Width && Row >= 0 && Row < Height ? Flags[Row * Width + Column] : 0;
+	}
+
+	void SetFlags(int32 Column, int32 Row, uint8 CellFlags) { Flags[Row * Width + Column] = CellFlags; }
+
+	/** Flags of all the cells Box overlaps, or'ed together. */
+	uint8 OverlapFlags(const FBox2D& Box) const;
+
+	/**
+	 * Moves Box by Delta and stops it at the first cell of Mask it runs into. One-way cells only
+	 * stop a box moving down onto them. Returns true on a hit.
+	 */
+	bool SweepBox(const FBox2D& Box, const FVector2D& Delta, uint8 Mask, FClawTileHit& OutHit) const;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	float TileSize = 64.0f;
+	FVector2D Origin = FVector2D::ZeroVector;
+
+private:
+	// from the XZ plane to grid space, where one unit is a tile and Y goes down
+	FVector2D ToGrid(const FVector2D& Point) const { return FVector2D(Point.X - Origin.X, Origin.Y - Point.Y) / TileSize; }
+
+	bool IsSpanBlocked(bool bColumn, int32 Line, float SpanMin, float SpanMax, uint8 Mask, FIntPoint& OutCell, uint8& OutFlags) const;
+
+	TArray<uint8> Flags;
+};
+
+/**
+ * The collision of the tile level in the world.
+ *
+ * Filled from the tile attributes of the level as its chunks stream in and cleared as they
+ * stream out, so only the resident part of the level collides. Characters with a
+ * UClawTileMovementComponent sweep against it instead of against physics bodies.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawTileCollision : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	const FClawTileGrid& GetGrid() const { return Grid; }
+
+	bool HasCollision() const { return !Grid.IsEmpty(); }
+
+private:
+	void OnChunkStreamed(int32 Chunk, int32 FirstColumn, int32 LastColumn, bool bResident);
+
+	uint8 GetCellFlags(const AClawTileLevel& Level, int32 Column, int32 Row) const;
+
+	UPROPERTY()
+	UClawLevelStreamer* LevelStreamer;
+
+	FDelegateHandle ChunkStreamedHandle;
+
+	FClawTileGrid Grid;
+};
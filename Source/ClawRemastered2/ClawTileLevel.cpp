@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawTileLevel.h"
+#include "ClawLevelStreamer.h"
+#include "Components/SceneComponent.h"
+
+AClawTileLevel::AClawTileLevel()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void AClawTileLevel::BeginPlay()
+{
+	Super::BeginPlay();
+
+	LevelStreamer = GetWorld()->GetSubsystem<UClawLevelStreamer>();
+	LevelStreamer->OpenLevel(this);
+}
+
+void AClawTileLevel::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (LevelStreamer)
+	{
+		LevelStreamer->CloseLevel(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ClawTileCollision.h"
+#include "ClawTileLevel.generated.h"
+
+class UMaterialInterface;
+
+// an actor the level spawns once the chunk under Location streams in
+USTRUCT(BlueprintType)
+struct FClawTileSpawn
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<AActor> ActorClass;
+
+	// relative to the level actor
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (MakeEditWidget = true))
+	FVector Location = FVector::ZeroVector;
+};
+
+/**
+ * One of the original levels, drawn from the tile map the level importer wrote.
+ *
+ * Place it where the top left corner of the level should be. The level streamer builds
+ * the tiles, collision and spawns of the chunks around the camera, so only a few screens
+ * of the level are ever resident.
+ */
+UCLASS()
+class CLAWREMASTERED2_API AClawTileLevel : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AClawTileLevel();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// the number of Content/TileMaps/lvlN.clawtiles
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Level)
+	int32 LevelNumber = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Level)
+	TArray<FClawTileSpawn> Spawns;
+
+	// needs a SpriteTexture parameter, the masked unlit sprite material of Paper2D when empty
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Level)
+	UMaterialInterface* TileMaterial;
+
+	// the attribute of the action tiles, by the number of the original tile
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Collision)
+	TMap<int32, EClawTileAttribute> TileAttributes;
+
+	// for action tiles that aren't in TileAttributes
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Collision)
+	EClawTileAttribute DefaultActionAttribute = EClawTileAttribute::Solid;
+
+private:
+	class UClawLevelStreamer* LevelStreamer;
+};
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawTileMap.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	// "CLTM"
+	const uint32 TileMapMagic = 0x4d544c43;
+	const uint32 TileMapVersion = 1;
+}
+
+bool FClawTileMap::Save(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Serialize(Writer);
+
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FClawTileMap::Load(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	Serialize(Reader);
+
+	return !Reader.IsError();
+}
+
+void FClawTileMap::Serialize(FArchive& Ar)
+{
+	uint32 Magic = TileMapMagic;
+	uint32 Version = TileMapVersion;
+	Ar << Magic << Version;
+
+	if (Ar.IsLoading() && (Magic != TileMapMagic || Version != TileMapVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << Width << Height << TileSize << AtlasColumns;
+
+	// the layers are plain uint16 arrays, so they go through as one block
+	for (TArray<uint16>& Layer : Layers)
+	{
+		Layer.BulkSerialize(Ar);
+	}
+
+	Ar << AtlasTiles;
+
+	if (Ar.IsLoading())
+	{
+		for (const TArray<uint16>& Layer : Layers)
+		{
+			if (Layer.Num() != Width * Height)
+			{
+				Ar.SetError();
+				return;
+			}
+		}
+	}
+}
+
+FString FClawTileMap::GetDirectory()
+{
+	return FPaths::ProjectContentDir() / TEXT("TileMaps");
+}
+
+FString FClawTileMap::GetTileMapFilename(int32 Level)
+{
+	return GetDirectory() / FString::Printf(TEXT("lvl%d.clawtiles"), Level);
+}
+
+FString FClawTileMap::GetAtlasFilename(int32 Level)
+{
+	return GetDirectory() / FString::Printf(TEXT("lvl%d_atlas.png"), Level);
+}
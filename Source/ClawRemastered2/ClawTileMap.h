@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// the tile sets of the original levels, drawn back to front
+enum class EClawTileLayer : uint8
+{
+	Back,
+	Action,
+	Front,
+
+	Count
+};
+
+// a cell of a layer without a tile
+static constexpr uint16 CLAW_NoTile = 0xffff;
+
+// a tile of the atlas and the original tile it was made from
+struct FClawAtlasTile
+{
+	// the number in the file name of the original tile, 416 for TILES/FRONT/416.png
+	uint16 TileId = 0;
+
+	EClawTileLayer Layer = EClawTileLayer::Back;
+
+	friend FArchive& operator<<(FArchive& Ar, FClawAtlasTile& Tile)
+	{
+		return Ar << Tile.TileId << Tile.Layer;
+	}
+};
+
+/**
+ * The tiles of an imported level.
+ *
+ * Every layer holds one uint16 per cell, row by row from the top left, which is the index
+ * of the cell's tile in the atlas or CLAW_NoTile. The atlas is a PNG next to the tile map
+ * with the tiles in rows of AtlasColumns. Written by the ClawLevelImport commandlet.
+ */
+struct CLAWREMASTERED2_API FClawTileMap
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 TileSize = 64;
+	int32 AtlasColumns = 16;
+
+	TArray<uint16> Layers[(int32)EClawTileLayer::Count];
+
+	TArray<FClawAtlasTile> AtlasTiles;
+
+	uint16 GetTile(EClawTileLayer Layer, int32 X, int32 Y) const
+	{
+		return Layers[(int32)Layer][Y * Width + X];
+	}
+
+	// where the tile is in the atlas, in pixels
+	FIntPoint GetAtlasOffset(uint16 AtlasIndex) const
+	{
+		return FIntPoint(AtlasIndex % AtlasColumns, AtlasIndex / AtlasColumns) * TileSize;
+	}
+
+	bool Save(const FString& Filename);
+	bool Load(const FString& Filename);
+
+	void Serialize(FArchive& Ar);
+
+	// where the imported levels are kept, Content/TileMaps
+	static FString GetDirectory();
+
+	static FString GetTileMapFilename(int32 Level);
+	static FString GetAtlasFilename(int32 Level);
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawTileMovementComponent.h"
+#include "ClawTileCollision.h"
+#include "ClawStats.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tile Sweeps"), STAT_ClawTileSweeps, STATGROUP_Claw);
+
+namespace
+{
+	// moves stop this far from the tile they hit, so the next sweep doesn't start touching it
+	const float TileSkin = 0.125f;
+}
+
+void UClawTileMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TileCollision = GetWorld()->GetSubsystem<UClawTileCollision>();
+}
+
+FBox2D UClawTileMovementComponent::GetCapsuleBounds(const FVector& Location) const
+{
+	// the floor checks use a flat base, so the capsule is treated as its bounding box
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+
+	return FBox2D(FVector2D(Location.X - Radius, Location.Z - HalfHeight), FVector2D(Location.X + Radius, Location.Z + HalfHeight));
+}
+
+bool UClawTileMovementComponent::MoveUpdatedComponentImpl(const FVector& Delta, const FQuat& NewRotation, bool bSweep, FHitResult* OutHit, ETeleportType Teleport)
+{
+	if (!TileCollision || !TileCollision->HasCollision() || !CharacterOwner || !UpdatedComponent)
+	{
+		return Super::MoveUpdatedComponentImpl(Delta, NewRotation, bSweep, OutHit, Teleport);
+	}
+
+	const FClawTileGrid& Grid = TileCollision->GetGrid();
+	const FVector Start = UpdatedComponent->GetComponentLocation();
+
+	// cut the move short at the first tile in the way, physics only sees the part that's left
+	float TileTime = 1.0f;
+	FClawTileHit TileHit;
+	bool bTileHit = false;
+	if (bSweep)
+	{
+		CLAW_SCOPE_CYCLE_COUNTER(STAT_ClawTileSweeps);
+
+		bTileHit = Grid.SweepBox(GetCapsuleBounds(Start), FVector2D(Delta.X, Delta.Z), CLAW_TileBlocking, TileHit);
+		if (bTileHit)
+		{
+			TileTime = FMath::Max(TileHit.Time - TileSkin / Delta.Size(), 0.0f);
+		}
+	}
+
+	const bool bMoved = Super::MoveUpdatedComponentImpl(Delta * TileTime, NewRotation, bSweep, OutHit, Teleport);
+
+	if (OutHit)
+	{
+		if (OutHit->bBlockingHit)
+		{
+			// physics stopped it first, its time is a fraction of the shortened move
+			OutHit->Time *= TileTime;
+		}
+		else if (bTileHit)
+		{
+			const FVector Normal(TileHit.Normal.X, 0.0f, TileHit.Normal.Y);
+			const FVector End = UpdatedComponent->GetComponentLocation();
+			const FBox2D Bounds = GetCapsuleBounds(End);
+
+			*OutHit = FHitResult(TileTime);
+			OutHit->bBlockingHit = true;
+			OutHit->Normal = Normal;
+			OutHit->ImpactNormal = Normal;
+			OutHit->TraceStart = Start;
+			OutHit->TraceEnd = Start + Delta;
+			OutHit->Location = End;
+			OutHit->ImpactPoint = End - Normal * (Normal.X != 0.0f ? Bounds.GetExtent().X : Bounds.GetExtent().Y);
+		}
+	}
+
+	TouchedTileFlags = Grid.OverlapFlags(GetCapsuleBounds(UpdatedComponent->GetComponentLocation()).ExpandBy(TileSkin * 2.0f));
+
+	return bMoved;
+}
+
+void UClawTileMovementComponent::ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult) const
+{
+	Super::ComputeFloorDist(CapsuleLocation, LineDistance, SweepDistance, OutFloorResult, SweepRadius, DownwardSweepResult);
+
+	if (!TileCollision || !TileCollision->HasCollision() || !CharacterOwner)
+	{
+		return;
+	}
+
+	FClawTileHit TileHit;
+	if (!TileCollision->GetGrid().SweepBox(GetCapsuleBounds(CapsuleLocation), FVector2D(0.0f, -SweepDistance), CLAW_TileBlocking, TileHit))
+	{
+		return;
+	}
+
+	// a physics floor that's closer wins
+	const float FloorDist = TileHit.Time * SweepDistance;
+	if (OutFloorResult.bBlockingHit && OutFloorResult.FloorDist <= FloorDist)
+	{
+		return;
+	}
+
+	FHitResult Hit(TileHit.Time);
+	Hit.bBlockingHit = true;
+	Hit.Normal = FVector::UpVector;
+	Hit.ImpactNormal = FVector::UpVector;
+	Hit.TraceStart = CapsuleLocation;
+	Hit.TraceEnd = CapsuleLocation - FVector(0.0f, 0.0f, SweepDistance);
+	Hit.Location = CapsuleLocation - FVector(0.0f, 0.0f, FloorDist);
+	Hit.ImpactPoint = Hit.Location - FVector(0.0f, 0.0f, CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+
+	OutFloorResult.SetFromSweep(Hit, FloorDist, true);
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "ClawTileMovementComponent.generated.h"
+
+class UClawTileCollision;
+
+/**
+ * Character movement that collides with the tile level.
+ *
+ * Every move is first swept through the tile collision grid, then through physics for
+ * everything that isn't a tile, so level geometry needs no physics bodies. Floors are
+ * found the same way and one-way tiles only hold characters coming down onto them.
+ * Outside of tile levels it moves like the regular character movement.
+ */
+UCLASS()
+class CLAWREMASTERED2_API UClawTileMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginPlay() override;
+
+	virtual void ComputeFloorDist(const FVector& CapsuleLocation, float LineDistance, float SweepDistance, FFindFloorResult& OutFloorResult, float SweepRadius, const FHitResult* DownwardSweepResult = nullptr) const override;
+
+	// flags of the tiles the capsule overlapped after its last move
+	uint8 GetTouchedTileFlags() const { return TouchedTileFlags; }
+
+protected:
+	virtual bool MoveUpdatedComponentImpl(const FVector& Delta, const FQuat& NewRotation, bool bSweep, FHitResult* OutHit = nullptr, ETeleportType Teleport = ETeleportType::None) override;
+
+private:
+	FBox2D GetCapsuleBounds(const FVector& Location) const;
+
+	UPROPERTY()
+	UClawTileCollision* TileCollision;
+
+	uint8 TouchedTileFlags = 0;
+};
@@ -2,6 +2,7 @@
 
 
 #include "Enemy.h"
+#include "ClawTileMovementComponent.h"
 #include "PaperFlipbookComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -9,10 +10,13 @@
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
 #include "BlueOfficerBullet.h"
-#include "Kismet/GameplayStatics.h"
+#include "ClawSoundPool.h"
 #include "Engine/Engine.h"
+#include "Net/UnrealNetwork.h"
+#include "ClawStats.h"
 
-AEnemy::AEnemy()
+AEnemy::AEnemy(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UClawTileMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Use only Yaw from the controller and ignore the rest of the rotation.
 	bUseControllerRotationPitch = false;
@@ -38,9 +42,11 @@ AEnemy::AEnemy()
 	// behavior on the edge of a ledge versus inclines by setting this to true or false
 	GetCharacterMovement()->bUseFlatBaseForFloorChecks = true;
 
-	// Enable replication on the Sprite component so animations show up when networked
-	GetSprite()->SetIsReplicated(true);
+	// the enemy manager replicates the position, animation and facing as one small state,
+	// so neither the movement nor the flipbook component is sent
 	bReplicates = true;
+	SetReplicatingMovement(false);
+	NetUpdateFrequency = 10.0f;
 
 	//UE_LOG(LogTemp, Warning, TEXT("swording"));
 	OfficerHealth = CreateDefaultSubobject<UHealthComponent>(TEXT("HealthComponent"));
@@ -69,223 +75,127 @@ void AEnemy::BeginPlay()
 
 	//UE_LOG(LogTemp, Warning, TEXT("beginplay"));
 
-	currentState = walking;
-	walkDirection = 1.0f;
+	FClawEnemyFlipbooks Flipbooks;
+	Flipbooks.ByState[(int32)EClawEnemyState::Walking] = WalkingAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Idling] = IdleAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Aggroed] = AggroedAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Hurt] = HurtAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Dead] = DeadAnimation;
 
-	GetWorldTimerManager().SetTimer(EndWalkTimer, this, &AEnemy::TurnLeft, walkDuration, false);
-}
-
-void AEnemy::UpdateCharacter()
-{
-	const FVector PlayerVelocity = GetVelocity();
-	const float PlayerSpeedSqr = PlayerVelocity.SizeSquared();
-
-	UPaperFlipbook* CurrentAnimation = GetSprite()->GetFlipbook();
+	// AEnemy dies from OnDamageTaken, so the manager doesn't need to watch its health
+	EnemyManager = GetWorld()->GetSubsystem<UClawEnemyManager>();
+	FClawEnemySenses Senses;
+	Senses.Sight = OfficerIdleSightCollisionBox;
+	Senses.Reach = OfficerWalkSightCollisionBox;
 
-	if (currentState == walking) {
-		AddMovementInput(FVector(walkDirection, 0.0f, 0.0f), 1);
-		if (CurrentAnimation != WalkingAnimation)
-		{
-			GetSprite()->SetFlipbook(WalkingAnimation);
+	BrainHandle = EnemyManager->RegisterEnemy(this, EClawEnemyKind::Enemy, nullptr, Flipbooks, Senses,
+		Behaviour ? Behaviour : EnemyManager->GetDefaultBehaviour(EClawEnemyKind::Enemy, walkDuration, idlingDuration));
 
-			//UE_LOG(LogTemp, Warning, TEXT("right"));
-		}
-	}
-	else if (currentState == idling) {
-		if (CurrentAnimation != IdleAnimation)
-		{
-			GetSprite()->SetFlipbook(IdleAnimation);
-		}
-	}
-	else if (currentState == aggroed) {
-		if (CurrentAnimation != AggroedAnimation)
-		{
-			GetSprite()->SetFlipbook(AggroedAnimation);
-		}
-		ActAggroed();
-	}
-	else if (currentState == dead) {
-		if (CurrentAnimation != DeadAnimation)
-		{
-			GetSprite()->SetFlipbook(DeadAnimation);
-		}
-		AddMovementInput(FVector(deathJumpDirection, 0.0f, 0.0f), 1);
-	}
-	//else if (currentState == hurt) {
-	//	DesiredAnimation = HurtAnimation;
-	//}
+	// the enemy manager updates all brains in one pass unless batching is turned off
+	SetActorTickEnabled(!EnemyManager->IsBatched());
 }
 
-void AEnemy::Tick(float DeltaSeconds)
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaSeconds);
-
-	UpdateCharacter();
-
-	UpdateRotation();
+	if (EnemyManager)
+	{
+		EnemyManager->UnregisterEnemy(BrainHandle);
+		BrainHandle = INDEX_NONE;
+	}
 
-	//UE_LOG(LogTemp, Error, TEXT("Value = %f"), walkDirection);
-	//UE_LOG(LogTemp, Error, TEXT("Value = %f"), GetWorldTimerManager().GetTimerRemaining(EndWalkTimer));
+	Super::EndPlay(EndPlayReason);
 }
 
-void AEnemy::OnOverlapBeginIdleSightCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+EClawEnemyState AEnemy::GetCurrentState() const
 {
-	if (currentState == idling && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
+	// an enemy without a brain hasn't begun play or already left the world
+	if (BrainHandle == INDEX_NONE)
 	{
-		//UE_LOG(LogTemp, Error, TEXT("begin overlap idle sight"));
-		UpdateToClawCharacterDirection(OtherComp);
-
-		currentState = aggroed;
-		GetWorldTimerManager().PauseTimer(EndWalkTimer);
+		return EClawEnemyState::Dead;
 	}
+
+	return EnemyManager->GetState(BrainHandle);
 }
 
-void AEnemy::OnOverlapEndIdleSightCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void AEnemy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	if (currentState == aggroed && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
-	{
-		//UE_LOG(LogTemp, Error, TEXT("end overlap idle sight"));
-		UpdateToClawCharacterDirection(OtherComp);
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-		currentState = walking;
-		GetWorldTimerManager().UnPauseTimer(EndWalkTimer);
-	}
+	DOREPLIFETIME(AEnemy, NetState);
 }
 
-void AEnemy::OnOverlapBeginWalkSightCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+bool AEnemy::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
 {
-	if (currentState == walking && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
-	{
-		//UE_LOG(LogTemp, Error, TEXT("begin overlap walk sight"));
-		UpdateToClawCharacterDirection(OtherComp);
-
-		currentState = aggroed;
-		GetWorldTimerManager().PauseTimer(EndWalkTimer);
-	}
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
 }
 
-void AEnemy::OnOverlapEndWalkSightCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void AEnemy::OnRep_NetState()
 {
-	if (currentState == aggroed && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
+	// the manager picks the state up when the enemy registers
+	if (BrainHandle != INDEX_NONE)
 	{
-		//UE_LOG(LogTemp, Error, TEXT("end overlap walk sight"));
-		UpdateToClawCharacterDirection(OtherComp);
-
-		currentState = walking;
-		GetWorldTimerManager().UnPauseTimer(EndWalkTimer);
+		EnemyManager->ApplyNetState(BrainHandle, NetState);
 	}
 }
 
-void AEnemy::TurnRight()
+void AEnemy::Tick(float DeltaSeconds)
 {
-	currentState = walking;
-
-	GetWorldTimerManager().SetTimer(EndWalkTimer, this, &AEnemy::TurnLeft, walkDuration, false);
-	walkDirection *= -1;
+	Super::Tick(DeltaSeconds);
 
-	//UE_LOG(LogTemp, Error, TEXT("turn right"));
+	// only reached when the enemy manager doesn't batch the brains
+	EnemyManager->TickEnemy(BrainHandle, DeltaSeconds);
 }
 
-void AEnemy::TurnLeft()
+// the idle sight reaches far, an idling enemy that sees Claw goes after him until he's out of it
+void AEnemy::OnOverlapBeginIdleSightCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	patrols++;
+	CLAW_SCOPE_OVERLAP();
 
-	if (patrols == 2) 
+	if (GetCurrentState() != EClawEnemyState::Dead && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		patrols = 0;
-
-		currentState = idling;
-		
-		UPrimitiveComponent* clawCapsuleComponent = CheckIfClawInSight();
-		if (clawCapsuleComponent)
-		{
-			UpdateToClawCharacterDirection(clawCapsuleComponent);
-
-			currentState = aggroed;
-			GetWorldTimerManager().PauseTimer(EndWalkTimer);
-		}
-			
-		GetWorldTimerManager().SetTimer(EndWalkTimer, this, &AEnemy::TurnRight, idlingDuration, false);
-
-		//UE_LOG(LogTemp, Error, TEXT("start idle"));
-	}
-	else
-	{
-		currentState = walking;
-
-		GetWorldTimerManager().SetTimer(EndWalkTimer, this, &AEnemy::TurnRight, walkDuration, false);
-		walkDirection *= -1;
-
-		//UE_LOG(LogTemp, Error, TEXT("turn left"));
+		EnemyManager->SetClawInSight(BrainHandle, OtherActor, true);
 	}
 }
 
-UPrimitiveComponent* AEnemy::CheckIfClawInSight()
+void AEnemy::OnOverlapEndIdleSightCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	TSet<UPrimitiveComponent*> OverlappingComponents;
+	CLAW_SCOPE_OVERLAP();
 
-	OfficerIdleSightCollisionBox->GetOverlappingComponents(OverlappingComponents);
-
-	for (auto& Component : OverlappingComponents)
+	if (GetCurrentState() != EClawEnemyState::Dead && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		if (Component->IsA(UCapsuleComponent::StaticClass()))
-		{
-			if (Component->GetOwner()->IsA(AClawRemastered2Character::StaticClass()))
-			{
-				return Component;
-			}
-		}
+		EnemyManager->SetClawInSight(BrainHandle, OtherActor, false);
 	}
-	
-	return nullptr;
 }
 
-void AEnemy::UpdateRotation()
+// a walking enemy only notices Claw when he comes close
+void AEnemy::OnOverlapBeginWalkSightCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	float direction = walkDirection;
-	if (currentState == aggroed) 
-	{
-		direction = toClawCharacterDirection;
-	}
+	CLAW_SCOPE_OVERLAP();
 
-	if (direction == 1) 
-	{
-		SetRotationToRight();
-	}
-	else 
+	if (GetCurrentState() != EClawEnemyState::Dead && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		SetRotationToLeft();
-	}
-}
-
-void AEnemy::UpdateToClawCharacterDirection(UPrimitiveComponent* clawCapsule)
-{
-	//UE_LOG(LogTemp, Error, TEXT("Value = %f"), GetActorLocation().X - clawCapsule->GetComponentLocation().X);
-	if (GetActorLocation().X - clawCapsule->GetComponentLocation().X < 0) {
-		toClawCharacterDirection = 1.0f;
-	}
-	else {
-		toClawCharacterDirection = -1.0f;
+		EnemyManager->SetClawInReach(BrainHandle, OtherActor, true);
 	}
 }
 
-void AEnemy::SetRotationToRight()
+void AEnemy::OnOverlapEndWalkSightCollisionBox(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	SetActorRotation(FRotator(0.0f, 180.0f, 0.0f));
-}
+	CLAW_SCOPE_OVERLAP();
 
-void AEnemy::SetRotationToLeft()
-{
-	SetActorRotation(FRotator(0.0f, 0.0f, 0.0f));
+	if (GetCurrentState() != EClawEnemyState::Dead && OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
+	{
+		EnemyManager->SetClawInReach(BrainHandle, OtherActor, false);
+	}
 }
 
 void AEnemy::OnDamageTaken(float DamageAmount, const UDamageType* damageType, AController* InstigatedBy, AActor* DamageCauser)
 {
-	if (GetActorLocation().X - DamageCauser->GetActorLocation().X < 0) {
+	// simulated bullets report their shooter as the cause, which can be gone by the time they hit
+	if (DamageCauser && GetActorLocation().X - DamageCauser->GetActorLocation().X < 0) {
 		deathJumpDirection = -1.0f;
 	}
 	
-	if (OfficerHealth->GetHealth() <= 0)
+	if (OfficerHealth->GetHealth() <= 0 && GetCurrentState() != EClawEnemyState::Dead)
 	{
 		HandleDeath();
 	}
@@ -293,28 +203,12 @@ void AEnemy::OnDamageTaken(float DamageAmount, const UDamageType* damageType, AC
 
 void AEnemy::HandleDeath()
 {
-	UGameplayStatics::SpawnSound2D(this, DeathSound, 1.0f, 1.0f, 0.0f);
+	UClawSoundPool::PlaySound2D(this, DeathSound, EClawSoundCategory::Effect, 2.0f);
 
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AEnemy::DestroySelf, 1.6f, false);
-	GetWorldTimerManager().ClearTimer(EndWalkTimer);
+	// the dead state of the behaviour keeps the jump direction and destroys the enemy once it landed
+	EnemyManager->Kill(BrainHandle);
+	EnemyManager->SetMoveDirection(BrainHandle, deathJumpDirection);
 
 	Jump();
 	this->SetActorEnableCollision(false);
-
-	currentState = dead;
 }
-
-void AEnemy::DestroySelf()
-{
-	UE_LOG(LogTemp, Error, TEXT("destroyed.."));
-	this->Destroy();
-}
-
-void AEnemy::ActAggroed()
-{
-	//UE_LOG(LogTemp, Error, TEXT("claw Detected.."));
-
-	AddMovementInput(FVector(toClawCharacterDirection, 0.0f, 0.0f), 1);
-}
-
@@ -7,6 +7,8 @@
 #include "HealthComponent.h"
 #include "Sound/SoundBase.h"
 #include "Interfaces/TakeDamage.h"
+#include "ClawEnemyManager.h"
+#include "ClawNet.h"
 #include "Enemy.generated.h"
 
 
@@ -20,6 +22,9 @@ class CLAWREMASTERED2_API AEnemy : public APaperCharacter, public ITakeDamage
 {
 	GENERATED_BODY()
 
+	// the enemy manager writes the replicated state
+	friend class UClawEnemyManager;
+
 protected:
 	// The animation to play while idle (standing still)
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
@@ -41,19 +46,9 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	class UPaperFlipbook* DeadAnimation;
 
-	enum State
-	{
-		walking,
-		idling,
-		aggroed,
-		dead,
-		hurt
-	};
-
-	State currentState;
-
-	float walkDirection;
-	float toClawCharacterDirection;
+	// what the enemy does, the enemy manager builds one from the durations below when none is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Behaviour)
+	UClawEnemyBehaviour* Behaviour;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	float walkDuration = 2.0f;
@@ -78,24 +73,33 @@ protected:
 	class UBoxComponent* OfficerWalkSightCollisionBox;
 
 private:
-	int patrols = 0;
-
-	// movementDirection will be multiplied by world vector
-	// 0 will result in no movement, 1 is right
-	// movement and -1 is left movement.
-	float movementDirection = 1.0f;
+	// direction the enemy jumps off in when it dies, away from what killed it
 	float deathJumpDirection = 1.0f;
 
-	FTimerHandle EndWalkTimer;
-
 	UHealthComponent* OfficerHealth;
 
+	UClawEnemyManager* EnemyManager;
+
+	// handle of this enemy's brain in the enemy manager
+	int32 BrainHandle = INDEX_NONE;
+
+	// what the clients see of the enemy, written by the enemy manager on the server
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FClawNetEnemyState NetState;
+
+	UFUNCTION()
+	void OnRep_NetState();
+
 public:
-	AEnemy();
+	AEnemy(const FObjectInitializer& ObjectInitializer);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 private:
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION()
 	void OnOverlapBeginIdleSightCollisionBox(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -111,23 +115,8 @@ private:
 
 	void HandleDeath();
 
-	void DestroySelf();
-
 protected:
 	virtual void OnDamageTaken(float DamageAmount, const UDamageType* damageType, AController* InstigatedBy, AActor* DamageCauser) override;
 
-	virtual void ActAggroed();
-
-	void UpdateCharacter();
-
-	void TurnRight();
-	void TurnLeft();
-
-	UPrimitiveComponent* CheckIfClawInSight();
-
-	void UpdateRotation();
-	void UpdateToClawCharacterDirection(UPrimitiveComponent* clawCapsule);
-
-	void SetRotationToRight();
-	void SetRotationToLeft();
+	EClawEnemyState GetCurrentState() const;
 };
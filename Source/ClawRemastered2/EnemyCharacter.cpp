@@ -2,18 +2,24 @@
 
 
 #include "EnemyCharacter.h"
+#include "ClawRemastered2.h"
+#include "ClawTileMovementComponent.h"
 #include "PaperFlipbookComponent.h" 
 #include "Components/CapsuleComponent.h"  
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h" 
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
-#include "Kismet/GameplayStatics.h"	
+#include "ClawSoundPool.h"
+#include "ClawDamageSystem.h"
 #include "Components/CapsuleComponent.h"
 #include "Engine/Engine.h"
+#include "Net/UnrealNetwork.h"
+#include "ClawStats.h"
 
 
-AEnemyCharacter::AEnemyCharacter() 
+AEnemyCharacter::AEnemyCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UClawTileMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Use only Yaw from the controller and ignore the rest of the rotation.
 	bUseControllerRotationPitch = false;
@@ -39,9 +45,11 @@ AEnemyCharacter::AEnemyCharacter()
 	// behavior on the edge of a ledge versus inclines by setting this to true or false
 	GetCharacterMovement()->bUseFlatBaseForFloorChecks = true;
 
-	// Enable replication on the Sprite component so animations show up when networked
-	GetSprite()->SetIsReplicated(true);
+	// the enemy manager replicates the position, animation and facing as one small state,
+	// so neither the movement nor the flipbook component is sent
 	bReplicates = true;
+	SetReplicatingMovement(false);
+	NetUpdateFrequency = 10.0f;
 
 	//UE_LOG(LogTemp, Warning, TEXT("swording"));
 
@@ -59,46 +67,31 @@ AEnemyCharacter::AEnemyCharacter()
 // will be called when the Claw character enter the collision box
 void AEnemyCharacter::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	//UE_LOG(LogTemp, Warning, TEXT("begin overlap"));
 	//GEngine->AddOnScreenDebugMessage(-1, 1.0f, FColor::Green, "overlap Begin");
-	if (OtherActor && OtherComp->IsA(UCapsuleComponent::StaticClass()) && !isDead)
+	if (OtherActor && OtherComp->IsA(UCapsuleComponent::StaticClass()) && !IsDead())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("overlapping"));
+		UE_LOG(LogClaw, Verbose, TEXT("%s overlapped %s"), *GetName(), *GetNameSafe(OtherActor));
 
 		if (OtherActor && OtherActor != this && OtherActor->IsA(AClawRemastered2Character::StaticClass()))
 		{
 			ClawCharacter = OtherActor;
-			StartSwording();
+
+			// the behaviour starts swording on its next update
+			EnemyManager->SetClawInReach(BrainHandle, OtherActor, true);
 		}
 	}
 }
 
-//////////////////////////////////////////////////////////////////////////
-// Animation
-
-void AEnemyCharacter::UpdateAnimation()
+void AEnemyCharacter::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	const FVector PlayerVelocity = GetVelocity();
-	const float PlayerSpeedSqr = PlayerVelocity.SizeSquared();
-
-	UPaperFlipbook* DesiredAnimation;
+	CLAW_SCOPE_OVERLAP();
 
-	if (isDead) {
-		DesiredAnimation = DeadAnimation;
-	}
-	else if (isSwording) {
-		// if swording then render the sword animation.
-		DesiredAnimation = SwordingAnimation;
-	}
-	else {
-		// else render running or idle animation
-		DesiredAnimation = (PlayerSpeedSqr > 0.0f) ? WalkingAnimation : IdleAnimation;
-	}
-
-	// Are we moving or standing still?
-	if (GetSprite()->GetFlipbook() != DesiredAnimation)
+	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()) && BrainHandle != INDEX_NONE)
 	{
-		GetSprite()->SetFlipbook(DesiredAnimation);
+		EnemyManager->SetClawInReach(BrainHandle, OtherActor, false);
 	}
 }
 
@@ -108,131 +101,102 @@ void AEnemyCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	attackCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &AEnemyCharacter::OnOverlapBegin);
-	UE_LOG(LogTemp, Warning, TEXT("beginplay"));
+	attackCollisionBox->OnComponentEndOverlap.AddDynamic(this, &AEnemyCharacter::OnOverlapEnd);
+	UE_LOG(LogClaw, Verbose, TEXT("%s began play"), *GetName());
+
+	FClawEnemyFlipbooks Flipbooks;
+	Flipbooks.ByState[(int32)EClawEnemyState::Walking] = WalkingAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Idling] = IdleAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Attacking] = SwordingAnimation;
+	Flipbooks.ByState[(int32)EClawEnemyState::Dead] = DeadAnimation;
+	Flipbooks.bIdleWhenStill = true;
+
+	EnemyManager = GetWorld()->GetSubsystem<UClawEnemyManager>();
+	FClawEnemySenses Senses;
+	Senses.Reach = attackCollisionBox;
 
-	SetActorRotation(FRotator(0.0f, 180.0f, 0.0f));
-	StartMovement();
+	BrainHandle = EnemyManager->RegisterEnemy(this, EClawEnemyKind::EnemyCharacter, EnemyHealth, Flipbooks, Senses,
+		Behaviour ? Behaviour : EnemyManager->GetDefaultBehaviour(EClawEnemyKind::EnemyCharacter));
+
+	// the enemy manager updates all brains in one pass unless batching is turned off
+	SetActorTickEnabled(!EnemyManager->IsBatched());
 }
 
-void AEnemyCharacter::Tick(float DeltaSeconds)
+void AEnemyCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaSeconds); 
-
-	// the movementDirection will routinly be changed from 1 to -1
-	// so the enemy will always be moving either to left or to right
-	if (isDead)
-	{ 
-		AddMovementInput(FVector(-1.0f, 0.0f, 0.0f), 1);
-	}
-	else 
+	if (EnemyManager)
 	{
-		AddMovementInput(FVector(movementDirection, 0.0f, 0.0f), 1);
+		EnemyManager->UnregisterEnemy(BrainHandle);
+		BrainHandle = INDEX_NONE;
 	}
 
-	if (!isDead && EnemyHealth->GetHealth() <= 0) {
-		HandleDeath();
-	}
-	
-	UpdateAnimation();
+	Super::EndPlay(EndPlayReason);
 }
 
-
-// starts the timer for the swording animation
-void AEnemyCharacter::StartSwording()
+void AEnemyCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	//for animation
-	isSwording = true;
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	// swording animation takes 0.6 second
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AEnemyCharacter::DealDamage, 0.5f, false);
-
-	GetCharacterMovement()->DisableMovement(); 
+	DOREPLIFETIME(AEnemyCharacter, NetState);
 }
 
-// starts the timer for the swording animation
-void AEnemyCharacter::DealDamage()
+bool AEnemyCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
 {
-	if (ClawCharacter != nullptr && attackCollisionBox->IsOverlappingActor(ClawCharacter))
-	{ 
-		UGameplayStatics::ApplyDamage(ClawCharacter, 20, GetOwner()->GetInstigatorController(), this, DamageType);
-	} 
-
-	// swording animation takes 0.6 second
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AEnemyCharacter::StopSwording, 0.1f, false); 
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
 }
 
-// called when the timer for the swording animation ends
-void AEnemyCharacter::StopSwording()
-{ 
-	// if he's still overlapping claw, then he keeps attacking.
-	if (ClawCharacter != nullptr && attackCollisionBox->IsOverlappingActor(ClawCharacter))
-	{ 
-		StartSwording();
-	} else {
-		GetCharacterMovement()->SetMovementMode(MOVE_Walking);
-		isSwording = false;
+void AEnemyCharacter::OnRep_NetState()
+{
+	// the manager picks the state up when the enemy registers
+	if (BrainHandle != INDEX_NONE)
+	{
+		EnemyManager->ApplyNetState(BrainHandle, NetState);
 	}
-} 
+}
 
-void AEnemyCharacter::StartMovement()
+void AEnemyCharacter::Tick(float DeltaSeconds)
 {
-	//UE_LOG(LogTemp, Error, TEXT("started timer"));
+	Super::Tick(DeltaSeconds); 
 
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AEnemyCharacter::ChangeMovementDirection, 2.2f, false);
+	// only reached when the enemy manager doesn't batch the brains
+	EnemyManager->TickEnemy(BrainHandle, DeltaSeconds);
 }
 
-void AEnemyCharacter::ChangeMovementDirection()
+bool AEnemyCharacter::IsDead() const
 {
-	if (isDead)
-	{
-		return;
-	}
+	// an enemy without a brain hasn't begun play or already left the world
+	return BrainHandle == INDEX_NONE || EnemyManager->GetState(BrainHandle) == EClawEnemyState::Dead;
+}
 
-	if (ClawCharacter != nullptr && attackCollisionBox->IsOverlappingActor(ClawCharacter))
-	{
-		StartMovement();
-		return;
-	}
 
-	//if moving right reverse and vice versa
-	movementDirection *= -1.0f;
-	
-	if (movementDirection < 0.0f)
-	{
-		SetActorRotation(FRotator(0.0f, 0.0f, 0.0f)); 
-	}
-	else if (movementDirection > 0.0f)
-	{
-		SetActorRotation(FRotator(0.0f, 180.0f, 0.0f)); 
-	}
-	
-	StartMovement();
-}  
+// run by the behaviour when the sword hits
+void AEnemyCharacter::DealDamage()
+{
+	// the Claw in reach comes from the attack box, either through its overlaps or the spatial hash
+	AActor* Claw = EnemyManager->GetClawInReach(BrainHandle);
+	if (Claw)
+	{ 
+		UClawDamageSystem::ApplyDamage(Claw, 20, GetOwner()->GetInstigatorController(), this, DamageType);
+	} 
+}
 
 void AEnemyCharacter::HandleDeath()
 {
-	isDead = true; 
+	// the dead state of the behaviour destroys the enemy once the animation played
+	EnemyManager->Kill(BrainHandle);
+
+	// dead enemies slide off to the left
+	EnemyManager->SetMoveDirection(BrainHandle, -1.0f);
 
-	UGameplayStatics::SpawnSound2D(this, DeathSound, 1.0f, 1.0f, 0.0f);
+	UClawSoundPool::PlaySound2D(this, DeathSound, EClawSoundCategory::Effect, 2.0f);
 
 	if (ClawCelebrationSound != nullptr)
 	{
-		UGameplayStatics::SpawnSound2D(this, ClawCelebrationSound, 1.0f, 1.0f, 0.0f);
+		UClawSoundPool::PlaySound2D(this, ClawCelebrationSound, EClawSoundCategory::Voice);
 	}
 
 	//TODO: Disable Enemy movement and make him fall  
 
-	FTimerHandle UnusedHandle;
-	GetWorldTimerManager().SetTimer(UnusedHandle, this, &AEnemyCharacter::DestroyEnemy, 0.6f, false);
-
 	//SetActorLocation(GetActorLocation() + FVector(0.0f, 4.0f, 0.0f));
 	this->SetActorEnableCollision(false);
 }
-
-void AEnemyCharacter::DestroyEnemy()
-{
-	this->Destroy();
-}
\ No newline at end of file
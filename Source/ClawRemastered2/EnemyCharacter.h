@@ -6,6 +6,8 @@
 #include "PaperCharacter.h"
 #include "HealthComponent.h"
 #include "Sound/SoundBase.h"
+#include "ClawEnemyManager.h"
+#include "ClawNet.h"
 #include "EnemyCharacter.generated.h"
 
 /**
@@ -18,6 +20,10 @@ class CLAWREMASTERED2_API AEnemyCharacter : public APaperCharacter
 
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// the enemy manager updates the brain and calls HandleDeath
+	friend class UClawEnemyManager;
 
 protected:
 	// The animation to play while idle (standing still)
@@ -36,24 +42,26 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Animations)
 	class UPaperFlipbook* DeadAnimation;
 
-	/** Called to choose the correct animation to play based on the character's movement state */
-	void UpdateAnimation(); 
-
-	void StartMovement();
-	void ChangeMovementDirection();
+	// what the enemy does, the enemy manager uses the default behaviour when none is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Behaviour)
+	UClawEnemyBehaviour* Behaviour;
 
-	void StartSwording();
+	// run by the behaviour when the sword hits
 	void DealDamage();
-	void StopSwording(); 
 
-	bool isSwording = false;
-	bool isDead = false;
+	bool IsDead() const;
+
+	UClawEnemyManager* EnemyManager;
 
-	// movementDirection will be multiplied by world vector
-	// 0 will result in no movement, 1 is right
-	// movement and -1 is left movement.
-	float movementDirection = 1.0f;
+	// handle of this enemy's brain in the enemy manager
+	int32 BrainHandle = INDEX_NONE;
 
+	// what the clients see of the enemy, written by the enemy manager on the server
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FClawNetEnemyState NetState;
+
+	UFUNCTION()
+	void OnRep_NetState();
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sounds)
 	USoundBase* DeathSound;
@@ -62,7 +70,10 @@ protected:
 	USoundBase* ClawCelebrationSound;
 
 public:
-	AEnemyCharacter(); 
+	AEnemyCharacter(const FObjectInitializer& ObjectInitializer); 
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
 
 	class AActor* ClawCharacter; 
 
@@ -78,7 +89,8 @@ private:
 	UFUNCTION()
 	void OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
 
-	void HandleDeath();
+	UFUNCTION()
+	void OnOverlapEnd(class UPrimitiveComponent* OverlappedComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	void DestroyEnemy();
+	void HandleDeath();
 };
@@ -2,9 +2,15 @@
 
 
 #include "HealthComponent.h"
+#include "ClawRemastered2.h"
+#include "ClawDamageSystem.h"
 #include "ClawGameMode.h"
 #include "Interfaces/TakeDamage.h"
 #include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+#include "ClawStats.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Damage Events"), STAT_ClawDamageEvents, STATGROUP_Claw);
 
 // Sets default values for this component's properties
 UHealthComponent::UHealthComponent()
@@ -13,18 +19,64 @@ UHealthComponent::UHealthComponent()
 	// You can turn these features off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = false;
 
-	// ...
+	SetIsReplicatedByDefault(true);
 }
 
+void UHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(UHealthComponent, Health, COND_OwnerOnly);
+}
 
-float UHealthComponent::GetHealth()
+void UHealthComponent::OnRep_Health(float OldHealth)
 {
-	return Health;
+	NotifyHealthChanged(OldHealth);
 }
 
+
 void UHealthComponent::SetHealth(float damage)
 {
-	Health = FMath::Clamp(Health - damage, 0.0f, DefaultHealth);
+	ChangeHealth(-damage);
+}
+
+void UHealthComponent::ChangeHealth(float Delta)
+{
+	const float OldHealth = Health;
+	if (DamageHandle != INDEX_NONE)
+	{
+		Health = DamageSystem->ChangeHealth(DamageHandle, Delta);
+	}
+	else
+	{
+		Health = FMath::Clamp(Health + Delta, 0.0f, DefaultHealth);
+	}
+
+	NotifyHealthChanged(OldHealth);
+}
+
+void UHealthComponent::NotifyHealthChanged(float OldHealth)
+{
+	if (Health == OldHealth)
+	{
+		return;
+	}
+
+	HealthChangedEvent.Broadcast(this, Health, Health - OldHealth);
+
+	if (Health <= 0)
+	{
+		if (GameModeRef)
+		{
+			GameModeRef->ActorDied(GetOwner());
+		}
+		else if (GetOwner()->HasAuthority())
+		{
+			UE_LOG(LogClaw, Warning, TEXT("Health Component does not have a valid GameMode reference"));
+		}
+
+		DeathEvent.Broadcast(this);
+	}
 }
 
 // Called when the game starts
@@ -36,6 +88,25 @@ void UHealthComponent::BeginPlay()
 
 	GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
 	GetOwner()->OnTakeAnyDamage.AddDynamic(this, &UHealthComponent::TakeDamage);
+
+	UClawDamageSystem* System = GetWorld()->GetSubsystem<UClawDamageSystem>();
+	if (System && System->IsBatched())
+	{
+		DamageSystem = System;
+		DamageHandle = DamageSystem->Register(this, Health, DefaultHealth);
+	}
+}
+
+void UHealthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (DamageHandle != INDEX_NONE)
+	{
+		DamageSystem->Unregister(DamageHandle);
+		DamageHandle = INDEX_NONE;
+		DamageSystem = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UHealthComponent::TakeDamage(AActor* DamagedActor, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
@@ -45,19 +116,31 @@ void UHealthComponent::TakeDamage(AActor* DamagedActor, float Damage, const UDam
 		return;
 	}
 
-	Health = FMath::Clamp(Health - Damage, 0.0f, DefaultHealth);
+	// damage that still goes through the engine joins the batch too
+	if (DamageHandle != INDEX_NONE)
+	{
+		DamageSystem->QueueHit(DamageHandle, Damage, DamageType, InstigatedBy, DamageCauser);
+		return;
+	}
 
-	if (Health <= 0)
+	INC_DWORD_STAT(STAT_ClawDamageEvents);
+
+	ChangeHealth(-Damage);
+
+	if (GetOwner()->GetClass()->ImplementsInterface(UTakeDamage::StaticClass()))
 	{
-		if (GameModeRef)
-		{
-			GameModeRef->ActorDied(GetOwner());
-		}
-		else
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Health Component does not have a valid GameMode reference"));
-		}
+		ITakeDamage* DamageInterface = Cast<ITakeDamage>(GetOwner());
+		DamageInterface->OnDamageTaken(Damage, DamageType, InstigatedBy, DamageCauser);
 	}
+}
+
+void UHealthComponent::ApplyResolvedDamage(float NewHealth, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
+{
+	INC_DWORD_STAT(STAT_ClawDamageEvents);
+
+	const float OldHealth = Health;
+	Health = NewHealth;
+	NotifyHealthChanged(OldHealth);
 
 	if (GetOwner()->GetClass()->ImplementsInterface(UTakeDamage::StaticClass()))
 	{
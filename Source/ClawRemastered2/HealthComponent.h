@@ -9,6 +9,12 @@
 
 
 class AClawGameMode;
+class UClawDamageSystem;
+class UHealthComponent;
+
+// the health after the change and by how much it changed, negative for damage
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnClawHealthChanged, UHealthComponent* /*HealthComponent*/, float /*Health*/, float /*Delta*/);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnClawDeath, UHealthComponent* /*HealthComponent*/);
 
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
@@ -20,20 +26,54 @@ private:
 
 	UPROPERTY(EditAnywhere)
 	float DefaultHealth = 100.0f;
+
+	// only sent to the owning player, enemies show their health through their state
+	UPROPERTY(ReplicatedUsing = OnRep_Health)
 	float Health = 0.0f;
 
+	UFUNCTION()
+	void OnRep_Health(float OldHealth);
+
 	AClawGameMode* GameModeRef;
 
+	FOnClawHealthChanged HealthChangedEvent;
+	FOnClawDeath DeathEvent;
+
+	// set while the health lives in the damage system's store
+	UPROPERTY()
+	UClawDamageSystem* DamageSystem = nullptr;
+	int32 DamageHandle = INDEX_NONE;
+
+	// clamps the new health, then tells the listeners when it changed and when it ran out
+	void ChangeHealth(float Delta);
+
+	void NotifyHealthChanged(float OldHealth);
+
 public:	
 	// Sets default values for this component's properties
 	UHealthComponent();
 
-	float GetHealth();
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	float GetHealth() const { return Health; }
 	void SetHealth(float damage);
 
+	/** Broadcast whenever the health changes, so nothing has to poll it. */
+	FOnClawHealthChanged& OnHealthChanged() { return HealthChangedEvent; }
+
+	/** Broadcast once, when the health drops to zero. */
+	FOnClawDeath& OnDeath() { return DeathEvent; }
+
+	/** Handle of the health in the damage system, INDEX_NONE when hits are applied on the spot. */
+	int32 GetDamageHandle() const { return DamageHandle; }
+
+	/** Called by the damage system with the health a resolved hit left. */
+	void ApplyResolvedDamage(float NewHealth, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser);
+
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION()
 	void TakeDamage(AActor* DamagedActor, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser);
@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pickup.h"
+
+// Add default functionality here for any IPickup functions that are not pure virtual.
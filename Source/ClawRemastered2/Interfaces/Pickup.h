@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Pickup.generated.h"
+
+class AClawRemastered2Character;
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UPickup : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Something Claw collects by touching it, found through the spatial hash.
+ */
+class CLAWREMASTERED2_API IPickup
+{
+	GENERATED_BODY()
+
+	// Add interface functions to this class. This is the class that will be inherited to implement this interface.
+public:
+	virtual void OnPickedUp(AClawRemastered2Character* Claw) = 0;
+};
@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PooledProjectile.h"
+
+// Add default functionality here for any IPooledProjectile functions that are not pure virtual.
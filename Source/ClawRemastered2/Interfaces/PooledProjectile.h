@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PooledProjectile.generated.h"
+
+struct FClawProjectileDesc;
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UPooledProjectile : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * A projectile that the projectile pool recycles instead of spawning and destroying it,
+ * and that the projectile system can simulate without an actor at all.
+ */
+class CLAWREMASTERED2_API IPooledProjectile
+{
+	GENERATED_BODY()
+
+	// Add interface functions to this class. This is the class that will be inherited to implement this interface.
+public:
+	// called when the pool hands the projectile out at its new location, restarts the flight
+	virtual void OnAcquired() = 0;
+
+	// called when the pool takes the projectile back, stops it and hides it
+	virtual void OnReleased() = 0;
+
+	// called on the class defaults, fills in how the projectile system can simulate the projectile without its actor
+	virtual bool DescribeSimulatedProjectile(FClawProjectileDesc& OutDesc) const { return false; }
+};
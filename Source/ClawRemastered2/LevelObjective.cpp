@@ -2,6 +2,7 @@
 
 
 #include "LevelObjective.h"
+#include "ClawRemastered2.h"
 #include "PaperFlipbookComponent.h" 
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
@@ -9,6 +10,7 @@
 #include "Components/CapsuleComponent.h" 
 #include "ClawGameMode.h"
 #include "Engine/Engine.h"
+#include "ClawStats.h"
 
 
 ALevelObjective::ALevelObjective()
@@ -28,13 +30,15 @@ void ALevelObjective::BeginPlay()
 {
     Super::BeginPlay();
     // the potion has touched claw
-    UE_LOG(LogTemp, Warning, TEXT("potion"));
+    UE_LOG(LogClaw, Verbose, TEXT("level objective"));
 
     GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
 }
 
 void ALevelObjective::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+    CLAW_SCOPE_OVERLAP();
+
     // check it it's claw who's overlapping with the object.
     if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
     {
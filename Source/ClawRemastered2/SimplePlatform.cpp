@@ -2,11 +2,13 @@
 
 
 #include "SimplePlatform.h"
+#include "ClawRemastered2.h"
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h" 
 #include "ClawRemastered2Character.h"
 #include "PaperSpriteComponent.h"
 #include "GameFramework/Actor.h"
+#include "ClawStats.h"
 
 ASimplePlatform::ASimplePlatform()
 {
@@ -30,10 +32,12 @@ ASimplePlatform::ASimplePlatform()
 
 void ASimplePlatform::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	// check it it's claw who's overlapping with the box.
 	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("enter"));
+		UE_LOG(LogClaw, Verbose, TEXT("enter"));
 		//SetActorEnableCollision(false);
 		
 		baseCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
@@ -42,10 +46,12 @@ void ASimplePlatform::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, A
 
 void ASimplePlatform::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	// check it it's claw who's overlapping with the box.
 	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("exit"));
+		UE_LOG(LogClaw, Verbose, TEXT("exit"));
 		//SetActorEnableCollision(true);
 
 		baseCollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
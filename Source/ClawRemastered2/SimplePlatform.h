@@ -8,7 +8,8 @@
 #include "SimplePlatform.generated.h"
 
 /**
- * 
+ * A platform Claw can jump through from below, for hand-built levels. Tile levels get
+ * the same from the one-way tiles of the tile collision.
  */
 UCLASS()
 class CLAWREMASTERED2_API ASimplePlatform : public APaperSpriteActor
@@ -10,8 +10,10 @@
 #include "Components/CapsuleComponent.h" 
 #include "ClawGameMode.h"
 #include "Templates/Casts.h"
-#include "Kismet/GameplayStatics.h"	
+#include "Kismet/GameplayStatics.h"
+#include "ClawDamageSystem.h"
 #include "BlueOfficer.h"
+#include "ClawStats.h"
 
 
 ASpikes::ASpikes()
@@ -34,8 +36,10 @@ void ASpikes::BeginPlay()
 
 void ASpikes::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	if (OtherActor && (OtherActor->IsA(AClawRemastered2Character::StaticClass()) || OtherActor->IsA(AEnemyCharacter::StaticClass()) || OtherActor->IsA(ABlueOfficer::StaticClass())) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		UGameplayStatics::ApplyDamage(OtherActor, SpikeDamage, GetInstigatorController(), this, DamageType);
+		UClawDamageSystem::ApplyDamage(OtherActor, SpikeDamage, GetInstigatorController(), this, DamageType);
 	}
 };
\ No newline at end of file
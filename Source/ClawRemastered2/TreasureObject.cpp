@@ -2,13 +2,19 @@
 
 
 #include "TreasureObject.h"
+#include "ClawRemastered2.h"
 #include "PaperFlipbookComponent.h" 
 #include "Components/BoxComponent.h"
 #include "ClawRemastered2Character.h"
-#include "Kismet/GameplayStatics.h"	
+#include "Kismet/GameplayStatics.h"
+#include "ClawSoundPool.h"
 #include "Components/CapsuleComponent.h" 
 #include "ClawGameMode.h"
+#include "ClawSpatialHash.h"
+#include "ClawPickupManager.h"
+#include "ClawNet.h"
 #include "Engine/Engine.h"
+#include "ClawStats.h"
 
 ATreasureObject::ATreasureObject()
 {
@@ -20,6 +26,10 @@ ATreasureObject::ATreasureObject()
 
 	ScoreCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &ATreasureObject::OnOverlapBegin);
 	ScoreCollisionBox->OnComponentEndOverlap.AddDynamic(this, &ATreasureObject::OnOverlapEnd);
+
+	// treasure doesn't change until it is collected, so only its removal is sent to clients
+	bReplicates = true;
+	NetDormancy = DORM_Initial;
 }
 
 void ATreasureObject::BeginPlay()
@@ -28,26 +38,70 @@ void ATreasureObject::BeginPlay()
 
 	GameModeRef = Cast<AClawGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
 
-	UE_LOG(LogTemp, Warning, TEXT("started treasure system"));
-	UE_LOG(LogTemp, Warning, TEXT("started treasure system"));
+	UE_LOG(LogClaw, Verbose, TEXT("started treasure system"));
+
+	// the pickup manager keeps the treasure as a record, the actor isn't needed anymore
+	UClawPickupManager* PickupManager = GetWorld()->GetSubsystem<UClawPickupManager>();
+	if (PickupManager->IsManaging())
+	{
+		PickupManager->AddTreasure(FClawSpatialGrid::MakeBounds(ScoreCollisionBox->GetComponentLocation(), ScoreCollisionBox->GetScaledBoxExtent()),
+			GetRenderComponent()->GetFlipbook(), GetRenderComponent()->GetComponentTransform(), TreasureObjectScore, CollectedSound);
+		Destroy();
+		return;
+	}
+
+	ClawNet::SetDormant(this, true);
+
+	// Claw finds the treasure through the spatial hash, the trigger box is only needed without it
+	SpatialHash = GetWorld()->GetSubsystem<UClawSpatialHash>();
+	if (SpatialHash->IsQuerying())
+	{
+		SpatialHandle = SpatialHash->Insert(this, FClawSpatialGrid::MakeBounds(ScoreCollisionBox->GetComponentLocation(), ScoreCollisionBox->GetScaledBoxExtent()), CLAW_SpatialPickup);
+		ScoreCollisionBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+}
+
+void ATreasureObject::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (SpatialHandle != INDEX_NONE)
+	{
+		SpatialHash->Remove(SpatialHandle);
+		SpatialHandle = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool ATreasureObject::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return ClawNet::IsRelevant(this, RealViewer, ViewTarget, SrcLocation);
 }
 
 void ATreasureObject::OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	CLAW_SCOPE_OVERLAP();
+
 	// check it it's claw who's overlapping with the score object.
 	if (OtherActor && OtherActor->IsA(AClawRemastered2Character::StaticClass()) && OtherComp->IsA(UCapsuleComponent::StaticClass()))
 	{
-		// increase the score in the game mode.
-		GameModeRef->AddScore(TreasureObjectScore);
+		OnPickedUp(Cast<AClawRemastered2Character>(OtherActor));
+	} 
+}
 
-		UGameplayStatics::SpawnSound2D(this, CollectedSound, 1.0f, 1.0f, 0.0f);
-		// TODO: create animation for the score object flying to the score.
+void ATreasureObject::OnPickedUp(AClawRemastered2Character* Claw)
+{
+	// increase the score in the game mode.
+	GameModeRef->AddScore(TreasureObjectScore);
 
-		// destroy actor.
-		this->Destroy();
-	} 
+	UClawSoundPool::PlaySound2D(this, CollectedSound, EClawSoundCategory::Pickup);
+	// TODO: create animation for the score object flying to the score.
+
+	// destroy actor.
+	this->Destroy();
 }
 
 void ATreasureObject::OnOverlapEnd(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	CLAW_SCOPE_OVERLAP();
+
 } 
\ No newline at end of file
@@ -5,21 +5,27 @@
 #include "CoreMinimal.h"
 #include "PaperFlipbookActor.h"
 #include "Sound/SoundBase.h"
+#include "Interfaces/Pickup.h"
 #include "TreasureObject.generated.h"
 
 
 class AClawGameMode;
 
 UCLASS()
-class CLAWREMASTERED2_API ATreasureObject : public APaperFlipbookActor
+class CLAWREMASTERED2_API ATreasureObject : public APaperFlipbookActor, public IPickup
 {
 	GENERATED_BODY()
 	
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	ATreasureObject();
 
+	virtual void OnPickedUp(AClawRemastered2Character* Claw) override;
+
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 private:
 	UFUNCTION()
 	void OnOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -35,6 +41,10 @@ private:
 
 	AClawGameMode* GameModeRef;
 
+	class UClawSpatialHash* SpatialHash;
+
+	int32 SpatialHandle = INDEX_NONE;
+
 protected:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Sounds)
@@ -9,6 +9,6 @@ public class ClawRemastered2EditorTarget : TargetRules
 	{
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
-		ExtraModuleNames.Add("ClawRemastered2");
+		ExtraModuleNames.AddRange(new string[] { "ClawRemastered2", "ClawRemastered2Editor" });
 	}
 }
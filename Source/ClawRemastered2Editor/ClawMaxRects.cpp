@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawMaxRects.h"
+
+namespace
+{
+	bool Intersects(const FIntRect& A, const FIntRect& B)
+	{
+		return A.Min.X < B.Max.X && A.Max.X > B.Min.X && A.Min.Y < B.Max.Y && A.Max.Y > B.Min.Y;
+	}
+
+	bool Contains(const FIntRect& Outer, const FIntRect& Inner)
+	{
+		return Inner.Min.X >= Outer.Min.X && Inner.Min.Y >= Outer.Min.Y && Inner.Max.X <= Outer.Max.X && Inner.Max.Y <= Outer.Max.Y;
+	}
+}
+
+FClawMaxRectsBin::FClawMaxRectsBin(int32 InWidth, int32 InHeight)
+	: Width(InWidth)
+	, Height(InHeight)
+{
+	FreeRects.Add(FIntRect(0, 0, Width, Height));
+}
+
+bool FClawMaxRectsBin::Insert(int32 RectWidth, int32 RectHeight, FIntRect& OutRect)
+{
+	if (!FindPosition(RectWidth, RectHeight, OutRect))
+	{
+		return false;
+	}
+
+	Place(OutRect);
+	return true;
+}
+
+void FClawMaxRectsBin::Place(const FIntRect& Rect)
+{
+	SplitFreeRects(Rect);
+	PruneFreeRects();
+
+	UsedArea += (int64)Rect.Width() * Rect.Height();
+}
+
+bool FClawMaxRectsBin::FindPosition(int32 RectWidth, int32 RectHeight, FIntRect& OutRect) const
+{
+	int32 BestShortSide = MAX_int32;
+	int32 BestLongSide = MAX_int32;
+
+	// frames keep their orientation, sprites can't be rotated in the atlas
+	for (const FIntRect& Free : FreeRects)
+	{
+		if (Free.Width() < RectWidth || Free.Height() < RectHeight)
+		{
+			continue;
+		}
+
+		const int32 LeftoverX = Free.Width() - RectWidth;
+		const int32 LeftoverY = Free.Height() - RectHeight;
+		const int32 ShortSide = FMath::Min(LeftoverX, LeftoverY);
+		const int32 LongSide = FMath::Max(LeftoverX, LeftoverY);
+
+		if (ShortSide < BestShortSide || (ShortSide == BestShortSide && LongSide < BestLongSide))
+		{
+			OutRect = FIntRect(Free.Min, Free.Min + FIntPoint(RectWidth, RectHeight));
+			BestShortSide = ShortSide;
+			BestLongSide = LongSide;
+		}
+	}
+
+	return BestShortSide != MAX_int32;
+}
+
+void FClawMaxRectsBin::SplitFreeRects(const FIntRect& Used)
+{
+	// every free rectangle the used one cuts into is replaced by the up to four parts around it
+	for (int32 Index = FreeRects.Num() - 1; Index >= 0; --Index)
+	{
+		const FIntRect Free = FreeRects[Index];
+		if (!Intersects(Free, Used))
+		{
+			continue;
+		}
+
+		FreeRects.RemoveAtSwap(Index, 1, false);
+
+		if (Used.Min.X > Free.Min.X)
+		{
+			FreeRects.Add(FIntRect(Free.Min.X, Free.Min.Y, Used.Min.X, Free.Max.Y));
+		}
+		if (Used.Max.X < Free.Max.X)
+		{
+			FreeRects.Add(FIntRect(Used.Max.X, Free.Min.Y, Free.Max.X, Free.Max.Y));
+		}
+		if (Used.Min.Y > Free.Min.Y)
+		{
+			FreeRects.Add(FIntRect(Free.Min.X, Free.Min.Y, Free.Max.X, Used.Min.Y));
+		}
+		if (Used.Max.Y < Free.Max.Y)
+		{
+			FreeRects.Add(FIntRect(Free.Min.X, Used.Max.Y, Free.Max.X, Free.Max.Y));
+		}
+	}
+}
+
+void FClawMaxRectsBin::PruneFreeRects()
+{
+	// drop the free rectangles that lie within another one
+	for (int32 Index = 0; Index < FreeRects.Num(); ++Index)
+	{
+		for (int32 Other = Index + 1; Other < FreeRects.Num(); ++Other)
+		{
+			if (Contains(FreeRects[Other], FreeRects[Index]))
+			{
+				FreeRects.RemoveAtSwap(Index, 1, false);
+				--Index;
+				break;
+			}
+			if (Contains(FreeRects[Index], FreeRects[Other]))
+			{
+				FreeRects.RemoveAtSwap(Other, 1, false);
+				--Other;
+			}
+		}
+	}
+}
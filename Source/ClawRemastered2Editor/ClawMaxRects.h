@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A page packed with the MaxRects algorithm.
+ *
+ * The bin keeps every maximal free rectangle, which may overlap each other, and puts a
+ * new rectangle where it leaves the shortest side over (best short side fit). Placed
+ * rectangles can also be given back from an earlier packing, so a page can be topped up
+ * without moving what's already on it.
+ */
+class CLAWREMASTERED2EDITOR_API FClawMaxRectsBin
+{
+public:
+	FClawMaxRectsBin(int32 InWidth, int32 InHeight);
+
+	/** Finds room for a Width x Height rectangle and takes it, returns false when it doesn't fit. */
+	bool Insert(int32 Width, int32 Height, FIntRect& OutRect);
+
+	/** Takes a rectangle that was placed before. */
+	void Place(const FIntRect& Rect);
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	// of the page area, how much is taken
+	float GetOccupancy() const { return (float)UsedArea / (Width * Height); }
+
+private:
+	bool FindPosition(int32 RectWidth, int32 RectHeight, FIntRect& OutRect) const;
+	void SplitFreeRects(const FIntRect& Used);
+	void PruneFreeRects();
+
+	int32 Width;
+	int32 Height;
+	int64 UsedArea = 0;
+
+	TArray<FIntRect> FreeRects;
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawPcxFactory.h"
+#include "ClawPcx.h"
+#include "Engine/Texture2D.h"
+#include "Editor.h"
+#include "Subsystems/ImportSubsystem.h"
+#include "HAL/FileManager.h"
+
+UClawPcxFactory::UClawPcxFactory()
+{
+	SupportedClass = UTexture2D::StaticClass();
+	Formats.Add(TEXT("pcx;PCX Image"));
+
+	bCreateNew = false;
+	bEditorImport = true;
+}
+
+bool UClawPcxFactory::FactoryCanImport(const FString& Filename)
+{
+	// only the header is needed to tell
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Filename));
+	uint8 Header[129];
+	if (!Reader || Reader->TotalSize() < (int64)sizeof(Header))
+	{
+		return false;
+	}
+
+	Reader->Serialize(Header, sizeof(Header));
+	return ClawPcx::IsPcx(Header, sizeof(Header));
+}
+
+UObject* UClawPcxFactory::FactoryCreateBinary(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const uint8*& Buffer, const uint8* BufferEnd, FFeedbackContext* Warn)
+{
+	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPreImport(this, InClass, InParent, InName, Type);
+
+	FClawPcxImage Image;
+	FString Error;
+	if (!ClawPcx::Decode(Buffer, BufferEnd - Buffer, Image, &Error))
+	{
+		Warn->Logf(ELogVerbosity::Error, TEXT("Couldn't import %s: %s."), *InName.ToString(), *Error);
+		GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPostImport(this, nullptr);
+		return nullptr;
+	}
+
+	UTexture2D* Texture = NewObject<UTexture2D>(InParent, InName, Flags);
+	Texture->Source.Init(Image.Width, Image.Height, 1, 1, TSF_BGRA8, reinterpret_cast<const uint8*>(Image.Pixels.GetData()));
+
+	// the images are pixel art shown at their size
+	Texture->Filter = TF_Nearest;
+	Texture->LODGroup = TEXTUREGROUP_UI;
+	Texture->MipGenSettings = TMGS_NoMipmaps;
+	Texture->PostEditChange();
+
+	GEditor->GetEditorSubsystem<UImportSubsystem>()->BroadcastAssetPostImport(this, Texture);
+
+	return Texture;
+}
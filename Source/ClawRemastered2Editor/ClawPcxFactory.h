@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Factories/Factory.h"
+#include "ClawPcxFactory.generated.h"
+
+/**
+ * Imports the PCX images of the original games as textures.
+ */
+UCLASS()
+class CLAWREMASTERED2EDITOR_API UClawPcxFactory : public UFactory
+{
+	GENERATED_BODY()
+
+public:
+	UClawPcxFactory();
+
+	// UFactory interface
+	virtual bool FactoryCanImport(const FString& Filename) override;
+	virtual UObject* FactoryCreateBinary(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const uint8*& Buffer, const uint8* BufferEnd, FFeedbackContext* Warn) override;
+};
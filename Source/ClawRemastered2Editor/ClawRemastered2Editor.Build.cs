@@ -0,0 +1,15 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class ClawRemastered2Editor : ModuleRules
+{
+	public ClawRemastered2Editor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "UnrealEd", "ClawRemastered2" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "AssetRegistry", "ImageWrapper", "Paper2D" });
+	}
+}
@@ -0,0 +1,6 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+// editor only importers and packers for the assets of the original games
+IMPLEMENT_MODULE(FDefaultModuleImpl, ClawRemastered2Editor);
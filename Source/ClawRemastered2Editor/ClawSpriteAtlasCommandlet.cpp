@@ -0,0 +1,716 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClawSpriteAtlasCommandlet.h"
+#include "ClawRemastered2.h"
+#include "ClawMaxRects.h"
+#include "AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Texture2D.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "ObjectTools.h"
+#include "PaperSprite.h"
+#include "SpriteEditorOnlyTypes.h"
+#include "UObject/Package.h"
+
+namespace
+{
+	const TCHAR* const ManifestVersion = TEXT("version\t1");
+
+	struct FPackOptions
+	{
+		FString SourceDir;
+		FString CacheDir;
+		FString ContentPath;
+
+		// pages start at MinPageSize and grow in powers of two up to MaxPageSize
+		int32 MinPageSize = 256;
+		int32 MaxPageSize = 2048;
+
+		// transparent pixels right and below every frame, so filtering doesn't bleed between them
+		int32 Padding = 2;
+
+		bool bForce = false;
+	};
+
+	// one png of a group, and the part of a page its opaque pixels went to
+	struct FAtlasFrame
+	{
+		// relative to the folder of the group
+		FString Path;
+
+		uint64 FileHash = 0;
+
+		// of the trimmed pixels, the frames that share it share their region
+		uint64 PixelHash = 0;
+
+		FIntPoint SourceSize = FIntPoint::ZeroValue;
+
+		// the opaque part of the source image
+		FIntRect Trim;
+
+		int32 Page = INDEX_NONE;
+		FIntPoint Position = FIntPoint::ZeroValue;
+
+		// only decoded for frames that changed since the last run
+		TArray<FColor> Pixels;
+
+		bool bChanged = false;
+		bool bValid = true;
+
+		// the first frame of new pixels, the one drawn into the region
+		bool bDrawsRegion = false;
+	};
+
+	struct FAtlasRegion
+	{
+		int32 Page = INDEX_NONE;
+		FIntPoint Position = FIntPoint::ZeroValue;
+		FIntPoint Size = FIntPoint::ZeroValue;
+	};
+
+	struct FAtlasPage
+	{
+		int32 Size = 0;
+		TUniquePtr<FClawMaxRectsBin> Bin;
+		TArray<FColor> Pixels;
+		bool bDirty = false;
+	};
+
+	// what the last run wrote
+	struct FAtlasManifest
+	{
+		TArray<int32> PageSizes;
+		TMap<FString, FAtlasFrame> Frames;
+	};
+
+	struct FGroupReport
+	{
+		int32 NumFrames = 0;
+		int32 NumUnique = 0;
+		int32 NumPages = 0;
+		int32 NumChanged = 0;
+		int32 NumDirtyPages = 0;
+		int32 NumFailed = 0;
+		int64 LooseBytes = 0;
+		int64 AtlasBytes = 0;
+		double Seconds = 0.0;
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// images
+
+	bool LoadPng(const FString& Filename, const TArray<uint8>& Compressed, FIntPoint& OutSize, TArray<FColor>& OutPixels)
+	{
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+
+		TArray<uint8> Raw;
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(Compressed.GetData(), Compressed.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Raw))
+		{
+			return false;
+		}
+
+		OutSize = FIntPoint(ImageWrapper->GetWidth(), ImageWrapper->GetHeight());
+		OutPixels.SetNumUninitialized(OutSize.X * OutSize.Y);
+		FMemory::Memcpy(OutPixels.GetData(), Raw.GetData(), Raw.Num());
+		return true;
+	}
+
+	bool SavePng(const FString& Filename, int32 Size, const TArray<FColor>& Pixels)
+	{
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num() * sizeof(FColor), Size, Size, ERGBFormat::BGRA, 8))
+		{
+			return false;
+		}
+
+		return FFileHelper::SaveArrayToFile(ImageWrapper->GetCompressed(), *Filename);
+	}
+
+	// the smallest rectangle around the pixels that aren't fully transparent
+	FIntRect FindOpaqueBounds(const TArray<FColor>& Pixels, FIntPoint Size)
+	{
+		FIntRect Bounds(Size, FIntPoint::ZeroValue);
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			const FColor* Row = Pixels.GetData() + Y * Size.X;
+			for (int32 X = 0; X < Size.X; ++X)
+			{
+				if (Row[X].A != 0)
+				{
+					Bounds.Min = Bounds.Min.ComponentMin(FIntPoint(X, Y));
+					Bounds.Max = Bounds.Max.ComponentMax(FIntPoint(X + 1, Y + 1));
+				}
+			}
+		}
+
+		// an empty frame keeps one transparent pixel
+		return Bounds.Min.X < Bounds.Max.X ? Bounds : FIntRect(0, 0, 1, 1);
+	}
+
+	void CopyRect(const FColor* Source, int32 SourceStride, FColor* Dest, int32 DestStride, FIntPoint Size)
+	{
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			FMemory::Memcpy(Dest + Y * DestStride, Source + Y * SourceStride, Size.X * sizeof(FColor));
+		}
+	}
+
+	// decodes the file and keeps its trimmed pixels
+	bool DecodeFrame(const FString& Filename, const TArray<uint8>& Compressed, FAtlasFrame& Frame)
+	{
+		TArray<FColor> Pixels;
+		if (!LoadPng(Filename, Compressed, Frame.SourceSize, Pixels))
+		{
+			return false;
+		}
+
+		Frame.Trim = FindOpaqueBounds(Pixels, Frame.SourceSize);
+
+		const FIntPoint TrimSize = Frame.Trim.Size();
+		Frame.Pixels.SetNumUninitialized(TrimSize.X * TrimSize.Y);
+		CopyRect(Pixels.GetData() + Frame.Trim.Min.Y * Frame.SourceSize.X + Frame.Trim.Min.X, Frame.SourceSize.X, Frame.Pixels.GetData(), TrimSize.X, TrimSize);
+
+		// the size goes into the seed, or a 2x1 and a 1x2 frame of the same pixels would match
+		const uint64 Seed = ((uint64)TrimSize.X << 32) | (uint32)TrimSize.Y;
+		Frame.PixelHash = CityHash64WithSeed(reinterpret_cast<const char*>(Frame.Pixels.GetData()), Frame.Pixels.Num() * sizeof(FColor), Seed);
+		return true;
+	}
+
+	// reuses what the manifest knows of the file when it didn't change
+	void LoadFrame(const FString& Filename, const FAtlasFrame* Cached, FAtlasFrame& Frame)
+	{
+		TArray<uint8> Compressed;
+		if (!FFileHelper::LoadFileToArray(Compressed, *Filename))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't read %s."), *Filename);
+			Frame.bValid = false;
+			return;
+		}
+
+		Frame.FileHash = CityHash64(reinterpret_cast<const char*>(Compressed.GetData()), Compressed.Num());
+		if (Cached && Cached->FileHash == Frame.FileHash)
+		{
+			Frame.PixelHash = Cached->PixelHash;
+			Frame.SourceSize = Cached->SourceSize;
+			Frame.Trim = Cached->Trim;
+			Frame.Page = Cached->Page;
+			Frame.Position = Cached->Position;
+			return;
+		}
+
+		Frame.bChanged = true;
+		if (!DecodeFrame(Filename, Compressed, Frame))
+		{
+			UE_LOG(LogClaw, Error, TEXT("Couldn't decode %s."), *Filename);
+			Frame.bValid = false;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// manifest
+
+	// a "page<TAB>size" line per page, then a tab separated "frame" line per frame
+	void LoadManifest(const FString& Filename, FAtlasManifest& OutManifest)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *Filename) || Lines.Num() == 0 || Lines[0] != ManifestVersion)
+		{
+			return;
+		}
+
+		for (const FString& Line : Lines)
+		{
+			TArray<FString> Fields;
+			Line.ParseIntoArray(Fields, TEXT("\t"));
+
+			if (Fields.Num() == 2 && Fields[0] == TEXT("page"))
+			{
+				OutManifest.PageSizes.Add(FCString::Atoi(*Fields[1]));
+			}
+			else if (Fields.Num() == 13 && Fields[0] == TEXT("frame"))
+			{
+				FAtlasFrame Frame;
+				Frame.Path = Fields[1];
+				Frame.FileHash = FCString::Strtoui64(*Fields[2], nullptr, 16);
+				Frame.PixelHash = FCString::Strtoui64(*Fields[3], nullptr, 16);
+				Frame.SourceSize = FIntPoint(FCString::Atoi(*Fields[4]), FCString::Atoi(*Fields[5]));
+				Frame.Trim = FIntRect(FCString::Atoi(*Fields[6]), FCString::Atoi(*Fields[7]), FCString::Atoi(*Fields[8]), FCString::Atoi(*Fields[9]));
+				Frame.Page = FCString::Atoi(*Fields[10]);
+				Frame.Position = FIntPoint(FCString::Atoi(*Fields[11]), FCString::Atoi(*Fields[12]));
+				OutManifest.Frames.Add(Frame.Path, MoveTemp(Frame));
+			}
+		}
+	}
+
+	void SaveManifest(const FString& Filename, const TArray<FAtlasPage>& Pages, const TArray<FAtlasFrame>& Frames)
+	{
+		FString Text = FString(ManifestVersion) + TEXT("\n");
+		for (const FAtlasPage& Page : Pages)
+		{
+			Text += FString::Printf(TEXT("page\t%d\n"), Page.Size);
+		}
+		for (const FAtlasFrame& Frame : Frames)
+		{
+			Text += FString::Printf(TEXT("frame\t%s\t%016llx\t%016llx\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n"),
+				*Frame.Path, Frame.FileHash, Frame.PixelHash, Frame.SourceSize.X, Frame.SourceSize.Y,
+				Frame.Trim.Min.X, Frame.Trim.Min.Y, Frame.Trim.Max.X, Frame.Trim.Max.Y, Frame.Page, Frame.Position.X, Frame.Position.Y);
+		}
+		FFileHelper::SaveStringToFile(Text, *Filename);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// assets
+
+	template<typename AssetType>
+	AssetType* FindOrCreateAsset(const FString& PackageName)
+	{
+		const FString AssetName = FPackageName::GetLongPackageAssetName(PackageName);
+
+		UPackage* Package = FPackageName::DoesPackageExist(PackageName) ? LoadPackage(nullptr, *PackageName, LOAD_None) : nullptr;
+		if (!Package)
+		{
+			Package = CreatePackage(*PackageName);
+		}
+
+		AssetType* Asset = FindObject<AssetType>(Package, *AssetName);
+		if (!Asset)
+		{
+			Asset = NewObject<AssetType>(Package, *AssetName, RF_Public | RF_Standalone);
+			FAssetRegistryModule::AssetCreated(Asset);
+		}
+		return Asset;
+	}
+
+	bool SaveAsset(UObject* Asset)
+	{
+		UPackage* Package = Asset->GetOutermost();
+		Package->MarkPackageDirty();
+
+		const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+		return UPackage::SavePackage(Package, Asset, RF_Public | RF_Standalone, *Filename);
+	}
+
+	UTexture2D* WritePageTexture(const FString& PackageName, const FAtlasPage& Page)
+	{
+		UTexture2D* Texture = FindOrCreateAsset<UTexture2D>(PackageName);
+		Texture->Source.Init(Page.Size, Page.Size, 1, 1, TSF_BGRA8, reinterpret_cast<const uint8*>(Page.Pixels.GetData()));
+
+		// the settings Paper2D gives the sprite textures it imports
+		Texture->Filter = TF_Nearest;
+		Texture->LODGroup = TEXTUREGROUP_Pixels2D;
+		Texture->CompressionSettings = TC_EditorIcon;
+		Texture->MipGenSettings = TMGS_NoMipmaps;
+		Texture->PostEditChange();
+
+		return SaveAsset(Texture) ? Texture : nullptr;
+	}
+
+	bool WriteSprite(const FString& PackageName, UTexture2D* PageTexture, const FAtlasFrame& Frame)
+	{
+		UPaperSprite* Sprite = FindOrCreateAsset<UPaperSprite>(PackageName);
+
+		FSpriteAssetInitParameters InitParams;
+		InitParams.Texture = PageTexture;
+		InitParams.Offset = Frame.Position;
+		InitParams.Dimension = Frame.Trim.Size();
+		Sprite->InitializeSprite(InitParams);
+
+		// where the center of the untrimmed frame is, so the trimmed frames still line up
+		const FVector2D Pivot = FVector2D(Frame.Position - Frame.Trim.Min) + FVector2D(Frame.SourceSize) * 0.5f;
+		Sprite->SetPivotMode(ESpritePivotMode::Custom, Pivot);
+		Sprite->PostEditChange();
+
+		return SaveAsset(Sprite);
+	}
+
+	FString GetSpriteName(const FString& Path)
+	{
+		return ObjectTools::SanitizeObjectName(FPaths::ChangeExtension(Path, TEXT("")).Replace(TEXT("/"), TEXT("_")));
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// packing
+
+	int32 ChoosePageSize(int64 Area, int32 LargestSide, const FPackOptions& Options)
+	{
+		// some slack, MaxRects rarely gets a page completely full
+		const int64 PackedArea = Area + Area / 8;
+
+		int32 Size = Options.MinPageSize;
+		while (Size < Options.MaxPageSize && ((int64)Size * Size < PackedArea || Size < LargestSide))
+		{
+			Size *= 2;
+		}
+		return Size;
+	}
+
+	FGroupReport PackGroup(const FString& Group, const FString& GroupDir, const FPackOptions& Options)
+	{
+		FGroupReport Report;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		TArray<FString> Files;
+		IFileManager::Get().FindFilesRecursive(Files, *GroupDir, TEXT("*.png"), true, false);
+		Files.Sort();
+
+		const FString ManifestPath = Options.CacheDir / Group + TEXT(".txt");
+		FAtlasManifest Manifest;
+		if (!Options.bForce)
+		{
+			LoadManifest(ManifestPath, Manifest);
+		}
+
+		TArray<FAtlasFrame> Frames;
+		Frames.SetNum(Files.Num());
+		ParallelFor(Files.Num(), [&](int32 Index)
+		{
+			FAtlasFrame& Frame = Frames[Index];
+			Frame.Path = Files[Index];
+			FPaths::MakePathRelativeTo(Frame.Path, *(GroupDir + TEXT("/")));
+
+			LoadFrame(Files[Index], Manifest.Frames.Find(Frame.Path), Frame);
+		});
+
+		Report.NumFailed = Frames.RemoveAll([](const FAtlasFrame& Frame) { return !Frame.bValid; });
+
+		bool bAnyChanged = Frames.Num() != Manifest.Frames.Num();
+		for (const FAtlasFrame& Frame : Frames)
+		{
+			bAnyChanged |= Frame.bChanged;
+			Report.NumChanged += Frame.bChanged ? 1 : 0;
+		}
+
+		// the regions of the unchanged frames stay where they are
+		TMap<uint64, FAtlasRegion> Regions;
+		for (const FAtlasFrame& Frame : Frames)
+		{
+			if (!Frame.bChanged)
+			{
+				Regions.Add(Frame.PixelHash, { Frame.Page, Frame.Position, Frame.Trim.Size() });
+			}
+		}
+
+		TArray<FAtlasPage> Pages;
+		for (int32 PageSize : Manifest.PageSizes)
+		{
+			FAtlasPage& Page = Pages.AddDefaulted_GetRef();
+			Page.Size = PageSize;
+			Page.Bin = MakeUnique<FClawMaxRectsBin>(PageSize, PageSize);
+		}
+		for (const TPair<uint64, FAtlasRegion>& Region : Regions)
+		{
+			const FAtlasRegion& Kept = Region.Value;
+			Pages[Kept.Page].Bin->Place(FIntRect(Kept.Position, Kept.Position + Kept.Size + FIntPoint(Options.Padding, Options.Padding)));
+		}
+
+		// regions nothing uses anymore are cleared, their space goes to the new frames
+		TArray<TPair<int32, FIntRect>> FreedRects;
+		TSet<uint64> FreedHashes;
+		for (const TPair<FString, FAtlasFrame>& Old : Manifest.Frames)
+		{
+			const FAtlasFrame& Frame = Old.Value;
+			if (!Regions.Contains(Frame.PixelHash) && !FreedHashes.Contains(Frame.PixelHash) && Pages.IsValidIndex(Frame.Page))
+			{
+				FreedHashes.Add(Frame.PixelHash);
+				FreedRects.Emplace(Frame.Page, FIntRect(Frame.Position, Frame.Position + Frame.Trim.Size()));
+				Pages[Frame.Page].bDirty = true;
+			}
+		}
+
+		// the frames that bring pixels no region has yet, tallest first
+		TMap<uint64, int32> NewRegionFrames;
+		for (int32 Index = 0; Index < Frames.Num(); ++Index)
+		{
+			if (Frames[Index].bChanged && !Regions.Contains(Frames[Index].PixelHash))
+			{
+				NewRegionFrames.FindOrAdd(Frames[Index].PixelHash, Index);
+			}
+		}
+
+		TArray<int32> ToPlace;
+		NewRegionFrames.GenerateValueArray(ToPlace);
+		ToPlace.Sort([&Frames](int32 A, int32 B)
+		{
+			const FIntPoint SizeA = Frames[A].Trim.Size();
+			const FIntPoint SizeB = Frames[B].Trim.Size();
+			return SizeA.Y != SizeB.Y ? SizeA.Y > SizeB.Y : SizeA.X > SizeB.X;
+		});
+
+		int64 RemainingArea = 0;
+		for (int32 Index : ToPlace)
+		{
+			const FIntPoint Size = Frames[Index].Trim.Size() + FIntPoint(Options.Padding, Options.Padding);
+			RemainingArea += (int64)Size.X * Size.Y;
+		}
+
+		for (int32 Index : ToPlace)
+		{
+			FAtlasFrame& Frame = Frames[Index];
+			const FIntPoint Size = Frame.Trim.Size() + FIntPoint(Options.Padding, Options.Padding);
+			RemainingArea -= (int64)Size.X * Size.Y;
+
+			if (Size.X > Options.MaxPageSize || Size.Y > Options.MaxPageSize)
+			{
+				UE_LOG(LogClaw, Error, TEXT("%s: %s doesn't fit on a %d page."), *Group, *Frame.Path, Options.MaxPageSize);
+				continue;
+			}
+
+			FIntRect Rect;
+			int32 PageIndex = 0;
+			while (PageIndex < Pages.Num() && !Pages[PageIndex].Bin->Insert(Size.X, Size.Y, Rect))
+			{
+				++PageIndex;
+			}
+
+			if (PageIndex == Pages.Num())
+			{
+				FAtlasPage& Page = Pages.AddDefaulted_GetRef();
+				Page.Size = ChoosePageSize(RemainingArea + (int64)Size.X * Size.Y, FMath::Max(Size.X, Size.Y), Options);
+				Page.Bin = MakeUnique<FClawMaxRectsBin>(Page.Size, Page.Size);
+				Page.Bin->Insert(Size.X, Size.Y, Rect);
+			}
+
+			Pages[PageIndex].bDirty = true;
+			Frame.bDrawsRegion = true;
+			Regions.Add(Frame.PixelHash, { PageIndex, Rect.Min, Frame.Trim.Size() });
+		}
+
+		for (FAtlasFrame& Frame : Frames)
+		{
+			if (const FAtlasRegion* Region = Regions.Find(Frame.PixelHash))
+			{
+				Frame.Page = Region->Page;
+				Frame.Position = Region->Position;
+			}
+			else
+			{
+				Frame.bValid = false;
+			}
+		}
+		Report.NumFailed += Frames.RemoveAll([](const FAtlasFrame& Frame) { return !Frame.bValid; });
+
+		const FString GroupPath = Options.ContentPath / Group;
+		TArray<UTexture2D*> PageTextures;
+		PageTextures.SetNumZeroed(Pages.Num());
+
+		for (int32 PageIndex = 0; PageIndex < Pages.Num(); ++PageIndex)
+		{
+			FAtlasPage& Page = Pages[PageIndex];
+			const FString PageName = FString::Printf(TEXT("%s_Page%d"), *Group, PageIndex);
+
+			if (!Page.bDirty)
+			{
+				continue;
+			}
+			++Report.NumDirtyPages;
+
+			// start from what the last run wrote, or redraw every frame on the page when that's gone
+			const FString CachedPage = Options.CacheDir / PageName + TEXT(".png");
+			TArray<uint8> Compressed;
+			FIntPoint CachedSize;
+			const bool bCached = PageIndex < Manifest.PageSizes.Num() && FFileHelper::LoadFileToArray(Compressed, *CachedPage, FILEREAD_Silent)
+				&& LoadPng(CachedPage, Compressed, CachedSize, Page.Pixels) && CachedSize == FIntPoint(Page.Size, Page.Size);
+			if (!bCached)
+			{
+				Page.Pixels.Init(FColor(0, 0, 0, 0), Page.Size * Page.Size);
+			}
+
+			for (const TPair<int32, FIntRect>& Freed : FreedRects)
+			{
+				if (bCached && Freed.Key == PageIndex)
+				{
+					for (int32 Y = Freed.Value.Min.Y; Y < Freed.Value.Max.Y; ++Y)
+					{
+						FMemory::Memzero(Page.Pixels.GetData() + Y * Page.Size + Freed.Value.Min.X, Freed.Value.Width() * sizeof(FColor));
+					}
+				}
+			}
+
+			TSet<uint64> Drawn;
+			for (FAtlasFrame& Frame : Frames)
+			{
+				if (Frame.Page != PageIndex || (bCached && !Frame.bDrawsRegion) || Drawn.Contains(Frame.PixelHash))
+				{
+					continue;
+				}
+
+				if (Frame.Pixels.Num() == 0)
+				{
+					const FString Filename = GroupDir / Frame.Path;
+					if (!FFileHelper::LoadFileToArray(Compressed, *Filename) || !DecodeFrame(Filename, Compressed, Frame))
+					{
+						UE_LOG(LogClaw, Error, TEXT("%s: couldn't redraw %s."), *Group, *Frame.Path);
+						continue;
+					}
+				}
+
+				Drawn.Add(Frame.PixelHash);
+				CopyRect(Frame.Pixels.GetData(), Frame.Trim.Width(), Page.Pixels.GetData() + Frame.Position.Y * Page.Size + Frame.Position.X, Page.Size, Frame.Trim.Size());
+			}
+
+			if (!SavePng(CachedPage, Page.Size, Page.Pixels))
+			{
+				UE_LOG(LogClaw, Error, TEXT("%s: couldn't write %s."), *Group, *CachedPage);
+			}
+
+			PageTextures[PageIndex] = WritePageTexture(GroupPath / PageName, Page);
+			if (!PageTextures[PageIndex])
+			{
+				UE_LOG(LogClaw, Error, TEXT("%s: couldn't save %s."), *Group, *PageName);
+				++Report.NumFailed;
+			}
+			Page.Pixels.Empty();
+		}
+
+		// the sprites of the frames that didn't change still point at the right place
+		for (const FAtlasFrame& Frame : Frames)
+		{
+			if (!Frame.bChanged)
+			{
+				continue;
+			}
+
+			UTexture2D*& PageTexture = PageTextures[Frame.Page];
+			if (!PageTexture)
+			{
+				const FString PageName = FString::Printf(TEXT("%s_Page%d"), *Group, Frame.Page);
+				PageTexture = LoadObject<UTexture2D>(nullptr, *(GroupPath / PageName + TEXT(".") + PageName));
+			}
+
+			if (!PageTexture || !WriteSprite(GroupPath / TEXT("Sprites") / GetSpriteName(Frame.Path), PageTexture, Frame))
+			{
+				UE_LOG(LogClaw, Error, TEXT("%s: couldn't save the sprite of %s."), *Group, *Frame.Path);
+				++Report.NumFailed;
+			}
+		}
+
+		int32 NumStale = 0;
+		for (const TPair<FString, FAtlasFrame>& Old : Manifest.Frames)
+		{
+			NumStale += Frames.ContainsByPredicate([&Old](const FAtlasFrame& Frame) { return Frame.Path == Old.Key; }) ? 0 : 1;
+		}
+		if (NumStale > 0)
+		{
+			UE_LOG(LogClaw, Warning, TEXT("%s: %d sprites have no source frame anymore, they're left in %s/Sprites."), *Group, NumStale, *GroupPath);
+		}
+
+		if (bAnyChanged)
+		{
+			SaveManifest(ManifestPath, Pages, Frames);
+		}
+
+		Report.NumFrames = Frames.Num();
+		Report.NumUnique = Regions.Num();
+		Report.NumPages = Pages.Num();
+		for (const FAtlasFrame& Frame : Frames)
+		{
+			Report.LooseBytes += (int64)Frame.SourceSize.X * Frame.SourceSize.Y * sizeof(FColor);
+		}
+		for (const FAtlasPage& Page : Pages)
+		{
+			Report.AtlasBytes += (int64)Page.Size * Page.Size * sizeof(FColor);
+		}
+		Report.Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+		return Report;
+	}
+}
+
+UClawSpriteAtlasCommandlet::UClawSpriteAtlasCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClawSpriteAtlasCommandlet::Main(const FString& Params)
+{
+	FPackOptions Options;
+	Options.SourceDir = FPaths::ProjectDir() / TEXT("Claw_Assets");
+	FParse::Value(*Params, TEXT("Source="), Options.SourceDir);
+	FPaths::NormalizeDirectoryName(Options.SourceDir);
+
+	Options.ContentPath = TEXT("/Game/Atlases");
+	FParse::Value(*Params, TEXT("Path="), Options.ContentPath);
+
+	FParse::Value(*Params, TEXT("PageSize="), Options.MaxPageSize);
+	FParse::Value(*Params, TEXT("Padding="), Options.Padding);
+	Options.MaxPageSize = FMath::RoundUpToPowerOfTwo(FMath::Max(Options.MaxPageSize, Options.MinPageSize));
+	Options.Padding = FMath::Max(Options.Padding, 0);
+	Options.bForce = FParse::Param(*Params, TEXT("Force"));
+
+	Options.CacheDir = FPaths::ProjectSavedDir() / TEXT("ClawAtlases");
+	IFileManager::Get().MakeDirectory(*Options.CacheDir, true);
+
+	// Claw's own frames, then the images of every level
+	TArray<FString> Groups;
+	FString GroupList;
+	if (FParse::Value(*Params, TEXT("Groups="), GroupList, false))
+	{
+		GroupList.ParseIntoArray(Groups, TEXT(","));
+	}
+	else
+	{
+		Groups.Add(TEXT("Claw"));
+
+		TArray<FString> LevelDirs;
+		IFileManager::Get().FindFiles(LevelDirs, *(Options.SourceDir / TEXT("LEVEL*")), false, true);
+		LevelDirs.Sort([](const FString& A, const FString& B) { return FCString::Atoi(*A + 5) < FCString::Atoi(*B + 5); });
+		Groups.Append(LevelDirs);
+	}
+
+	// the module must be loaded on the game thread before the workers decode images
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	FGroupReport Total;
+	for (const FString& Group : Groups)
+	{
+		const FString GroupDir = Options.SourceDir / (Group == TEXT("Claw") ? FString(TEXT("Claw_Movements")) : Group / TEXT("IMAGES"));
+		if (!IFileManager::Get().DirectoryExists(*GroupDir))
+		{
+			UE_LOG(LogClaw, Error, TEXT("%s: there's no %s."), *Group, *GroupDir);
+			++Total.NumFailed;
+			continue;
+		}
+
+		const FGroupReport Report = PackGroup(Group, GroupDir, Options);
+
+		// every loose frame was a texture of its own, so a draw of its own
+		UE_LOG(LogClaw, Display, TEXT("%s: %d frames, %d unique, on %d pages; %d frames and %d pages rewritten, %.2f s. Draw calls %d -> %d, texture memory %.1f MB -> %.1f MB."),
+			*Group, Report.NumFrames, Report.NumUnique, Report.NumPages, Report.NumChanged, Report.NumDirtyPages, Report.Seconds,
+			Report.NumFrames, Report.NumPages, Report.LooseBytes / (1024.0 * 1024.0), Report.AtlasBytes / (1024.0 * 1024.0));
+
+		Total.NumFrames += Report.NumFrames;
+		Total.NumUnique += Report.NumUnique;
+		Total.NumPages += Report.NumPages;
+		Total.NumChanged += Report.NumChanged;
+		Total.NumFailed += Report.NumFailed;
+		Total.LooseBytes += Report.LooseBytes;
+		Total.AtlasBytes += Report.AtlasBytes;
+
+		// the sprites and pages of a group aren't needed by the next
+		CollectGarbage(RF_NoFlags);
+	}
+
+	const double Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	UE_LOG(LogClaw, Display, TEXT("Packed %d frames (%d unique, %d changed) of %d groups onto %d pages in %.2f s, %d failed. Draw calls %d -> %d, texture memory %.1f MB -> %.1f MB."),
+		Total.NumFrames, Total.NumUnique, Total.NumChanged, Groups.Num(), Total.NumPages, Seconds, Total.NumFailed,
+		Total.NumFrames, Total.NumPages, Total.LooseBytes / (1024.0 * 1024.0), Total.AtlasBytes / (1024.0 * 1024.0));
+
+	return Total.NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClawSpriteAtlasCommandlet.generated.h"
+
+/**
+ * Packs the loose sprite frames of Claw_Assets into atlas pages.
+ *
+ * Claw's frames in Claw_Movements get their own pages and every level gets the pages of
+ * its LEVELN/IMAGES. Frames are trimmed to their opaque pixels, identical frames are stored
+ * once, and the rest is packed with MaxRects into power of two pages under Path/Group. Each
+ * frame gets a sprite there whose source region points into its page, with the pivot where
+ * the center of the untrimmed frame was.
+ *
+ * A manifest in Saved/ClawAtlases remembers where every frame went. Later runs only decode
+ * the frames whose file changed, put them into the free space of the existing pages and
+ * rewrite the pages and sprites they touch.
+ *
+ * Usage: -run=ClawSpriteAtlas [-Groups=Claw,LEVEL1] [-Source=Dir] [-Path=/Game/Atlases] [-PageSize=2048] [-Padding=2] [-Force]
+ */
+UCLASS()
+class UClawSpriteAtlasCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClawSpriteAtlasCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+};